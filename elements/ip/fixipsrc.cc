@@ -53,10 +53,8 @@ FixIPSrc::fix_it(Packet *p_in)
                 ip->ip_src.s_addr,
                 _my_ip.s_addr);
 #endif
+  click_update_in_cksum32(&ip->ip_sum, ip->ip_src.s_addr, _my_ip.s_addr);
   ip->ip_src = _my_ip;
-  int hlen = ip->ip_hl << 2;
-  ip->ip_sum = 0;
-  ip->ip_sum = click_in_cksum((unsigned char *)ip, hlen);
   return p;
 }
 
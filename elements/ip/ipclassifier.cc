@@ -20,6 +20,7 @@
 #include "ipclassifier.hh"
 #include <click/glue.hh>
 #include <click/error.hh>
+#include <click/args.hh>
 #include <click/confparse.hh>
 #include <click/router.hh>
 CLICK_DECLS
@@ -35,6 +36,9 @@ IPClassifier::~IPClassifier()
 int
 IPClassifier::configure(Vector<String> &conf, ErrorHandler *errh)
 {
+    bool jit = false;
+    if (Args(this, errh).bind(conf).read("JIT", jit).consume() < 0)
+	return -1;
     if (conf.size() != noutputs())
 	return errh->error("need %d arguments, one per output port", noutputs());
 
@@ -42,6 +46,8 @@ IPClassifier::configure(Vector<String> &conf, ErrorHandler *errh)
     Vector<String> new_conf;
     for (int i = 0; i < conf.size(); i++)
 	new_conf.push_back(String(i) + " " + conf[i]);
+    if (jit)
+	new_conf.push_back("JIT true");
     int r = IPFilter::configure(new_conf, errh);
     if (r >= 0 && !router()->initialized())
 	_zprog.warn_unused_outputs(noutputs(), errh);
@@ -198,6 +198,9 @@ Every IPClassifier element has an equivalent corresponding IPFilter element
 and vice versa. Use the element whose syntax is more convenient for your
 needs.
 
+IPClassifier also accepts IPFilter's JIT keyword argument, which compiles the
+program into native code where supported.
+
 =e
 
 For example,
@@ -228,6 +231,9 @@ is using to classify packets. At each step in the program, four bytes
 of packet data are ANDed with a mask and compared against four bytes of
 classifier pattern.
 
+=h jit read-only
+Returns true iff IPClassifier is running native code for its program.
+
 =h pattern0 rw
 Returns or sets the element's pattern 0. There are as many C<pattern>
 handlers as there are output ports.
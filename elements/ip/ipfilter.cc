@@ -1294,10 +1294,28 @@ IPFilter::parse_program(Classification::Wordwise::CompressedProgram &zprog,
 int
 IPFilter::configure(Vector<String> &conf, ErrorHandler *errh)
 {
+    // Remove the JIT keyword before the patterns are parsed.
+    bool jit = false;
+    if (Args(this, errh).bind(conf).read("JIT", jit).consume() < 0)
+	return -1;
+    if (jit && !Classification::Wordwise::JITProgram::available()) {
+	errh->warning("JIT not supported on this platform, interpreting");
+	jit = false;
+    }
+
     IPFilterProgram zprog;
     parse_program(zprog, conf, noutputs(), this, errh);
     if (!errh->nerrors()) {
 	_zprog = zprog;
+	static const int segments[] = { offset_mac, offset_net, offset_transp };
+	// Programs that output everything are never compiled, since they
+	// never run.
+	if (!jit)
+	    _jit.clear();
+	else if (!_jit.compile(_zprog, segments, 3,
+			       String(class_name()) + "@" + name())
+		 && _zprog.output_everything() < 0)
+	    errh->warning("JIT compilation failed, interpreting");
 	return 0;
     } else
 	return -1;
@@ -1310,10 +1328,18 @@ IPFilter::program_string(Element *e, void *)
     return ipf->_zprog.unparse();
 }
 
+String
+IPFilter::read_jit(Element *e, void *)
+{
+    IPFilter *ipf = static_cast<IPFilter *>(e);
+    return String(ipf->_jit.compiled());
+}
+
 void
 IPFilter::add_handlers()
 {
     add_read_handler("program", program_string);
+    add_read_handler("jit", read_jit);
 }
 
 
@@ -1386,10 +1412,87 @@ IPFilter::length_checked_match(const IPFilterProgram &zprog, const Packet *p,
     }
 }
 
+/** @brief Classify @a n packets at once.
+ * @param zprog program
+ * @param p packets
+ * @param n number of packets, at most Classification::batch_width
+ * @param[out] outputs output port for each packet
+ *
+ * The result for each packet equals match(@a zprog, @a p[i]).  The packets
+ * are run through the program in lockstep, so that their header loads
+ * overlap. */
+void
+IPFilter::match_batch(const IPFilterProgram &zprog, const Packet * const *p,
+		      int n, int *outputs)
+{
+    assert(n <= Classification::batch_width);
+    if (zprog.output_everything() >= 0) {
+	for (int i = 0; i < n; ++i)
+	    outputs[i] = zprog.output_everything();
+	return;
+    }
+
+    const uint32_t *pr[Classification::batch_width];
+    int lane[Classification::batch_width], nlive = 0;
+    for (int i = 0; i < n; ++i) {
+	int packet_length = classified_length(p[i]);
+	if (packet_length < (int) zprog.safe_length())
+	    outputs[i] = length_checked_match(zprog, p[i], packet_length);
+	else {
+	    pr[i] = zprog.begin();
+	    lane[nlive++] = i;
+	}
+    }
+
+    // One step of every live packet per round.
+    while (nlive) {
+	int j = 0;
+	for (int k = 0; k < nlive; ++k) {
+	    int i = lane[k];
+	    int off = step(pr[i], p[i]->mac_header() - 2,
+			   p[i]->network_header(), p[i]->transport_header());
+	    if (off > 0) {
+		pr[i] += off;
+		lane[j++] = i;
+	    } else
+		outputs[i] = -off;
+	}
+	nlive = j;
+    }
+}
+
 void
 IPFilter::push(int, Packet *p)
 {
-    checked_output_push(match(_zprog, p), p);
+    checked_output_push(match(_zprog, p, &_jit), p);
+}
+
+void
+IPFilter::push_batch(int, PacketBatch &batch)
+{
+    // Emit each run of consecutive packets bound for the same output as one
+    // batch, as Classifier does.
+    PacketBatch run;
+    int run_port = -1;
+    Packet *p[Classification::batch_width];
+    int port[Classification::batch_width];
+    while (!batch.empty()) {
+	int n = 0;
+	while (n < Classification::batch_width && !batch.empty())
+	    p[n++] = batch.pop_front();
+	if (_jit.compiled())
+	    for (int i = 0; i < n; ++i)
+		port[i] = match(_zprog, p[i], &_jit);
+	else
+	    match_batch(_zprog, p, n, port);
+	for (int i = 0; i < n; ++i) {
+	    if (port[i] != run_port && !run.empty())
+		checked_output_push_batch(run_port, run);
+	    run_port = port[i];
+	    run.append(p[i]);
+	}
+    }
+    checked_output_push_batch(run_port, run);
 }
 
 CLICK_ENDDECLS
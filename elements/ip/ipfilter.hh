@@ -31,12 +31,34 @@ The IPFilter element has an arbitrary number of outputs. Input packets must
 have their IP header annotation set; CheckIPHeader and MarkIPHeader do
 this.
 
+Keyword arguments are:
+
+=over 8
+
+=item JIT
+
+Boolean. If true, IPFilter translates its program into native machine code
+whenever it is configured or reconfigured, which avoids the interpreter's
+per-test dispatch. Only x86-64 user-level drivers support this; elsewhere,
+IPFilter warns and keeps interpreting. If the CLICK_PERF_MAP environment
+variable is set, compiled programs are listed in F</tmp/perf-PID.map> so that
+perf(1) can attribute samples to them. Default is false.
+
+=back
+
 =n
 
 Every IPFilter element has an equivalent corresponding IPClassifier element
 and vice versa. Use the element whose syntax is more convenient for your
 needs.
 
+IPFilter and IPClassifier classify the packets of a batch together, stepping
+through their programs for several packets at once so that the packets'
+header loads overlap. Packets pushed one at a time are classified at once.
+They are not held back to form batches, since that would delay every packet
+until a flush task or timer ran. To classify in batches, use a batching
+source, such as Unqueue with BATCH set.
+
 =e
 
 This large IPFilter implements the incoming packet filtering rules for the
@@ -102,6 +124,9 @@ is using to classify packets. At each step in the program, four bytes
 of packet data are ANDed with a mask and compared against four bytes of
 classifier pattern.
 
+=h jit read-only
+Returns true iff IPFilter is running native code for its program.
+
 =a
 
 IPClassifier, Classifier, CheckIPHeader, MarkIPHeader, CheckIPHeader2,
@@ -126,12 +151,16 @@ class IPFilter : public Element { public:
     void add_handlers() CLICK_COLD;
 
     void push(int port, Packet *);
+    void push_batch(int port, PacketBatch &batch);
 
     typedef Classification::Wordwise::CompressedProgram IPFilterProgram;
     static void parse_program(IPFilterProgram &zprog,
 			      const Vector<String> &conf, int noutputs,
 			      const Element *context, ErrorHandler *errh);
-    static inline int match(const IPFilterProgram &zprog, const Packet *p);
+    static inline int match(const IPFilterProgram &zprog, const Packet *p,
+			    const Classification::Wordwise::JITProgram *jit = 0);
+    static void match_batch(const IPFilterProgram &zprog,
+			    const Packet * const *p, int n, int *outputs);
 
     enum {
 	TYPE_NONE	= 0,		// data types
@@ -253,6 +282,7 @@ class IPFilter : public Element { public:
   protected:
 
     IPFilterProgram _zprog;
+    Classification::Wordwise::JITProgram _jit;
 
   private:
 
@@ -293,10 +323,15 @@ class IPFilter : public Element { public:
 	int parse_test(int pos, bool negated);
     };
 
+    static inline int classified_length(const Packet *p);
+    static inline int step(const uint32_t *pr, const unsigned char *mac_data,
+			   const unsigned char *neth_data,
+			   const unsigned char *transph_data);
     static int length_checked_match(const IPFilterProgram &zprog,
 				    const Packet *p, int packet_length);
 
     static String program_string(Element *e, void *user_data);
+    static String read_jit(Element *e, void *user_data);
 
 };
 
@@ -318,8 +353,12 @@ IPFilter::Primitive::negation_is_simple() const
 	return _type == TYPE_HOST || (_type & TYPE_FIELD) || _type == TYPE_IPFRAG;
 }
 
+/** @brief Return @a p's length in program offsets.
+ *
+ * Program offsets below offset_net address the link header, those below
+ * offset_transp the network header, and the rest the transport header. */
 inline int
-IPFilter::match(const IPFilterProgram &zprog, const Packet *p)
+IPFilter::classified_length(const Packet *p)
 {
     int packet_length = p->network_length(),
 	network_header_length = p->network_header_length();
@@ -327,6 +366,50 @@ IPFilter::match(const IPFilterProgram &zprog, const Packet *p)
 	packet_length += offset_transp - network_header_length;
     else
 	packet_length += offset_net;
+    return packet_length;
+}
+
+/** @brief Run the program test at @a pr and return its jump. */
+inline int
+IPFilter::step(const uint32_t *pr, const unsigned char *mac_data,
+	       const unsigned char *neth_data,
+	       const unsigned char *transph_data)
+{
+    uint32_t data;
+    int off = (int16_t) pr[0];
+    if (off >= offset_transp)
+	data = *(const uint32_t *)(transph_data + off - offset_transp);
+    else if (off >= offset_net)
+	data = *(const uint32_t *)(neth_data + off - offset_net);
+    else
+	data = *(const uint32_t *)(mac_data + off);
+    data &= pr[3];
+    off = pr[0] >> 17;
+    const uint32_t *pp = pr + 4;
+    if (!PERFORM_BINARY_SEARCH || off < MIN_BINARY_SEARCH) {
+	for (; off; --off, ++pp)
+	    if (*pp == data)
+		return pr[2];
+    } else {
+	const uint32_t *px = pp + off;
+	while (pp < px) {
+	    const uint32_t *pm = pp + (px - pp) / 2;
+	    if (*pm == data)
+		return pr[2];
+	    else if (*pm < data)
+		pp = pm + 1;
+	    else
+		px = pm;
+	}
+    }
+    return pr[1];
+}
+
+inline int
+IPFilter::match(const IPFilterProgram &zprog, const Packet *p,
+		const Classification::Wordwise::JITProgram *jit)
+{
+    int packet_length = classified_length(p);
 
     if (zprog.output_everything() >= 0)
 	return zprog.output_everything();
@@ -334,44 +417,20 @@ IPFilter::match(const IPFilterProgram &zprog, const Packet *p)
 	// common case never checks packet length
 	return length_checked_match(zprog, p, packet_length);
 
+    if (jit && jit->compiled()) {
+	const unsigned char *bases[3] = {
+	    p->mac_header() - 2, p->network_header(), p->transport_header()
+	};
+	return jit->match(bases);
+    }
+
+    const unsigned char *mac_data = p->mac_header() - 2;
     const unsigned char *neth_data = p->network_header();
     const unsigned char *transph_data = p->transport_header();
 
     const uint32_t *pr = zprog.begin();
-    const uint32_t *pp;
-    uint32_t data;
     while (1) {
-	int off = (int16_t) pr[0];
-	if (off >= offset_transp)
-	    data = *(const uint32_t *)(transph_data + off - offset_transp);
-	else if (off >= offset_net)
-	    data = *(const uint32_t *)(neth_data + off - offset_net);
-	else
-	    data = *(const uint32_t *)(p->mac_header() - 2 + off);
-	data &= pr[3];
-	off = pr[0] >> 17;
-	pp = pr + 4;
-	if (!PERFORM_BINARY_SEARCH || off < MIN_BINARY_SEARCH) {
-	    for (; off; --off, ++pp)
-		if (*pp == data) {
-		    off = pr[2];
-		    goto gotit;
-		}
-	} else {
-	    const uint32_t *px = pp + off;
-	    while (pp < px) {
-		const uint32_t *pm = pp + (px - pp) / 2;
-		if (*pm == data) {
-		    off = pr[2];
-		    goto gotit;
-		} else if (*pm < data)
-		    pp = pm + 1;
-		else
-		    px = pm;
-	    }
-	}
-	off = pr[1];
-    gotit:
+	int off = step(pr, mac_data, neth_data, transph_data);
 	if (off <= 0)
 	    return -off;
 	pr += off;
@@ -23,6 +23,18 @@
 #include <click/error.hh>
 #include <click/straccum.hh>
 #include <click/standard/alignmentinfo.hh>
+#if CLICK_CLASSIFICATION_WORDWISE_JIT
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <unistd.h>
+# include <fcntl.h>
+# include <sys/mman.h>
+#endif
+#if CLICK_CLASSIFICATION_WORDWISE_AVX2
+# include <immintrin.h>
+# include <stddef.h>
+#endif
 CLICK_DECLS
 namespace Classification {
 namespace Wordwise {
@@ -1176,6 +1188,401 @@ Program::length_checked_match(const Packet *p)
     return -pos;
 }
 
+
+//
+// BATCH MATCHING
+//
+
+#if CLICK_CLASSIFICATION_WORDWISE_AVX2
+namespace {
+
+bool
+have_avx2()
+{
+    static int have = -1;
+    if (have < 0) {
+	__builtin_cpu_init();
+	have = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return have;
+}
+
+// Run @a insns over eight packets in vector lanes.  @a data holds each
+// packet's data pointer (already adjusted by the alignment offset); lanes
+// whose @a live_bits bit is clear are skipped.  Each live lane's output is
+// stored in @a outputs.
+__attribute__((target("avx2"))) void
+match_avx2(const Insn *insns, const unsigned char * const *data,
+	   unsigned live_bits, int *outputs)
+{
+    const char *ib = reinterpret_cast<const char *>(insns);
+    const int *i_offset = reinterpret_cast<const int *>(ib + offsetof(Insn, offset));
+    const int *i_mask = reinterpret_cast<const int *>(ib + offsetof(Insn, mask));
+    const int *i_value = reinterpret_cast<const int *>(ib + offsetof(Insn, value));
+    const int *i_no = reinterpret_cast<const int *>(ib + offsetof(Insn, j));
+    const int *i_yes = i_no + 1;
+
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i insn_size = _mm256_set1_epi32(sizeof(Insn));
+    const __m256i offset_mask = _mm256_set1_epi32(0xFFFF);
+    const __m256i lane_bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    __m256i live = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(live_bits), lane_bits), lane_bits);
+    __m256i data_lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data));
+    __m256i data_hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + 4));
+    __m256i pos = zero;
+
+    while (!_mm256_testz_si256(live, live)) {
+	// Gather each live lane's instruction.
+	__m256i idx = _mm256_mullo_epi32(pos, insn_size);
+	__m256i off = _mm256_mask_i32gather_epi32(zero, i_offset, idx, live, 1);
+	off = _mm256_and_si256(off, offset_mask);
+	__m256i mask = _mm256_mask_i32gather_epi32(zero, i_mask, idx, live, 1);
+	__m256i value = _mm256_mask_i32gather_epi32(zero, i_value, idx, live, 1);
+	__m256i no = _mm256_mask_i32gather_epi32(zero, i_no, idx, live, 1);
+	__m256i yes = _mm256_mask_i32gather_epi32(zero, i_yes, idx, live, 1);
+
+	// Gather the tested packet words, four 64-bit addresses at a time.
+	__m256i addr_lo = _mm256_add_epi64(data_lo, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(off)));
+	__m256i addr_hi = _mm256_add_epi64(data_hi, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(off, 1)));
+	__m128i word_lo = _mm256_mask_i64gather_epi32(_mm_setzero_si128(), (const int *) 0, addr_lo, _mm256_castsi256_si128(live), 1);
+	__m128i word_hi = _mm256_mask_i64gather_epi32(_mm_setzero_si128(), (const int *) 0, addr_hi, _mm256_extracti128_si256(live, 1), 1);
+	__m256i word = _mm256_inserti128_si256(_mm256_castsi128_si256(word_lo), word_hi, 1);
+
+	__m256i eq = _mm256_cmpeq_epi32(_mm256_and_si256(word, mask), value);
+	__m256i next = _mm256_blendv_epi8(no, yes, eq);
+	pos = _mm256_blendv_epi8(pos, next, live);
+	live = _mm256_and_si256(live, _mm256_cmpgt_epi32(next, zero));
+    }
+
+    int result[8];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(result), pos);
+    for (int i = 0; i < 8; ++i)
+	if (live_bits & (1 << i))
+	    outputs[i] = -result[i];
+}
+
+}
+#endif
+
+/** @brief Classify @a n packets at once.
+ * @param p packets
+ * @param n number of packets, at most batch_width
+ * @param[out] outputs output port for each packet
+ *
+ * The result for each packet equals match(@a p[i]).  The packets are run
+ * through the program in lockstep, so that their header loads overlap.  On
+ * x86-64 processors with AVX2, groups of eight packets are evaluated in
+ * vector lanes. */
+void
+Program::match_batch(const Packet * const *p, int n, int *outputs)
+{
+    assert(n <= batch_width);
+    if (_output_everything >= 0) {
+	for (int i = 0; i < n; ++i)
+	    outputs[i] = _output_everything;
+	return;
+    }
+
+    // Short packets take the length-checked path.
+    const unsigned char *data[batch_width];
+    int lane[batch_width], nlive = 0;
+    unsigned live_bits = 0;
+    for (int i = 0; i < n; ++i) {
+	data[i] = p[i]->data() - _align_offset;
+	if (p[i]->length() < _safe_length)
+	    outputs[i] = length_checked_match(p[i]);
+	else {
+	    lane[nlive++] = i;
+	    live_bits |= 1U << i;
+	}
+    }
+
+#if CLICK_CLASSIFICATION_WORDWISE_AVX2
+    if (have_avx2()) {
+	int first = 0;
+	for (; first + 8 <= n; first += 8)
+	    if (live_bits & (0xFFU << first))
+		match_avx2(_insn.begin(), data + first,
+			   (live_bits >> first) & 0xFF, outputs + first);
+	// Drop the lanes handled by vector code.
+	int j = 0;
+	for (int k = 0; k < nlive; ++k)
+	    if (lane[k] >= first)
+		lane[j++] = lane[k];
+	nlive = j;
+    }
+#endif
+
+    // Scalar lockstep evaluation: one step of every live packet per round.
+    const Insn *ex = _insn.begin();
+    int pos[batch_width];
+    for (int k = 0; k < nlive; ++k)
+	pos[lane[k]] = 0;
+    while (nlive) {
+	int j = 0;
+	for (int k = 0; k < nlive; ++k) {
+	    int i = lane[k];
+	    const Insn &in = ex[pos[i]];
+	    uint32_t word = *(const uint32_t *) (data[i] + in.offset);
+	    int next = in.j[(word & in.mask.u) == in.value.u];
+	    if (next > 0) {
+		pos[i] = next;
+		lane[j++] = i;
+	    } else
+		outputs[i] = -next;
+	}
+	nlive = j;
+    }
+}
+
+
+//
+// NATIVE CODE COMPILATION
+//
+
+#if CLICK_CLASSIFICATION_WORDWISE_JIT
+namespace {
+
+// A minimal x86-64 assembler.  All jumps are rel32, patched by link().
+class JITAssembler { public:
+
+    enum { JMP = 0, JB = 0x82, JE = 0x84 };
+
+    int new_label() {
+	_labels.push_back(-1);
+	return _labels.size() - 1;
+    }
+    void bind(int label) {
+	_labels[label] = _code.size();
+    }
+
+    void byte(uint8_t b) {
+	_code.push_back(b);
+    }
+    void word(uint32_t w) {
+	for (int i = 0; i < 4; ++i)
+	    byte(w >> (8 * i));
+    }
+    void jump(int cc, int label) {
+	if (cc) {
+	    byte(0x0F);
+	    byte(cc);
+	} else
+	    byte(0xE9);
+	_fixup_pos.push_back(_code.size());
+	_fixup_label.push_back(label);
+	word(0);
+    }
+    void cmp_eax(uint32_t x) {
+	byte(0x3D);
+	word(x);
+    }
+
+    // Return the label for program jump @a j taken from the test at @a pos.
+    int target(int32_t j, int pos, const Vector<int> &test_label) {
+	if (j > 0)
+	    return test_label[pos + j];
+	for (int i = 0; i < _outputs.size(); ++i)
+	    if (_outputs[i] == j)
+		return _output_labels[i];
+	_outputs.push_back(j);
+	_output_labels.push_back(new_label());
+	return _output_labels.back();
+    }
+
+    void emit_outputs() {
+	for (int i = 0; i < _outputs.size(); ++i) {
+	    bind(_output_labels[i]);
+	    byte(0xB8);		// mov eax, imm32
+	    word(-_outputs[i]);
+	    byte(0xC3);		// ret
+	}
+    }
+
+    bool link() {
+	for (int i = 0; i < _fixup_pos.size(); ++i) {
+	    int target = _labels[_fixup_label[i]];
+	    if (target < 0)
+		return false;
+	    uint32_t rel = target - (_fixup_pos[i] + 4);
+	    for (int k = 0; k < 4; ++k)
+		_code[_fixup_pos[i] + k] = rel >> (8 * k);
+	}
+	return true;
+    }
+
+    const Vector<uint8_t> &code() const {
+	return _code;
+    }
+
+  private:
+
+    Vector<uint8_t> _code;
+    Vector<int> _labels;
+    Vector<int> _fixup_pos;
+    Vector<int> _fixup_label;
+    Vector<int32_t> _outputs;
+    Vector<int> _output_labels;
+
+};
+
+// Emit an unrolled binary search of the sorted values [lo, hi) against eax.
+void
+jit_search(JITAssembler &a, const uint32_t *v, int lo, int hi,
+	   int yes, int no)
+{
+    while (hi - lo > 3) {
+	int mid = lo + (hi - lo) / 2;
+	int below = a.new_label();
+	a.cmp_eax(v[mid]);
+	a.jump(JITAssembler::JE, yes);
+	a.jump(JITAssembler::JB, below);
+	jit_search(a, v, mid + 1, hi, yes, no);
+	a.bind(below);
+	hi = mid;
+    }
+    for (int i = lo; i < hi; ++i) {
+	a.cmp_eax(v[i]);
+	a.jump(JITAssembler::JE, yes);
+    }
+    a.jump(JITAssembler::JMP, no);
+}
+
+}
+#endif
+
+bool
+JITProgram::available()
+{
+#if CLICK_CLASSIFICATION_WORDWISE_JIT
+    return true;
+#else
+    return false;
+#endif
+}
+
+/** @brief Compile @a zprog to native code.
+ * @param zprog program
+ * @param segments first program offset addressed by each base pointer
+ * @param nsegments number of base pointers (1 to 3)
+ * @param name symbol name recorded in the perf map, if enabled
+ * @return true iff compilation succeeded
+ *
+ * Any previous code is released first.  Programs that output everything
+ * are not compiled, since the caller never runs them. */
+bool
+JITProgram::compile(const CompressedProgram &zprog, const int *segments,
+		    int nsegments, const String &name)
+{
+    clear();
+#if CLICK_CLASSIFICATION_WORDWISE_JIT
+    const uint32_t *zbegin = zprog.begin(), *zend = zprog.end();
+    if (zprog.output_everything() >= 0 || zbegin == zend
+	|| nsegments < 1 || nsegments > 3)
+	return false;
+
+    JITAssembler a;
+    Vector<int> test_label(zend - zbegin + 1, -1);
+    for (const uint32_t *pr = zbegin; pr < zend; pr += 4 + (pr[0] >> 17))
+	test_label[pr - zbegin] = a.new_label();
+
+    // Load the base pointers into r8, r9, and r10.
+    a.byte(0x4C); a.byte(0x8B); a.byte(0x07);			// mov r8, [rdi]
+    if (nsegments > 1) {
+	a.byte(0x4C); a.byte(0x8B); a.byte(0x4F); a.byte(0x08);	// mov r9, [rdi+8]
+    }
+    if (nsegments > 2) {
+	a.byte(0x4C); a.byte(0x8B); a.byte(0x57); a.byte(0x10);	// mov r10, [rdi+16]
+    }
+
+    for (const uint32_t *pr = zbegin; pr < zend; pr += 4 + (pr[0] >> 17)) {
+	int pos = pr - zbegin;
+	a.bind(test_label[pos]);
+
+	int off = (int16_t) pr[0], k = nsegments - 1;
+	while (k > 0 && off < segments[k])
+	    --k;
+	a.byte(0x41); a.byte(0x8B); a.byte(0x80 + k);		// mov eax, [r8+k + disp32]
+	a.word(off - segments[k]);
+	if (pr[3] != 0xFFFFFFFFU) {
+	    a.byte(0x25);						// and eax, imm32
+	    a.word(pr[3]);
+	}
+
+	int nval = pr[0] >> 17;
+	const uint32_t *v = pr + 4;
+	int yes = a.target(pr[2], pos, test_label);
+	int no = a.target(pr[1], pos, test_label);
+	bool sorted = nval >= 4;
+	for (int i = 1; sorted && i < nval; ++i)
+	    sorted = v[i - 1] < v[i];
+	if (sorted)
+	    jit_search(a, v, 0, nval, yes, no);
+	else {
+	    for (int i = 0; i < nval; ++i) {
+		a.cmp_eax(v[i]);
+		a.jump(JITAssembler::JE, yes);
+	    }
+	    // fall through to the next test when possible
+	    if ((int32_t) pr[1] != 4 + nval)
+		a.jump(JITAssembler::JMP, no);
+	}
+    }
+    a.emit_outputs();
+    if (!a.link())
+	return false;
+
+    size_t size = a.code().size();
+    void *code = mmap(0, size, PROT_READ | PROT_WRITE,
+		      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED)
+	return false;
+    memcpy(code, a.code().begin(), size);
+    if (mprotect(code, size, PROT_READ | PROT_EXEC) < 0) {
+	munmap(code, size);
+	return false;
+    }
+    _code = code;
+    _code_size = size;
+    _f = reinterpret_cast<function_type>(code);
+
+    // The perf map lives at a predictable name in a shared directory, so
+    // write it only on request, and never through a symbolic link.
+    const char *perf_map = getenv("CLICK_PERF_MAP");
+    if (perf_map && *perf_map && strcmp(perf_map, "0") != 0) {
+	char buf[64];
+	sprintf(buf, "/tmp/perf-%d.map", (int) getpid());
+	int fd = open(buf, O_WRONLY | O_CREAT | O_APPEND | O_NOFOLLOW | O_CLOEXEC,
+		      0644);
+	if (fd >= 0) {
+	    if (FILE *f = fdopen(fd, "a")) {
+		fprintf(f, "%lx %lx %s\n", (unsigned long) code,
+			(unsigned long) size, name.c_str());
+		fclose(f);
+	    } else
+		close(fd);
+	}
+    }
+    return true;
+#else
+    (void) zprog, (void) segments, (void) nsegments, (void) name;
+    return false;
+#endif
+}
+
+/** @brief Release any compiled code. */
+void
+JITProgram::clear()
+{
+#if CLICK_CLASSIFICATION_WORDWISE_JIT
+    if (_code)
+	munmap(_code, _code_size);
+#endif
+    _f = 0;
+    _code = 0;
+    _code_size = 0;
+}
+
 }}
 CLICK_ENDDECLS
 ELEMENT_PROVIDES(Classification)
@@ -1,6 +1,12 @@
 #ifndef CLICK_CLASSIFICATION_HH
 #define CLICK_CLASSIFICATION_HH 1
 #define CLICK_CLASSIFICATION_WORDWISE_DOMINATOR_FASTPRED 1
+#if CLICK_USERLEVEL && ALLOW_MMAP && defined(__x86_64__)
+# define CLICK_CLASSIFICATION_WORDWISE_JIT 1
+#endif
+#if CLICK_USERLEVEL && defined(__x86_64__) && (__GNUC__ >= 5 || defined(__clang__))
+# define CLICK_CLASSIFICATION_WORDWISE_AVX2 1
+#endif
 #include <click/packet.hh>
 #include <click/vector.hh>
 CLICK_DECLS
@@ -20,7 +26,8 @@ enum Combiner {
 };
 
 enum {
-    offset_max = 0x7FFFFFFF
+    offset_max = 0x7FFFFFFF,
+    batch_width = 16		// Maximum packets per match_batch() call.
 };
 
 namespace Wordwise {
@@ -214,6 +221,7 @@ class Program { public:
     void warn_unused_outputs(int noutputs, ErrorHandler *errh) const;
 
     int match(const Packet *p);
+    void match_batch(const Packet * const *p, int n, int *outputs);
 
     String unparse() const;
 
@@ -276,6 +284,64 @@ class CompressedProgram { public:
 };
 
 
+/** @brief A CompressedProgram translated to native machine code.
+ *
+ * A JITProgram is compiled from a CompressedProgram and then called in
+ * place of the interpreter loop.  Each test's packet offset is resolved
+ * against one of up to three base pointers: @a segments[k] is the first
+ * program offset that addresses base @em k, and the generated function,
+ * called with the array of bases, reads offset @em off at
+ * <tt>bases[k] + off - segments[k]</tt>.  The generated code does no
+ * length checking, so callers must use it only for packets at least
+ * CompressedProgram::safe_length() bytes long, and fall back to the
+ * interpreter for shorter ones.
+ *
+ * Compilation is supported on x86-64 user-level drivers.  Elsewhere
+ * compile() always fails and callers should keep interpreting.  If the
+ * CLICK_PERF_MAP environment variable is set to anything but empty or "0",
+ * successful compilations are appended to /tmp/perf-PID.map so that perf(1)
+ * can symbolize the generated code; the file is not followed if it is a
+ * symbolic link. */
+class JITProgram { public:
+
+    typedef int (*function_type)(const unsigned char * const *bases);
+
+    JITProgram()
+	: _f(0), _code(0), _code_size(0) {
+    }
+    ~JITProgram() {
+	clear();
+    }
+
+    static bool available();
+
+    bool compile(const CompressedProgram &zprog, const int *segments,
+		 int nsegments, const String &name);
+    void clear();
+
+    bool compiled() const {
+	return _f != 0;
+    }
+    size_t code_size() const {
+	return _code_size;
+    }
+
+    int match(const unsigned char * const *bases) const {
+	return _f(bases);
+    }
+
+  private:
+
+    function_type _f;
+    void *_code;
+    size_t _code_size;
+
+    JITProgram(const JITProgram &);
+    JITProgram &operator=(const JITProgram &);
+
+};
+
+
 class DominatorOptimizer { public:
 
     DominatorOptimizer(Program *p);
@@ -22,6 +22,7 @@
 #include "classifier.hh"
 #include <click/glue.hh>
 #include <click/error.hh>
+#include <click/args.hh>
 #include <click/confparse.hh>
 #include <click/straccum.hh>
 #if !HAVE_INDIFFERENT_ALIGNMENT
@@ -222,8 +223,15 @@ Classifier::parse_program(Classification::Wordwise::Program &prog,
 int
 Classifier::configure(Vector<String> &conf, ErrorHandler *errh)
 {
+    bool jit = false;
+    if (Args(this, errh).bind(conf).read("JIT", jit).consume() < 0)
+	return -1;
     if (conf.size() != noutputs())
 	return errh->error("need %d arguments, one per output port", noutputs());
+    if (jit && !Classification::Wordwise::JITProgram::available()) {
+	errh->warning("JIT not supported on this platform, interpreting");
+	jit = false;
+    }
 
     Classification::Wordwise::Program prog = empty_program(errh);
     parse_program(prog, conf, errh);
@@ -231,6 +239,16 @@ Classifier::configure(Vector<String> &conf, ErrorHandler *errh)
     if (!errh->nerrors()) {
 	prog.warn_unused_outputs(noutputs(), errh);
 	_prog = prog;
+	if (jit) {
+	    Classification::Wordwise::CompressedProgram zprog;
+	    zprog.compile(_prog, false, 0);
+	    static const int segments[] = { 0 };
+	    if (!_jit.compile(zprog, segments, 1,
+			      String(class_name()) + "@" + name())
+		&& zprog.output_everything() < 0)
+		errh->warning("JIT compilation failed, interpreting");
+	} else
+	    _jit.clear();
 	return 0;
     } else
 	return -1;
@@ -243,16 +261,52 @@ Classifier::program_string(Element *element, void *)
     return c->_prog.unparse();
 }
 
+String
+Classifier::read_jit(Element *element, void *)
+{
+    Classifier *c = static_cast<Classifier *>(element);
+    return String(c->_jit.compiled());
+}
+
 void
 Classifier::add_handlers()
 {
     add_read_handler("program", Classifier::program_string, 0, Handler::CALM);
+    add_read_handler("jit", Classifier::read_jit, 0, Handler::CALM);
 }
 
 void
 Classifier::push(int, Packet *p)
 {
-    checked_output_push(_prog.match(p), p);
+    checked_output_push(match(p), p);
+}
+
+void
+Classifier::push_batch(int, PacketBatch &batch)
+{
+    // Emit each run of consecutive packets bound for the same output as one
+    // batch.  This keeps the order in which push() would have emitted them.
+    PacketBatch run;
+    int run_port = -1;
+    Packet *p[Classification::batch_width];
+    int port[Classification::batch_width];
+    while (!batch.empty()) {
+	int n = 0;
+	while (n < Classification::batch_width && !batch.empty())
+	    p[n++] = batch.pop_front();
+	if (_jit.compiled())
+	    for (int i = 0; i < n; ++i)
+		port[i] = match(p[i]);
+	else
+	    _prog.match_batch(p, n, port);
+	for (int i = 0; i < n; ++i) {
+	    if (port[i] != run_port && !run.empty())
+		checked_output_push_batch(run_port, run);
+	    run_port = port[i];
+	    run.append(p[i]);
+	}
+    }
+    checked_output_push_batch(run_port, run);
 }
 
 CLICK_ENDDECLS
@@ -37,11 +37,31 @@ CLICK_DECLS
  * could ever match a pattern. Usually, this is because an earlier pattern is
  * more general, or because your pattern is contradictory (`12/0806 12/0800').
  *
+ * Keyword arguments are:
+ *
+ * =over 8
+ *
+ * =item JIT
+ *
+ * Boolean.  If true, Classifier translates its program into native machine
+ * code, which avoids the interpreter's per-step dispatch.  Only x86-64
+ * user-level drivers support this; elsewhere, Classifier warns and keeps
+ * interpreting.  Default is false.
+ *
+ * =back
+ *
  * =n
  *
  * The IPClassifier and IPFilter elements have a friendlier syntax if you are
  * classifying IP packets.
  *
+ * Packets that arrive in a batch are classified together, up to 16 at a
+ * time, with AVX2 vector instructions where the CPU supports them.  Packets
+ * pushed one at a time are classified at once.  Classifier does not hold
+ * them back to form batches, since that would delay every packet until a
+ * flush task or timer ran.  To classify minimum-size packets in batches,
+ * give Classifier a batching source, such as Unqueue with BATCH set.
+ *
  * =e
  * For example,
  *
@@ -70,6 +90,9 @@ CLICK_DECLS
  *   safe length 22
  *   alignment offset 0
  *
+ * =h jit read-only
+ * Returns true iff Classifier is running native code for its program.
+ *
  * =a IPClassifier, IPFilter */
 
 class Classifier : public Element { public:
@@ -87,6 +110,7 @@ class Classifier : public Element { public:
     void add_handlers() CLICK_COLD;
 
     void push(int port, Packet *);
+    void push_batch(int port, PacketBatch &batch);
 
     Classification::Wordwise::Program empty_program(ErrorHandler *errh) const;
     static void parse_program(Classification::Wordwise::Program &prog,
@@ -95,10 +119,24 @@ class Classifier : public Element { public:
   protected:
 
     Classification::Wordwise::Program _prog;
+    Classification::Wordwise::JITProgram _jit;
+
+    inline int match(const Packet *p);
 
     static String program_string(Element *, void *);
+    static String read_jit(Element *, void *);
 
 };
 
+inline int
+Classifier::match(const Packet *p)
+{
+    if (_jit.compiled() && p->length() >= _prog.safe_length()) {
+	const unsigned char *data = p->data() - _prog.align_offset();
+	return _jit.match(&data);
+    }
+    return _prog.match(p);
+}
+
 CLICK_ENDDECLS
 #endif
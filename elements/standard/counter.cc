@@ -107,6 +107,42 @@ Counter::simple_action(Packet *p)
   return p;
 }
 
+void
+Counter::count_batch(const PacketBatch &batch)
+{
+    // Triggers must fire on the exact packet that reaches them.
+    if (_count_trigger_h || _byte_trigger_h) {
+	for (Packet *p = batch.first(); p; p = p->next())
+	    (void) Counter::simple_action(p);
+	return;
+    }
+
+    counter_t bytes = 0;
+    for (Packet *p = batch.first(); p; p = p->next())
+	bytes += p->length();
+    _count += batch.count();
+    _byte_count += bytes;
+    _rate.update(batch.count());
+    _byte_rate.update(bytes);
+}
+
+void
+Counter::push_batch(int, PacketBatch &batch)
+{
+    count_batch(batch);
+    output(0).push_batch(batch);
+}
+
+int
+Counter::pull_batch(int, PacketBatch &batch, int max)
+{
+    PacketBatch pulled;
+    int n = input(0).pull_batch(pulled, max);
+    count_batch(pulled);
+    batch.append(pulled);
+    return n;
+}
+
 
 enum { H_COUNT, H_BYTE_COUNT, H_RATE, H_BIT_RATE, H_BYTE_RATE, H_RESET,
        H_COUNT_CALL, H_BYTE_COUNT_CALL };
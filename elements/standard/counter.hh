@@ -121,6 +121,8 @@ class Counter : public Element { public:
     int llrpc(unsigned, void *);
 
     Packet *simple_action(Packet *);
+    void push_batch(int port, PacketBatch &batch);
+    int pull_batch(int port, PacketBatch &batch, int max);
 
   private:
 
@@ -147,6 +149,8 @@ class Counter : public Element { public:
     bool _count_triggered : 1;
     bool _byte_triggered : 1;
 
+    void count_batch(const PacketBatch &batch);
+
     static String read_handler(Element *, void *) CLICK_COLD;
     static int write_handler(const String&, Element*, void*, ErrorHandler*) CLICK_COLD;
 
@@ -76,6 +76,65 @@ FullNoteQueue::pull(int)
 	return pull_failure();
 }
 
+void
+FullNoteQueue::push_batch(int, PacketBatch &batch)
+{
+    // Enqueue as much of the batch as fits, then publish the new tail and
+    // update notifiers once for the whole batch.
+    Storage::index_type h = head(), t = tail(), nt = next_i(t);
+    int n = 0;
+    while (!batch.empty()) {
+	if (nt == h && (h = head(), nt == h))
+	    break;
+	_q[t] = batch.pop_front();
+	t = nt;
+	nt = next_i(nt);
+	++n;
+    }
+
+    if (n) {
+	set_tail(t);
+
+	int s = size(h, t);
+	if (s > _highwater_length)
+	    _highwater_length = s;
+
+	_empty_note.wake();
+
+	if (s == capacity()) {
+	    _full_note.sleep();
+#if HAVE_MULTITHREAD
+	    // See push_success().
+	    if (size() < capacity())
+		_full_note.wake();
+#endif
+	}
+    }
+
+    while (Packet *p = batch.pop_front())
+	push_failure(p);
+}
+
+int
+FullNoteQueue::pull_batch(int, PacketBatch &batch, int max)
+{
+    Storage::index_type h = head(), t = tail();
+    int n = 0;
+    while (h != t && n < max) {
+	batch.append(_q[h]);
+	h = next_i(h);
+	++n;
+    }
+
+    if (n) {
+	set_head(h);
+	_sleepiness = 0;
+	_full_note.wake();
+    } else
+	(void) pull_failure();
+    return n;
+}
+
 #if CLICK_DEBUG_SCHEDULING
 String
 FullNoteQueue::read_handler(Element *e, void *)
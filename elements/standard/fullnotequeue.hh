@@ -80,6 +80,8 @@ class FullNoteQueue : public NotifierQueue { public:
 
     void push(int port, Packet *p);
     Packet *pull(int port);
+    void push_batch(int port, PacketBatch &batch);
+    int pull_batch(int port, PacketBatch &batch, int max);
 
   protected:
 
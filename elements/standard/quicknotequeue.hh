@@ -72,8 +72,11 @@ class QuickNoteQueue : public FullNoteQueue { public:
 
     // FullNoteQueue's configure() suffices
 
-    // FullNoteQueue's push() suffices
+    // FullNoteQueue's push() and push_batch() suffice
     Packet *pull(int port);
+    int pull_batch(int port, PacketBatch &batch, int max) {
+	return Element::pull_batch(port, batch, max);
+    }
 
 };
 
@@ -0,0 +1,262 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * ringqueue.{cc,hh} -- ring queue for handing packets between threads
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "ringqueue.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/master.hh>
+#include <click/packetbatch.hh>
+CLICK_DECLS
+
+RingQueue::RingQueue()
+    : _cons_head(0), _cons_seen_tail(0), _sleepiness(0),
+      _prod_tail(0), _prod_seen_head(0), _ring(0), _capacity(0), _mask(0),
+      _single_producer(false), _single_producer_set(false)
+{
+    _prod_head = 0;
+    _drops = 0;
+}
+
+RingQueue::~RingQueue()
+{
+}
+
+void *
+RingQueue::cast(const char *n)
+{
+    if (strcmp(n, "RingQueue") == 0)
+	return (RingQueue *)this;
+    else if (strcmp(n, Notifier::EMPTY_NOTIFIER) == 0)
+	return static_cast<Notifier *>(&_empty_note);
+    else
+	return Element::cast(n);
+}
+
+int
+RingQueue::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    uint32_t capacity = 1024;
+    if (Args(conf, this, errh)
+	.read_p("CAPACITY", capacity)
+	.read("SINGLE_PRODUCER", _single_producer).read_status(_single_producer_set)
+	.complete() < 0)
+	return -1;
+    if (capacity == 0 || capacity > 0x80000000U)
+	return errh->error("CAPACITY out of range");
+    for (_capacity = 1; _capacity < capacity; _capacity *= 2)
+	/* nada */;
+    _mask = _capacity - 1;
+    _empty_note.initialize(Notifier::EMPTY_NOTIFIER, router());
+    return 0;
+}
+
+int
+RingQueue::initialize(ErrorHandler *errh)
+{
+    _ring = (Packet **) CLICK_LALLOC(sizeof(Packet *) * _capacity);
+    if (!_ring)
+	return errh->error("out of memory");
+    // Tasks can push from any thread once work stealing moves them, so
+    // home threads prove nothing; only a single-threaded router is safe.
+    if (!_single_producer_set)
+	_single_producer = master()->nthreads() == 1;
+    return 0;
+}
+
+void
+RingQueue::cleanup(CleanupStage)
+{
+    if (_ring) {
+	for (uint32_t i = _cons_head; i != _prod_tail; ++i)
+	    _ring[i & _mask]->kill();
+	CLICK_LFREE(_ring, sizeof(Packet *) * _capacity);
+	_ring = 0;
+    }
+}
+
+/* Reserve room for up to @a n packets, returning the number of slots
+ * reserved, starting at index @a head. */
+inline uint32_t
+RingQueue::reserve(uint32_t n, uint32_t &head)
+{
+    uint32_t free;
+    if (_single_producer) {
+	// Only we write _prod_tail; refresh our view of the consumer only
+	// when the ring looks too full.
+	head = _prod_tail;
+	free = _capacity - (head - _prod_seen_head);
+	if (free < n) {
+	    _prod_seen_head = _cons_head;
+	    free = _capacity - (head - _prod_seen_head);
+	}
+	return n < free ? n : free;
+    }
+
+    uint32_t h;
+    do {
+	h = _prod_head.value();
+	free = _capacity - (h - _cons_head);
+	if (free < n)
+	    n = free;
+	if (n == 0)
+	    return 0;
+    } while (_prod_head.compare_swap(h, h + n) != h);
+    head = h;
+    return n;
+}
+
+/* Publish the @a n packets stored at index @a head onward, and wake the
+ * consumer if the ring was empty. */
+inline void
+RingQueue::commit(uint32_t head, uint32_t n)
+{
+    if (!_single_producer)
+	// Producers commit in reservation order.
+	while (_prod_tail != head)
+	    click_relax_fence();
+    click_write_fence();
+    _prod_tail = head + n;
+
+    // If the consumer had caught up with us, it may be asleep.  The
+    // fence pairs with the one in pull_failure().
+    click_fence();
+    if (_cons_head == head && !_empty_note.active())
+	_empty_note.wake();
+}
+
+void
+RingQueue::drop(Packet *p)
+{
+    if (_drops == 0)
+	click_chatter("%p{element}: overflow", this);
+    _drops++;
+    checked_output_push(1, p);
+}
+
+void
+RingQueue::push(int, Packet *p)
+{
+    uint32_t head;
+    if (reserve(1, head)) {
+	_ring[head & _mask] = p;
+	commit(head, 1);
+    } else
+	drop(p);
+}
+
+void
+RingQueue::push_batch(int, PacketBatch &batch)
+{
+    uint32_t head;
+    uint32_t n = reserve(batch.count(), head);
+    if (n) {
+	for (uint32_t i = 0; i < n; ++i)
+	    _ring[(head + i) & _mask] = batch.pop_front();
+	commit(head, n);
+    }
+    while (Packet *p = batch.pop_front())
+	drop(p);
+}
+
+inline Packet *
+RingQueue::pull_failure()
+{
+    if (_sleepiness >= SLEEPINESS_TRIGGER) {
+	_empty_note.sleep();
+#if HAVE_MULTITHREAD
+	// A producer may have committed packets without seeing us asleep.
+	click_fence();
+	if (_prod_tail != _cons_head)
+	    _empty_note.wake();
+#endif
+    } else
+	++_sleepiness;
+    return 0;
+}
+
+Packet *
+RingQueue::pull(int)
+{
+    uint32_t head = _cons_head;
+    if (head == _cons_seen_tail) {
+	_cons_seen_tail = _prod_tail;
+	if (head == _cons_seen_tail)
+	    return pull_failure();
+    }
+    click_read_fence();
+    Packet *p = _ring[head & _mask];
+    click_read_fence();
+    _cons_head = head + 1;
+    _sleepiness = 0;
+    return p;
+}
+
+int
+RingQueue::pull_batch(int, PacketBatch &batch, int max)
+{
+    uint32_t head = _cons_head;
+    uint32_t n = _cons_seen_tail - head;
+    if (n < (uint32_t) max) {
+	_cons_seen_tail = _prod_tail;
+	n = _cons_seen_tail - head;
+	if (n == 0) {
+	    (void) pull_failure();
+	    return 0;
+	}
+    }
+    if (n > (uint32_t) max)
+	n = max;
+    click_read_fence();
+    for (uint32_t i = 0; i < n; ++i)
+	batch.append(_ring[(head + i) & _mask]);
+    click_read_fence();
+    _cons_head = head + n;
+    _sleepiness = 0;
+    return n;
+}
+
+enum { h_length, h_capacity, h_drops, h_single_producer };
+
+String
+RingQueue::read_handler(Element *e, void *thunk)
+{
+    RingQueue *rq = static_cast<RingQueue *>(e);
+    switch ((intptr_t) thunk) {
+    case h_length:
+	return String(rq->size());
+    case h_capacity:
+	return String(rq->_capacity);
+    case h_drops:
+	return String(rq->_drops.value());
+    case h_single_producer:
+	return String(rq->_single_producer);
+    default:
+	return String();
+    }
+}
+
+void
+RingQueue::add_handlers()
+{
+    add_read_handler("length", read_handler, h_length);
+    add_read_handler("capacity", read_handler, h_capacity);
+    add_read_handler("drops", read_handler, h_drops);
+    add_read_handler("single_producer", read_handler, h_single_producer);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(RingQueue)
+ELEMENT_MT_SAFE(RingQueue)
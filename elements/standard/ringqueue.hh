@@ -0,0 +1,132 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_RINGQUEUE_HH
+#define CLICK_RINGQUEUE_HH
+#include <click/element.hh>
+#include <click/notifier.hh>
+#include <click/atomic.hh>
+CLICK_DECLS
+
+/*
+=c
+
+RingQueue
+RingQueue(CAPACITY [, I<keywords> SINGLE_PRODUCER])
+
+=s threads
+
+stores packets in a FIFO ring for handoff between threads
+
+=d
+
+Stores incoming packets in a first-in-first-out ring, and emits them when
+pulled.  Drops incoming packets if the ring already holds CAPACITY packets;
+dropped packets are emitted on output 1 if it exists.  CAPACITY is rounded up
+to a power of two.  The default for CAPACITY is 1024.
+
+RingQueue hands packets from one or more pushing threads to a single pulling
+thread, and is cheaper than ThreadSafeQueue for that purpose.  Batches are
+enqueued and dequeued with one synchronization operation each, rather than
+one per packet.  If all of RingQueue's packets come from a single thread, it
+needs no atomic operations at all: the producer and the consumer only load
+and store their own indexes.  Otherwise, producers reserve room for their
+batches with an atomic compare-and-swap, fill it, and then commit it in
+reservation order.
+
+Only one thread may pull from a RingQueue at a time.
+
+Like NotifierQueue, RingQueue has an empty notifier.  Producers only wake it
+when they make an empty ring nonempty.
+
+Keyword arguments are:
+
+=over 8
+
+=item SINGLE_PRODUCER
+
+Boolean.  Whether all packets are pushed by a single thread.  Set it to true
+only if a single thread can ever push to RingQueue: the upstream tasks must
+be pinned to one thread, must not be moved by work stealing, and must not
+push from several threads themselves, as FromDPDKDevice with several queues
+and ParallelFromDump do.  Default is true if the router has one thread, and
+false otherwise.
+
+=back
+
+=h length read-only
+
+Returns the current number of packets in the ring.
+
+=h capacity read-only
+
+Returns the ring's capacity.
+
+=h drops read-only
+
+Returns the number of packets dropped by the ring so far.
+
+=h single_producer read-only
+
+Returns true iff the ring runs in single-producer mode.
+
+=a ThreadSafeQueue, CPUQueue, Queue, NotifierQueue */
+
+class RingQueue : public Element { public:
+
+    RingQueue() CLICK_COLD;
+    ~RingQueue() CLICK_COLD;
+
+    const char *class_name() const		{ return "RingQueue"; }
+    const char *port_count() const		{ return "1-/1-2"; }
+    const char *processing() const		{ return "h/lh"; }
+    void *cast(const char *);
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    void push(int port, Packet *p);
+    void push_batch(int port, PacketBatch &batch);
+    Packet *pull(int port);
+    int pull_batch(int port, PacketBatch &batch, int max);
+
+    int size() const {
+	return _prod_tail - _cons_head;
+    }
+
+  private:
+
+    enum { SLEEPINESS_TRIGGER = 9 };
+
+    // Indexes run freely and are masked into the ring.
+
+    // Consumer side.
+    volatile uint32_t _cons_head CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+    uint32_t _cons_seen_tail;		// last _prod_tail seen
+    int _sleepiness;
+
+    // Producer side.  _prod_head reserves slots, _prod_tail commits them.
+    atomic_uint32_t _prod_head CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+    volatile uint32_t _prod_tail;
+    uint32_t _prod_seen_head;		// last _cons_head seen (single producer)
+    atomic_uint32_t _drops;
+
+    // Read-mostly.
+    Packet **_ring CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+    uint32_t _capacity;
+    uint32_t _mask;
+    bool _single_producer;
+    bool _single_producer_set;
+    ActiveNotifier _empty_note;
+
+    inline uint32_t reserve(uint32_t n, uint32_t &head);
+    inline void commit(uint32_t head, uint32_t n);
+    inline Packet *pull_failure();
+    void drop(Packet *p);
+
+    static String read_handler(Element *, void *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
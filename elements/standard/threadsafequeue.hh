@@ -64,6 +64,15 @@ class ThreadSafeQueue : public FullNoteQueue { public:
     void push(int port, Packet *);
     Packet *pull(int port);
 
+    // FullNoteQueue's batch methods are not safe for concurrent pushers;
+    // fall back to one packet at a time.
+    void push_batch(int port, PacketBatch &batch) {
+	Element::push_batch(port, batch);
+    }
+    int pull_batch(int port, PacketBatch &batch, int max) {
+	return Element::pull_batch(port, batch, max);
+    }
+
   private:
 
     atomic_uint32_t _xhead;
@@ -36,10 +36,12 @@ Unqueue::configure(Vector<String> &conf, ErrorHandler *errh)
     _burst = 1;
     _limit = -1;
     _active = true;
+    _batch = false;
     return Args(conf, this, errh)
 	.read_p("BURST", _burst)
 	.read("ACTIVE", _active)
-	.read("LIMIT", _limit).complete();
+	.read("LIMIT", _limit)
+	.read("BATCH", _batch).complete();
 }
 
 int
@@ -68,16 +70,25 @@ Unqueue::run_task(Task *)
 	    return false;
     }
 
-    while (worked < limit && _active) {
-	if (Packet *p = input(0).pull()) {
-	    ++worked;
-	    ++_count;
-	    output(0).push(p);
+    if (_batch) {
+	PacketBatch batch;
+	worked = input(0).pull_batch(batch, limit);
+	if (worked) {
+	    _count += worked;
+	    output(0).push_batch(batch);
 	} else if (!_signal)
 	    goto out;
-	else
-	    break;
-    }
+    } else
+	while (worked < limit && _active) {
+	    if (Packet *p = input(0).pull()) {
+		++worked;
+		++_count;
+		output(0).push(p);
+	    } else if (!_signal)
+		goto out;
+	    else
+		break;
+	}
 
     _task.fast_reschedule();
   out:
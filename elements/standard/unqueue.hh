@@ -8,7 +8,7 @@ CLICK_DECLS
 /*
 =c
 
-Unqueue([I<keywords> ACTIVE, LIMIT, BURST])
+Unqueue([I<keywords> ACTIVE, LIMIT, BURST, BATCH])
 
 =s shaping
 
@@ -37,6 +37,13 @@ The default value is true.
 If positive, then at most LIMIT packets are pulled.  The default is -1, which
 means there is no limit.
 
+=item BATCH
+
+Boolean.  If true, each scheduling pulls up to BURST packets as a single
+batch and pushes them downstream together, so elements with batch support
+(such as Classifier and IPFilter) handle them in one call.  The default is
+false.
+
 =back
 
 =h count read-only
@@ -80,6 +87,7 @@ class Unqueue : public Element { public:
   private:
 
     bool _active;
+    bool _batch;
     int32_t _burst;
     int32_t _limit;
     uint32_t _count;
@@ -66,9 +66,9 @@ TimerTest::initialize(ErrorHandler *)
 	    ts[i].assign();
 	    ts[i].initialize(this);
 	}
-	benchmark_schedules(ts, _benchmark, now);
-	benchmark_changes(ts, _benchmark, now);
-	benchmark_fires(ts, _benchmark, now);
+	benchmark("schedule", &TimerTest::benchmark_schedules, ts, _benchmark, now);
+	benchmark("change", &TimerTest::benchmark_changes, ts, _benchmark, now);
+	benchmark("fire", &TimerTest::benchmark_fires, ts, _benchmark, now);
 	delete[] ts;
     }
 
@@ -81,6 +81,18 @@ TimerTest::run_timer(Timer *t)
     click_chatter("%p{timestamp}: %p{element} fired", &t->expiry_steady(), this);
 }
 
+void
+TimerTest::benchmark(const char *name, benchmark_type f, Timer *ts, int nts,
+		     const Timestamp &now)
+{
+    Timestamp before = Timestamp::now_steady();
+    (this->*f)(ts, nts, now);
+    Timestamp elapsed = Timestamp::now_steady() - before;
+    click_chatter("%p{element}: %s %d timers (%s): %p{timestamp}s", this, name,
+		  nts, ts->thread()->timer_set().timer_wheel() ? "wheel" : "heap",
+		  &elapsed);
+}
+
 void
 TimerTest::benchmark_schedules(Timer *ts, int nts, const Timestamp &now)
 {
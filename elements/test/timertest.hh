@@ -39,7 +39,9 @@ is printed to standard error.
 
 Integer.  If set to a positive number, then TimerTest runs a timer
 manipulation benchmark at installation time involving BENCHMARK total
-timers.  Default is 0 (don't benchmark).
+timers, and reports how long each phase took.  Default is 0 (don't
+benchmark).  To benchmark timing wheels rather than heaps, run the user-level
+driver with C<--timer-wheel>.
 
 =back
 
@@ -81,6 +83,9 @@ class TimerTest : public Element { public:
     void benchmark_schedules(Timer *ts, int nts, const Timestamp &now);
     void benchmark_changes(Timer *ts, int nts, const Timestamp &now);
     void benchmark_fires(Timer *ts, int nts, const Timestamp &now);
+    typedef void (TimerTest::*benchmark_type)(Timer *, int, const Timestamp &);
+    void benchmark(const char *name, benchmark_type f, Timer *ts, int nts,
+		   const Timestamp &now);
 
     enum { h_scheduled, h_expiry, h_schedule_after, h_unschedule };
     static String read_handler(Element *e, void *user_data) CLICK_COLD;
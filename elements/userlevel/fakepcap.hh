@@ -10,6 +10,18 @@ CLICK_DECLS
 #define FAKE_PCAP_VERSION_MAJOR		2
 #define FAKE_PCAP_VERSION_MINOR		4
 
+/* pcapng block types and options */
+#define FAKE_PCAPNG_SHB			0x0A0D0D0A	/* Section Header Block */
+#define FAKE_PCAPNG_BYTE_ORDER_MAGIC	0x1A2B3C4D
+#define FAKE_PCAPNG_VERSION_MAJOR	1
+#define FAKE_PCAPNG_IDB			1	/* Interface Description Block */
+#define FAKE_PCAPNG_OPB			2	/* Packet Block (obsolete) */
+#define FAKE_PCAPNG_SPB			3	/* Simple Packet Block */
+#define FAKE_PCAPNG_EPB			6	/* Enhanced Packet Block */
+#define FAKE_PCAPNG_OPT_ENDOFOPT	0
+#define FAKE_PCAPNG_OPT_IF_TSRESOL	9
+#define FAKE_PCAPNG_OPT_IF_TSOFFSET	14
+
 /* Canonical (pcap file) data link types (may differ from host versions) */
 #define FAKE_DLT_NONE			(-1)	/* Unknown */
 #define FAKE_DLT_NULL			0	/* Null encapsulation */
@@ -86,6 +98,7 @@ int fake_pcap_canonical_dlt(int, bool from_file);
 
 // Handling FORCE_IP.
 bool fake_pcap_dlt_force_ipable(int);
+const click_ip *fake_pcap_ip_header(const uint8_t *, const uint8_t *, int);
 bool fake_pcap_force_ip(Packet*&, int);
 bool fake_pcap_force_ip(WritablePacket*&, int);
 
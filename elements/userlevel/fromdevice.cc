@@ -39,6 +39,7 @@
 #include <click/args.hh>
 #include <click/glue.hh>
 #include <click/packet_anno.hh>
+#include <click/master.hh>
 #include <click/standard/scheduleinfo.hh>
 #include <click/userutils.hh>
 #include <unistd.h>
@@ -51,10 +52,38 @@
 # include <features.h>
 # include <linux/if_packet.h>
 # include <net/ethernet.h>
+# ifdef TPACKET3_HDRLEN
+#  define FROMDEVICE_ALLOW_MMAP 1
+#  include <sys/mman.h>
+#  include <click/atomic.hh>
+# endif
+# ifdef PACKET_FANOUT
+#  define FROMDEVICE_ALLOW_FANOUT 1
+# endif
 #endif
 
 CLICK_DECLS
 
+#if FROMDEVICE_ALLOW_LINUX
+/* A METHOD LINUX or MMAP packet socket.  Each socket is read on its task's
+ * home thread; the task itself only runs to restart a stalled ring. */
+struct FromDevice::RxSocket {
+    RxSocket(FromDevice *e)
+	: task(e), ring_timer(&task), fd(-1), thread(-1), ring(0),
+	  count(0), ring_blocks(0), ring_drops(0), ring_freezes(0) {
+    }
+    Task task;
+    Timer ring_timer;
+    int fd;
+    int thread;			// home thread, or -1 for the element's
+    RxRing *ring;
+    counter_t count;
+    counter_t ring_blocks;
+    counter_t ring_drops;
+    counter_t ring_freezes;
+};
+#endif
+
 FromDevice::FromDevice()
     :
 #if FROMDEVICE_ALLOW_NETMAP || FROMDEVICE_ALLOW_PCAP
@@ -72,6 +101,10 @@ FromDevice::FromDevice()
 
 FromDevice::~FromDevice()
 {
+#if FROMDEVICE_ALLOW_LINUX
+    for (int i = 0; i < _socks.size(); ++i)
+	delete _socks[i];
+#endif
 }
 
 int
@@ -86,6 +119,14 @@ FromDevice::configure(Vector<String> &conf, ErrorHandler *errh)
     _burst = 1;
     String bpf_filter, capture, encap_type;
     bool has_encap;
+#if FROMDEVICE_ALLOW_LINUX
+    _ring_nblocks = 64;
+    _ring_block_size = 262144;
+    _ring_timeout = 1;
+    String fanout, threads;
+    bool has_threads;
+    _fanout_group = (getpid() + eindex()) & 0xFFFF;
+#endif
     if (Args(conf, this, errh)
 	.read_mp("DEVNAME", _ifname)
 	.read_p("PROMISC", promisc)
@@ -101,6 +142,14 @@ FromDevice::configure(Vector<String> &conf, ErrorHandler *errh)
 	.read("ENCAP", WordArg(), encap_type).read_status(has_encap)
 	.read("BURST", _burst)
 	.read("TIMESTAMP", timestamp)
+#if FROMDEVICE_ALLOW_LINUX
+	.read("RING_BLOCKS", _ring_nblocks)
+	.read("RING_BLOCK_SIZE", _ring_block_size)
+	.read("RING_TIMEOUT", _ring_timeout)
+	.read("FANOUT", WordArg(), fanout)
+	.read("THREADS", AnyArg(), threads).read_status(has_threads)
+	.read("FANOUT_GROUP", BoundedIntArg(0, 0xFFFF), _fanout_group)
+#endif
 	.complete() < 0)
 	return -1;
     if (_snaplen > 65535 || _snaplen < 14)
@@ -135,6 +184,18 @@ FromDevice::configure(Vector<String> &conf, ErrorHandler *errh)
 #if FROMDEVICE_ALLOW_LINUX
     else if (capture == "LINUX")
 	_method = method_linux;
+    else if (capture == "MMAP") {
+# if FROMDEVICE_ALLOW_MMAP
+	_method = method_mmap;
+	if (_ring_nblocks == 0)
+	    return errh->error("RING_BLOCKS out of range");
+	long page_size = sysconf(_SC_PAGESIZE);
+	if (_ring_block_size == 0 || _ring_block_size % page_size != 0)
+	    return errh->error("RING_BLOCK_SIZE must be a multiple of %ld", page_size);
+# else
+	return errh->error("METHOD MMAP not supported on this platform");
+# endif
+    }
 #endif
 #if FROMDEVICE_ALLOW_PCAP
     else if (capture == "PCAP")
@@ -150,6 +211,53 @@ FromDevice::configure(Vector<String> &conf, ErrorHandler *errh)
     if (bpf_filter && _method != method_pcap)
 	errh->warning("not using METHOD PCAP, BPF filter ignored");
 
+#if FROMDEVICE_ALLOW_LINUX
+    _fanout = -1;
+    if (fanout) {
+# if FROMDEVICE_ALLOW_FANOUT
+	if (_method != method_linux && _method != method_mmap)
+	    return errh->error("FANOUT requires METHOD LINUX or MMAP");
+	if (fanout == "HASH")	// defragment so fragments follow their flow
+	    _fanout = PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_DEFRAG;
+	else if (fanout == "CPU")
+	    _fanout = PACKET_FANOUT_CPU;
+	else if (fanout == "LB")
+	    _fanout = PACKET_FANOUT_LB;
+	else if (fanout == "QM")
+	    _fanout = PACKET_FANOUT_QM;
+	else
+	    return errh->error("bad FANOUT");
+# else
+	return errh->error("FANOUT not supported on this platform");
+# endif
+    } else if (has_threads)
+	return errh->error("THREADS requires FANOUT");
+
+    Vector<int> thread_ids;
+    if (has_threads) {
+	Vector<String> words;
+	cp_spacevec(threads, words);
+	for (int i = 0; i < words.size(); ++i) {
+	    int t;
+	    if (!IntArg().parse(words[i], t)
+		|| t < 0 || t >= master()->nthreads())
+		return errh->error("bad THREADS, expected thread IDs less than %d", master()->nthreads());
+	    thread_ids.push_back(t);
+	}
+	if (thread_ids.empty())
+	    return errh->error("THREADS empty");
+    } else if (_fanout >= 0)
+	for (int t = 0; t < master()->nthreads(); ++t)
+	    thread_ids.push_back(t);
+    else
+	thread_ids.push_back(-1);
+    for (int i = 0; i < thread_ids.size(); ++i) {
+	RxSocket *s = new RxSocket(this);
+	s->thread = thread_ids[i];
+	_socks.push_back(s);
+    }
+#endif
+
     _sniffer = sniffer;
     _promisc = promisc;
     _outbound = outbound;
@@ -159,9 +267,12 @@ FromDevice::configure(Vector<String> &conf, ErrorHandler *errh)
 
 #if FROMDEVICE_ALLOW_LINUX
 int
-FromDevice::open_packet_socket(String ifname, ErrorHandler *errh)
+FromDevice::open_packet_socket(String ifname, ErrorHandler *errh, bool receive)
 {
-    int fd = socket(PF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+    // A send-only socket binds to protocol 0, so the kernel never queues
+    // received packets on it.
+    int protocol = receive ? htons(ETH_P_ALL) : 0;
+    int fd = socket(PF_PACKET, SOCK_RAW, protocol);
     if (fd == -1)
 	return errh->error("%s: socket: %s", ifname.c_str(), strerror(errno));
 
@@ -182,7 +293,7 @@ FromDevice::open_packet_socket(String ifname, ErrorHandler *errh)
     sockaddr_ll sa;
     memset(&sa, 0, sizeof(sa));
     sa.sll_family = AF_PACKET;
-    sa.sll_protocol = htons(ETH_P_ALL);
+    sa.sll_protocol = protocol;
     sa.sll_ifindex = ifindex;
     res = bind(fd, (struct sockaddr *)&sa, sizeof(sa));
     if (res != 0) {
@@ -227,8 +338,210 @@ FromDevice::set_promiscuous(int fd, String ifname, bool promisc)
 
     return was_promisc;
 }
+
+int
+FromDevice::open_socket(RxSocket *s, ErrorHandler *errh)
+{
+    s->fd = open_packet_socket(_ifname, errh);
+    if (s->fd < 0)
+	return -1;
+# if FROMDEVICE_ALLOW_MMAP
+    if (_method == method_mmap && open_ring(s, errh) < 0)
+	return -1;
+# endif
+# if FROMDEVICE_ALLOW_FANOUT
+    // join after setting up the ring, so no packets arrive before it exists
+    if (_fanout >= 0) {
+	int arg = _fanout_group | (_fanout << 16);
+	if (setsockopt(s->fd, SOL_PACKET, PACKET_FANOUT, &arg, sizeof(arg)) < 0)
+	    return errh->error("%s: PACKET_FANOUT: %s", _ifname.c_str(), strerror(errno));
+    }
+# endif
+    if (s->thread >= 0)
+	s->task.move_thread(s->thread);
+    s->task.set_pinned(true);
+    ScheduleInfo::initialize_task(this, &s->task, false, errh);
+    s->ring_timer.initialize(this);
+    set_socket_select(s, true);
+    return 0;
+}
+
+void
+FromDevice::set_socket_select(RxSocket *s, bool on)
+{
+    SelectSet &ss = master()->thread(s->task.home_thread_id())->select_set();
+    if (on)
+	ss.add_select(s->fd, this, SELECT_READ);
+    else
+	ss.remove_select(s->fd, this, SELECT_READ);
+}
 #endif /* FROMDEVICE_ALLOW_LINUX */
 
+#if FROMDEVICE_ALLOW_MMAP
+/* A TPACKET_V3 receive ring.  Emitted packets point into the ring's blocks.
+ * Each block counts its outstanding packets, plus one while FromDevice walks
+ * it; when the count drops to zero, the block goes back to the kernel.  The
+ * ring itself counts FromDevice plus every held block, so its mapping
+ * outlives the element if packets do. */
+struct FromDevice::RxRing {
+    struct Block {
+	RxRing *ring;
+	atomic_uint32_t refcount;
+    };
+
+    unsigned char *map;
+    size_t map_size;
+    unsigned nblocks;
+    unsigned block_size;
+    unsigned pos;
+    Block *blocks;
+    atomic_uint32_t refcount;
+
+    tpacket_block_desc *block_desc(unsigned i) const {
+	return reinterpret_cast<tpacket_block_desc *>(map + (size_t) i * block_size);
+    }
+    void release(Block *b) {
+	__sync_synchronize();
+	block_desc(b - blocks)->hdr.bh1.block_status = TP_STATUS_KERNEL;
+	unuse();
+    }
+    void unuse() {
+	if (refcount.dec_and_test()) {
+	    munmap(map, map_size);
+	    delete[] blocks;
+	    delete this;
+	}
+    }
+    static void packet_destructor(unsigned char *, size_t, void *arg) {
+	Block *b = static_cast<Block *>(arg);
+	if (b->refcount.dec_and_test())
+	    b->ring->release(b);
+    }
+};
+
+int
+FromDevice::open_ring(RxSocket *s, ErrorHandler *errh)
+{
+    int version = TPACKET_V3;
+    if (setsockopt(s->fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0)
+	return errh->error("%s: PACKET_VERSION: %s", _ifname.c_str(), strerror(errno));
+    // keep HEADROOM free in front of every frame
+    unsigned reserve = _headroom;
+    if (setsockopt(s->fd, SOL_PACKET, PACKET_RESERVE, &reserve, sizeof(reserve)) < 0)
+	return errh->error("%s: PACKET_RESERVE: %s", _ifname.c_str(), strerror(errno));
+
+    tpacket_req3 req;
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = _ring_block_size;
+    req.tp_block_nr = _ring_nblocks;
+    req.tp_frame_size = TPACKET_ALIGN(TPACKET3_HDRLEN + _headroom + _snaplen);
+    if (req.tp_frame_size > req.tp_block_size)
+	return errh->error("%s: RING_BLOCK_SIZE too small for SNAPLEN", _ifname.c_str());
+    req.tp_frame_nr = (req.tp_block_size / req.tp_frame_size) * req.tp_block_nr;
+    req.tp_retire_blk_tov = _ring_timeout;
+    if (setsockopt(s->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0)
+	return errh->error("%s: PACKET_RX_RING: %s", _ifname.c_str(), strerror(errno));
+
+    size_t map_size = (size_t) req.tp_block_size * req.tp_block_nr;
+    void *map = mmap(0, map_size, PROT_READ | PROT_WRITE,
+		     MAP_SHARED | MAP_LOCKED, s->fd, 0);
+    if (map == MAP_FAILED)	// MAP_LOCKED may exceed RLIMIT_MEMLOCK
+	map = mmap(0, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, s->fd, 0);
+    if (map == MAP_FAILED)
+	return errh->error("%s: mmap: %s", _ifname.c_str(), strerror(errno));
+
+    RxRing *ring = new RxRing;
+    ring->map = reinterpret_cast<unsigned char *>(map);
+    ring->map_size = map_size;
+    ring->nblocks = req.tp_block_nr;
+    ring->block_size = req.tp_block_size;
+    ring->pos = 0;
+    ring->blocks = new RxRing::Block[req.tp_block_nr];
+    for (unsigned i = 0; i < req.tp_block_nr; ++i) {
+	ring->blocks[i].ring = ring;
+	ring->blocks[i].refcount = 0;
+    }
+    ring->refcount = 1;
+    s->ring = ring;
+    return 0;
+}
+
+void
+FromDevice::ring_dispatch(RxSocket *s)
+{
+    RxRing *ring = s->ring;
+    PacketBatch batch;
+    int n = 0;
+    while (n < _burst) {
+	tpacket_block_desc *bd = ring->block_desc(ring->pos);
+	if (!(bd->hdr.bh1.block_status & TP_STATUS_USER))
+	    break;
+	RxRing::Block *b = &ring->blocks[ring->pos];
+	if (b->refcount.value()) {
+	    // The next block still has packets downstream, so the ring is
+	    // stalled.  Stop polling for a while rather than spin.
+	    set_socket_select(s, false);
+	    s->ring_timer.schedule_after_msec(1);
+	    break;
+	}
+	__sync_synchronize();
+
+	b->refcount = 1;
+	++ring->refcount;
+	ring->pos = (ring->pos + 1) % ring->nblocks;
+	++s->ring_blocks;
+
+	unsigned char *frame = reinterpret_cast<unsigned char *>(bd) + bd->hdr.bh1.offset_to_first_pkt;
+	for (unsigned i = bd->hdr.bh1.num_pkts; i; --i) {
+	    tpacket3_hdr *h = reinterpret_cast<tpacket3_hdr *>(frame);
+	    frame += h->tp_next_offset;
+	    const sockaddr_ll *sa = reinterpret_cast<const sockaddr_ll *>
+		(reinterpret_cast<unsigned char *>(h) + TPACKET_ALIGN(sizeof(tpacket3_hdr)));
+	    if ((sa->sll_pkttype == PACKET_OUTGOING && !_outbound)
+		|| (_protocol != 0 && _protocol != sa->sll_protocol))
+		continue;
+
+	    uint32_t len = h->tp_snaplen < (uint32_t) _snaplen ? h->tp_snaplen : _snaplen;
+	    ++b->refcount;
+	    WritablePacket *p = Packet::make(reinterpret_cast<unsigned char *>(h) + h->tp_mac, len,
+					     RxRing::packet_destructor, b,
+					     h->tp_mac - TPACKET3_HDRLEN, 0);
+	    if (!p) {
+		RxRing::packet_destructor(0, 0, b);
+		continue;
+	    }
+	    SET_EXTRA_LENGTH_ANNO(p, h->tp_len - len);
+	    p->set_packet_type_anno((Packet::PacketType) sa->sll_pkttype);
+	    if (_timestamp)
+		p->timestamp_anno() = Timestamp::make_nsec(h->tp_sec, h->tp_nsec);
+	    p->set_mac_header(p->data());
+	    ++s->count;
+	    ++n;
+	    if (!_force_ip || fake_pcap_force_ip(p, _datalink))
+		batch.append(p);
+	    else
+		checked_output_push(1, p);
+	}
+
+	// done walking the block
+	RxRing::packet_destructor(0, 0, b);
+    }
+    output(0).push_batch(batch);
+}
+
+void
+FromDevice::ring_stats(RxSocket *s)
+{
+    tpacket_stats_v3 stats;
+    socklen_t statsize = sizeof(stats);
+    // the kernel resets its counters on every read
+    if (getsockopt(s->fd, SOL_PACKET, PACKET_STATISTICS, &stats, &statsize) >= 0) {
+	s->ring_drops += stats.tp_drops;
+	s->ring_freezes += stats.tp_freeze_q_cnt;
+    }
+}
+#endif /* FROMDEVICE_ALLOW_MMAP */
+
 #if FROMDEVICE_ALLOW_PCAP
 const char*
 FromDevice::fetch_pcap_error(pcap_t* pcap, const char *ebuf)
@@ -390,10 +703,12 @@ FromDevice::initialize(ErrorHandler *errh)
 #endif
 
 #if FROMDEVICE_ALLOW_LINUX
-    if (_method == method_default || _method == method_linux) {
-	_fd = open_packet_socket(_ifname, errh);
-	if (_fd < 0)
-	    return -1;
+    if (_method == method_default || _method == method_linux
+	|| _method == method_mmap) {
+	for (int i = 0; i < _socks.size(); ++i)
+	    if (open_socket(_socks[i], errh) < 0)
+		return -1;
+	_fd = _socks[0]->fd;
 
 	int promisc_ok = set_promiscuous(_fd, _ifname, _promisc);
 	if (promisc_ok < 0) {
@@ -404,16 +719,20 @@ FromDevice::initialize(ErrorHandler *errh)
 	    _was_promisc = promisc_ok;
 
 	_datalink = FAKE_DLT_EN10MB;
-	_method = method_linux;
+	if (_method == method_default)
+	    _method = method_linux;
     }
 #endif
 
 #if FROMDEVICE_ALLOW_PCAP || FROMDEVICE_ALLOW_NETMAP
-    if (_method == method_pcap || _method == method_netmap)
+    if (_method == method_pcap || _method == method_netmap) {
+	// the task reads the descriptor registered on our home thread
+	_task.set_pinned(true);
 	ScheduleInfo::initialize_task(this, &_task, false, errh);
+    }
 #endif
-#if FROMDEVICE_ALLOW_PCAP || FROMDEVICE_ALLOW_LINUX || FROMDEVICE_ALLOW_NETMAP
-    if (_fd >= 0)
+#if FROMDEVICE_ALLOW_PCAP || FROMDEVICE_ALLOW_NETMAP
+    if (_fd >= 0 && (_method == method_pcap || _method == method_netmap))
 	add_select(_fd, SELECT_READ);
 #endif
 
@@ -434,10 +753,21 @@ FromDevice::cleanup(CleanupStage stage)
 	_netmap.close(_fd);
 #endif
 #if FROMDEVICE_ALLOW_LINUX
-    if (_fd >= 0 && _method == method_linux) {
-	if (_was_promisc >= 0)
-	    set_promiscuous(_fd, _ifname, _was_promisc);
-	close(_fd);
+    if (_fd >= 0 && (_method == method_linux || _method == method_mmap)
+	&& _was_promisc >= 0)
+	set_promiscuous(_fd, _ifname, _was_promisc);
+    for (int i = 0; i < _socks.size(); ++i) {
+	RxSocket *s = _socks[i];
+	if (s->fd >= 0)
+	    close(s->fd);
+	s->fd = -1;
+# if FROMDEVICE_ALLOW_MMAP
+	if (s->ring) {
+	    // the mapping stays until every outstanding packet is freed
+	    s->ring->unuse();
+	    s->ring = 0;
+	}
+# endif
     }
 #endif
 #if FROMDEVICE_ALLOW_PCAP
@@ -468,7 +798,7 @@ FromDevice::emit_packet(WritablePacket *p, int extra_len, const Timestamp &ts)
     SET_EXTRA_LENGTH_ANNO(p, extra_len);
 
     if (!_force_ip || fake_pcap_force_ip(p, _datalink))
-	output(0).push(p);
+	_batch.append(p);
     else
 	checked_output_push(1, p);
 }
@@ -499,7 +829,7 @@ CLICK_DECLS
 
 
 void
-FromDevice::selected(int, int)
+FromDevice::selected(int fd, int)
 {
     // netmap and pcap are essentially the same code, different
     // dispatch function. This code is also in run_task()
@@ -509,6 +839,7 @@ FromDevice::selected(int, int)
 	// Read and push() at most one burst of packets.
 	int r = _netmap.dispatch(_burst,
 		reinterpret_cast<nm_cb_t>(FromDevice_get_packet), (u_char *) this);
+	output(0).push_batch(_batch);
 	if (r > 0) {
 	    _count += r;
 	    _task.reschedule();
@@ -521,6 +852,7 @@ FromDevice::selected(int, int)
     if (_method == method_pcap) {
 	// Read and push() at most one burst of packets.
 	int r = pcap_dispatch(_pcap, _burst, FromDevice_get_packet, (u_char *) this);
+	output(0).push_batch(_batch);
 	if (r > 0) {
 	    _count += r;
 	    _task.reschedule();
@@ -529,42 +861,77 @@ FromDevice::selected(int, int)
     }
 #endif
 #if FROMDEVICE_ALLOW_LINUX
-    int nlinux = 0;
-    while (_method == method_linux && nlinux < _burst) {
+    if (_method == method_linux || _method == method_mmap)
+	for (int i = 0; i < _socks.size(); ++i)
+	    if (_socks[i]->fd == fd) {
+# if FROMDEVICE_ALLOW_MMAP
+		if (_method == method_mmap)
+		    ring_dispatch(_socks[i]);
+		else
+# endif
+		    linux_dispatch(_socks[i]);
+		break;
+	    }
+#endif
+}
+
+#if FROMDEVICE_ALLOW_LINUX
+void
+FromDevice::linux_dispatch(RxSocket *s)
+{
+    // Allocate buffers for a whole burst at once; unused ones go back to
+    // the packet pool together.
+    PacketBatch batch, bufs;
+    Packet::make_bulk(_burst, _headroom, _snaplen, 0, bufs);
+    while (Packet *x = bufs.pop_front()) {
+	WritablePacket *p = static_cast<WritablePacket *>(x);
 	struct sockaddr_ll sa;
 	socklen_t fromlen = sizeof(sa);
-	WritablePacket *p = Packet::make(_headroom, 0, _snaplen, 0);
-	int len = recvfrom(_fd, p->data(), p->length(), MSG_TRUNC, (sockaddr *)&sa, &fromlen);
+	int len = recvfrom(s->fd, p->data(), p->length(), MSG_TRUNC, (sockaddr *)&sa, &fromlen);
 	if (len > 0 && (sa.sll_pkttype != PACKET_OUTGOING || _outbound)
-            && (_protocol == 0 || _protocol == sa.sll_protocol)) {
+	    && (_protocol == 0 || _protocol == sa.sll_protocol)) {
 	    if (len > _snaplen) {
 		assert(p->length() == (uint32_t)_snaplen);
 		SET_EXTRA_LENGTH_ANNO(p, len - _snaplen);
 	    } else
 		p->take(_snaplen - len);
 	    p->set_packet_type_anno((Packet::PacketType)sa.sll_pkttype);
-	    p->timestamp_anno().set_timeval_ioctl(_fd, SIOCGSTAMP);
+	    p->timestamp_anno().set_timeval_ioctl(s->fd, SIOCGSTAMP);
 	    p->set_mac_header(p->data());
-	    ++nlinux;
-	    ++_count;
+	    ++s->count;
 	    if (!_force_ip || fake_pcap_force_ip(p, _datalink))
-		output(0).push(p);
+		batch.append(p);
 	    else
 		checked_output_push(1, p);
 	} else {
-	    p->kill();
+	    bufs.prepend(p);
 	    if (len <= 0 && errno != EAGAIN)
 		click_chatter("FromDevice(%s): recvfrom: %s", _ifname.c_str(), strerror(errno));
 	    break;
 	}
     }
-#endif
+    bufs.kill();
+    output(0).push_batch(batch);
 }
+#endif
 
-#if FROMDEVICE_ALLOW_PCAP || FROMDEVICE_ALLOW_NETMAP
+#if FROMDEVICE_ALLOW_PCAP || FROMDEVICE_ALLOW_NETMAP || FROMDEVICE_ALLOW_LINUX
 bool
-FromDevice::run_task(Task *)
+FromDevice::run_task(Task *task)
 {
+# if FROMDEVICE_ALLOW_MMAP
+    if (_method == method_mmap) {
+	// a stalled ring's timer fired: poll it again
+	for (int i = 0; i < _socks.size(); ++i)
+	    if (&_socks[i]->task == task) {
+		set_socket_select(_socks[i], true);
+		ring_dispatch(_socks[i]);
+	    }
+	return true;
+    }
+# else
+    (void) task;
+# endif
     // Read and push() at most one burst of packets.
     int r = 0;
 # if FROMDEVICE_ALLOW_NETMAP
@@ -572,6 +939,7 @@ FromDevice::run_task(Task *)
 	// Read and push() at most one burst of packets.
 	r = _netmap.dispatch(_burst,
 		reinterpret_cast<nm_cb_t>(FromDevice_get_packet), (u_char *) this);
+	output(0).push_batch(_batch);
 	if (r < 0 && ++_pcap_complaints < 5)
 	    ErrorHandler::default_handler()->error("%p{element}: %s",
 			this, "nm_dispatch failed");
@@ -580,13 +948,16 @@ FromDevice::run_task(Task *)
 # if FROMDEVICE_ALLOW_PCAP
     if (_method == method_pcap) {
 	r = pcap_dispatch(_pcap, _burst, FromDevice_get_packet, (u_char *) this);
+	output(0).push_batch(_batch);
 	if (r < 0 && ++_pcap_complaints < 5)
 	    ErrorHandler::default_handler()->error("%p{element}: %s", this, pcap_geterr(_pcap));
     }
 # endif
     if (r > 0) {
 	_count += r;
+# if FROMDEVICE_ALLOW_PCAP || FROMDEVICE_ALLOW_NETMAP
 	_task.fast_reschedule();
+# endif
 	return true;
     } else
 	return false;
@@ -604,12 +975,27 @@ FromDevice::kernel_drops(bool& known, int& max_drops) const
 	    known = true, max_drops = stats.ps_drop;
     }
 #endif
+#if FROMDEVICE_ALLOW_MMAP
+    if (_method == method_mmap) {
+	counter_t drops = 0;
+	for (int i = 0; i < _socks.size(); ++i) {
+	    const_cast<FromDevice *>(this)->ring_stats(_socks[i]);
+	    drops += _socks[i]->ring_drops;
+	}
+	known = true, max_drops = drops;
+    }
+#endif
 #if FROMDEVICE_ALLOW_LINUX && defined(PACKET_STATISTICS)
     if (_method == method_linux) {
-        struct tpacket_stats stats;
-        socklen_t statsize = sizeof(stats);
-        if (getsockopt(_fd, SOL_PACKET, PACKET_STATISTICS, &stats, &statsize) >= 0)
-            known = true, max_drops = stats.tp_drops;
+        known = true, max_drops = 0;
+        for (int i = 0; i < _socks.size(); ++i) {
+            struct tpacket_stats stats;
+            socklen_t statsize = sizeof(stats);
+            if (getsockopt(_socks[i]->fd, SOL_PACKET, PACKET_STATISTICS, &stats, &statsize) >= 0)
+                max_drops += stats.tp_drops;
+            else
+                known = false, max_drops = -1;
+        }
     }
 #endif
 }
@@ -630,8 +1016,41 @@ FromDevice::read_handler(Element* e, void *thunk)
 	    return "??";
     } else if (thunk == (void *) 1)
 	return String(fake_pcap_unparse_dlt(fd->_datalink));
-    else
-	return String(fd->_count);
+#if FROMDEVICE_ALLOW_LINUX
+    else if (thunk == (void *) 3) {
+	counter_t blocks = 0;
+	for (int i = 0; i < fd->_socks.size(); ++i)
+	    blocks += fd->_socks[i]->ring_blocks;
+	return String(blocks);
+    } else if (thunk == (void *) 4) {
+	int held = 0;
+# if FROMDEVICE_ALLOW_MMAP
+	for (int i = 0; i < fd->_socks.size(); ++i)
+	    if (RxRing *ring = fd->_socks[i]->ring)
+		for (unsigned j = 0; j < ring->nblocks; ++j)
+		    held += ring->blocks[j].refcount.value() != 0;
+# endif
+	return String(held);
+    } else if (thunk == (void *) 5) {
+	counter_t freezes = 0;
+	for (int i = 0; i < fd->_socks.size(); ++i) {
+# if FROMDEVICE_ALLOW_MMAP
+	    if (fd->_socks[i]->ring)
+		fd->ring_stats(fd->_socks[i]);
+# endif
+	    freezes += fd->_socks[i]->ring_freezes;
+	}
+	return String(freezes);
+    }
+#endif
+    else {
+	counter_t count = fd->_count;
+#if FROMDEVICE_ALLOW_LINUX
+	for (int i = 0; i < fd->_socks.size(); ++i)
+	    count += fd->_socks[i]->count;
+#endif
+	return String(count);
+    }
 }
 
 int
@@ -639,6 +1058,10 @@ FromDevice::write_handler(const String &, Element *e, void *, ErrorHandler *)
 {
     FromDevice* fd = static_cast<FromDevice*>(e);
     fd->_count = 0;
+#if FROMDEVICE_ALLOW_LINUX
+    for (int i = 0; i < fd->_socks.size(); ++i)
+	fd->_socks[i]->count = 0;
+#endif
     return 0;
 }
 
@@ -648,6 +1071,11 @@ FromDevice::add_handlers()
     add_read_handler("kernel_drops", read_handler, 0);
     add_read_handler("encap", read_handler, 1);
     add_read_handler("count", read_handler, 2);
+#if FROMDEVICE_ALLOW_LINUX
+    add_read_handler("ring_blocks", read_handler, 3);
+    add_read_handler("ring_held", read_handler, 4);
+    add_read_handler("ring_freezes", read_handler, 5);
+#endif
     add_write_handler("reset_counts", write_handler, 0, Handler::BUTTON);
 }
 
@@ -1,6 +1,7 @@
 #ifndef CLICK_FROMDEVICE_USERLEVEL_HH
 #define CLICK_FROMDEVICE_USERLEVEL_HH
 #include <click/element.hh>
+#include <click/timer.hh>
 #include "elements/userlevel/kernelfilter.hh"
 
 #ifdef __linux__
@@ -95,8 +96,15 @@ but the IP header annotation has been set appropriately.) Default is false.
 =item METHOD
 
 Word.  Defines the capture method FromDevice will use to read packets from the
-device.  Linux targets generally support PCAP and LINUX; other targets support
-only PCAP.  Defaults to PCAP.
+device.  Linux targets generally support PCAP, LINUX, and MMAP; other targets
+support only PCAP.  Defaults to PCAP.
+
+METHOD MMAP reads from a memory-mapped TPACKET_V3 receive ring, which the
+kernel fills a block of packets at a time.  Packets are not copied: each
+emitted packet points into the ring, and a ring block is returned to the
+kernel once every packet from it has been freed.  Elements that hold packets
+for a long time, such as large Queues, can therefore stall the ring; size
+RING_BLOCKS accordingly.
 
 =item BPF_FILTER
 
@@ -120,6 +128,42 @@ false.
 Integer. If set and nonzero, then only emit packets with this link-level
 protocol. Only affects METHOD LINUX. Default is 0.
 
+=item RING_BLOCKS
+
+Integer.  Number of blocks in the METHOD MMAP ring.  Defaults to 64.
+
+=item RING_BLOCK_SIZE
+
+Integer.  Size of each METHOD MMAP ring block in bytes, a multiple of the
+page size.  Defaults to 262144.
+
+=item RING_TIMEOUT
+
+Integer.  Milliseconds after which the kernel hands a partly filled METHOD
+MMAP block to FromDevice.  Defaults to 1.
+
+=item FANOUT
+
+Word.  If set, FromDevice opens one packet socket per thread listed in
+THREADS, and joins them in a PACKET_FANOUT group so the kernel spreads
+arriving packets across them.  Each socket is read on its own thread, so
+packets are pushed downstream concurrently; the downstream elements must be
+thread safe.  The value selects how the kernel picks a socket: HASH (by flow
+hash, so each flow stays on one thread), CPU (by the CPU that received the
+packet), LB (round robin), or QM (by the device's receive queue).  Only
+affects METHOD LINUX and MMAP.  By default there is no fanout group.
+
+=item THREADS
+
+String.  Space-separated list of the thread IDs that read the FANOUT group's
+sockets, one socket per entry.  Defaults to every thread.
+
+=item FANOUT_GROUP
+
+Integer.  The PACKET_FANOUT group ID, between 0 and 65535.  Sockets from
+other processes may join the same group.  Defaults to a value derived from
+the process ID.
+
 =item HEADROOM
 
 Integer. Amount of bytes of headroom to leave before the packet data. Defaults
@@ -128,6 +172,9 @@ to roughly 28.
 =item BURST
 
 Integer. Maximum number of packets to read per scheduling. Defaults to 1.
+The packets read in one scheduling are pushed to output 0 as a single batch.
+METHOD MMAP always consumes whole ring blocks, so it may read more than BURST
+packets at a time.
 
 =item TIMESTAMP
 
@@ -145,7 +192,8 @@ FromDevice sets packets' extra length annotations as appropriate.
 
 =h count read-only
 
-Returns the number of packets read by the device.
+Returns the number of packets read by the device.  With FANOUT, this sums
+over all sockets in the group, as do the kernel_drops and ring handlers.
 
 =h reset_counts write-only
 
@@ -158,6 +206,19 @@ constraints, before FromDevice could get them. This may be an integer; the
 notation C<"<I<d>">, meaning at most C<I<d>> drops; or C<"??">, meaning the
 number of drops is not known.
 
+=h ring_blocks read-only
+
+Returns the number of METHOD MMAP ring blocks received from the kernel.
+
+=h ring_held read-only
+
+Returns the number of METHOD MMAP ring blocks that are waiting for some of
+their packets to be freed before they can be returned to the kernel.
+
+=h ring_freezes read-only
+
+Returns the number of times the kernel found the METHOD MMAP ring full.
+
 =h encap read-only
 
 Returns a string indicating the encapsulation type on this link. Can be
@@ -197,8 +258,8 @@ class FromDevice : public Element { public:
 #endif
 
 #if FROMDEVICE_ALLOW_LINUX
-    int linux_fd() const		{ return _method == method_linux ? _fd : -1; }
-    static int open_packet_socket(String, ErrorHandler *);
+    int linux_fd() const		{ return _method == method_linux || _method == method_mmap ? _fd : -1; }
+    static int open_packet_socket(String, ErrorHandler *, bool receive = true);
     static int set_promiscuous(int, String, bool);
 #endif
 
@@ -206,7 +267,7 @@ class FromDevice : public Element { public:
     const NetmapInfo *netmap() const { return _method == method_netmap ? &_netmap : 0; }
 #endif
 
-#if FROMDEVICE_ALLOW_NETMAP || FROMDEVICE_ALLOW_PCAP
+#if FROMDEVICE_ALLOW_NETMAP || FROMDEVICE_ALLOW_PCAP || FROMDEVICE_ALLOW_LINUX
     bool run_task(Task *task);
 #endif
 
@@ -214,6 +275,12 @@ class FromDevice : public Element { public:
 
   private:
 
+#if HAVE_INT64_TYPES
+    typedef uint64_t counter_t;
+#else
+    typedef uint32_t counter_t;
+#endif
+
 #if FROMDEVICE_ALLOW_LINUX || FROMDEVICE_ALLOW_PCAP || FROMDEVICE_ALLOW_NETMAP
     int _fd;
 #endif
@@ -231,11 +298,28 @@ class FromDevice : public Element { public:
     NetmapInfo _netmap;
     int netmap_dispatch();
 #endif
+#if FROMDEVICE_ALLOW_LINUX
+    struct RxRing;
+    struct RxSocket;
+    Vector<RxSocket *> _socks;	// one, or one per FANOUT thread
+    unsigned _ring_nblocks;
+    unsigned _ring_block_size;
+    unsigned _ring_timeout;
+    int _fanout;
+    int _fanout_group;
+    int open_socket(RxSocket *s, ErrorHandler *errh);
+    int open_ring(RxSocket *s, ErrorHandler *errh);
+    void linux_dispatch(RxSocket *s);
+    void ring_dispatch(RxSocket *s);
+    void ring_stats(RxSocket *s);
+    void set_socket_select(RxSocket *s, bool on);
+#endif
 #if FROMDEVICE_ALLOW_PCAP || FROMDEVICE_ALLOW_NETMAP
     friend void FromDevice_get_packet(u_char*, const struct pcap_pkthdr*,
                                       const u_char*);
 #endif
 
+    PacketBatch _batch;		// packets for output 0, pushed per burst
     bool _force_ip;
 #if FROMDEVICE_ALLOW_PCAP && TIMESTAMP_NANOSEC && defined(PCAP_TSTAMP_PRECISION_NANO)
     bool _pcap_nanosec;
@@ -243,11 +327,6 @@ class FromDevice : public Element { public:
     int _burst;
     int _datalink;
 
-#if HAVE_INT64_TYPES
-    typedef uint64_t counter_t;
-#else
-    typedef uint32_t counter_t;
-#endif
     counter_t _count;
 
     String _ifname;
@@ -259,7 +338,8 @@ class FromDevice : public Element { public:
     int _snaplen;
     uint16_t _protocol;
     unsigned _headroom;
-    enum { method_default, method_netmap, method_pcap, method_linux };
+    enum { method_default, method_netmap, method_pcap, method_linux,
+	   method_mmap };
     int _method;
 #if FROMDEVICE_ALLOW_PCAP
     String _bpf_filter;
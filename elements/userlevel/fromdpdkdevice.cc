@@ -24,6 +24,7 @@
 #include <click/error.hh>
 #include <click/standard/scheduleinfo.hh>
 #include <click/straccum.hh>
+#include <click/master.hh>
 
 #include "fromdpdkdevice.hh"
 
@@ -31,33 +32,104 @@ CLICK_DECLS
 
 FromDPDKDevice::FromDPDKDevice() :
     _dev(0), _queue_id(0), _promisc(true),
-    _count(0), _active(true), _task(this)
+    _active(true), _max_threads(-1)
 {
     _burst_size = DPDKDevice::DEF_BURST_SIZE;
 }
 
 FromDPDKDevice::~FromDPDKDevice()
 {
+    for (int i = 0; i < _queues.size(); i++)
+        delete _queues[i];
+}
+
+int FromDPDKDevice::parse_rss_key(const String &str, String &key,
+                                  uint16_t key_size)
+{
+    if (str.equals("SYMMETRIC", -1)) {
+        // A key repeating 16 bits hashes (a, b) and (b, a) alike
+        char *x = key.extend(key_size);
+        for (uint16_t i = 0; i < key_size; i++)
+            x[i] = (i & 1) ? 0x5a : 0x6d;
+        return 0;
+    }
+
+    StringAccum sa;
+    int nibble = -1;
+    for (const char *s = str.begin(); s != str.end(); ++s) {
+        int d;
+        if (*s >= '0' && *s <= '9')
+            d = *s - '0';
+        else if (*s >= 'a' && *s <= 'f')
+            d = *s - 'a' + 10;
+        else if (*s >= 'A' && *s <= 'F')
+            d = *s - 'A' + 10;
+        else if (*s == ':' && nibble < 0)
+            continue;
+        else
+            return -1;
+        if (nibble < 0)
+            nibble = d;
+        else {
+            sa << (char) ((nibble << 4) | d);
+            nibble = -1;
+        }
+    }
+    if (nibble >= 0 || !sa.length())
+        return -1;
+    key = sa.take_string();
+    return 0;
+}
+
+int FromDPDKDevice::parse_rss_hash(const String &str, uint64_t &hash_fields)
+{
+    Vector<String> words;
+    cp_spacevec(str, words);
+    hash_fields = 0;
+    for (int i = 0; i < words.size(); i++) {
+        if (words[i] == "IP")
+            hash_fields |= ETH_RSS_IP;
+        else if (words[i] == "TCP")
+            hash_fields |= ETH_RSS_TCP;
+        else if (words[i] == "UDP")
+            hash_fields |= ETH_RSS_UDP;
+        else if (words[i] == "SCTP")
+            hash_fields |= ETH_RSS_SCTP;
+        else if (words[i] == "L2_PAYLOAD")
+            hash_fields |= ETH_RSS_L2_PAYLOAD;
+        else
+            return -1;
+    }
+    return 0;
 }
 
 int FromDPDKDevice::configure(Vector<String> &conf, ErrorHandler *errh)
 {
     int n_desc = -1;
+    int n_queues = 1;
     String dev;
     bool allow_nonexistent = false;
     EtherAddress mac;
     uint16_t mtu = 0;
     bool has_mac = false;
     bool has_mtu = false;
+    bool has_n_queues = false;
+    String rss_key_str, rss_hash_str;
+    bool has_rss_key = false;
+    bool has_rss_hash = false;
 
     if (Args(conf, this, errh)
         .read_mp("PORT", dev)
         .read_p("QUEUE", _queue_id)
+        .read("N_QUEUES", n_queues).read_status(has_n_queues)
+        .read("MAXTHREADS", _max_threads)
         .read("PROMISC", _promisc)
         .read("BURST", _burst_size)
         .read("NDESC", n_desc)
         .read("MAC", mac).read_status(has_mac)
         .read("MTU", mtu).read_status(has_mtu)
+        .read("RSS_KEY", AnyArg(), rss_key_str).read_status(has_rss_key)
+        .read("RSS_HASH", AnyArg(), rss_hash_str).read_status(has_rss_hash)
         .read("ALLOW_NONEXISTENT", allow_nonexistent)
         .read("ACTIVE", _active)
         .complete() < 0)
@@ -76,9 +148,51 @@ int FromDPDKDevice::configure(Vector<String> &conf, ErrorHandler *errh)
     if (has_mtu)
         _dev->set_init_mtu(mtu);
 
-    return _dev->add_rx_queue(_queue_id, _promisc, (n_desc > 0) ?
-                                n_desc : DPDKDevice::DEF_DEV_RXDESC,
-                                errh);
+    if (has_rss_key || has_rss_hash) {
+        String key;
+        uint64_t hash_fields = ETH_RSS_IP | ETH_RSS_UDP | ETH_RSS_TCP;
+        uint16_t key_size = 40;
+#if RTE_VERSION >= RTE_VERSION_NUM(17,02,0,0)
+        struct rte_eth_dev_info dev_info;
+        memset(&dev_info, 0, sizeof(dev_info));
+# if RTE_VERSION >= RTE_VERSION_NUM(19,11,0,0)
+        // On failure keep the default 40-byte key.
+        if (rte_eth_dev_info_get(_dev->port_id, &dev_info) == 0
+            && dev_info.hash_key_size > 0)
+            key_size = dev_info.hash_key_size;
+# else
+        rte_eth_dev_info_get(_dev->port_id, &dev_info);
+        if (dev_info.hash_key_size > 0)
+            key_size = dev_info.hash_key_size;
+# endif
+#endif
+        if (has_rss_key && parse_rss_key(cp_unquote(rss_key_str), key, key_size) < 0)
+            return errh->error("RSS_KEY must be a hexadecimal string or SYMMETRIC");
+        if (has_rss_hash && parse_rss_hash(cp_unquote(rss_hash_str), hash_fields) < 0)
+            return errh->error("RSS_HASH must be a list of IP, TCP, UDP, SCTP, and L2_PAYLOAD");
+        if (_dev->set_init_rss(key, hash_fields, errh) < 0)
+            return -1;
+    }
+
+    // One queue per thread, up to MAXTHREADS
+    int n_threads = master()->nthreads();
+    if (_max_threads > 0 && _max_threads < n_threads)
+        n_threads = _max_threads;
+    if (n_queues < 0 || (!has_n_queues && _max_threads > 0))
+        n_queues = n_threads;
+    if (n_queues == 0)
+        return errh->error("N_QUEUES must not be zero");
+
+    for (int i = 0; i < n_queues; i++) {
+        unsigned queue_id = _queue_id ? _queue_id + i : 0;
+        if (_dev->add_rx_queue(queue_id, _promisc, (n_desc > 0) ?
+                               n_desc : DPDKDevice::DEF_DEV_RXDESC,
+                               errh) < 0)
+            return -1;
+        _queues.push_back(new RXQueue(this, queue_id));
+    }
+
+    return 0;
 }
 
 int FromDPDKDevice::initialize(ErrorHandler *errh)
@@ -86,7 +200,22 @@ int FromDPDKDevice::initialize(ErrorHandler *errh)
     if (!_dev)
         return 0;
 
-    ScheduleInfo::initialize_task(this, &_task, true, errh);
+    /* each task polls an RX queue bound to its thread. The first runs on
+     * the home thread, the others on the following threads. */
+    int n_threads = master()->nthreads();
+    int n_used = n_threads;
+    if (_max_threads > 0 && _max_threads < n_used)
+        n_used = _max_threads;
+    int home = router()->home_thread_id(this);
+    if (home < 0)
+        home = 0;
+    for (int i = 0; i < _queues.size(); i++) {
+        RXQueue *q = _queues[i];
+        if (i > 0)
+            q->task.move_thread((home + i % n_used) % n_threads);
+        ScheduleInfo::initialize_task(this, &q->task, _active, errh);
+        q->task.set_pinned(true);
+    }
 
     return DPDKDevice::initialize(errh);
 }
@@ -97,9 +226,14 @@ void FromDPDKDevice::cleanup(CleanupStage)
 
 bool FromDPDKDevice::run_task(Task * t)
 {
+    RXQueue *q = _queues[0];
+    for (int i = 1; &q->task != t; i++)
+        q = _queues[i];
+
     struct rte_mbuf *pkts[_burst_size];
+    PacketBatch batch;
 
-    unsigned n = rte_eth_rx_burst(_dev->port_id, _queue_id, pkts, _burst_size);
+    unsigned n = rte_eth_rx_burst(_dev->port_id, q->queue_id, pkts, _burst_size);
     for (unsigned i = 0; i < n; ++i) {
         unsigned char* data = rte_pktmbuf_mtod(pkts[i], unsigned char *);
         rte_prefetch0(data);
@@ -112,9 +246,10 @@ bool FromDPDKDevice::run_task(Task * t)
         p->set_packet_type_anno(Packet::HOST);
         p->set_mac_header(data);
 
-        output(0).push(p);
+        batch.append(p);
     }
-    _count += n;
+    output(0).push_batch(batch);
+    q->count += n;
 
     /* We reschedule directly, as we cannot know if there is actually packet
      * available and DPDK has no select mechanism*/
@@ -128,8 +263,23 @@ String FromDPDKDevice::read_handler(Element *e, void * thunk)
     FromDPDKDevice *fd = static_cast<FromDPDKDevice *>(e);
 
     switch((uintptr_t) thunk) {
-        case h_count:
-            return String(fd->_count);
+        case h_count: {
+            unsigned long count = 0;
+            for (int i = 0; i < fd->_queues.size(); i++)
+                count += fd->_queues[i]->count;
+            return String(count);
+        }
+        case h_queue_counts: {
+            StringAccum sa;
+            for (int i = 0; i < fd->_queues.size(); i++) {
+                RXQueue *q = fd->_queues[i];
+                sa << q->queue_id << ' ' << q->task.home_thread_id() << ' '
+                   << q->count << '\n';
+            }
+            return sa.take_string();
+        }
+        case h_n_queues:
+            return String(fd->_queues.size());
         case h_active:
               if (!fd->_dev)
                   return "false";
@@ -240,15 +390,18 @@ int FromDPDKDevice::write_handler(
                 return errh->error("Not a valid boolean");
             if (fd->_active != active) {
                 fd->_active = active;
-                if (fd->_active)
-                    fd->_task.reschedule();
-                else
-                    fd->_task.unschedule();
+                for (int i = 0; i < fd->_queues.size(); i++) {
+                    if (fd->_active)
+                        fd->_queues[i]->task.reschedule();
+                    else
+                        fd->_queues[i]->task.unschedule();
+                }
             }
             return 0;
         }
         case h_reset_count:
-            fd->_count = 0;
+            for (int i = 0; i < fd->_queues.size(); i++)
+                fd->_queues[i]->count = 0;
             return 0;
     }
     return -1;
@@ -302,6 +455,8 @@ int FromDPDKDevice::xstats_handler(
 void FromDPDKDevice::add_handlers()
 {
     add_read_handler("count", read_handler, h_count);
+    add_read_handler("queue_counts", read_handler, h_queue_counts);
+    add_read_handler("n_queues", read_handler, h_n_queues);
     add_write_handler("reset_count", write_handler, h_reset_count,
                           Handler::BUTTON);
 
@@ -13,7 +13,7 @@ CLICK_DECLS
 
 =c
 
-FromDPDKDevice(PORT [, QUEUE [, I<keywords> PROMISC, BURST, NDESC]])
+FromDPDKDevice(PORT [, QUEUE [, I<keywords> N_QUEUES, MAXTHREADS, PROMISC, BURST, NDESC, RSS_KEY, RSS_HASH]])
 
 =s netdevices
 
@@ -28,11 +28,16 @@ received by devices put in DPDK mode will NOT be received by the kernel, and
 will thus be processed only once.
 
 To use RSS (Receive Side Scaling) to receive packets from the same device
-on multiple queues (possibly pinned to different Click threads), simply
-use multiple FromDPDKDevice with the same PORT argument. Each
-FromDPDKDevice will open a different RX queue attached to the same port,
-and packets will be dispatched among the FromDPDKDevice elements that
-you can pin to different thread using StaticThreadSched.
+on multiple queues pinned to different Click threads, set N_QUEUES or
+MAXTHREADS.  FromDPDKDevice then opens N_QUEUES RX queues on the port, and
+polls each of them from its own task.  The task of the first queue runs on
+the element's home thread (see StaticThreadSched), and the tasks of the
+following queues on the following threads, wrapping around after MAXTHREADS
+threads.  The device dispatches received packets among the queues according
+to a hash of the fields selected by RSS_HASH, so all packets of a flow are
+received by the same thread.  Alternatively, use multiple FromDPDKDevice with
+the same PORT argument, each opening a different RX queue attached to the
+same port.
 
 Arguments:
 
@@ -45,8 +50,19 @@ format fffff:ff:ff.f
 
 =item QUEUE
 
-Integer.  Index of the queue to use. If omitted or negative, auto-increment
-between FromDPDKDevice attached to the same port will be used.
+Integer.  Index of the first queue to use. If omitted or negative,
+auto-increment between FromDPDKDevice attached to the same port will be used.
+
+=item N_QUEUES
+
+Integer.  Number of RX queues to open and poll.  If negative, one queue per
+thread is used, up to MAXTHREADS.  Defaults to 1, or to -1 if MAXTHREADS is
+given.
+
+=item MAXTHREADS
+
+Integer.  Maximum number of threads polling the queues.  Defaults to all the
+threads.
 
 =item PROMISC
 
@@ -56,12 +72,27 @@ true. The default is false.
 =item BURST
 
 Integer.  Maximal number of packets that will be processed before rescheduling.
-The default is 32.
+The default is 32.  The packets received in one burst are pushed downstream as
+a single batch.
 
 =item NDESC
 
 Integer.  Number of descriptors per ring. The default is 256.
 
+=item RSS_KEY
+
+Either a hexadecimal string, such as "6d5a6d5a...", or C<SYMMETRIC>.  The key
+of the RSS hash function.  Its length must be the device's hash key size,
+which is 40 bytes for most devices.  C<SYMMETRIC> sets the key to a repeated
+0x6d5a pattern, so that both directions of a flow hash to the same queue.
+Defaults to the driver's key.
+
+=item RSS_HASH
+
+Space-separated list of C<IP>, C<TCP>, C<UDP>, C<SCTP>, and C<L2_PAYLOAD>.
+The packet fields the RSS hash function is computed over; fields the device
+cannot hash are ignored.  Defaults to "IP TCP UDP".
+
 =item MAC
 
 Colon-separated string. The device's MAC address.
@@ -88,13 +119,31 @@ support.
 
   FromDPDKDevice(3, QUEUE 1) -> ...
 
+This configuration receives packets on four RSS queues polled by four threads.
+It can be tried without a DPDK-capable NIC using the pcap virtual device,
+which reads a queue's packets from each rx_pcap file:
+
+  // click --dpdk -l 0-3 --vdev=net_pcap0,rx_pcap=a.pcap,rx_pcap=b.pcap,\
+  //   rx_pcap=c.pcap,rx_pcap=d.pcap,tx_pcap=out.pcap -- conf.click
+  FromDPDKDevice(0, N_QUEUES 4) -> Counter -> ToDPDKDevice(0);
+
 =h count read-only
 
-Returns the number of packets processed by this FromDPDKDevice
+Returns the number of packets processed by this FromDPDKDevice, summed over
+its queues.
+
+=h queue_counts read-only
+
+Returns the number of packets received on each of this FromDPDKDevice's
+queues, one queue per line, as "QUEUE THREAD COUNT".
+
+=h n_queues read-only
+
+Returns the number of RX queues polled by this FromDPDKDevice.
 
 =h reset_count write-only
 
-Resets "count" to zero.
+Resets "count" and the queue counts to zero.
 
 =h hw_count read-only
 
@@ -201,8 +250,21 @@ private:
     static String statistics_handler(Element *e, void *thunk) CLICK_COLD;
     static int xstats_handler(int operation, String &input, Element *e,
                               const Handler *handler, ErrorHandler *errh);
+    /* RXQueue is one of the RX queues opened by this element, and the task
+     * polling it on its thread. */
+    struct RXQueue {
+        RXQueue(FromDPDKDevice *e, unsigned queue_id)
+            : task(e), queue_id(queue_id), count(0) { }
+        Task task;
+        unsigned queue_id;
+        unsigned long count;
+    } __attribute__((aligned(64)));
+
+    static int parse_rss_key(const String &, String &, uint16_t key_size);
+    static int parse_rss_hash(const String &, uint64_t &);
+
     enum {
-        h_count, h_reset_count,
+        h_count, h_reset_count, h_queue_counts, h_n_queues,
         h_driver, h_carrier, h_duplex, h_autoneg, h_speed,
         h_ipackets, h_ibytes, h_imissed, h_ierrors,
         h_active,
@@ -215,10 +277,10 @@ private:
     unsigned _queue_id;
     bool _promisc;
     unsigned int _burst_size;
-    unsigned long _count;
     bool _active;
 
-    Task _task;
+    Vector<RXQueue *> _queues;
+    int _max_threads;
 };
 
 CLICK_ENDDECLS
@@ -31,6 +31,9 @@
 #if CLICK_NS
 # include <click/master.hh>
 #endif
+#if CLICK_USERLEVEL
+# include <click/routerthread.hh>
+#endif
 #include "fakepcap.hh"
 #include <unistd.h>
 #include <sys/types.h>
@@ -47,7 +50,9 @@ CLICK_DECLS
 	( (((y)&0xff)<<8) | ((u_short)((y)&0xff00)>>8) )
 
 FromDump::FromDump()
-    : _packet(0), _end_h(0), _count(0), _timer(this), _task(this)
+    : _packet(0), _io_uring(false), _pcapng(false), _loop(1), _pass(0),
+      _pass_has_records(false), _first_record_pos(0), _first_record_nifs(0),
+      _end_h(0), _count(0), _timer(this), _task(this)
 {
 }
 
@@ -106,6 +111,8 @@ FromDump::configure(Vector<String> &conf, ErrorHandler *errh)
 	.read("PER_NODE", per_node)
 #endif
 	.read("FILEPOS", _packet_filepos)
+	.read("LOOP", _loop)
+	.read("IO_URING", _io_uring)
 	.complete() < 0)
 	return -1;
 
@@ -188,6 +195,62 @@ swap_packet_header(const fake_pcap_pkthdr *hp, fake_pcap_pkthdr *outp)
     outp->len = SWAPLONG(hp->len);
 }
 
+static inline uint16_t
+pcapng_u16(const void *p, bool swapped)
+{
+    uint16_t x;
+    memcpy(&x, p, sizeof(x));
+    return swapped ? SWAPSHORT(x) : x;
+}
+
+static inline uint32_t
+pcapng_u32(const void *p, bool swapped)
+{
+    uint32_t x;
+    memcpy(&x, p, sizeof(x));
+    return swapped ? SWAPLONG(x) : x;
+}
+
+static inline uint64_t
+pcapng_u64(const void *p, bool swapped)
+{
+    const uint8_t *u = reinterpret_cast<const uint8_t *>(p);
+    uint32_t a = pcapng_u32(u, swapped), b = pcapng_u32(u + 4, swapped);
+    // a 64-bit quantity is stored in the section's byte order
+    if (swapped == (CLICK_BYTE_ORDER == CLICK_BIG_ENDIAN))
+	return ((uint64_t) b << 32) | a;
+    else
+	return ((uint64_t) a << 32) | b;
+}
+
+static Timestamp
+pcapng_timestamp(uint64_t t, uint8_t tsresol, int64_t tsoffset)
+{
+    // if_tsresol: MSB clear means units of 10^-n seconds, set means 2^-n
+    uint64_t sec, nsec;
+    int n = tsresol & 0x7F;
+    if (tsresol & 0x80) {
+	sec = t >> n;
+	uint64_t frac = t & ((1ULL << n) - 1);
+	if (n > 32) {
+	    frac >>= n - 32;
+	    n = 32;
+	}
+	nsec = (frac * 1000000000) >> n;
+    } else {
+	uint64_t units = 1;
+	for (int i = 0; i < n; ++i)
+	    units *= 10;
+	sec = t / units;
+	nsec = t % units;
+	for (; n < 9; ++n)
+	    nsec *= 10;
+	for (; n > 9; --n)
+	    nsec /= 10;
+    }
+    return Timestamp::make_nsec(sec + tsoffset, nsec);
+}
+
 FromDump *
 FromDump::hotswap_element() const
 {
@@ -199,27 +262,8 @@ FromDump::hotswap_element() const
 }
 
 int
-FromDump::initialize(ErrorHandler *errh)
+FromDump::initialize_pcap(ErrorHandler *errh)
 {
-    // make sure notifier is initialized
-    if (!output_is_push(0))
-	_notifier.initialize(Notifier::EMPTY_NOTIFIER, router());
-
-    // check handler call, initialize Task
-    if (_end_h && _end_h->initialize_write(this, errh) < 0)
-	return -1;
-    if (output_is_push(0))
-	ScheduleInfo::initialize_task(this, &_task, _active, errh);
-    _timer.initialize(this);
-
-    // skip if hotswapping
-    if (hotswap_element())
-	return 0;
-
-    // open file
-    if (_ff.initialize(errh) < 0)
-	return -1;
-
     // check magic number
     fake_pcap_file_header swapped_fh;
     const fake_pcap_file_header *fh = (const fake_pcap_file_header *)_ff.get_aligned(sizeof(fake_pcap_file_header), &swapped_fh);
@@ -247,6 +291,76 @@ FromDump::initialize(ErrorHandler *errh)
     _minor_version = fh->version_minor;
     // map possible host link types to global link types
     _linktype = fake_pcap_canonical_dlt(fh->linktype, true);
+    return 0;
+}
+
+int
+FromDump::initialize_pcapng(ErrorHandler *errh)
+{
+    // read blocks until the first interface is described
+    _pcapng = true;
+    Timestamp ts;
+    int len, caplen, skiplen;
+    while (_pcapng_ifs.empty()) {
+	int r = read_pcapng_block(ts, len, caplen, skiplen, errh);
+	if (r < 0)
+	    return -1;
+	else if (r == 0)
+	    return _ff.error(errh, "not a tcpdump file (no pcapng interfaces)");
+	else if (r == 1)
+	    return _ff.error(errh, "pcapng packet block before interface description");
+    }
+    _linktype = _pcapng_ifs[0].linktype;
+    _first_record_nifs = _pcapng_ifs.size();
+    return 0;
+}
+
+int
+FromDump::initialize(ErrorHandler *errh)
+{
+    // make sure notifier is initialized
+    if (!output_is_push(0))
+	_notifier.initialize(Notifier::EMPTY_NOTIFIER, router());
+
+    // check handler call, initialize Task
+    if (_end_h && _end_h->initialize_write(this, errh) < 0)
+	return -1;
+    if (output_is_push(0))
+	ScheduleInfo::initialize_task(this, &_task, _active, errh);
+    _timer.initialize(this);
+
+    // The io_uring belongs to the home thread, so only that thread may read.
+    if (_io_uring) {
+	if (!output_is_push(0))
+	    return errh->error("IO_URING requires a push output");
+	_task.set_pinned(true);
+#if CLICK_USERLEVEL && HAVE_LINUX_IO_URING_H
+	if (IOUring *ring = home_thread()->io_uring())
+	    _ff.set_io_uring(ring);
+	else
+#endif
+	    errh->warning("io_uring not available, ignoring IO_URING");
+    }
+
+    // skip if hotswapping
+    if (hotswap_element())
+	return 0;
+
+    // open file
+    if (_ff.initialize(errh) < 0)
+	return -1;
+
+    // pcapng files start with a Section Header Block
+    uint32_t magic_buf;
+    const uint32_t *magic = (const uint32_t *)_ff.get_aligned(sizeof(uint32_t), &magic_buf);
+    if (!magic)
+	return _ff.error(errh, "not a tcpdump file (too short)");
+    _ff.shift_pos(-(int) sizeof(uint32_t));
+    int r = (*magic == FAKE_PCAPNG_SHB ? initialize_pcapng(errh) : initialize_pcap(errh));
+    if (r < 0)
+	return r;
+    _packet_linktype = _linktype;
+    _first_record_pos = _ff.file_pos();
 
     // if forcing IP packets, check datalink type to ensure we understand it
     if (_force_ip) {
@@ -280,6 +394,15 @@ FromDump::take_state(Element *e, ErrorHandler *errh)
     _minor_version = o->_minor_version;
 
     _linktype = o->_linktype;
+    _packet_linktype = o->_packet_linktype;
+    _pcapng = o->_pcapng;
+    _pcapng_ifs.swap(o->_pcapng_ifs);
+    _pass = o->_pass;
+    _pass_has_records = o->_pass_has_records;
+    _first_record_pos = o->_first_record_pos;
+    _first_record_nifs = o->_first_record_nifs;
+    _first_record_ts = o->_first_record_ts;
+    _last_record_ts = o->_last_record_ts;
     if (_linktype == FAKE_DLT_RAW)
 	_force_ip = true;
     else if (_force_ip && !fake_pcap_dlt_force_ipable(_linktype))
@@ -324,22 +447,166 @@ FromDump::prepare_times(const Timestamp &ts)
     _have_any_times = true;
 }
 
+/* Read one pcapng block.  Returns 1 for a packet block, whose header
+   fields are stored in the arguments, 2 for any other block, 0 at end of
+   file, and -1 on error. */
+int
+FromDump::read_pcapng_block(Timestamp &ts, int &len, int &caplen, int &skiplen, ErrorHandler *errh)
+{
+    off_t filepos = _ff.file_pos();
+    uint32_t hbuf[5];
+    const uint8_t *h = _ff.get_aligned(8, hbuf);
+    if (!h)
+	return 0;
+
+    uint32_t type = pcapng_u32(h, false);
+    uint32_t blen = pcapng_u32(h + 4, false);
+    if (type == FAKE_PCAPNG_SHB) {
+	// a new section, possibly with a new byte order
+	uint32_t bom;
+	const uint8_t *b = _ff.get_aligned(4, &bom);
+	if (!b)
+	    return _ff.error(errh, "pcapng section header truncated");
+	uint32_t magic = pcapng_u32(b, false);
+	if (magic == FAKE_PCAPNG_BYTE_ORDER_MAGIC)
+	    _swapped = false;
+	else if (magic == SWAPLONG(FAKE_PCAPNG_BYTE_ORDER_MAGIC))
+	    _swapped = true;
+	else
+	    return _ff.error(errh, "bad pcapng byte-order magic");
+    } else
+	type = pcapng_u32(h, _swapped);
+
+    if (_swapped)
+	blen = SWAPLONG(blen);
+    if (blen < 12 || (blen & 3) || blen > 0x40000000
+	|| (type == FAKE_PCAPNG_SHB && blen < 28))
+	return _ff.error(errh, "bad pcapng block length; giving up");
+    uint32_t body = blen - 12;
+
+    if (type == FAKE_PCAPNG_SHB) {
+	// byte-order magic already read
+	String s = _ff.get_string(body - 4, errh);
+	if (s.length() != (int) body - 4)
+	    return -1;
+	if (pcapng_u16(s.data(), _swapped) != FAKE_PCAPNG_VERSION_MAJOR)
+	    return _ff.error(errh, "unknown pcapng major version %d", pcapng_u16(s.data(), _swapped));
+	_pcapng_ifs.clear();
+	_ff.shift_pos(4);
+	return 2;
+
+    } else if (type == FAKE_PCAPNG_IDB) {
+	if (body < 8)
+	    return _ff.error(errh, "bad pcapng interface description; giving up");
+	String s = _ff.get_string(body, errh);
+	if (s.length() != (int) body)
+	    return -1;
+	PcapngInterface pi;
+	pi.linktype = fake_pcap_canonical_dlt(pcapng_u16(s.data(), _swapped), true);
+	pi.snaplen = pcapng_u32(s.data() + 4, _swapped);
+	pi.tsresol = 6;
+	pi.tsoffset = 0;
+	for (uint32_t o = 8; o + 4 <= body; ) {
+	    int code = pcapng_u16(s.data() + o, _swapped);
+	    uint32_t olen = pcapng_u16(s.data() + o + 2, _swapped);
+	    const char *val = s.data() + o + 4;
+	    if (code == FAKE_PCAPNG_OPT_ENDOFOPT || o + 4 + olen > body)
+		break;
+	    else if (code == FAKE_PCAPNG_OPT_IF_TSRESOL && olen >= 1)
+		pi.tsresol = val[0];
+	    else if (code == FAKE_PCAPNG_OPT_IF_TSOFFSET && olen >= 8)
+		pi.tsoffset = pcapng_u64(val, _swapped);
+	    o += 4 + ((olen + 3) & ~3U);
+	}
+	if ((pi.tsresol & 0x80) ? (pi.tsresol & 0x7F) > 63 : pi.tsresol > 19)
+	    return _ff.error(errh, "unsupported pcapng timestamp resolution %d", pi.tsresol);
+	_pcapng_ifs.push_back(pi);
+	_ff.shift_pos(4);
+	return 2;
+
+    } else if (type == FAKE_PCAPNG_EPB || type == FAKE_PCAPNG_OPB) {
+	if (body < 20)
+	    return _ff.error(errh, "bad pcapng packet block; giving up");
+	if (!(h = _ff.get_aligned(20, hbuf)))
+	    return 0;
+	uint32_t ifid;
+	if (type == FAKE_PCAPNG_EPB)
+	    ifid = pcapng_u32(h, _swapped);
+	else
+	    ifid = pcapng_u16(h, _swapped);
+	uint64_t t = ((uint64_t) pcapng_u32(h + 4, _swapped) << 32)
+	    | pcapng_u32(h + 8, _swapped);
+	uint32_t cl = pcapng_u32(h + 12, _swapped);
+	if (ifid >= (uint32_t) _pcapng_ifs.size())
+	    return _ff.error(errh, "pcapng packet on unknown interface %u", ifid);
+	else if (cl > body - 20)
+	    return _ff.error(errh, "bad pcapng packet length; giving up");
+	const PcapngInterface &pi = _pcapng_ifs[ifid];
+	ts = pcapng_timestamp(t, pi.tsresol, pi.tsoffset);
+	caplen = cl;
+	len = pcapng_u32(h + 16, _swapped);
+	skiplen = body - 20 - caplen + 4;
+	_packet_linktype = pi.linktype;
+
+    } else if (type == FAKE_PCAPNG_SPB) {
+	if (body < 4)
+	    return _ff.error(errh, "bad pcapng packet block; giving up");
+	if (!(h = _ff.get_aligned(4, hbuf)))
+	    return 0;
+	if (_pcapng_ifs.empty())
+	    return _ff.error(errh, "pcapng packet on unknown interface 0");
+	const PcapngInterface &pi = _pcapng_ifs[0];
+	uint32_t l = pcapng_u32(h, _swapped), cl = l;
+	if (pi.snaplen && cl > pi.snaplen)
+	    cl = pi.snaplen;
+	if (cl > body - 4)
+	    cl = body - 4;
+	ts = Timestamp();
+	caplen = cl;
+	len = l;
+	skiplen = body - 4 - caplen + 4;
+	_packet_linktype = pi.linktype;
+
+    } else {
+	_ff.shift_pos(body + 4);
+	return 2;
+    }
+
+    if (len < caplen)
+	len = caplen;
+    _packet_filepos = filepos;
+    return 1;
+}
+
 bool
-FromDump::read_packet(ErrorHandler *errh)
+FromDump::rewind(ErrorHandler *errh)
+{
+    if ((_loop && _pass + 1 >= _loop) || !_pass_has_records
+	|| _ff.seek(_first_record_pos, errh) < 0)
+	return false;
+    // forget interfaces described after the first packet
+    _pcapng_ifs.resize(_first_record_nifs);
+    // with TIMING, play the next pass right after this one
+    _timing_offset += _last_record_ts - _first_record_ts;
+    _pass_has_records = false;
+    ++_pass;
+    return true;
+}
+
+/* Read a classic pcap packet header, with the same return values as
+   read_pcapng_block. */
+int
+FromDump::read_pcap_header(Timestamp &ts, int &len, int &caplen, int &skiplen, ErrorHandler *errh)
 {
     fake_pcap_pkthdr swapped_ph;
     const fake_pcap_pkthdr *ph;
-    Timestamp ts = Timestamp::uninitialized_t();
-    int len, caplen, skiplen = 0;
-    Packet *p;
-    assert(!_packet);
 
     // record file position
     _packet_filepos = _ff.file_pos();
 
     // read the packet header
     if (!(ph = reinterpret_cast<const fake_pcap_pkthdr *>(_ff.get_aligned(sizeof(*ph), &swapped_ph))))
-	return false;
+	return 0;
     if (_swapped) {
 	swap_packet_header(ph, &swapped_ph);
 	ph = &swapped_ph;
@@ -359,10 +626,10 @@ FromDump::read_packet(ErrorHandler *errh)
     // tcpdump files store an incorrect caplen. It's only off by one. Tcptrace
     // should be fixed, but we hack around the problem here, as does
     // tcpdump itself.
-    if (caplen > 65535) {
-	_ff.error(errh, "bad packet header; giving up");
-	return false;
-    } else if (caplen > len) {
+    skiplen = 0;
+    if (caplen > 65535)
+	return _ff.error(errh, "bad packet header; giving up");
+    else if (caplen > len) {
 	skiplen = caplen - len;
 	caplen = len;
     }
@@ -370,9 +637,38 @@ FromDump::read_packet(ErrorHandler *errh)
     // compensate for modified pcap versions
     _ff.shift_pos(_extra_pkthdr_crap);
 
+    ts = fake_bpf_timeval_union::make_timestamp(&ph->ts, _have_nanosecond_timestamps);
+    return 1;
+}
+
+bool
+FromDump::read_packet(ErrorHandler *errh)
+{
+    Timestamp ts = Timestamp::uninitialized_t();
+    int len, caplen, skiplen, r;
+    Packet *p;
+    assert(!_packet);
+
+    // read the packet header, rewinding at end of file if looping
+  retry:
+    if (_pcapng)
+	while ((r = read_pcapng_block(ts, len, caplen, skiplen, errh)) == 2)
+	    /* skip blocks without packets */;
+    else
+	r = read_pcap_header(ts, len, caplen, skiplen, errh);
+    if (r == 0 && rewind(errh))
+	goto retry;
+    else if (r <= 0)
+	return false;
+
+    if (!_pass_has_records) {
+	_first_record_ts = ts;
+	_pass_has_records = true;
+    }
+    _last_record_ts = ts;
+
     // check times
   check_times:
-    ts = fake_bpf_timeval_union::make_timestamp(&ph->ts, _have_nanosecond_timestamps);
     if (!_have_any_times)
 	prepare_times(ts);
     if (_have_first_time) {
@@ -458,7 +754,7 @@ FromDump::run_task(Task *)
     }
     if (_packet && _timing && !check_timing(_packet))
 	return false;
-    if (_packet && _force_ip && !fake_pcap_force_ip(_packet, _linktype)) {
+    if (_packet && _force_ip && !fake_pcap_force_ip(_packet, _packet_linktype)) {
 	checked_output_push(1, _packet);
 	_packet = 0;
     }
@@ -488,7 +784,7 @@ FromDump::pull(int)
 	more = read_packet(0);
     if (_packet && _timing && !check_timing(_packet))
 	return 0;
-    if (_packet && _force_ip && !fake_pcap_force_ip(_packet, _linktype)) {
+    if (_packet && _force_ip && !fake_pcap_force_ip(_packet, _packet_linktype)) {
 	checked_output_push(1, _packet);
 	_packet = 0;
     }
@@ -508,7 +804,7 @@ FromDump::pull(int)
 
 enum {
     H_SAMPLING_PROB, H_ACTIVE, H_ENCAP, H_STOP, H_PACKET_FILEPOS,
-    H_EXTEND_INTERVAL, H_COUNT, H_RESET_COUNTS, H_RESET_TIMING
+    H_EXTEND_INTERVAL, H_COUNT, H_RESET_COUNTS, H_RESET_TIMING, H_IO_URING
 };
 
 String
@@ -520,6 +816,8 @@ FromDump::read_handler(Element *e, void *thunk)
 	return cp_unparse_real2(fd->_sampling_prob, SAMPLING_SHIFT);
     case H_ENCAP:
 	return String(fake_pcap_unparse_dlt(fd->_linktype));
+    case H_IO_URING:
+	return String(fd->_ff.io_uring() != 0);
     default:
 	return "<error>";
     }
@@ -574,6 +872,7 @@ FromDump::add_handlers()
     add_data_handlers("active", Handler::OP_READ | Handler::CHECKBOX, &_active);
     add_write_handler("active", write_handler, H_ACTIVE);
     add_read_handler("encap", read_handler, H_ENCAP);
+    add_read_handler("io_uring", read_handler, H_IO_URING);
     add_write_handler("stop", write_handler, H_STOP, Handler::BUTTON);
     add_data_handlers("packet_filepos", Handler::OP_READ, &_packet_filepos);
     add_write_handler("extend_interval", write_handler, H_EXTEND_INTERVAL);
@@ -12,7 +12,7 @@ class HandlerCall;
 /*
 =c
 
-FromDump(FILENAME [, I<keywords> STOP, TIMING, SAMPLE, FORCE_IP, START, START_AFTER, END, END_AFTER, INTERVAL, END_CALL, FILEPOS, MMAP])
+FromDump(FILENAME [, I<keywords> STOP, TIMING, SAMPLE, FORCE_IP, START, START_AFTER, END, END_AFTER, INTERVAL, END_CALL, FILEPOS, LOOP, MMAP, PREFETCH, IO_URING])
 
 =s traces
 
@@ -24,6 +24,12 @@ Reads packets from a file produced by `tcpdump -w FILENAME' or ToDump and
 emits them from the output, optionally stopping the driver when there are no
 more packets.
 
+FromDump also reads pcapng files, such as those written by Wireshark and
+dumpcap.  It honors each interface's link type, timestamp resolution
+(if_tsresol), and timestamp offset (if_tsoffset), and skips blocks other than
+Enhanced, Simple, and obsolete Packet Blocks.  Packets from Simple Packet
+Blocks have zero timestamps.
+
 FromDump also transparently reads gzip- and bzip2-compressed tcpdump files, if
 you have zcat(1) and bzcat(1) installed.
 
@@ -101,12 +107,36 @@ this (uncompressed) file position. This is dangerous; there's no cheap way
 to check whether you got the offset wrong, and if you did get it wrong,
 FromDump will emit garbage.
 
+=item LOOP
+
+Unsigned integer.  FromDump replays the trace this many times, rewinding to
+the first packet each time it reaches the end of the file; 0 means replay
+forever.  With TIMING, each pass continues where the previous one left off,
+as if the trace's packets followed one another without a break.  Timestamp
+annotations are not changed.  START and END times apply to the recorded
+timestamps.  LOOP requires an uncompressed file.  Default is 1.
+
 =item MMAP
 
 Boolean. If true, then FromDump will use mmap(2) to access the tcpdump file.
-This can result in slightly better performance on some machines. FromDump's
-regular file discipline is pretty optimized, so the difference is often small
-in practice. Default is true on most operating systems, but false on Linux.
+The whole file is mapped once and packets are emitted without copying their
+data, which is especially useful with LOOP: after the first pass, the trace
+is replayed from memory.  Default is true.
+
+=item PREFETCH
+
+Unsigned integer.  When MMAP is true, FromDump asks the kernel to read this
+many bytes of the file ahead of the packets it is emitting.  Default is
+16777216 (16MB).
+
+=item IO_URING
+
+Boolean.  If true, then FromDump reads the file through its home thread's
+io_uring instead of mapping it, and reads the next 256 kB of the file while
+it emits the packets of the current 256 kB, so its thread rarely waits for
+the disk.  FromDump's output must be push, and its task is pinned to its home
+thread.  FILENAME must name a regular, uncompressed file.  Ignored, with a
+warning, if io_uring is not available.  Default is false.
 
 =back
 
@@ -163,6 +193,10 @@ cannot be determined (because the file was compressed, for example).
 
 Returns or sets FromDump's position in the (uncompressed) file, in bytes.
 
+=h io_uring read-only
+
+Returns true iff FromDump reads through io_uring.
+
 =h packet_filepos read-only
 
 Returns the (uncompressed) file position of the last packet emitted, in bytes.
@@ -229,10 +263,29 @@ class FromDump : public Element { public:
     bool _last_time_interval : 1;
     bool _have_nanosecond_timestamps : 1;
     bool _active;
+    bool _io_uring;
     unsigned _extra_pkthdr_crap;
     unsigned _sampling_prob;
     int _minor_version;
     int _linktype;
+    int _packet_linktype;
+
+    struct PcapngInterface {
+	int linktype;
+	uint32_t snaplen;
+	uint8_t tsresol;
+	int64_t tsoffset;
+    };
+    bool _pcapng;
+    Vector<PcapngInterface> _pcapng_ifs;
+
+    unsigned _loop;
+    unsigned _pass;
+    bool _pass_has_records;
+    off_t _first_record_pos;
+    int _first_record_nifs;
+    Timestamp _first_record_ts;
+    Timestamp _last_record_ts;
 
     Timestamp _first_time;
     Timestamp _last_time;
@@ -252,7 +305,12 @@ class FromDump : public Element { public:
     Timestamp _timing_offset;
     off_t _packet_filepos;
 
+    int initialize_pcap(ErrorHandler *);
+    int initialize_pcapng(ErrorHandler *);
+    int read_pcap_header(Timestamp &, int &, int &, int &, ErrorHandler *);
+    int read_pcapng_block(Timestamp &, int &, int &, int &, ErrorHandler *);
     bool read_packet(ErrorHandler *);
+    bool rewind(ErrorHandler *);
 
     void prepare_times(const Timestamp &);
     bool check_timing(Packet *p);
@@ -0,0 +1,263 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * fromsharedring.{cc,hh} -- element receives packets from another Click
+ * process through shared memory
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "fromsharedring.hh"
+#include "sharedring.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/standard/scheduleinfo.hh>
+#include <click/packetbatch.hh>
+CLICK_DECLS
+
+FromSharedRing::FromSharedRing()
+    : _burst(32), _zerocopy(true), _poll(false), _active(true),
+      _ring(0), _task(this), _timer(this), _desc_head_seen(0), _sleepiness(0),
+      _count(0), _copies(0)
+{
+}
+
+FromSharedRing::~FromSharedRing()
+{
+}
+
+int
+FromSharedRing::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    if (Args(conf, this, errh)
+	.read_mp("FILENAME", FilenameArg(), _filename)
+	.read("BURST", _burst)
+	.read("ZEROCOPY", _zerocopy)
+	.read("POLL", _poll)
+	.read("ACTIVE", _active)
+	.complete() < 0)
+	return -1;
+    if (_burst <= 0)
+	return errh->error("BURST must be positive");
+    return 0;
+}
+
+int
+FromSharedRing::initialize(ErrorHandler *errh)
+{
+    ScheduleInfo::initialize_task(this, &_task, false, errh);
+    _timer.initialize(this);
+    if (attach(errh) && _active)
+	_task.reschedule();
+    _timer.schedule_after_msec(CHECK_INTERVAL);
+    return errh->nerrors() ? -1 : 0;
+}
+
+void
+FromSharedRing::cleanup(CleanupStage)
+{
+    detach();
+}
+
+bool
+FromSharedRing::attach(ErrorHandler *errh)
+{
+    _ring = SharedRing::attach(_filename, errh);
+    if (!_ring)
+	return false;
+    if (!_poll && (_ring->open_bell(true, errh) < 0
+		   || add_select(_ring->bell_fd(), SELECT_READ) < 0)) {
+	_ring->unref();
+	_ring = 0;
+	return false;
+    }
+    _desc_head_seen = _ring->header()->desc_tail;
+    _sleepiness = 0;
+    return true;
+}
+
+void
+FromSharedRing::detach()
+{
+    if (_ring) {
+	if (_ring->bell_fd() >= 0)
+	    remove_select(_ring->bell_fd(), SELECT_READ);
+	// Zero-copy packets still downstream keep the ring mapped.
+	_ring->unref();
+	_ring = 0;
+    }
+}
+
+void
+FromSharedRing::run_timer(Timer *)
+{
+    // Finish the packets left by a departed producer before moving on.
+    if (_ring && _ring->stale()
+	&& _ring->header()->desc_head == _ring->header()->desc_tail)
+	detach();
+    if (!_ring && attach(ErrorHandler::default_handler()) && _active)
+	_task.reschedule();
+    _timer.reschedule_after_msec(CHECK_INTERVAL);
+}
+
+void
+FromSharedRing::selected(int, int)
+{
+    if (_ring) {
+	_ring->drain_bell();
+	if (_active)
+	    _task.reschedule();
+    }
+}
+
+/* Tell the producer to ring the bell, unless it published packets past
+ * @a tail meanwhile.  Returns true iff we may stop polling. */
+bool
+FromSharedRing::sleep(uint32_t tail)
+{
+    SharedRing::Header *h = _ring->header();
+    h->consumer_asleep = 1;
+    // Pairs with the fence in ToSharedRing::push_batch().
+    SharedRing::fence();
+    if (h->desc_head == tail)
+	return true;
+    // If the producer cleared consumer_asleep, it also rang the bell, and
+    // selected() will drain it.
+    (void) __sync_bool_compare_and_swap(&h->consumer_asleep, 1, 0);
+    return false;
+}
+
+bool
+FromSharedRing::run_task(Task *)
+{
+    if (!_ring || !_active)
+	return false;
+
+    SharedRing::Header *h = _ring->header();
+    uint32_t tail = h->desc_tail;
+    uint32_t n = _desc_head_seen - tail;
+    if (n < (uint32_t) _burst) {
+	_desc_head_seen = h->desc_head;
+	n = _desc_head_seen - tail;
+	if (n == 0) {
+	    if (_poll || ++_sleepiness < SLEEPINESS_TRIGGER || !sleep(tail))
+		_task.fast_reschedule();
+	    return false;
+	}
+    }
+    if (n > (uint32_t) _burst)
+	n = _burst;
+    SharedRing::read_fence();
+
+    uint32_t buffer_size = h->buffer_size;
+    uint32_t headroom = h->headroom;
+    uint32_t nbuffers = h->nbuffers;
+    uint32_t copied[n];
+    int ncopied = 0;
+    PacketBatch batch;
+
+    for (uint32_t i = 0; i < n; ++i) {
+	SharedRing::Desc d = _ring->desc(tail + i);
+	// Don't trust the other process with our memory, but give back a
+	// valid buffer even if its length is bad.
+	if (d.buffer >= nbuffers)
+	    continue;
+	if (d.length > buffer_size - headroom) {
+	    copied[ncopied++] = d.buffer;
+	    continue;
+	}
+	unsigned char *data = _ring->buffer(d.buffer) + headroom;
+	WritablePacket *p = 0;
+	if (_zerocopy && _ring->outstanding < nbuffers / 2) {
+	    p = Packet::make(data, d.length, SharedRing::release_packet_buffer,
+			     _ring, headroom, buffer_size - headroom - d.length);
+	    if (p) {
+		_ring->ref();
+		_ring->outstanding++;
+	    }
+	}
+	if (!p) {
+	    p = Packet::make(Packet::default_headroom, data, d.length, 0);
+	    copied[ncopied++] = d.buffer;
+	    ++_copies;
+	}
+	if (!p)
+	    continue;
+	if (d.sec || d.subsec)
+	    p->timestamp_anno() = Timestamp::make_nsec(d.sec, d.subsec);
+	batch.append(p);
+    }
+
+    SharedRing::read_fence();
+    h->desc_tail = tail + n;
+    if (ncopied)
+	_ring->release(copied, ncopied);
+
+    _count += batch.count();
+    _sleepiness = 0;
+    if (batch.count())
+	output(0).push_batch(batch);
+    _task.fast_reschedule();
+    return true;
+}
+
+String
+FromSharedRing::read_handler(Element *e, void *thunk)
+{
+    FromSharedRing *fsr = static_cast<FromSharedRing *>(e);
+    switch ((intptr_t) thunk) {
+    case h_count:
+	return String(fsr->_count);
+    case h_copies:
+	return String(fsr->_copies);
+    case h_active:
+	return String(fsr->_active);
+    case h_attached:
+	return String(fsr->_ring != 0);
+    default:
+	return String();
+    }
+}
+
+int
+FromSharedRing::write_handler(const String &s, Element *e, void *thunk, ErrorHandler *errh)
+{
+    FromSharedRing *fsr = static_cast<FromSharedRing *>(e);
+    switch ((intptr_t) thunk) {
+    case h_reset_counts:
+	fsr->_count = fsr->_copies = 0;
+	return 0;
+    case h_active:
+	if (!BoolArg().parse(s, fsr->_active))
+	    return errh->error("syntax error");
+	if (fsr->_active && fsr->_ring)
+	    fsr->_task.reschedule();
+	return 0;
+    default:
+	return 0;
+    }
+}
+
+void
+FromSharedRing::add_handlers()
+{
+    add_read_handler("count", read_handler, h_count);
+    add_read_handler("copies", read_handler, h_copies);
+    add_write_handler("reset_counts", write_handler, h_reset_counts, Handler::BUTTON);
+    add_read_handler("active", read_handler, h_active, Handler::CHECKBOX);
+    add_write_handler("active", write_handler, h_active);
+    add_read_handler("attached", read_handler, h_attached);
+    add_task_handlers(&_task);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel SharedRing)
+EXPORT_ELEMENT(FromSharedRing)
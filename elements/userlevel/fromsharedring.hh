@@ -0,0 +1,132 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_FROMSHAREDRING_HH
+#define CLICK_FROMSHAREDRING_HH
+#include <click/element.hh>
+#include <click/task.hh>
+#include <click/timer.hh>
+CLICK_DECLS
+class SharedRing;
+
+/*
+=c
+
+FromSharedRing(FILENAME [, I<keywords> BURST, ZEROCOPY, POLL, ACTIVE])
+
+=s comm
+
+receives packets from another Click process through shared memory
+
+=d
+
+Receives packets sent by a ToSharedRing element in another Click process on
+the same host, through the ring ToSharedRing creates as the file FILENAME.
+FromSharedRing checks for the file until ToSharedRing creates it.  When
+ToSharedRing's process stops, FromSharedRing emits the packets left in the
+ring, detaches, and waits for a new ring.
+
+By default, packets are emitted without copying: they point into the ring's
+buffers, which are returned to ToSharedRing when the packets are freed.  To
+keep ToSharedRing from running out of buffers, FromSharedRing copies packets
+instead while half of the buffers are held by packets downstream.
+
+When the ring is empty, FromSharedRing sleeps on the FIFO named
+FILENAME.bell, and ToSharedRing wakes it.
+
+Keyword arguments are:
+
+=over 8
+
+=item BURST
+
+Integer.  Maximum number of packets emitted per scheduling.  Default is 32.
+
+=item ZEROCOPY
+
+Boolean.  If false, always copy packets out of the ring.  Default is true.
+
+=item POLL
+
+Boolean.  If true, never sleep on the FIFO, polling the ring instead.  This
+saves ToSharedRing's system calls at the price of a busy thread.  Default is
+false.
+
+=item ACTIVE
+
+Boolean.  If false, do not emit packets.  Default is true.
+
+=back
+
+Only available in user-level processes.
+
+=h count read-only
+
+Returns the number of packets received.
+
+=h copies read-only
+
+Returns the number of packets that were copied.
+
+=h reset_counts write-only
+
+Resets the counts to zero.
+
+=h active read/write
+
+Returns or sets the ACTIVE parameter.
+
+=h attached read-only
+
+Returns true iff FromSharedRing is attached to a ring.
+
+=a ToSharedRing, FromDevice.u, Socket */
+
+class FromSharedRing : public Element { public:
+
+    FromSharedRing() CLICK_COLD;
+    ~FromSharedRing() CLICK_COLD;
+
+    const char *class_name() const		{ return "FromSharedRing"; }
+    const char *port_count() const		{ return PORTS_0_1; }
+    const char *processing() const		{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    bool run_task(Task *);
+    void run_timer(Timer *);
+    void selected(int fd, int mask);
+
+  private:
+
+    String _filename;
+    int _burst;
+    bool _zerocopy;
+    bool _poll;
+    bool _active;
+
+    SharedRing *_ring;
+    Task _task;
+    Timer _timer;
+    uint32_t _desc_head_seen;
+    int _sleepiness;
+
+    unsigned long _count;
+    unsigned long _copies;
+
+    enum { SLEEPINESS_TRIGGER = 9 };
+    enum { CHECK_INTERVAL = 100 };	// msec between checks of FILENAME
+
+    bool attach(ErrorHandler *);
+    void detach();
+    bool sleep(uint32_t tail);
+
+    enum { h_count, h_copies, h_reset_counts, h_active, h_attached };
+    static String read_handler(Element *, void *) CLICK_COLD;
+    static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
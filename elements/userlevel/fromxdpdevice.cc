@@ -0,0 +1,210 @@
+// -*- c-basic-offset: 4; related-file-name: "fromxdpdevice.hh" -*-
+/*
+ * fromxdpdevice.{cc,hh} -- element reads packets from network via AF_XDP
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "fromxdpdevice.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/master.hh>
+#include <click/standard/scheduleinfo.hh>
+
+CLICK_DECLS
+
+FromXDPDevice::FromXDPDevice()
+    : _dev(0), _burst(32), _per_thread(false)
+{
+}
+
+FromXDPDevice::~FromXDPDevice()
+{
+}
+
+/** @brief Parse the device-wide keywords shared by FromXDPDevice and
+ * ToXDPDevice, and apply them to @a dev. */
+int
+FromXDPDevice::configure_device(XDPDevice *dev, Vector<String> &conf,
+                                Element *e, ErrorHandler *errh)
+{
+    String mode_str;
+    bool zerocopy, has_zerocopy;
+    unsigned nframes = XDPDevice::DEF_NFRAMES, frame_size = XDPDevice::DEF_FRAME_SIZE;
+    unsigned ndesc;
+    bool has_nframes, has_frame_size, has_ndesc;
+    if (Args(e, errh).bind(conf)
+        .read("MODE", WordArg(), mode_str)
+        .read("ZEROCOPY", zerocopy).read_status(has_zerocopy)
+        .read("NFRAMES", nframes).read_status(has_nframes)
+        .read("FRAME_SIZE", frame_size).read_status(has_frame_size)
+        .read("NDESC", ndesc).read_status(has_ndesc)
+        .consume() < 0)
+        return -1;
+
+    if (mode_str) {
+        int mode;
+        if (!XDPDevice::parse_mode(mode_str, mode))
+            return errh->error("bad MODE");
+        dev->set_mode(mode);
+    }
+    if (has_zerocopy)
+        dev->set_zerocopy(zerocopy);
+    if (has_nframes || has_frame_size)
+        dev->set_frames(nframes, frame_size);
+    if (has_ndesc)
+        dev->set_ndesc(ndesc);
+    return 0;
+}
+
+int
+FromXDPDevice::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    String ifname;
+    int queue = -1;
+    if (Args(this, errh).bind(conf)
+        .read_mp("DEVNAME", ifname)
+        .read_p("QUEUE", queue)
+        .read("BURST", _burst)
+        .consume() < 0)
+        return -1;
+    if (_burst == 0)
+        return errh->error("bad BURST");
+
+    if (!(_dev = XDPDevice::get(ifname, errh))
+        || configure_device(_dev, conf, this, errh) < 0
+        || Args(conf, this, errh).complete() < 0)
+        return -1;
+
+    _per_thread = queue < 0;
+    if (!_per_thread)
+        _queues.push_back(new RxQueue(this, queue));
+    else {
+        int n = master()->nthreads();
+        if (n > _dev->nqueues())
+            n = _dev->nqueues();
+        for (int q = 0; q < n; ++q)
+            _queues.push_back(new RxQueue(this, q));
+    }
+    for (int i = 0; i < _queues.size(); ++i)
+        if (_dev->add_queue(_queues[i]->queue, true, errh) < 0)
+            return -1;
+    return 0;
+}
+
+int
+FromXDPDevice::initialize(ErrorHandler *errh)
+{
+    if (_dev->initialize(errh) < 0)
+        return -1;
+    for (int i = 0; i < _queues.size(); ++i) {
+        RxQueue *q = _queues[i];
+        q->sock = _dev->socket(q->queue);
+        // queue i runs on thread i
+        if (_per_thread)
+            q->task.move_thread(q->queue);
+        ScheduleInfo::initialize_task(this, &q->task, true, errh);
+        q->task.set_pinned(true);
+        q->timer.initialize(this);
+        master()->thread(q->task.home_thread_id())->select_set()
+            .add_select(q->sock->fd(), this, SELECT_READ);
+    }
+    return 0;
+}
+
+void
+FromXDPDevice::cleanup(CleanupStage)
+{
+    for (int i = 0; i < _queues.size(); ++i) {
+        RxQueue *q = _queues[i];
+        if (q->sock && q->task.initialized())
+            master()->thread(q->task.home_thread_id())->select_set()
+                .remove_select(q->sock->fd(), this, SELECT_READ);
+        delete q;
+    }
+    _queues.clear();
+    if (_dev)
+        _dev->unuse();
+    _dev = 0;
+}
+
+bool
+FromXDPDevice::run_task(Task *t)
+{
+    RxQueue *q = 0;
+    for (int i = 0; !q; ++i)
+        if (&_queues[i]->task == t)
+            q = _queues[i];
+
+    PacketBatch batch;
+    unsigned n = q->sock->receive(batch, _burst);
+    if (!q->sock->refill())
+        // Click holds every frame; look again once some may be free.
+        q->timer.schedule_after_msec(1);
+    else if (n == _burst)
+        t->fast_reschedule();
+    // otherwise, wait for selected()
+    q->count += n;
+    output(0).push_batch(batch);
+    return n > 0;
+}
+
+void
+FromXDPDevice::selected(int fd, int)
+{
+    for (int i = 0; i < _queues.size(); ++i)
+        if (_queues[i]->sock->fd() == fd)
+            _queues[i]->task.reschedule();
+}
+
+String
+FromXDPDevice::read_handler(Element *e, void *thunk)
+{
+    FromXDPDevice *fd = static_cast<FromXDPDevice *>(e);
+    switch ((uintptr_t) thunk) {
+    case h_count: {
+        unsigned long count = 0;
+        for (int i = 0; i < fd->_queues.size(); ++i)
+            count += fd->_queues[i]->count;
+        return String(count);
+    }
+    case h_kernel_drops: {
+        long long drops = 0;
+        for (int i = 0; i < fd->_queues.size(); ++i) {
+            long long d = fd->_queues[i]->sock->kernel_drops();
+            if (d < 0)
+                return "??";
+            drops += d;
+        }
+        return String(drops);
+    }
+    case h_zerocopy:
+        return String(fd->_queues.size() && fd->_queues[0]->sock->zerocopy());
+    default:
+        return String();
+    }
+}
+
+void
+FromXDPDevice::add_handlers()
+{
+    add_read_handler("count", read_handler, h_count);
+    add_read_handler("kernel_drops", read_handler, h_kernel_drops);
+    add_read_handler("zerocopy", read_handler, h_zerocopy);
+    for (int i = 0; i < _queues.size(); ++i)
+        add_task_handlers(&_queues[i]->task, String("queue") + String(_queues[i]->queue) + ".");
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel xdp XDPDevice)
+EXPORT_ELEMENT(FromXDPDevice)
+ELEMENT_MT_SAFE(FromXDPDevice)
@@ -0,0 +1,165 @@
+#ifndef CLICK_FROMXDPDEVICE_HH
+#define CLICK_FROMXDPDEVICE_HH
+#include <click/element.hh>
+#include <click/task.hh>
+#include <click/timer.hh>
+#include "elements/userlevel/xdpdevice.hh"
+CLICK_DECLS
+
+/*
+=title FromXDPDevice
+
+=c
+
+FromXDPDevice(DEVNAME [, QUEUE, I<keywords> BURST, MODE, ZEROCOPY, NFRAMES, FRAME_SIZE, NDESC])
+
+=s netdevices
+
+reads packets from network device using AF_XDP sockets (user-level)
+
+=d
+
+Reads packets from the Linux network device named DEVNAME through AF_XDP
+sockets.  FromXDPDevice attaches a small XDP program to the device that
+redirects packets arriving on its queues to Click; the device otherwise stays
+under the kernel's control, and packets on other queues reach the kernel
+stack as usual.
+
+Each queue has its own socket and its own UMEM, a region of packet buffers
+shared with the kernel.  Emitted packets point directly into the UMEM.  A
+buffer returns to the kernel once its packet is freed, or once it has been
+transmitted by a ToXDPDevice on the same device and queue, which sends it
+without copying.
+
+If QUEUE is given, FromXDPDevice reads that queue only.  Otherwise it reads
+one queue per Click thread: queue 0 on thread 0, queue 1 on thread 1, and so
+on, up to the number of receive queues of the device.  Each queue is polled by
+its own task pinned to its thread, so packets from queue I<i> are pushed
+downstream on thread I<i>.  Use the device's RSS or flow steering settings to
+spread traffic across queues.
+
+Arguments:
+
+=over 8
+
+=item DEVNAME
+
+String.  The network device name.
+
+=item QUEUE
+
+Integer.  The device queue to read.  If omitted or negative, read one queue
+per thread.
+
+=item BURST
+
+Integer.  Maximum number of packets to read per queue per scheduling.  The
+packets are pushed downstream as a single batch.  Defaults to 32.
+
+=item MODE
+
+Word.  How the XDP program attaches to the device: DRV (in the driver), SKB
+(generic XDP, which works on any device but is slower), or AUTO (the driver if
+it supports XDP, generic otherwise).  Defaults to AUTO.
+
+=item ZEROCOPY
+
+Boolean.  If true, require zero-copy mode, in which the NIC writes packets
+directly into the UMEM; if false, require copy mode.  By default, zero-copy
+mode is used if the driver supports it.
+
+=item NFRAMES
+
+Integer.  Number of frames in each queue's UMEM.  Defaults to 4096.
+
+=item FRAME_SIZE
+
+Integer.  Size of each UMEM frame, a power of two between 2048 and the page
+size.  Defaults to 4096.
+
+=item NDESC
+
+Integer.  Number of descriptors in each AF_XDP ring, a power of two.  Defaults
+to 1024.
+
+=back
+
+MODE, ZEROCOPY, NFRAMES, FRAME_SIZE, and NDESC apply to the whole device, and
+are shared with any ToXDPDevice for the same device.
+
+This element is only available at user level on Linux, and needs the
+CAP_NET_ADMIN and CAP_BPF capabilities (or root).
+
+=n
+
+FromXDPDevice tasks sleep while their queues are empty.  Packets that Click
+holds for a long time, such as packets in a large Queue, keep their UMEM
+frames away from the kernel; once all of a queue's frames are held, the
+kernel drops arriving packets.  Size NFRAMES accordingly.
+
+=e
+
+  // two threads, each reading and writing its own queue
+  FromXDPDevice(eth0) -> ... -> ToXDPDevice(eth0);
+
+=h count read-only
+
+Returns the number of packets received.
+
+=h kernel_drops read-only
+
+Returns the number of packets the kernel dropped because a receive ring was
+full or invalid.
+
+=h zerocopy read-only
+
+Returns true if the sockets use zero-copy mode.
+
+=a ToXDPDevice, FromDevice.u, FromDPDKDevice */
+
+class FromXDPDevice : public Element { public:
+
+    FromXDPDevice() CLICK_COLD;
+    ~FromXDPDevice() CLICK_COLD;
+
+    const char *class_name() const { return "FromXDPDevice"; }
+    const char *port_count() const { return PORTS_0_1; }
+    const char *processing() const { return PUSH; }
+    int configure_phase() const { return CONFIGURE_PHASE_PRIVILEGED - 5; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    bool run_task(Task *);
+    void selected(int fd, int mask);
+
+    static int configure_device(XDPDevice *dev, Vector<String> &conf,
+                                Element *e, ErrorHandler *errh) CLICK_COLD;
+
+  private:
+
+    struct RxQueue {
+        RxQueue(FromXDPDevice *e, int q)
+            : task(e), timer(&task), sock(0), queue(q), count(0) {
+        }
+        Task task;
+        Timer timer;
+        XDPSocket *sock;
+        int queue;
+        unsigned long count;
+    };
+
+    XDPDevice *_dev;
+    Vector<RxQueue *> _queues;
+    unsigned _burst;
+    bool _per_thread;
+
+    enum { h_count, h_kernel_drops, h_zerocopy };
+    static String read_handler(Element *e, void *thunk) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -27,9 +27,12 @@
 #include <click/glue.hh>
 #include <clicknet/ether.h>
 #include <click/standard/scheduleinfo.hh>
+#include <click/packet_anno.hh>
+#include <click/master.hh>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <arpa/inet.h>
 
 #if defined(__linux__) && defined(HAVE_LINUX_IF_TUN_H)
@@ -55,6 +58,23 @@
 #if HAVE_NET_IF_TAP_H
 # include <net/if_tap.h>
 #endif
+#if KERNELTUN_LINUX && defined(IFF_VNET_HDR) && defined(TUNSETOFFLOAD)
+# define KERNELTUN_VNET 1
+# ifndef TUN_F_USO4
+#  define TUN_F_USO4 0x20
+#  define TUN_F_USO6 0x40
+# endif
+// <linux/virtio_net.h> is not valid C++; this is its struct virtio_net_hdr,
+// in native byte order for TUN/TAP
+struct click_virtio_net_hdr {
+    uint8_t flags;
+    uint8_t gso_type;
+    uint16_t hdr_len;
+    uint16_t gso_size;
+    uint16_t csum_start;
+    uint16_t csum_offset;
+};
+#endif
 
 #if defined(__NetBSD__)
 # include <sys/param.h>
@@ -69,8 +89,7 @@ CLICK_DECLS
 
 KernelTun::KernelTun()
     : _fd(-1), _tap(false), _task(this), _ignore_q_errs(false),
-      _printed_write_err(false), _printed_read_err(false),
-      _selected_calls(0), _packets(0)
+      _printed_write_err(false), _printed_read_err(false)
 {
 }
 
@@ -96,6 +115,8 @@ KernelTun::configure(Vector<String> &conf, ErrorHandler *errh)
     _headroom += (4 - _headroom % 4) % 4; // default 4/0 alignment
     _mtu_out = DEFAULT_MTU;
     _burst = 1;
+    _multiqueue = _vnet_hdr = false;
+    bool csum = false, tso = false, ufo = false;
     if (Args(conf, this, errh)
 	.read_mp("ADDR", IPPrefixArg(), _near, _mask)
 	.read_p("GATEWAY", _gw)
@@ -105,6 +126,11 @@ KernelTun::configure(Vector<String> &conf, ErrorHandler *errh)
 	.read("ETHER", _macaddr)
 	.read("IGNORE_QUEUE_OVERFLOWS", _ignore_q_errs)
 	.read("MTU", _mtu_out)
+	.read("MULTIQUEUE", _multiqueue)
+	.read("VNET_HDR", _vnet_hdr)
+	.read("CHECKSUM_OFFLOAD", csum)
+	.read("TSO", tso)
+	.read("UFO", ufo)
 #if KERNELTUN_LINUX
 	.read("DEV_NAME", Args::deprecated, _dev_name)
 	.read("DEVNAME", _dev_name)
@@ -120,6 +146,25 @@ KernelTun::configure(Vector<String> &conf, ErrorHandler *errh)
 	return errh->error("MTU must be greater than %d", sizeof(click_ip));
     if (_headroom > 8192)
 	return errh->error("HEADROOM too big");
+
+    _offload = 0;
+#if KERNELTUN_VNET
+    if (csum || tso || ufo)
+	_offload |= TUN_F_CSUM;
+    if (tso)
+	_offload |= TUN_F_TSO4 | TUN_F_TSO6 | TUN_F_TSO_ECN;
+    if (ufo)
+	_offload |= TUN_F_USO4 | TUN_F_USO6;
+    if (_offload)
+	_vnet_hdr = true;
+#else
+    if (_vnet_hdr || csum || tso || ufo)
+	return errh->error("VNET_HDR and offloads not supported on this platform");
+#endif
+#if !KERNELTUN_LINUX || !defined(IFF_MULTI_QUEUE)
+    if (_multiqueue)
+	return errh->error("MULTIQUEUE not supported on this platform");
+#endif
     _adjust_headroom = !_adjust_headroom;
     return 0;
 }
@@ -128,24 +173,46 @@ KernelTun::configure(Vector<String> &conf, ErrorHandler *errh)
 int
 KernelTun::try_linux_universal()
 {
-    int fd = open("/dev/net/tun", O_RDWR | O_NONBLOCK);
-    if (fd < 0)
-	return -errno;
-
     struct ifreq ifr;
     memset(&ifr, 0, sizeof(ifr));
     ifr.ifr_flags = (_tap ? IFF_TAP : IFF_TUN);
+    int nqueues = 1;
+#ifdef IFF_MULTI_QUEUE
+    if (_multiqueue) {
+	ifr.ifr_flags |= IFF_MULTI_QUEUE;
+	nqueues = master()->nthreads();
+    }
+#endif
+#if KERNELTUN_VNET
+    // the virtio_net_hdr replaces the protocol information
+    if (_vnet_hdr)
+	ifr.ifr_flags |= IFF_VNET_HDR | IFF_NO_PI;
+#endif
     if (_dev_name)
 	// Setting ifr_name allows us to select an arbitrary interface name.
 	strncpy(ifr.ifr_name, _dev_name.c_str(), sizeof(ifr.ifr_name));
-    int err = ioctl(fd, TUNSETIFF, (void *)&ifr);
-    if (err < 0) {
-	close(fd);
-	return -errno;
+
+    // TUNSETIFF fills in ifr_name, so later queues attach to the device
+    // the first one created.
+    for (int i = 0; i < nqueues; ++i) {
+	int fd = open("/dev/net/tun", O_RDWR | O_NONBLOCK);
+	if (fd < 0 || ioctl(fd, TUNSETIFF, (void *)&ifr) < 0) {
+	    int err = -errno;
+	    if (fd >= 0)
+		close(fd);
+	    for (int j = 0; j < _queues.size(); ++j)
+		close(_queues[j].fd);
+	    _queues.clear();
+	    return err;
+	}
+	TunQueue q;
+	memset(&q, 0, sizeof(q));
+	q.fd = fd;
+	_queues.push_back(q);
     }
 
     _dev_name = ifr.ifr_name;
-    _fd = fd;
+    _fd = _queues[0].fd;
     _type = LINUX_UNIVERSAL;
     return 0;
 }
@@ -387,6 +454,20 @@ KernelTun::updown(IPAddress addr, IPAddress mask, ErrorHandler *errh)
 int
 KernelTun::setup_tun(ErrorHandler *errh)
 {
+#if KERNELTUN_VNET
+    if ((_vnet_hdr || _multiqueue) && _type != LINUX_UNIVERSAL)
+	return errh->error("MULTIQUEUE and VNET_HDR need the Linux Universal TUN/TAP driver");
+    if (_offload && ioctl(_fd, TUNSETOFFLOAD, _offload) != 0) {
+	// kernels without UDP segmentation offload may still take UFO
+	unsigned offload = _offload;
+	if (offload & TUN_F_USO4)
+	    offload = (offload & ~(TUN_F_USO4 | TUN_F_USO6)) | TUN_F_UFO;
+	if (offload == _offload || ioctl(_fd, TUNSETOFFLOAD, offload) != 0)
+	    return errh->error("TUNSETOFFLOAD failed: %s", strerror(errno));
+	_offload = offload;
+    }
+#endif
+
 // #if defined(__OpenBSD__)  && !defined(TUNSIFMODE)
 //     /* see OpenBSD bug: http://cvs.openbsd.org/cgi-bin/wwwgnats.pl/full/782 */
 // #define       TUNSIFMODE      _IOW('t', 88, int)
@@ -437,7 +518,10 @@ KernelTun::setup_tun(ErrorHandler *errh)
 
     // calculate maximum packet size needed to receive data from
     // tun/tap.
-    if (_tap) {
+    if (_vnet_hdr)
+	// no protocol information; the virtio_net_hdr is read separately
+	_mtu_in = _mtu_out + (_tap ? 14 : 0);
+    else if (_tap) {
 	if (_type == LINUX_UNIVERSAL)
 	    _mtu_in = _mtu_out + 18;
 	else if (_type == LINUX_ETHERTAP)
@@ -463,6 +547,12 @@ KernelTun::initialize(ErrorHandler *errh)
 {
     if (alloc_tun(errh) < 0)
 	return -1;
+    if (_queues.empty()) {
+	TunQueue q;
+	memset(&q, 0, sizeof(q));
+	q.fd = _fd;
+	_queues.push_back(q);
+    }
     if (setup_tun(errh) < 0)
 	return -1;
     if (input_is_pull(0)) {
@@ -475,35 +565,56 @@ KernelTun::initialize(ErrorHandler *errh)
 	else
 	    _headroom += (4 - _headroom % 4) % 4; // default 4/0 alignment
     }
-    add_select(_fd, SELECT_READ);
+    // with segmentation offload, packets may exceed the MTU
+#if KERNELTUN_VNET
+    bool spill = _offload & ~TUN_F_CSUM;
+#else
+    bool spill = false;
+#endif
+    for (int i = 0; i < _queues.size(); ++i) {
+	TunQueue &q = _queues[i];
+	if (spill)
+	    q.spill = new unsigned char[SPILL_SIZE];
+	// queue i is read on thread i
+	RouterThread *thread = _multiqueue ? master()->thread(i) : home_thread();
+	thread->select_set().add_select(q.fd, this, SELECT_READ);
+    }
     return 0;
 }
 
 void
 KernelTun::cleanup(CleanupStage)
 {
-    if (_fd >= 0) {
-	if (_type != LINUX_UNIVERSAL && _type != NETBSD_TAP)
-	    updown(0, ~0, ErrorHandler::default_handler());
-	close(_fd);
-	remove_select(_fd, SELECT_READ);
+    if (_fd >= 0 && _type != LINUX_UNIVERSAL && _type != NETBSD_TAP)
+	updown(0, ~0, ErrorHandler::default_handler());
+    for (int i = 0; i < _queues.size(); ++i) {
+	TunQueue &q = _queues[i];
+	RouterThread *thread = _multiqueue ? master()->thread(i) : home_thread();
+	thread->select_set().remove_select(q.fd, this, SELECT_READ);
+	close(q.fd);
+	delete[] q.spill;
     }
+    _queues.clear();
+    _fd = -1;
 }
 
 void
 KernelTun::selected(int fd, int)
 {
     Timestamp now = Timestamp::now();
-    if (fd != _fd)
-	return;
-    ++_selected_calls;
-    unsigned n = _burst;
-    while (n > 0 && one_selected(now))
-	--n;
+    for (int i = 0; i < _queues.size(); ++i)
+	if (_queues[i].fd == fd) {
+	    TunQueue &q = _queues[i];
+	    ++q.selected_calls;
+	    unsigned n = _burst;
+	    while (n > 0 && one_selected(q, now))
+		--n;
+	    break;
+	}
 }
 
 bool
-KernelTun::one_selected(const Timestamp &now)
+KernelTun::one_selected(TunQueue &q, const Timestamp &now)
 {
     WritablePacket *p = Packet::make(_headroom, 0, _mtu_in, 0);
     if (!p) {
@@ -511,12 +622,55 @@ KernelTun::one_selected(const Timestamp &now)
 	return false;
     }
 
-    int cc = read(_fd, p->data(), _mtu_in);
-    if (cc > 0) {
-	++_packets;
-	p->take(_mtu_in - cc);
+    // Read the virtio_net_hdr, if any, separately, and let offloaded
+    // packets larger than _mtu_in run over into the spill buffer.
+    struct iovec iov[3];
+    int niov = 0, hlen = 0;
+#if KERNELTUN_VNET
+    click_virtio_net_hdr vh;
+    if (_vnet_hdr) {
+	iov[niov].iov_base = &vh;
+	iov[niov++].iov_len = hlen = sizeof(vh);
+    }
+#endif
+    iov[niov].iov_base = p->data();
+    iov[niov++].iov_len = _mtu_in;
+    if (q.spill) {
+	iov[niov].iov_base = q.spill;
+	iov[niov++].iov_len = SPILL_SIZE;
+    }
+
+    int cc = readv(q.fd, iov, niov);
+    if (cc > hlen) {
+	++q.packets;
+	cc -= hlen;
+	if (cc > _mtu_in) {
+	    WritablePacket *x = Packet::make(_headroom, 0, cc, 0);
+	    if (x) {
+		memcpy(x->data(), p->data(), _mtu_in);
+		memcpy(x->data() + _mtu_in, q.spill, cc - _mtu_in);
+	    } else
+		click_chatter("out of memory!");
+	    p->kill();
+	    if (!(p = x))
+		return true;
+	} else
+	    p->take(_mtu_in - cc);
 	bool ok = false;
 
+#if KERNELTUN_VNET
+	if (_vnet_hdr) {
+	    SET_VNET_FLAGS_ANNO(p, vh.flags);
+	    SET_VNET_GSO_TYPE_ANNO(p, vh.gso_type);
+	    SET_VNET_GSO_SIZE_ANNO(p, vh.gso_size);
+	    SET_VNET_CSUM_START_ANNO(p, vh.csum_start);
+	    SET_VNET_CSUM_OFFSET_ANNO(p, vh.csum_offset);
+	    // no protocol information: tap packets start with the Ethernet
+	    // header, tun packets with the IP header
+	    int v = p->data()[0] >> 4;
+	    ok = _tap || ((v == 4 || v == 6) && fake_pcap_force_ip(p, FAKE_DLT_RAW));
+	} else
+#endif
 	if (_tap) {
 	    if (_type == LINUX_UNIVERSAL)
 		// 2-byte padding, 2-byte Ethernet type, then Ethernet header
@@ -616,12 +770,42 @@ KernelTun::push(int, Packet *p)
 	check_length = p->length();
     }
 
-    // check MTU
-    if (check_length > _mtu_out) {
+    // check MTU; the kernel segments offloaded packets itself
+    if (check_length > _mtu_out
+	&& !(_vnet_hdr && VNET_GSO_TYPE_ANNO(p) != 0)) {
 	click_chatter("%s(%s): packet larger than MTU (%d)", class_name(), _dev_name.c_str(), _mtu_out);
 	goto kill;
     }
 
+    int fd;
+    fd = _queues[click_current_cpu_id() % _queues.size()].fd;
+
+#if KERNELTUN_VNET
+    if (_vnet_hdr) {
+	// gather the virtio_net_hdr with the packet rather than pushing it,
+	// which would copy shared packets
+	click_virtio_net_hdr vh;
+	vh.flags = VNET_FLAGS_ANNO(p);
+	vh.gso_type = VNET_GSO_TYPE_ANNO(p);
+	vh.hdr_len = 0;
+	vh.gso_size = VNET_GSO_SIZE_ANNO(p);
+	vh.csum_start = VNET_CSUM_START_ANNO(p);
+	vh.csum_offset = VNET_CSUM_OFFSET_ANNO(p);
+	struct iovec iov[2];
+	iov[0].iov_base = &vh;
+	iov[0].iov_len = sizeof(vh);
+	iov[1].iov_base = const_cast<unsigned char *>(p->data());
+	iov[1].iov_len = p->length();
+	int w = writev(fd, iov, 2);
+	if (w != (int) (sizeof(vh) + p->length()) && (errno != ENOBUFS || !_ignore_q_errs || !_printed_write_err)) {
+	    _printed_write_err = true;
+	    click_chatter("%s(%s): write failed: %s", class_name(), _dev_name.c_str(), strerror(errno));
+	}
+	p->kill();
+	return;
+    }
+#endif
+
     WritablePacket *q;
     if (_tap) {
 	if (_type == LINUX_UNIVERSAL) {
@@ -663,7 +847,7 @@ KernelTun::push(int, Packet *p)
     }
 
     if (p) {
-	int w = write(_fd, p->data(), p->length());
+	int w = write(fd, p->data(), p->length());
 	if (w != (int) p->length() && (errno != ENOBUFS || !_ignore_q_errs || !_printed_write_err)) {
 	    _printed_write_err = true;
 	    click_chatter("%s(%s): write failed: %s", class_name(), _dev_name.c_str(), strerror(errno));
@@ -679,8 +863,21 @@ KernelTun::add_handlers()
     if (input_is_pull(0))
 	add_task_handlers(&_task);
     add_data_handlers("dev_name", Handler::OP_READ, &_dev_name);
-    add_data_handlers("selected_calls", Handler::OP_READ, &_selected_calls);
-    add_data_handlers("packets", Handler::OP_READ, &_packets);
+    add_read_handler("selected_calls", read_handler, h_selected_calls);
+    add_read_handler("packets", read_handler, h_packets);
+}
+
+String
+KernelTun::read_handler(Element *e, void *thunk)
+{
+    KernelTun *kt = static_cast<KernelTun *>(e);
+    click_uint_large_t n = 0;
+    for (int i = 0; i < kt->_queues.size(); ++i)
+	if ((uintptr_t) thunk == h_selected_calls)
+	    n += kt->_queues[i].selected_calls;
+	else
+	    n += kt->_queues[i].packets;
+    return String(n);
 }
 
 CLICK_ENDDECLS
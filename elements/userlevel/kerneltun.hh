@@ -10,7 +10,7 @@ CLICK_DECLS
 /*
 =c
 
-KernelTun(ADDR/MASK [, GATEWAY, I<keywords> HEADROOM, ETHER, MTU, IGNORE_QUEUE_OVERFLOWS])
+KernelTun(ADDR/MASK [, GATEWAY, I<keywords> HEADROOM, ETHER, MTU, IGNORE_QUEUE_OVERFLOWS, MULTIQUEUE, VNET_HDR, ...])
 
 =s comm
 
@@ -73,8 +73,53 @@ String. If specified, try to alloc a tun device with name DEVNAME.
 Otherwise, we'll just take the first virtual device we find. This option
 only works with the Linux Universal TUN/TAP driver.
 
+=item MULTIQUEUE
+
+Boolean. If true, open the device with IFF_MULTI_QUEUE, one queue per Click
+thread.  Queue I<i> is read on thread I<i>, and packets pushed to KernelTun
+on thread I<i> are written to queue I<i> (modulo the number of queues).  The
+kernel spreads the packets it sends to the device across queues by flow.
+Linux Universal TUN/TAP driver only.  Default is false.
+
+=item VNET_HDR
+
+Boolean. If true, exchange a virtio_net_hdr with the kernel alongside every
+packet (IFF_VNET_HDR), and expose it through the VNET_* packet annotations:
+flags, GSO type and segment size, and checksum start and offset.  The
+checksum start counts from the IP header for KernelTun and from the Ethernet
+header for KernelTap.  Packets KernelTun emits carry the kernel's header;
+packets written to the device take their header from their annotations, so
+a packet whose annotations are zero is sent as is.  Linux Universal TUN/TAP
+driver only.  Default is false, or true if any offload below is enabled.
+
+=item CHECKSUM_OFFLOAD
+
+Boolean. If true, the kernel may send packets whose transport checksum is
+incomplete, marked with VIRTIO_NET_HDR_F_NEEDS_CSUM, leaving the checksum to
+whoever finally transmits the packet.  Elements that verify transport
+checksums will reject such packets.  Default is false.
+
+=item TSO
+
+Boolean. If true, the kernel may send TCP segments of up to 64KB, to be
+segmented later according to their GSO annotations.  Implies
+CHECKSUM_OFFLOAD.  Default is false.
+
+=item UFO
+
+Boolean. If true, the kernel may send UDP packets of up to 64KB holding
+several datagrams of the annotated segment size (UDP segmentation offload;
+UDP fragmentation offload on kernels without it).  Implies CHECKSUM_OFFLOAD.
+Default is false.
+
 =back
 
+Large packets received with TSO or UFO are read with readv(), which places
+the first MTU bytes of each packet in a normal-sized packet buffer; only
+packets that overflow it are copied into a larger buffer.  Written packets
+are sent with writev(), so link and virtio headers are never pushed onto the
+packet data.
+
 =n
 
 Make sure that your kernel has tun support enabled before running
@@ -100,6 +145,17 @@ and C<ping> should print Click's responses.
 This element differs from KernelTap in that it produces and expects IP
 packets, not IP-in-Ethernet packets.
 
+The VNET_* annotations share bytes 40-47 with other rarely used
+annotations, such as PERFCTR.
+
+=h packets read-only
+
+Returns the number of packets read from the device.
+
+=h selected_calls read-only
+
+Returns the number of times KernelTun woke up to read the device.
+
 =a
 
 FromDevice.u, ToDevice.u, KernelTap, ifconfig(8) */
@@ -129,11 +185,19 @@ class KernelTun : public Element { public:
 
   private:
 
-    enum { DEFAULT_MTU = 1500 };
+    enum { DEFAULT_MTU = 1500, SPILL_SIZE = 65536 };
     enum Type { LINUX_UNIVERSAL, LINUX_ETHERTAP, BSD_TUN, BSD_TAP, OSX_TUN,
 		NETBSD_TUN, NETBSD_TAP };
 
-    int _fd;
+    struct TunQueue {
+	int fd;
+	unsigned char *spill;	// tail of packets larger than _mtu_in
+	click_uint_large_t selected_calls;
+	click_uint_large_t packets;
+    };
+
+    int _fd;			// _queues[0].fd
+    Vector<TunQueue> _queues;
     int _mtu_in;
     int _mtu_out;
     Type _type;
@@ -152,9 +216,9 @@ class KernelTun : public Element { public:
     bool _printed_write_err;
     bool _printed_read_err;
     bool _adjust_headroom;
-
-    click_uint_large_t _selected_calls;
-    click_uint_large_t _packets;
+    bool _multiqueue;
+    bool _vnet_hdr;
+    unsigned _offload;		// TUN_F_* flags for TUNSETOFFLOAD
 
 #if HAVE_LINUX_IF_TUN_H
     int try_linux_universal();
@@ -163,7 +227,10 @@ class KernelTun : public Element { public:
     int alloc_tun(ErrorHandler *);
     int setup_tun(ErrorHandler *);
     int updown(IPAddress, IPAddress, ErrorHandler *);
-    bool one_selected(const Timestamp &now);
+    bool one_selected(TunQueue &q, const Timestamp &now);
+
+    enum { h_selected_calls, h_packets };
+    static String read_handler(Element *e, void *thunk) CLICK_COLD;
 
     friend class KernelTap;
 
@@ -0,0 +1,427 @@
+// -*- mode: c++; c-basic-offset: 4 -*-
+/*
+ * parallelfromdump.{cc,hh} -- element reads packets from tcpdump file
+ * on several threads
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "parallelfromdump.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/router.hh>
+#include <click/master.hh>
+#include <click/straccum.hh>
+#include <click/standard/scheduleinfo.hh>
+#include <click/packet_anno.hh>
+#include <click/userutils.hh>
+#include <clicknet/ip.h>
+#include <clicknet/ip6.h>
+#include "fakepcap.hh"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+CLICK_DECLS
+
+#define	SWAPLONG(y) \
+	((((y)&0xff)<<24) | (((y)&0xff00)<<8) | (((y)&0xff0000)>>8) | (((y)>>24)&0xff))
+#define	SWAPSHORT(y) \
+	( (((y)&0xff)<<8) | ((u_short)((y)&0xff00)>>8) )
+
+ParallelFromDump::ParallelFromDump()
+    : _data(0), _length(0)
+{
+}
+
+ParallelFromDump::~ParallelFromDump()
+{
+}
+
+int
+ParallelFromDump::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    int nshards = master()->nthreads();
+    String shard_by = "FLOW";
+    _burst = 32;
+    _timing = _stop = _force_ip = false;
+    _active = true;
+
+    if (Args(conf, this, errh)
+	.read_mp("FILENAME", FilenameArg(), _filename)
+	.read("SHARDS", nshards)
+	.read("SHARD_BY", WordArg(), shard_by)
+	.read("TIMING", _timing)
+	.read("STOP", _stop)
+	.read("FORCE_IP", _force_ip)
+	.read("BURST", _burst)
+	.read("ACTIVE", _active)
+	.complete() < 0)
+	return -1;
+
+    if (compressed_filename(_filename) > 0)
+	return errh->error("compressed traces are not supported");
+    if (nshards <= 0)
+	return errh->error("SHARDS must be positive");
+    if (_burst == 0)
+	return errh->error("BURST must be positive");
+    shard_by = shard_by.upper();
+    if (shard_by == "FLOW")
+	_flow = true;
+    else if (shard_by == "SEQUENTIAL")
+	_flow = false;
+    else
+	return errh->error("SHARD_BY must be FLOW or SEQUENTIAL");
+
+    for (int i = 0; i < nshards; ++i)
+	_shards.push_back(new Shard(this, i));
+    return 0;
+}
+
+/* Parse the record header at 'pos' into 'ph', 'caplen', and 'len'.
+   Returns the record's length in the file, or 0 if the trace ends or is
+   corrupt at 'pos'. */
+size_t
+ParallelFromDump::parse_record(size_t pos, fake_pcap_pkthdr &ph, uint32_t &caplen, uint32_t &len) const
+{
+    size_t hlen = sizeof(ph) + _extra_pkthdr_crap;
+    if (pos + hlen > _length)
+	return 0;
+    memcpy(&ph, _data + pos, sizeof(ph));
+    if (_swapped) {
+	ph.ts.tv.tv_sec = SWAPLONG(ph.ts.tv.tv_sec);
+	ph.ts.tv.tv_usec = SWAPLONG(ph.ts.tv.tv_usec);
+	ph.caplen = SWAPLONG(ph.caplen);
+	ph.len = SWAPLONG(ph.len);
+    }
+
+    // may need to swap 'caplen' and 'len' fields at or before version 2.3
+    if (_minor_version > 3 || (_minor_version == 3 && ph.caplen <= ph.len))
+	caplen = ph.caplen, len = ph.len;
+    else
+	caplen = ph.len, len = ph.caplen;
+    if (caplen > 65535 || pos + hlen + caplen > _length)
+	return 0;
+    return hlen + caplen;
+}
+
+/* Record the offsets of evenly spaced packets in 'index': every packet's
+   at first, and every other entry's each time the index fills up. */
+int
+ParallelFromDump::index_trace(Vector<size_t> &index, ErrorHandler *errh)
+{
+    fake_pcap_pkthdr ph;
+    uint32_t caplen, len;
+    size_t pos = sizeof(fake_pcap_file_header), n = 0, stride = 1;
+    while (pos < _length) {
+	size_t rlen = parse_record(pos, ph, caplen, len);
+	if (!rlen)
+	    return errh->error("%s: bad packet header at offset %lu", _filename.c_str(), (unsigned long) pos);
+	if (n % stride == 0) {
+	    if (index.size() == INDEX_MAX) {
+		for (int i = 0; i < INDEX_MAX / 2; ++i)
+		    index[i] = index[2 * i];
+		index.resize(INDEX_MAX / 2);
+		stride *= 2;
+	    }
+	    index.push_back(pos);
+	}
+	++n;
+	pos += rlen;
+    }
+    return 0;
+}
+
+int
+ParallelFromDump::initialize(ErrorHandler *errh)
+{
+    // map the trace
+    int fd = open(_filename.c_str(), O_RDONLY);
+    if (fd < 0)
+	return errh->error("%s: %s", _filename.c_str(), strerror(errno));
+    struct stat s;
+    if (fstat(fd, &s) < 0 || !S_ISREG(s.st_mode)) {
+	close(fd);
+	return errh->error("%s: not a regular file", _filename.c_str());
+    }
+    if (s.st_size < (off_t) sizeof(fake_pcap_file_header)) {
+	close(fd);
+	return errh->error("%s: not a tcpdump file (too short)", _filename.c_str());
+    }
+    _length = s.st_size;
+    void *data = mmap(0, _length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+	return errh->error("%s: mmap: %s", _filename.c_str(), strerror(errno));
+    _data = reinterpret_cast<unsigned char *>(data);
+    (void) madvise(_data, _length, MADV_SEQUENTIAL);
+
+    // check file header
+    fake_pcap_file_header fh;
+    memcpy(&fh, _data, sizeof(fh));
+    if (fh.magic == FAKE_PCAP_MAGIC || fh.magic == FAKE_PCAP_MAGIC_NANO
+	|| fh.magic == FAKE_MODIFIED_PCAP_MAGIC)
+	_swapped = false;
+    else {
+	_swapped = true;
+	fh.magic = SWAPLONG(fh.magic);
+	fh.version_major = SWAPSHORT(fh.version_major);
+	fh.version_minor = SWAPSHORT(fh.version_minor);
+	fh.linktype = SWAPLONG(fh.linktype);
+    }
+    if (fh.magic != FAKE_PCAP_MAGIC && fh.magic != FAKE_PCAP_MAGIC_NANO
+	&& fh.magic != FAKE_MODIFIED_PCAP_MAGIC)
+	return errh->error("%s: not a tcpdump file (bad magic number)", _filename.c_str());
+    if (fh.version_major != FAKE_PCAP_VERSION_MAJOR)
+	return errh->error("%s: unknown major version %d", _filename.c_str(), fh.version_major);
+    _nano = fh.magic == FAKE_PCAP_MAGIC_NANO;
+    if (fh.magic == FAKE_MODIFIED_PCAP_MAGIC)
+	_extra_pkthdr_crap = sizeof(fake_modified_pcap_pkthdr) - sizeof(fake_pcap_pkthdr);
+    else
+	_extra_pkthdr_crap = 0;
+    _minor_version = fh.version_minor;
+    _linktype = fake_pcap_canonical_dlt(fh.linktype, true);
+    if (_force_ip && !fake_pcap_dlt_force_ipable(_linktype))
+	return errh->error("%s: unknown linktype %d; can't force IP packets", _filename.c_str(), _linktype);
+
+    // assign each shard its part of the trace
+    size_t first = sizeof(fake_pcap_file_header);
+    int nshards = _shards.size();
+    if (_flow)
+	for (int i = 0; i < nshards; ++i)
+	    _shards[i]->pos = first, _shards[i]->end = _length;
+    else {
+	Vector<size_t> index;
+	if (index_trace(index, errh) < 0)
+	    return -1;
+	for (int i = 0; i < nshards; ++i) {
+	    int b = (int) ((uint64_t) index.size() * i / nshards);
+	    int e = (int) ((uint64_t) index.size() * (i + 1) / nshards);
+	    _shards[i]->pos = (b < index.size() ? index[b] : _length);
+	    _shards[i]->end = (e < index.size() ? index[e] : _length);
+	}
+    }
+
+    // all shards share the trace's timeline
+    if (_timing) {
+	fake_pcap_pkthdr ph;
+	uint32_t caplen, len;
+	if (parse_record(first, ph, caplen, len))
+	    _timing_offset = Timestamp::now_steady()
+		- fake_bpf_timeval_union::make_timestamp(&ph.ts, _nano);
+    }
+
+    // shard i runs on thread i
+    _shards_left = nshards;
+    for (int i = 0; i < nshards; ++i) {
+	Shard *s = _shards[i];
+	s->task.move_thread(i % master()->nthreads());
+	ScheduleInfo::initialize_task(this, &s->task, _active, errh);
+	s->task.set_pinned(true);
+	s->timer.initialize(this);
+    }
+    return 0;
+}
+
+void
+ParallelFromDump::cleanup(CleanupStage)
+{
+    for (int i = 0; i < _shards.size(); ++i) {
+	if (_shards[i]->pending)
+	    _shards[i]->pending->kill();
+	delete _shards[i];
+    }
+    _shards.clear();
+    if (_data)
+	munmap(_data, _length);
+    _data = 0;
+}
+
+/* Return a flow hash of the packet in 'data' that's the same for both
+   directions of a flow, scaled to the number of shards. */
+unsigned
+ParallelFromDump::flow_shard(const unsigned char *data, uint32_t caplen) const
+{
+    const unsigned char *end_data = data + caplen;
+    const unsigned char *ip = reinterpret_cast<const unsigned char *>(fake_pcap_ip_header(data, end_data, _linktype));
+    const unsigned char *ports = 0;
+    uint32_t h;
+    if (!ip || ip >= end_data)
+	return 0;
+    else if ((ip[0] >> 4) == 4 && ip + sizeof(click_ip) <= end_data) {
+	click_ip iph;
+	memcpy(&iph, ip, sizeof(iph));
+	h = iph.ip_src.s_addr ^ iph.ip_dst.s_addr ^ iph.ip_p;
+	if (!IP_ISFRAG(&iph)
+	    && (iph.ip_p == IP_PROTO_TCP || iph.ip_p == IP_PROTO_UDP
+		|| iph.ip_p == IP_PROTO_SCTP))
+	    ports = ip + (iph.ip_hl << 2);
+    } else if ((ip[0] >> 4) == 6 && ip + sizeof(click_ip6) <= end_data) {
+	// XOR source and destination addresses, at bytes 8-39
+	uint32_t a[8];
+	memcpy(a, ip + 8, sizeof(a));
+	int nxt = ip[6];
+	h = nxt;
+	for (int i = 0; i < 8; ++i)
+	    h ^= a[i];
+	if (nxt == IP_PROTO_TCP || nxt == IP_PROTO_UDP || nxt == IP_PROTO_SCTP)
+	    ports = ip + sizeof(click_ip6);
+    } else
+	return 0;
+
+    // the XOR of source and destination port is symmetric, too
+    if (ports && ports + 4 <= end_data)
+	h ^= ((ports[0] ^ ports[2]) << 8) | (ports[1] ^ ports[3]);
+    h *= 0x9E3779B1U;
+    return ((uint64_t) h * _shards.size()) >> 32;
+}
+
+Packet *
+ParallelFromDump::next_packet(Shard *s)
+{
+    fake_pcap_pkthdr ph;
+    uint32_t caplen, len;
+    while (s->pos < s->end) {
+	size_t rlen = parse_record(s->pos, ph, caplen, len);
+	if (!rlen) {
+	    click_chatter("%p{element}: bad packet header at offset %lu; giving up", this, (unsigned long) s->pos);
+	    s->pos = s->end;
+	    break;
+	}
+	const unsigned char *data = _data + s->pos + sizeof(ph) + _extra_pkthdr_crap;
+	s->pos += rlen;
+
+	// see FromDump: tcptrace stores too large a caplen
+	if (caplen > len)
+	    caplen = len;
+	if (_flow && _shards.size() > 1
+	    && flow_shard(data, caplen) != (unsigned) s->index)
+	    continue;
+
+	WritablePacket *p = Packet::make(Packet::default_headroom, data, caplen, 0);
+	if (!p)
+	    break;
+	p->timestamp_anno() = fake_bpf_timeval_union::make_timestamp(&ph.ts, _nano);
+	SET_EXTRA_LENGTH_ANNO(p, len - caplen);
+	p->set_mac_header(p->data());
+	return p;
+    }
+    return 0;
+}
+
+void
+ParallelFromDump::shard_done(Shard *s)
+{
+    if (s->done)
+	return;
+    s->done = true;
+    if (_shards_left.dec_and_test() && _stop)
+	router()->please_stop_driver();
+}
+
+bool
+ParallelFromDump::run_task(Task *t)
+{
+    Shard *s = 0;
+    for (int i = 0; !s; ++i)
+	if (&_shards[i]->task == t)
+	    s = _shards[i];
+    if (!_active)
+	return false;
+
+    Timestamp now_s;
+    if (_timing)
+	now_s = Timestamp::now_steady();
+    int port = s->index % noutputs();
+    unsigned n = 0;
+    while (n < _burst) {
+	Packet *p = s->pending;
+	s->pending = 0;
+	if (!p && !(p = next_packet(s))) {
+	    shard_done(s);
+	    return n > 0;
+	}
+	if (_timing) {
+	    Timestamp when = p->timestamp_anno() + _timing_offset;
+	    if (when > now_s) {
+		s->pending = p;
+		s->timer.schedule_at_steady(when);
+		return n > 0;
+	    }
+	}
+	if (_force_ip && !fake_pcap_force_ip(p, _linktype)) {
+	    p->kill();
+	    continue;
+	}
+	output(port).push(p);
+	++s->count;
+	++n;
+    }
+    t->fast_reschedule();
+    return true;
+}
+
+String
+ParallelFromDump::read_handler(Element *e, void *thunk)
+{
+    ParallelFromDump *pfd = static_cast<ParallelFromDump *>(e);
+    switch ((uintptr_t) thunk) {
+    case h_count: {
+	unsigned long count = 0;
+	for (int i = 0; i < pfd->_shards.size(); ++i)
+	    count += pfd->_shards[i]->count;
+	return String(count);
+    }
+    case h_shard_counts: {
+	StringAccum sa;
+	for (int i = 0; i < pfd->_shards.size(); ++i)
+	    sa << pfd->_shards[i]->count << '\n';
+	return sa.take_string();
+    }
+    case h_encap:
+	return String(fake_pcap_unparse_dlt(pfd->_linktype));
+    default:
+	return String();
+    }
+}
+
+int
+ParallelFromDump::write_handler(const String &s, Element *e, void *, ErrorHandler *errh)
+{
+    ParallelFromDump *pfd = static_cast<ParallelFromDump *>(e);
+    bool active;
+    if (!BoolArg().parse(s, active))
+	return errh->error("type mismatch");
+    pfd->_active = active;
+    if (active)
+	for (int i = 0; i < pfd->_shards.size(); ++i)
+	    if (pfd->_shards[i]->pos < pfd->_shards[i]->end
+		|| pfd->_shards[i]->pending)
+		pfd->_shards[i]->task.reschedule();
+    return 0;
+}
+
+void
+ParallelFromDump::add_handlers()
+{
+    add_read_handler("count", read_handler, h_count);
+    add_read_handler("shard_counts", read_handler, h_shard_counts);
+    add_data_handlers("active", Handler::OP_READ | Handler::CHECKBOX, &_active);
+    add_write_handler("active", write_handler, h_active);
+    add_read_handler("encap", read_handler, h_encap);
+    add_data_handlers("filename", Handler::OP_READ, &_filename);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel FakePcap)
+EXPORT_ELEMENT(ParallelFromDump)
+ELEMENT_MT_SAFE(ParallelFromDump)
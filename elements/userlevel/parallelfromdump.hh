@@ -0,0 +1,180 @@
+// -*- mode: c++; c-basic-offset: 4 -*-
+#ifndef CLICK_PARALLELFROMDUMP_HH
+#define CLICK_PARALLELFROMDUMP_HH
+#include <click/element.hh>
+#include <click/task.hh>
+#include <click/timer.hh>
+#include <click/atomic.hh>
+CLICK_DECLS
+struct fake_pcap_pkthdr;
+
+/*
+=c
+
+ParallelFromDump(FILENAME [, I<keywords> SHARDS, SHARD_BY, TIMING, STOP, FORCE_IP, BURST, ACTIVE])
+
+=s traces
+
+reads packets from a tcpdump file on several threads
+
+=d
+
+Reads packets from a tcpdump file, like FromDump, but splits the trace into
+SHARDS shards and emits each shard from its own task.  Shard I runs on
+thread I modulo the number of threads, and emits its packets on output I
+modulo the number of outputs.  Elements downstream of a single output must
+therefore be thread safe, or each shard can have its own output.
+
+The file is mapped into memory and each shard reads its packets directly
+from the mapping.  FILENAME must name an uncompressed tcpdump file; pcapng
+files are not supported.
+
+Keyword arguments are:
+
+=over 8
+
+=item SHARDS
+
+Positive integer.  Number of shards.  Default is the number of threads.
+
+=item SHARD_BY
+
+Either C<FLOW> or C<SEQUENTIAL>.  With C<FLOW>, each shard scans the whole
+trace and emits the packets whose flows hash to it, so all packets of a flow,
+in both directions, are emitted by the same shard in trace order.  The flow
+is the TCP, UDP, or SCTP 5-tuple, or the addresses and protocol of other IP
+packets and of fragments; non-IP packets go to shard 0.  With C<SEQUENTIAL>,
+ParallelFromDump indexes the trace's record offsets at initialization and
+splits it into SHARDS consecutive pieces of about the same number of packets.
+Default is C<FLOW>.
+
+=item TIMING
+
+Boolean.  If true, all shards replay the trace on a common timeline that
+starts when the router is initialized, so they stay loosely synchronized: a
+packet is emitted once as much time has passed as separates its timestamp
+from the trace's first.  This is mostly useful with SHARD_BY C<FLOW>.
+Default is false.
+
+=item STOP
+
+Boolean.  If true, then ParallelFromDump will ask the router to stop when
+every shard is done.  Default is false.
+
+=item FORCE_IP
+
+Boolean.  If true, then ParallelFromDump will emit only IP packets with their
+IP header annotations correctly set, and drop other packets.  Default is
+false.
+
+=item BURST
+
+Positive integer.  Maximum number of packets a shard emits per task
+invocation.  Default is 32.
+
+=item ACTIVE
+
+Boolean.  If false, then ParallelFromDump will not emit packets (until the
+C<active> handler is written).  Default is true.
+
+=back
+
+Packets keep their trace timestamps as timestamp annotations, and their extra
+length annotations are set to any additional length recorded in the dump.
+
+Only available in user-level processes.
+
+=h count read-only
+
+Returns the number of packets emitted so far, by all shards.
+
+=h shard_counts read-only
+
+Returns the number of packets emitted by each shard, one per line.
+
+=h active read/write
+
+Value is a Boolean.
+
+=h encap read-only
+
+Returns the file's encapsulation type.
+
+=h filename read-only
+
+Returns the filename supplied to ParallelFromDump.
+
+=a
+
+FromDump, ToDump, AggregateIPFlows, StaticThreadSched */
+
+class ParallelFromDump : public Element { public:
+
+    ParallelFromDump() CLICK_COLD;
+    ~ParallelFromDump() CLICK_COLD;
+
+    const char *class_name() const		{ return "ParallelFromDump"; }
+    const char *port_count() const		{ return "0/1-"; }
+    const char *processing() const		{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    bool run_task(Task *);
+
+  private:
+
+    enum { INDEX_MAX = 1 << 20 };
+
+    struct Shard {
+	Shard(ParallelFromDump *e, int i)
+	    : task(e), timer(&task), index(i), pos(0), end(0), pending(0),
+	      count(0), done(false) {
+	}
+	Task task;
+	Timer timer;
+	int index;
+	size_t pos;
+	size_t end;
+	Packet *pending;
+	unsigned long count;
+	bool done;
+    };
+
+    String _filename;
+    unsigned char *_data;
+    size_t _length;
+
+    Vector<Shard *> _shards;
+    atomic_uint32_t _shards_left;
+    unsigned _burst;
+
+    bool _flow;
+    bool _timing;
+    bool _stop;
+    bool _force_ip;
+    bool _active;
+    bool _swapped;
+    bool _nano;
+    int _minor_version;
+    unsigned _extra_pkthdr_crap;
+    int _linktype;
+
+    Timestamp _timing_offset;
+
+    size_t parse_record(size_t, fake_pcap_pkthdr &, uint32_t &, uint32_t &) const;
+    int index_trace(Vector<size_t> &, ErrorHandler *);
+    unsigned flow_shard(const unsigned char *, uint32_t) const;
+    Packet *next_packet(Shard *);
+    void shard_done(Shard *);
+
+    enum { h_count, h_shard_counts, h_active, h_encap };
+    static String read_handler(Element *, void *) CLICK_COLD;
+    static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
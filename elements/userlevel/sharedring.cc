@@ -0,0 +1,235 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * sharedring.{cc,hh} -- packet rings shared between Click processes
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "sharedring.hh"
+#include <click/error.hh>
+#include <click/glue.hh>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef __linux__
+# include <sys/vfs.h>
+# ifndef HUGETLBFS_MAGIC
+#  define HUGETLBFS_MAGIC 0x958458f6
+# endif
+#endif
+CLICK_DECLS
+
+SharedRing::SharedRing(const String &filename, void *map, size_t map_size,
+		       const struct stat &st)
+    : _filename(filename), _map(map), _map_size(map_size),
+      _dev(st.st_dev), _ino(st.st_ino), _bell_fd(-1)
+{
+    _h = reinterpret_cast<Header *>(map);
+    _desc = reinterpret_cast<Desc *>((char *) map + _h->desc_offset);
+    _free = reinterpret_cast<uint32_t *>((char *) map + _h->free_offset);
+    _buffers = (unsigned char *) map + _h->buffer_offset;
+    _desc_mask = _h->slots - 1;
+    _free_mask = _h->nbuffers - 1;
+    _refcount = 1;
+    outstanding = 0;
+}
+
+SharedRing::~SharedRing()
+{
+    if (_bell_fd >= 0)
+	close(_bell_fd);
+    munmap(_map, _map_size);
+}
+
+static size_t
+round_up(size_t x, size_t align)
+{
+    return (x + align - 1) & ~(align - 1);
+}
+
+SharedRing *
+SharedRing::create(const String &filename, uint32_t slots,
+		   uint32_t buffer_size, uint32_t headroom, ErrorHandler *errh)
+{
+    uint32_t nbuffers = 2 * slots;
+    size_t desc_offset = round_up(sizeof(Header), CLICK_CACHE_LINE_SIZE);
+    size_t free_offset = round_up(desc_offset + slots * sizeof(Desc), CLICK_CACHE_LINE_SIZE);
+    size_t buffer_offset = round_up(free_offset + nbuffers * sizeof(uint32_t), 4096);
+    size_t size = buffer_offset + (size_t) nbuffers * buffer_size;
+
+    // Start afresh, so a consumer that attached to a previous ring's file
+    // does not see this one change under it.
+    unlink(filename.c_str());
+    int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+	errh->error("%s: %s", filename.c_str(), strerror(errno));
+	return 0;
+    }
+
+    // Files on hugetlbfs must be a whole number of huge pages.
+    size_t map_size = round_up(size, 4096);
+#ifdef __linux__
+    struct statfs sfs;
+    if (fstatfs(fd, &sfs) == 0 && (uint32_t) sfs.f_type == HUGETLBFS_MAGIC)
+	map_size = round_up(size, sfs.f_bsize);
+#endif
+
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && ftruncate(fd, map_size) == 0)
+	map = mmap(0, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int saved_errno = errno;
+    close(fd);
+    if (map == MAP_FAILED) {
+	unlink(filename.c_str());
+	errh->error("%s: %s", filename.c_str(), strerror(saved_errno));
+	return 0;
+    }
+
+    Header *h = reinterpret_cast<Header *>(map);
+    memset(h, 0, sizeof(Header));
+    h->version = VERSION;
+    h->slots = slots;
+    h->nbuffers = nbuffers;
+    h->buffer_size = buffer_size;
+    h->headroom = headroom;
+    h->desc_offset = desc_offset;
+    h->free_offset = free_offset;
+    h->buffer_offset = buffer_offset;
+    h->size = size;
+
+    // Initially, every buffer is free.
+    SharedRing *r = new SharedRing(filename, map, map_size, st);
+    for (uint32_t i = 0; i < nbuffers; ++i)
+	r->free_slot(i) = i;
+    h->free_head = nbuffers;
+    fence();
+    h->magic = MAGIC;
+    return r;
+}
+
+/* Map the ring created by a producer.  Returns null, without reporting an
+ * error, if the producer has not created it yet. */
+SharedRing *
+SharedRing::attach(const String &filename, ErrorHandler *errh)
+{
+    int fd = open(filename.c_str(), O_RDWR);
+    if (fd < 0) {
+	if (errno != ENOENT)
+	    errh->error("%s: %s", filename.c_str(), strerror(errno));
+	return 0;
+    }
+
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t) st.st_size >= sizeof(Header))
+	map = mmap(0, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+	return 0;
+
+    Header *h = reinterpret_cast<Header *>(map);
+    if (h->magic != MAGIC) {
+	munmap(map, st.st_size);
+	return 0;
+    }
+    read_fence();
+    if (h->version != VERSION || h->size > (uint64_t) st.st_size
+	|| !h->slots || (h->slots & (h->slots - 1))
+	|| h->nbuffers != 2 * h->slots) {
+	munmap(map, st.st_size);
+	errh->error("%s: bad shared ring", filename.c_str());
+	return 0;
+    }
+    return new SharedRing(filename, map, st.st_size, st);
+}
+
+/* Return true iff the file no longer holds this ring, because the producer
+ * has stopped or a new producer has replaced it. */
+bool
+SharedRing::stale() const
+{
+    struct stat st;
+    if (stat(_filename.c_str(), &st) < 0)
+	return errno == ENOENT;
+    return st.st_dev != _dev || st.st_ino != _ino;
+}
+
+void
+SharedRing::release(const uint32_t *buffers, int n)
+{
+    _release_lock.acquire();
+    uint32_t head = _h->free_head;
+    for (int i = 0; i < n; ++i)
+	free_slot(head + i) = buffers[i];
+    write_fence();
+    _h->free_head = head + n;
+    _release_lock.release();
+}
+
+void
+SharedRing::release_packet_buffer(unsigned char *buf, size_t, void *arg)
+{
+    SharedRing *r = static_cast<SharedRing *>(arg);
+    uint32_t index = r->buffer_index(buf);
+    r->release(&index, 1);
+    r->outstanding--;
+    r->unref();
+}
+
+int
+SharedRing::open_bell(bool reader, ErrorHandler *errh)
+{
+    if (_bell_fd >= 0)
+	return 0;
+    String bell = _filename + ".bell";
+    if (mkfifo(bell.c_str(), 0600) < 0 && errno != EEXIST)
+	return errh->error("%s: %s", bell.c_str(), strerror(errno));
+    // A writer cannot open the FIFO before a reader has.
+    _bell_fd = open(bell.c_str(), (reader ? O_RDONLY : O_WRONLY) | O_NONBLOCK);
+    if (_bell_fd < 0)
+	return reader ? errh->error("%s: %s", bell.c_str(), strerror(errno)) : -1;
+    fcntl(_bell_fd, F_SETFD, FD_CLOEXEC);
+    return 0;
+}
+
+void
+SharedRing::ring_bell()
+{
+    if (_h->consumer_asleep
+	&& __sync_bool_compare_and_swap(&_h->consumer_asleep, 1, 0)) {
+	if (_bell_fd < 0)
+	    (void) open_bell(false, ErrorHandler::silent_handler());
+	char c = 0;
+	if (_bell_fd >= 0 && write(_bell_fd, &c, 1) < 0 && errno == EPIPE) {
+	    // The consumer went away; open the FIFO again next time.
+	    close(_bell_fd);
+	    _bell_fd = -1;
+	}
+    }
+}
+
+void
+SharedRing::drain_bell()
+{
+    char buf[64];
+    while (read(_bell_fd, buf, sizeof(buf)) > 0)
+	/* nada */;
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel)
+ELEMENT_PROVIDES(SharedRing)
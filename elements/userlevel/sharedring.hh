@@ -0,0 +1,144 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_SHAREDRING_HH
+#define CLICK_SHAREDRING_HH
+#include <click/string.hh>
+#include <click/atomic.hh>
+#include <click/sync.hh>
+#include <sys/types.h>
+struct stat;
+CLICK_DECLS
+class ErrorHandler;
+
+/* SharedRing is the memory layout shared by ToSharedRing and FromSharedRing:
+ * a file mapped by both processes, holding a header, a ring of packet
+ * descriptors from the producer to the consumer, a ring of free buffer
+ * indexes from the consumer back to the producer, and the packet buffers.
+ * Each ring has a single writer, which publishes entries by advancing its
+ * head; the reader advances the tail.  Indexes run freely and are masked
+ * into their rings.
+ *
+ * The producer creates the file.  A FIFO named FILENAME.bell serves as the
+ * consumer's doorbell: a sleeping consumer sets consumer_asleep and selects
+ * on the FIFO, and the producer writes a byte to it after publishing
+ * packets. */
+
+class SharedRing { public:
+
+    enum { MAGIC = 0x436B5352, VERSION = 1 };
+
+    struct Desc {
+	uint32_t buffer;
+	uint32_t length;
+	uint32_t sec;
+	uint32_t subsec;
+    };
+
+    struct Header {
+	uint32_t magic;			// written last by the producer
+	uint32_t version;
+	uint32_t slots;			// descriptor ring size, a power of 2
+	uint32_t nbuffers;		// buffers and free ring size, 2 * slots
+	uint32_t buffer_size;
+	uint32_t headroom;		// where packet data starts in a buffer
+	uint32_t desc_offset;
+	uint32_t free_offset;
+	uint64_t buffer_offset;
+	uint64_t size;
+
+	// written by the producer
+	volatile uint32_t desc_head CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+	volatile uint32_t free_tail;
+
+	// written by the consumer
+	volatile uint32_t desc_tail CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+	volatile uint32_t free_head;
+	volatile uint32_t consumer_asleep;
+    };
+
+    // The header is shared with another process, so these fences and
+    // consumer_asleep's updates must be real even in single-threaded
+    // builds, where Click's own fences and atomics are compiler-only.
+    static void fence() {
+	__sync_synchronize();
+    }
+    static void write_fence() {
+#if defined(__i386__) || defined(__x86_64__)
+	asm volatile("" : : : "memory");
+#else
+	__sync_synchronize();
+#endif
+    }
+    static void read_fence() {
+	write_fence();
+    }
+
+    static SharedRing *create(const String &filename, uint32_t slots,
+			      uint32_t buffer_size, uint32_t headroom,
+			      ErrorHandler *errh);
+    static SharedRing *attach(const String &filename, ErrorHandler *errh);
+    bool stale() const;
+
+    void ref() {
+	_refcount++;
+    }
+    void unref() {
+	if (_refcount.dec_and_test())
+	    delete this;
+    }
+
+    Header *header() const {
+	return _h;
+    }
+    Desc &desc(uint32_t i) const {
+	return _desc[i & _desc_mask];
+    }
+    uint32_t &free_slot(uint32_t i) const {
+	return _free[i & _free_mask];
+    }
+    unsigned char *buffer(uint32_t i) const {
+	return _buffers + (size_t) i * _h->buffer_size;
+    }
+    uint32_t buffer_index(const unsigned char *b) const {
+	return (b - _buffers) / _h->buffer_size;
+    }
+
+    // Consumer side: return buffers to the producer.  release() may be
+    // called from any thread, such as by zero-copy packets' destructors.
+    void release(const uint32_t *buffers, int n);
+    static void release_packet_buffer(unsigned char *, size_t, void *);
+
+    // Count of buffers held by zero-copy packets.
+    atomic_uint32_t outstanding;
+
+    int open_bell(bool reader, ErrorHandler *errh);
+    int bell_fd() const {
+	return _bell_fd;
+    }
+    void ring_bell();
+    void drain_bell();
+
+  private:
+
+    String _filename;
+    void *_map;
+    size_t _map_size;
+    dev_t _dev;
+    ino_t _ino;
+    Header *_h;
+    Desc *_desc;
+    uint32_t *_free;
+    unsigned char *_buffers;
+    uint32_t _desc_mask;
+    uint32_t _free_mask;
+    int _bell_fd;
+    atomic_uint32_t _refcount;
+    Spinlock _release_lock;
+
+    SharedRing(const String &filename, void *map, size_t map_size,
+	       const struct stat &st);
+    ~SharedRing();
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -30,9 +30,17 @@
 #include <sys/un.h>
 #include <arpa/inet.h>
 #include <netinet/tcp.h>
+#include <netinet/udp.h>
 #include <fcntl.h>
 #include "socket.hh"
 
+#if defined(__linux__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 14))
+# define SOCKET_ALLOW_MMSG 1
+#endif
+#if SOCKET_ALLOW_MMSG && defined(UDP_SEGMENT) && defined(UDP_GRO)
+# define SOCKET_ALLOW_UDP_OFFLOAD 1
+#endif
+
 #ifdef HAVE_PROPER
 #include <proper/prop.h>
 #endif
@@ -41,11 +49,11 @@ CLICK_DECLS
 
 Socket::Socket()
   : _task(this),
-    _fd(-1), _active(-1), _rq(0), _wq(0),
+    _fd(-1), _active(-1), _rq(0),
     _local_port(0), _local_pathname(""),
     _timestamp(true), _sndbuf(-1), _rcvbuf(-1),
     _snaplen(2048), _headroom(Packet::default_headroom), _nodelay(1),
-    _verbose(false), _client(false), _proper(false), _allow(0), _deny(0)
+    _burst(1), _gso(false), _gro(false), _verbose(false), _client(false), _proper(false), _allow(0), _deny(0)
 {
 }
 
@@ -72,6 +80,9 @@ Socket::configure(Vector<String> &conf, ErrorHandler *errh)
       .read("RCVBUF", _rcvbuf)
       .read("SNDBUF", _sndbuf)
       .read("NODELAY", _nodelay)
+      .read("BURST", _burst)
+      .read("GSO", _gso)
+      .read("GRO", _gro)
       .read("CLIENT", _client)
       .read("PROPER", _proper)
       .read("ALLOW", allow)
@@ -119,6 +130,15 @@ Socket::configure(Vector<String> &conf, ErrorHandler *errh)
   else
     return errh->error("unknown socket type `%s'", socktype.c_str());
 
+  if (_burst < 1)
+    return errh->error("BURST must be positive");
+  if ((_gso || _gro) && _protocol != IPPROTO_UDP)
+    return errh->error("GSO and GRO apply to UDP sockets only");
+#if !SOCKET_ALLOW_UDP_OFFLOAD
+  if (_gso || _gro)
+    return errh->error("GSO and GRO not supported on this platform");
+#endif
+
   return 0;
 }
 
@@ -189,6 +209,15 @@ Socket::initialize(ErrorHandler *errh)
     if (setsockopt(_fd, SOL_SOCKET, SO_RCVBUF, &_rcvbuf, sizeof(_rcvbuf)) < 0)
       return initialize_socket_error(errh, "setsockopt(SO_RCVBUF)");
 
+#if SOCKET_ALLOW_UDP_OFFLOAD
+  // let the kernel coalesce received datagrams
+  if (_gro) {
+    int one = 1;
+    if (setsockopt(_fd, IPPROTO_UDP, UDP_GRO, &one, sizeof(one)) < 0)
+      return initialize_socket_error(errh, "setsockopt(UDP_GRO)");
+  }
+#endif
+
   // if a server, then the first arguments should be interpreted as
   // the address/port/file to bind() to, not to connect() to
   if (!_client) {
@@ -262,8 +291,8 @@ Socket::cleanup(CleanupStage)
   }
   if (_rq)
     _rq->kill();
-  if (_wq)
-    _wq->kill();
+  _rbufs.kill();
+  _wq.kill();
   if (_fd >= 0) {
     // shut down the listening socket in case we forked
 #ifdef SHUT_RDWR
@@ -346,7 +375,17 @@ Socket::selected(int fd, int)
       add_select(_active, SELECT_READ);
     }
 
-    // read data from socket
+    // read data from socket; batched reads leave _rq null
+#if SOCKET_ALLOW_MMSG
+    if (_socktype == SOCK_DGRAM && (_burst > 1 || _gro)) {
+      if (read_batch() < 0 && errno != EAGAIN) {
+	if (_verbose)
+	  click_chatter("%s: %s", declaration().c_str(), strerror(errno));
+	close_active();
+	return;
+      }
+    } else
+#endif
     if (!_rq)
       _rq = Packet::make(_headroom, 0, _snaplen, 0);
     if (_rq) {
@@ -404,6 +443,101 @@ Socket::selected(int fd, int)
     run_task(0);
 }
 
+#if SOCKET_ALLOW_MMSG
+int
+Socket::read_batch()
+{
+  enum { max_mmsg = 64 };
+  struct mmsghdr msgs[max_mmsg];
+  struct iovec iov[max_mmsg];
+  union { struct sockaddr_in in; struct sockaddr_un un; } from[max_mmsg];
+  union { struct cmsghdr h; char buf[CMSG_SPACE(sizeof(int))]; } control[max_mmsg];
+
+  // GRO hands over up to 64KB of coalesced datagrams at once
+  uint32_t buflen = _gro && _snaplen < 65535 ? 65535 : _snaplen;
+  int n = _burst < max_mmsg ? _burst : max_mmsg;
+  // unused buffers are kept for the next call
+  if (_rbufs.count() < n)
+    Packet::make_bulk(n - _rbufs.count(), _headroom, buflen, 0, _rbufs);
+  if (_rbufs.count() < n)
+    n = _rbufs.count();
+
+  Packet *p = _rbufs.first();
+  for (int i = 0; i < n; ++i, p = p->next()) {
+    iov[i].iov_base = static_cast<WritablePacket *>(p)->data();
+    iov[i].iov_len = p->length();
+    memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+    if (!_client) {
+      // datagram server, find out who we are talking to
+      msgs[i].msg_hdr.msg_name = &from[i];
+      msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+    }
+    if (_gro) {
+      msgs[i].msg_hdr.msg_control = &control[i];
+      msgs[i].msg_hdr.msg_controllen = sizeof(control[i]);
+    }
+  }
+
+  int r = n ? recvmmsg(_active, msgs, n, MSG_TRUNC, 0) : 0;
+  if (r <= 0)
+    return r;
+
+  Timestamp now;
+  if (_timestamp)
+    now.assign_now();
+  PacketBatch batch, denied;
+  for (int i = 0; i < r; ++i) {
+    WritablePacket *q = static_cast<WritablePacket *>(_rbufs.pop_front());
+    uint32_t len = msgs[i].msg_len;
+
+    if (!_client) {
+      if (_family == AF_INET && !allowed(IPAddress(from[i].in.sin_addr))) {
+	if (_verbose)
+	  click_chatter("%s: dropped datagram from %s:%d", declaration().c_str(),
+			IPAddress(from[i].in.sin_addr).unparse().c_str(), ntohs(from[i].in.sin_port));
+	// reuse the buffer, but not for the messages after this one
+	denied.append(q);
+	continue;
+      }
+      memcpy(&_remote, &from[i], msgs[i].msg_hdr.msg_namelen);
+      _remote_len = msgs[i].msg_hdr.msg_namelen;
+    }
+
+    if (len > buflen)
+      SET_EXTRA_LENGTH_ANNO(q, len - buflen);
+    else
+      q->take(buflen - len);
+    if (_timestamp)
+      q->timestamp_anno() = now;
+
+#if SOCKET_ALLOW_UDP_OFFLOAD
+    // split coalesced datagrams into clones of the one buffer
+    int gso_size = 0;
+    if (_gro)
+      for (struct cmsghdr *c = CMSG_FIRSTHDR(&msgs[i].msg_hdr); c;
+	   c = CMSG_NXTHDR(&msgs[i].msg_hdr, c))
+	if (c->cmsg_level == IPPROTO_UDP && c->cmsg_type == UDP_GRO)
+	  memcpy(&gso_size, CMSG_DATA(c), sizeof(gso_size));
+    while (gso_size > 0 && q->length() > (uint32_t) gso_size) {
+      Packet *seg = q->clone();
+      if (!seg)
+	break;
+      seg->take(seg->length() - gso_size);
+      batch.append(seg);
+      q->pull(gso_size);
+    }
+#endif
+    batch.append(q);
+  }
+  _rbufs.append(denied);
+
+  output(0).push_batch(batch);
+  return r;
+}
+#endif
+
 int
 Socket::write_packet(Packet *p)
 {
@@ -451,6 +585,106 @@ Socket::write_packet(Packet *p)
   return 0;
 }
 
+#if SOCKET_ALLOW_MMSG
+int
+Socket::write_batch(PacketBatch &batch)
+{
+  enum { max_mmsg = 64, max_iov = 256, max_segs = 64, max_udp = 65507 };
+  struct mmsghdr msgs[max_mmsg];
+  struct iovec iov[max_iov];
+  int npackets[max_mmsg];
+  union { struct sockaddr_in in; struct sockaddr_un un; } to[max_mmsg];
+  union { struct cmsghdr h; char buf[CMSG_SPACE(sizeof(uint16_t))]; } control[max_mmsg];
+  // If the IP address specified when the element was created is 0.0.0.0,
+  // send each packet to its IP destination annotation address
+  bool dst_anno = !IPAddress(_remote_ip) && _client && _family == AF_INET;
+
+  assert(_active >= 0 && _socktype == SOCK_DGRAM);
+
+  while (!batch.empty()) {
+    int n = 0, niov = 0;
+    Packet *p = batch.first();
+    while (p && n < max_mmsg && niov < max_iov) {
+      struct msghdr &m = msgs[n].msg_hdr;
+      memset(&m, 0, sizeof(m));
+      memcpy(&to[n], &_remote, _remote_len);
+      if (dst_anno)
+	to[n].in.sin_addr = p->dst_ip_anno();
+      m.msg_name = &to[n];
+      m.msg_namelen = _remote_len;
+      m.msg_iov = &iov[niov];
+
+      // With GSO, gather a run of equal-sized packets, of which only the
+      // last may be shorter, into one message.
+      uint32_t seg = p->length(), total = 0;
+      int k = 0;
+      while (1) {
+	iov[niov + k].iov_base = const_cast<unsigned char *>(p->data());
+	iov[niov + k].iov_len = p->length();
+	total += p->length();
+	++k;
+	uint32_t last = p->length();
+	p = p->next();
+	if (!_gso || !p || last != seg || seg == 0
+	    || k == max_segs || niov + k == max_iov
+	    || p->length() > seg || total + p->length() > max_udp
+	    || (dst_anno && p->dst_ip_anno() != IPAddress(to[n].in.sin_addr)))
+	  break;
+      }
+      m.msg_iovlen = k;
+
+#if SOCKET_ALLOW_UDP_OFFLOAD
+      if (k > 1) {
+	uint16_t gso_size = seg;
+	m.msg_control = &control[n];
+	m.msg_controllen = sizeof(control[n].buf);
+	struct cmsghdr *c = CMSG_FIRSTHDR(&m);
+	c->cmsg_level = IPPROTO_UDP;
+	c->cmsg_type = UDP_SEGMENT;
+	c->cmsg_len = CMSG_LEN(sizeof(gso_size));
+	memcpy(CMSG_DATA(c), &gso_size, sizeof(gso_size));
+      }
+#endif
+      npackets[n] = k;
+      niov += k;
+      ++n;
+    }
+
+    int r = sendmmsg(_active, msgs, n, 0);
+
+    // error
+    if (r < 0) {
+      // out of memory or would block
+      if (errno == ENOBUFS || errno == EAGAIN)
+	return -1;
+
+      // interrupted by signal, try again immediately
+      else if (errno == EINTR)
+	continue;
+
+      // connection probably terminated or other fatal error
+      else {
+	if (_verbose)
+	  click_chatter("%s: %s", declaration().c_str(), strerror(errno));
+	close_active();
+	break;
+      }
+    }
+
+    // A short count means the next message hit an error; the next call
+    // reports it.
+    PacketBatch sent;
+    for (int i = 0; i < r; ++i)
+      for (int k = npackets[i]; k; --k)
+	sent.append(batch.pop_front());
+    sent.kill();
+  }
+
+  batch.kill();
+  return 0;
+}
+#endif
+
 void
 Socket::push(int, Packet *p)
 {
@@ -481,6 +715,36 @@ Socket::push(int, Packet *p)
     p->kill();
 }
 
+void
+Socket::push_batch(int port, PacketBatch &batch)
+{
+#if SOCKET_ALLOW_MMSG
+  if (_socktype == SOCK_DGRAM) {
+    fd_set fds;
+    int err = 0;
+
+    while (_active >= 0 && !batch.empty()) {
+      // block
+      do {
+	FD_ZERO(&fds);
+	FD_SET(_active, &fds);
+	err = select(_active + 1, NULL, &fds, NULL, NULL);
+      } while (err < 0 && errno == EINTR);
+
+      // write
+      if (err < 0 || (write_batch(batch) < 0 && errno != ENOBUFS && errno != EAGAIN))
+	break;
+    }
+
+    if (!batch.empty() && _verbose)
+      click_chatter("%s: %s, dropping packets", declaration().c_str(), strerror(errno));
+    batch.kill();
+    return;
+  }
+#endif
+  Element::push_batch(port, batch);
+}
+
 bool
 Socket::run_task(Task *)
 {
@@ -491,10 +755,22 @@ Socket::run_task(Task *)
     Packet *p = 0;
     int err = 0;
 
+#if SOCKET_ALLOW_MMSG
+    if (_socktype == SOCK_DGRAM && (_burst > 1 || _gso)) {
+      // write as much as we can, a burst at a time
+      do {
+	if (_wq.count() < _burst)
+	  input(0).pull_batch(_wq, _burst - _wq.count());
+	if (_wq.empty())
+	  break;
+	any = true;
+	err = write_batch(_wq);
+      } while (err >= 0 && _active >= 0);
+    } else
+#endif
     // write as much as we can
     do {
-      p = _wq ? _wq : input(0).pull();
-      _wq = 0;
+      p = _wq.empty() ? input(0).pull() : _wq.pop_front();
       if (p) {
 	any = true;
 	err = write_packet(p);
@@ -502,9 +778,9 @@ Socket::run_task(Task *)
     } while (p && err >= 0);
 
     if (err < 0) {
-      // queue packet for writing when socket becomes available
-      _wq = p;
-      p = 0;
+      // queue packets for writing when socket becomes available
+      if (p)
+	_wq.prepend(p);
       add_select(_active, SELECT_WRITE);
     } else if (_signal)
       // more pending
@@ -5,6 +5,7 @@
 #include <click/string.hh>
 #include <click/task.hh>
 #include <click/notifier.hh>
+#include <click/packetbatch.hh>
 #include "../ip/iproutetable.hh"
 #include <sys/un.h>
 CLICK_DECLS
@@ -141,6 +142,30 @@ Boolean. PlanetLab specific. If true and Click has been configured
 
 Integer. Per-packet headroom. Defaults to 28.
 
+=item BURST
+
+Unsigned integer. Applies to datagram sockets only. Maximum number of
+datagrams to receive with one recvmmsg() call, and to pull and send
+with one sendmmsg() call. Batches pushed to a datagram Socket are
+always sent with sendmmsg(). Default is 1, which receives and sends
+one datagram per system call.
+
+=item GSO
+
+Boolean. Applies to UDP sockets only. If set, consecutive input
+packets of equal length (the last may be shorter) for the same
+destination are sent as one UDP_SEGMENT message, which the kernel
+splits back into datagrams. Packets are not copied. Only packets sent
+together can be combined, so GSO needs BURST greater than 1 or pushed
+batches. Segments must fit within the path MTU. Default is false.
+
+=item GRO
+
+Boolean. Applies to UDP sockets only. If set, the kernel may coalesce
+consecutive datagrams from the same flow into one large receive
+(UDP_GRO). Socket splits each such receive back into one packet per
+datagram; the packets share one buffer. Default is false.
+
 =back
 
 =e
@@ -188,10 +213,13 @@ class Socket : public Element { public:
   bool run_task(Task *);
   void selected(int fd, int mask);
   void push(int port, Packet*);
+  void push_batch(int port, PacketBatch &batch);
 
   bool allowed(IPAddress);
   void close_active(void);
   int write_packet(Packet*);
+  int read_batch();
+  int write_batch(PacketBatch &batch);
 
 protected:
   Task _task;
@@ -211,7 +239,8 @@ private:
 
   NotifierSignal _signal;	// packet is available to pull()
   WritablePacket *_rq;		// queue to receive pulled packets
-  Packet *_wq;			// queue to store pulled packet for when sendto() blocks
+  PacketBatch _rbufs;		// spare buffers for recvmmsg()
+  PacketBatch _wq;		// queue to store pulled packets for when sendto() blocks
 
   int _family;			// AF_INET or AF_UNIX
   int _socktype;		// SOCK_STREAM or SOCK_DGRAM
@@ -229,6 +258,9 @@ private:
   int _snaplen;			// maximum received packet length
   unsigned _headroom;
   int _nodelay;			// disable Nagle algorithm
+  int _burst;			// datagrams per recvmmsg()/sendmmsg()
+  bool _gso;			// send with UDP_SEGMENT
+  bool _gro;			// receive with UDP_GRO
   bool _verbose;		// be verbose
   bool _client;			// client or server
   bool _proper;			// (PlanetLab only) use Proper to bind port
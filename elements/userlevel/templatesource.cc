@@ -0,0 +1,672 @@
+// -*- mode: c++; c-basic-offset: 4 -*-
+/*
+ * templatesource.{cc,hh} -- element generates many flows of packets from
+ * templates
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "templatesource.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/router.hh>
+#include <click/master.hh>
+#include <click/straccum.hh>
+#include <click/userutils.hh>
+#include <click/packetbatch.hh>
+#include <click/standard/scheduleinfo.hh>
+#include <clicknet/ip.h>
+#include <clicknet/tcp.h>
+#include <clicknet/udp.h>
+#include "fakepcap.hh"
+#include <unistd.h>
+CLICK_DECLS
+
+#define	SWAPLONG(y) \
+	((((y)&0xff)<<24) | (((y)&0xff00)<<8) | (((y)&0xff0000)>>8) | (((y)>>24)&0xff))
+#define	SWAPSHORT(y) \
+	( (((y)&0xff)<<8) | ((u_short)((y)&0xff00)>>8) )
+
+TemplateSource::TemplateSource()
+    : _rate_epoch(0), _use_cycles(false), _ticks_per_sec(1e9),
+      _packets_per_tick(0)
+{
+}
+
+TemplateSource::~TemplateSource()
+{
+}
+
+/* Parse a FIELD argument, `NAME RANGE [MODE]'. */
+int
+TemplateSource::parse_field(const String &str, Field &f, ErrorHandler *errh)
+{
+    Vector<String> words;
+    cp_spacevec(str, words);
+    if (words.size() < 2 || words.size() > 3)
+	return errh->error("FIELD %<%s%>: expected NAME RANGE [MODE]", str.c_str());
+
+    String name = words[0].upper();
+    if (name == "SRC")
+	f.type = F_SRC;
+    else if (name == "DST")
+	f.type = F_DST;
+    else if (name == "SPORT")
+	f.type = F_SPORT;
+    else if (name == "DPORT")
+	f.type = F_DPORT;
+    else if (name == "ID")
+	f.type = F_ID;
+    else
+	return errh->error("FIELD %<%s%>: unknown field %<%s%>", str.c_str(), words[0].c_str());
+
+    f.random = false;
+    if (words.size() == 3) {
+	String mode = words[2].upper();
+	if (mode == "RANDOM")
+	    f.random = true;
+	else if (mode != "SEQUENTIAL")
+	    return errh->error("FIELD %<%s%>: MODE must be SEQUENTIAL or RANDOM", str.c_str());
+    }
+
+    String range = words[1];
+    int dash = range.find_left('-');
+    String lo = (dash < 0 ? range : range.substring(0, dash));
+    String hi = (dash < 0 ? range : range.substring(dash + 1));
+    uint32_t first, last;
+    if (f.type == F_SRC || f.type == F_DST) {
+	IPAddress a, m;
+	if (dash < 0 && IPPrefixArg(true).parse(range, a, m)) {
+	    first = ntohl(a.addr() & m.addr());
+	    last = first | ~ntohl(m.addr());
+	} else if (dash >= 0 && IPAddressArg().parse(lo, a)
+		   && IPAddressArg().parse(hi, m)) {
+	    first = ntohl(a.addr());
+	    last = ntohl(m.addr());
+	} else
+	    return errh->error("FIELD %<%s%>: bad address range", str.c_str());
+    } else {
+	uint16_t a, b;
+	if (!IntArg().parse(lo, a) || !IntArg().parse(hi, b))
+	    return errh->error("FIELD %<%s%>: bad range", str.c_str());
+	first = a, last = b;
+    }
+    if (last < first)
+	return errh->error("FIELD %<%s%>: empty range", str.c_str());
+    f.base = first;
+    f.size = (uint64_t) last - first + 1;
+    return 0;
+}
+
+/* Parse LENGTHS into distinct lengths and their weights. */
+int
+TemplateSource::parse_lengths(const String &str, Vector<uint32_t> &lengths,
+			      Vector<uint32_t> &weights, ErrorHandler *errh)
+{
+    Vector<String> words;
+    cp_spacevec(str, words);
+    if (words.size() == 1 && words[0].upper() == "IMIX") {
+	words.clear();
+	cp_spacevec("60*7 590*4 1514*1", words);
+    }
+    uint32_t total = 0;
+    for (int i = 0; i < words.size(); ++i) {
+	int star = words[i].find_left('*');
+	uint32_t length, weight = 1;
+	if (!IntArg().parse(star < 0 ? words[i] : words[i].substring(0, star), length)
+	    || (star >= 0 && !IntArg().parse(words[i].substring(star + 1), weight))
+	    || length == 0 || length > 65535 || weight == 0)
+	    return errh->error("LENGTHS: bad length %<%s%>", words[i].c_str());
+	lengths.push_back(length);
+	weights.push_back(weight);
+	if ((total += weight) > 65536)
+	    return errh->error("LENGTHS: weights too large");
+    }
+    if (lengths.empty())
+	return errh->error("LENGTHS: no lengths");
+    return 0;
+}
+
+int
+TemplateSource::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    int nstreams = master()->nthreads();
+    Vector<String> fields;
+    String encap = "ETHER", lengths;
+    _burst = 32;
+    _limit = -1;
+    _rate = 0;
+    _stop = false;
+    _active = true;
+
+    if (Args(conf, this, errh)
+	.read("FILENAME", FilenameArg(), _filename)
+	.read_all("DATA", _data)
+	.read("ENCAP", WordArg(), encap)
+	.read_all("FIELD", AnyArg(), fields)
+	.read("LENGTHS", AnyArg(), lengths)
+	.read("RATE", _rate)
+	.read("LIMIT", _limit)
+	.read("STREAMS", nstreams)
+	.read("BURST", _burst)
+	.read("STOP", _stop)
+	.read("ACTIVE", _active)
+	.complete() < 0)
+	return -1;
+
+    if (!_filename && _data.empty())
+	return errh->error("no templates; supply FILENAME or DATA");
+    if ((_dlt = fake_pcap_parse_dlt(encap)) < 0)
+	return errh->error("bad encapsulation type");
+    if (nstreams <= 0)
+	return errh->error("STREAMS must be positive");
+    if (_burst == 0)
+	return errh->error("BURST must be positive");
+    if (fields.size() > MAX_FIELDS)
+	return errh->error("too many FIELDs");
+    for (int i = 0; i < fields.size(); ++i) {
+	Field f;
+	if (parse_field(fields[i], f, errh) < 0)
+	    return -1;
+	if (!f.random)
+	    _seq_fields.push_back(_fields.size());
+	_fields.push_back(f);
+    }
+
+    // Interleave the lengths evenly by smooth weighted round robin.
+    if (lengths) {
+	Vector<uint32_t> weights;
+	if (parse_lengths(lengths, _lengths, weights, errh) < 0)
+	    return -1;
+	Vector<int64_t> current(weights.size(), 0);
+	int64_t total = 0;
+	for (int i = 0; i < weights.size(); ++i)
+	    total += weights[i];
+	for (int64_t n = 0; n < total; ++n) {
+	    int best = 0;
+	    for (int i = 0; i < weights.size(); ++i) {
+		current[i] += weights[i];
+		if (current[i] > current[best])
+		    best = i;
+	    }
+	    current[best] -= total;
+	    _length_seq.push_back(best);
+	}
+    } else
+	_length_seq.push_back(0);
+
+    for (int i = 0; i < nstreams; ++i)
+	_streams.push_back(new Stream(this, i));
+    return 0;
+}
+
+/* Find the IPv4 and transport headers of template 't'. */
+void
+TemplateSource::analyze(Template &t, int dlt)
+{
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(t.data.data());
+    const uint8_t *end_data = data + t.data.length();
+    const uint8_t *ip = reinterpret_cast<const uint8_t *>(fake_pcap_ip_header(data, end_data, dlt));
+    click_ip iph;
+    t.ip_off = t.l4_off = t.l4_cksum_off = -1;
+    if (ip && ip + sizeof(iph) <= end_data) {
+	memcpy(&iph, ip, sizeof(iph));
+	if (iph.ip_v == 4 && iph.ip_hl >= 5 && ip + (iph.ip_hl << 2) <= end_data)
+	    t.ip_off = ip - data;
+    }
+    t.headroom = Packet::default_headroom;
+    if (t.ip_off < 0)
+	return;
+
+    // align the IP header in generated packets
+    t.headroom += (4 - ((Packet::default_headroom + t.ip_off) & 3)) & 3;
+
+    const uint8_t *l4 = ip + (iph.ip_hl << 2);
+    if (IP_ISFRAG(&iph))
+	return;
+    if (iph.ip_p == IP_PROTO_TCP && l4 + sizeof(click_tcp) <= end_data) {
+	t.l4_off = l4 - data;
+	t.l4_cksum_off = t.l4_off + offsetof(click_tcp, th_sum);
+    } else if (iph.ip_p == IP_PROTO_UDP && l4 + sizeof(click_udp) <= end_data) {
+	t.l4_off = l4 - data;
+	// a zero UDP checksum means none
+	if (l4[offsetof(click_udp, uh_sum)] || l4[offsetof(click_udp, uh_sum) + 1])
+	    t.l4_cksum_off = t.l4_off + offsetof(click_udp, uh_sum);
+    }
+}
+
+int
+TemplateSource::read_templates(const String &filename, Vector<Template> &templates, ErrorHandler *errh)
+{
+    String s = file_string(filename, errh);
+    if (!s && errh->nerrors())
+	return -1;
+    const unsigned char *data = reinterpret_cast<const unsigned char *>(s.data());
+    size_t length = s.length(), pos = sizeof(fake_pcap_file_header);
+    if (length < pos)
+	return errh->error("%s: not a tcpdump file (too short)", filename.c_str());
+
+    fake_pcap_file_header fh;
+    memcpy(&fh, data, sizeof(fh));
+    bool swapped = false;
+    if (fh.magic != FAKE_PCAP_MAGIC && fh.magic != FAKE_PCAP_MAGIC_NANO
+	&& fh.magic != FAKE_MODIFIED_PCAP_MAGIC) {
+	swapped = true;
+	fh.magic = SWAPLONG(fh.magic);
+	fh.version_major = SWAPSHORT(fh.version_major);
+	fh.linktype = SWAPLONG(fh.linktype);
+    }
+    if (fh.magic != FAKE_PCAP_MAGIC && fh.magic != FAKE_PCAP_MAGIC_NANO
+	&& fh.magic != FAKE_MODIFIED_PCAP_MAGIC)
+	return errh->error("%s: not a tcpdump file (bad magic number)", filename.c_str());
+    if (fh.version_major != FAKE_PCAP_VERSION_MAJOR)
+	return errh->error("%s: unknown major version %d", filename.c_str(), fh.version_major);
+    size_t hlen = sizeof(fake_pcap_pkthdr);
+    if (fh.magic == FAKE_MODIFIED_PCAP_MAGIC)
+	hlen = sizeof(fake_modified_pcap_pkthdr);
+    int dlt = fake_pcap_canonical_dlt(fh.linktype, true);
+
+    while (pos + hlen <= length) {
+	fake_pcap_pkthdr ph;
+	memcpy(&ph, data + pos, sizeof(ph));
+	uint32_t caplen = swapped ? SWAPLONG(ph.caplen) : ph.caplen;
+	if (caplen > 65535 || pos + hlen + caplen > length)
+	    return errh->error("%s: bad packet header at offset %lu", filename.c_str(), (unsigned long) pos);
+	Template t;
+	t.data = s.substring(pos + hlen, caplen);
+	analyze(t, dlt);
+	templates.push_back(t);
+	pos += hlen + caplen;
+    }
+    return 0;
+}
+
+/* Make 'v', a copy of template 't' whose lengths and checksums are for a
+   packet 'length' bytes long. */
+int
+TemplateSource::make_variant(const Template &t, uint32_t length, Template &v, ErrorHandler *errh)
+{
+    if (t.ip_off < 0)
+	return errh->error("LENGTHS requires IPv4 templates");
+    const click_ip *tip = reinterpret_cast<const click_ip *>(t.data.data() + t.ip_off);
+    uint32_t min_length = t.ip_off + (tip->ip_hl << 2);
+    if (t.l4_off >= 0)
+	min_length = t.l4_off + (tip->ip_p == IP_PROTO_TCP ? sizeof(click_tcp) : sizeof(click_udp));
+    if (length < min_length)
+	return errh->error("length %u too short for a template", length);
+
+    StringAccum sa;
+    uint32_t copy = length < (uint32_t) t.data.length() ? length : t.data.length();
+    sa.append(t.data.data(), copy);
+    sa.append_fill(0, length - copy);
+    unsigned char *d = reinterpret_cast<unsigned char *>(sa.data());
+
+    click_ip *ip = reinterpret_cast<click_ip *>(d + t.ip_off);
+    int hlen = ip->ip_hl << 2;
+    ip->ip_len = htons(length - t.ip_off);
+    ip->ip_sum = 0;
+    ip->ip_sum = click_in_cksum(reinterpret_cast<unsigned char *>(ip), hlen);
+    if (t.l4_off >= 0) {
+	unsigned char *l4 = d + t.l4_off;
+	int l4_len = length - t.l4_off;
+	if (ip->ip_p == IP_PROTO_UDP)
+	    reinterpret_cast<click_udp *>(l4)->uh_ulen = htons(l4_len);
+	if (t.l4_cksum_off >= 0) {
+	    uint16_t *sum = reinterpret_cast<uint16_t *>(d + t.l4_cksum_off);
+	    *sum = 0;
+	    *sum = click_in_cksum_pseudohdr(click_in_cksum(l4, l4_len), ip, l4_len);
+	    if (*sum == 0 && ip->ip_p == IP_PROTO_UDP)
+		*sum = 0xFFFF;
+	}
+    }
+
+    v = t;
+    v.data = sa.take_string();
+    return 0;
+}
+
+/* Measure the cycle counter against the steady clock, or fall back on the
+   clock if there is no cycle counter. */
+void
+TemplateSource::calibrate()
+{
+    click_cycles_t c0 = click_get_cycles();
+    Timestamp t0 = Timestamp::now_steady();
+    usleep(10000);
+    click_cycles_t c1 = click_get_cycles();
+    double secs = (Timestamp::now_steady() - t0).doubleval();
+    if (c1 > c0 && secs > 0) {
+	_use_cycles = true;
+	_ticks_per_sec = (c1 - c0) / secs;
+    } else {
+	_use_cycles = false;
+	_ticks_per_sec = 1e9;
+    }
+}
+
+inline uint64_t
+TemplateSource::ticks() const
+{
+    if (_use_cycles)
+	return click_get_cycles();
+    else
+	return Timestamp::now_steady().nsecval();
+}
+
+void
+TemplateSource::set_rate(uint32_t rate)
+{
+    _rate = rate;
+    _packets_per_tick = rate / (double) _streams.size() / _ticks_per_sec;
+    click_write_fence();
+    // streams restart their pacing when they see a new epoch
+    ++_rate_epoch;
+}
+
+int
+TemplateSource::initialize(ErrorHandler *errh)
+{
+    Vector<Template> templates;
+    if (_filename && read_templates(_filename, templates, errh) < 0)
+	return -1;
+    for (int i = 0; i < _data.size(); ++i) {
+	Template t;
+	t.data = _data[i];
+	analyze(t, _dlt);
+	templates.push_back(t);
+    }
+    if (templates.empty())
+	return errh->error("no templates");
+
+    bool ports = false;
+    for (int i = 0; i < _fields.size(); ++i)
+	if (_fields[i].type == F_SPORT || _fields[i].type == F_DPORT)
+	    ports = true;
+    for (int i = 0; i < templates.size(); ++i)
+	if (_fields.size() && templates[i].ip_off < 0)
+	    return errh->error("template %d is not an IPv4 packet", i);
+	else if (ports && templates[i].l4_off < 0)
+	    return errh->error("template %d is not a TCP or UDP packet", i);
+
+    // one variant per template and length
+    _nlengths = _lengths.size() ? _lengths.size() : 1;
+    for (int i = 0; i < templates.size(); ++i)
+	if (_lengths.empty())
+	    _templates.push_back(templates[i]);
+	else
+	    for (int j = 0; j < _lengths.size(); ++j) {
+		_templates.push_back(Template());
+		if (make_variant(templates[i], _lengths[j], _templates.back(), errh) < 0)
+		    return -1;
+	    }
+
+    calibrate();
+    set_rate(_rate);
+
+    // stream i runs on thread i and starts at position i of the flow cycle
+    int nstreams = _streams.size();
+    _streams_left = nstreams;
+    for (int i = 0; i < nstreams; ++i) {
+	Stream *s = _streams[i];
+	s->rng = ((uint64_t) click_random() << 32) | click_random() | 1;
+	memset(s->odometer, 0, sizeof(s->odometer));
+	uint64_t carry = i;
+	for (int k = 0; carry && k < _seq_fields.size(); ++k) {
+	    uint64_t size = _fields[_seq_fields[k]].size;
+	    s->odometer[k] = carry % size;
+	    carry /= size;
+	}
+	s->template_pos = i % templates.size();
+	if (_limit >= 0) {
+	    s->limit = _limit / nstreams + (i < _limit % nstreams);
+	    if (s->limit == 0)
+		s->done = true, --_streams_left;
+	}
+	s->task.move_thread(i % master()->nthreads());
+	ScheduleInfo::initialize_task(this, &s->task, _active && !s->done, errh);
+	s->task.set_pinned(true);
+	s->timer.initialize(this);
+    }
+    return 0;
+}
+
+void
+TemplateSource::cleanup(CleanupStage)
+{
+    for (int i = 0; i < _streams.size(); ++i)
+	delete _streams[i];
+    _streams.clear();
+}
+
+/* Move 's' to its next flow, STREAMS positions on in the cycle. */
+inline void
+TemplateSource::advance(Stream *s)
+{
+    uint64_t carry = _streams.size();
+    for (int k = 0; carry && k < _seq_fields.size(); ++k) {
+	uint64_t size = _fields[_seq_fields[k]].size;
+	uint64_t x = s->odometer[k] + carry;
+	if (x < size)
+	    s->odometer[k] = x, carry = 0;
+	else
+	    s->odometer[k] = x % size, carry = x / size;
+    }
+}
+
+inline Packet *
+TemplateSource::generate(Stream *s)
+{
+    const Template &t = _templates[s->template_pos * _nlengths + _length_seq[s->length_pos]];
+    // each template in turn, then the next length
+    if (++s->template_pos * _nlengths == (uint32_t) _templates.size()) {
+	s->template_pos = 0;
+	if (++s->length_pos == (uint32_t) _length_seq.size())
+	    s->length_pos = 0;
+    }
+
+    WritablePacket *p = Packet::make(t.headroom, t.data.data(), t.data.length(), 0);
+    if (!p || t.ip_off < 0)
+	return p;
+
+    unsigned char *d = p->data();
+    click_ip *ip = reinterpret_cast<click_ip *>(d + t.ip_off);
+    uint16_t *l4_sum = 0;
+    if (t.l4_cksum_off >= 0)
+	l4_sum = reinterpret_cast<uint16_t *>(d + t.l4_cksum_off);
+
+    int k = 0;
+    for (const Field *f = _fields.begin(); f != _fields.end(); ++f) {
+	uint64_t offset;
+	if (f->random) {
+	    // xorshift64*, scaled to the range without division
+	    uint64_t x = s->rng;
+	    x ^= x >> 12;
+	    x ^= x << 25;
+	    x ^= x >> 27;
+	    s->rng = x;
+	    offset = (((x * 2685821657736338717ULL) >> 32) * f->size) >> 32;
+	} else
+	    offset = s->odometer[k++];
+	uint32_t value = f->base + offset;
+
+	switch (f->type) {
+	case F_SRC:
+	case F_DST: {
+	    struct in_addr *a = (f->type == F_SRC ? &ip->ip_src : &ip->ip_dst);
+	    uint32_t old_w = a->s_addr, new_w = htonl(value);
+	    a->s_addr = new_w;
+	    click_update_in_cksum32(&ip->ip_sum, old_w, new_w);
+	    if (l4_sum)
+		click_update_in_cksum32(l4_sum, old_w, new_w);
+	    break;
+	}
+	case F_SPORT:
+	case F_DPORT: {
+	    uint16_t *port = reinterpret_cast<uint16_t *>(d + t.l4_off) + (f->type == F_DPORT);
+	    uint16_t old_hw = *port, new_hw = htons(value);
+	    *port = new_hw;
+	    if (l4_sum)
+		click_update_in_cksum(l4_sum, old_hw, new_hw);
+	    break;
+	}
+	case F_ID: {
+	    uint16_t old_hw = ip->ip_id, new_hw = htons(value);
+	    ip->ip_id = new_hw;
+	    click_update_in_cksum(&ip->ip_sum, old_hw, new_hw);
+	    break;
+	}
+	}
+    }
+    if (l4_sum && *l4_sum == 0 && ip->ip_p == IP_PROTO_UDP)
+	*l4_sum = 0xFFFF;
+    if (k)
+	advance(s);
+
+    p->set_ip_header(ip, ip->ip_hl << 2);
+    return p;
+}
+
+bool
+TemplateSource::run_task(Task *t)
+{
+    Stream *s = 0;
+    for (int i = 0; !s; ++i)
+	if (&_streams[i]->task == t)
+	    s = _streams[i];
+    if (!_active || s->done)
+	return false;
+
+    uint64_t n = _burst;
+    if (s->limit && s->limit - s->count < n)
+	n = s->limit - s->count;
+
+    if (_rate) {
+	uint64_t now = ticks();
+	if (s->epoch != _rate_epoch) {
+	    s->epoch = _rate_epoch;
+	    s->start = now;
+	    s->paced = 0;
+	}
+	// packets due by now, counting one at the start
+	uint64_t due = (uint64_t) ((now - s->start) * _packets_per_tick) + 1;
+	if (due <= s->paced) {
+	    // sleep on the timer unless the next packet is due soon
+	    double wait = (s->start + s->paced / _packets_per_tick - now) / _ticks_per_sec;
+	    if (wait > 0.0002)
+		s->timer.schedule_after(Timestamp(wait));
+	    else
+		t->fast_reschedule();
+	    return false;
+	}
+	if (due - s->paced < n)
+	    n = due - s->paced;
+    }
+
+    PacketBatch batch;
+    for (uint64_t i = 0; i < n; ++i)
+	if (Packet *p = generate(s))
+	    batch.append(p);
+	else
+	    break;
+    n = batch.count();
+    s->count += n;
+    s->paced += n;
+    if (n)
+	output(s->index % noutputs()).push_batch(batch);
+
+    if (s->limit && s->count >= s->limit) {
+	s->done = true;
+	if (_streams_left.dec_and_test() && _stop)
+	    router()->please_stop_driver();
+	return n > 0;
+    }
+    t->fast_reschedule();
+    return n > 0;
+}
+
+String
+TemplateSource::read_handler(Element *e, void *thunk)
+{
+    TemplateSource *ts = static_cast<TemplateSource *>(e);
+    switch ((uintptr_t) thunk) {
+    case h_count: {
+	uint64_t count = 0;
+	for (int i = 0; i < ts->_streams.size(); ++i)
+	    count += ts->_streams[i]->count;
+	return String(count);
+    }
+    case h_stream_counts: {
+	StringAccum sa;
+	for (int i = 0; i < ts->_streams.size(); ++i)
+	    sa << ts->_streams[i]->count << '\n';
+	return sa.take_string();
+    }
+    case h_flows: {
+	uint64_t flows = 1;
+	for (int k = 0; k < ts->_seq_fields.size(); ++k) {
+	    uint64_t size = ts->_fields[ts->_seq_fields[k]].size;
+	    flows = (flows > ~(uint64_t) 0 / size ? ~(uint64_t) 0 : flows * size);
+	}
+	return String(flows);
+    }
+    case h_rate:
+	return String(ts->_rate);
+    case h_active:
+	return String(ts->_active);
+    default:
+	return String();
+    }
+}
+
+int
+TemplateSource::write_handler(const String &str, Element *e, void *thunk, ErrorHandler *errh)
+{
+    TemplateSource *ts = static_cast<TemplateSource *>(e);
+    switch ((uintptr_t) thunk) {
+    case h_rate: {
+	uint32_t rate;
+	if (!IntArg().parse(str, rate))
+	    return errh->error("syntax error");
+	ts->set_rate(rate);
+	break;
+    }
+    case h_active:
+	if (!BoolArg().parse(str, ts->_active))
+	    return errh->error("syntax error");
+	// don't make up for the time spent inactive
+	if (ts->_active)
+	    ts->set_rate(ts->_rate);
+	break;
+    }
+    if (ts->_active)
+	for (int i = 0; i < ts->_streams.size(); ++i)
+	    if (!ts->_streams[i]->done)
+		ts->_streams[i]->task.reschedule();
+    return 0;
+}
+
+void
+TemplateSource::add_handlers()
+{
+    add_read_handler("count", read_handler, h_count);
+    add_read_handler("stream_counts", read_handler, h_stream_counts);
+    add_read_handler("flows", read_handler, h_flows);
+    add_read_handler("rate", read_handler, h_rate);
+    add_write_handler("rate", write_handler, h_rate);
+    add_read_handler("active", read_handler, h_active, Handler::CHECKBOX);
+    add_write_handler("active", write_handler, h_active);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel FakePcap)
+EXPORT_ELEMENT(TemplateSource)
+ELEMENT_MT_SAFE(TemplateSource)
@@ -0,0 +1,243 @@
+// -*- mode: c++; c-basic-offset: 4 -*-
+#ifndef CLICK_TEMPLATESOURCE_HH
+#define CLICK_TEMPLATESOURCE_HH
+#include <click/element.hh>
+#include <click/task.hh>
+#include <click/timer.hh>
+#include <click/atomic.hh>
+CLICK_DECLS
+
+/*
+=c
+
+TemplateSource([I<keywords> FILENAME, DATA, ENCAP, FIELD, LENGTHS, RATE, LIMIT, STREAMS, BURST, STOP, ACTIVE])
+
+=s basicsources
+
+generates many flows of packets from templates
+
+=d
+
+Generates packets by copying templates and varying their IP addresses, ports,
+IP IDs, and lengths.  The variations are computed as packets are generated,
+so TemplateSource can produce millions of flows without storing them, and
+the IP and transport checksums are updated incrementally rather than
+recomputed.
+
+Packets are generated by STREAMS streams, each on its own task.  Stream I runs
+on thread I modulo the number of threads, and emits its packets on output I
+modulo the number of outputs.
+
+Templates are read from the tcpdump file FILENAME, from the DATA keywords, or
+both.  Each stream uses the templates in turn, moving on to the next packet
+length (see LENGTHS) after each round.  Templates must be IPv4
+packets if they are to be varied, and TCP or UDP packets if their ports are.
+
+Keyword arguments are:
+
+=over 8
+
+=item FILENAME
+
+Filename.  Every packet in this tcpdump file is a template.
+
+=item DATA
+
+String.  A template packet.  May be given more than once.
+
+=item ENCAP
+
+The encapsulation of the DATA templates, such as C<ETHER> or C<IP>.
+Default is C<ETHER>.
+
+=item FIELD
+
+A field variation of the form `I<NAME> I<RANGE> [I<MODE>]'.  May be given
+more than once.  I<NAME> is C<SRC>, C<DST>, C<SPORT>, C<DPORT>, or C<ID>.
+I<RANGE> is an address prefix, such as `10.0.0.0/8', or an inclusive range of
+addresses or integers, such as `10.0.0.1-10.0.0.100' or `1024-65535', or a
+single value.  I<MODE> is C<SEQUENTIAL> or C<RANDOM>; default is
+C<SEQUENTIAL>.  A random field takes a new value from its range in each
+packet.  The sequential fields count through their ranges together like an
+odometer, the first field given moving fastest, so each flow of the cartesian
+product is visited once per cycle.  The streams share this cycle: stream I
+emits the flows at positions I, I+STREAMS, and so on.
+
+=item LENGTHS
+
+Space-separated list of packet lengths, each of the form `I<LENGTH>' or
+`I<LENGTH>*I<WEIGHT>', including any link header.  Templates are padded with
+zeros or truncated to these lengths, and their IP and UDP lengths are set to
+match; each length's share of the packets is proportional to its weight, and
+lengths are interleaved evenly.  C<IMIX> is short for `60*7 590*4 1514*1',
+the simple IMIX of Ethernet frame sizes without checksums.  By default,
+templates keep their lengths.
+
+=item RATE
+
+Integer.  Total packets per second generated by all streams.  Streams pace
+themselves on the CPU's timestamp counter, where available, calibrated at
+initialization.  If zero, streams generate packets as fast as they can.
+Default is 0.
+
+=item LIMIT
+
+Integer.  Total number of packets to generate, split among the streams, or
+-1 for no limit.  Default is -1.
+
+=item STREAMS
+
+Positive integer.  Number of streams.  Default is the number of threads.
+
+=item BURST
+
+Positive integer.  Maximum number of packets a stream emits per task
+invocation, as one batch.  Default is 32.
+
+=item STOP
+
+Boolean.  If true, then TemplateSource will ask the router to stop when every
+stream reaches its LIMIT.  Default is false.
+
+=item ACTIVE
+
+Boolean.  If false, then TemplateSource will not emit packets (until the
+C<active> handler is written).  Default is true.
+
+=back
+
+Only available in user-level processes.
+
+=e
+
+Generate 10 million UDP flows at 10 Mpps on 4 threads:
+
+  TemplateSource(DATA \<00000000000200000000000108004500 001c0000 00004011
+      0000 0a000001 0a000002 04d2 04d2 0008 0000>,
+    FIELD SRC 10.0.0.0/16, FIELD SPORT 1024-1176,
+    FIELD ID 0-65535 RANDOM, LENGTHS IMIX, RATE 10000000, STREAMS 4)
+  -> ToDPDKDevice(0);
+
+=h count read-only
+
+Returns the number of packets generated so far, by all streams.
+
+=h stream_counts read-only
+
+Returns the number of packets generated by each stream, one per line.
+
+=h flows read-only
+
+Returns the number of flows in a cycle of the sequential fields.
+
+=h rate read/write
+
+Returns or sets the RATE parameter.
+
+=h active read/write
+
+Returns or sets the ACTIVE parameter.
+
+=a
+
+InfiniteSource, RatedSource, FastUDPFlows, ParallelFromDump */
+
+class TemplateSource : public Element { public:
+
+    TemplateSource() CLICK_COLD;
+    ~TemplateSource() CLICK_COLD;
+
+    const char *class_name() const		{ return "TemplateSource"; }
+    const char *port_count() const		{ return "0/1-"; }
+    const char *processing() const		{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    bool run_task(Task *);
+
+  private:
+
+    enum { F_SRC, F_DST, F_SPORT, F_DPORT, F_ID };
+    enum { MAX_FIELDS = 16 };
+
+    struct Field {
+	int type;
+	bool random;
+	uint32_t base;
+	uint64_t size;
+    };
+
+    struct Template {
+	String data;
+	int ip_off;		// -1 if not IPv4
+	int l4_off;		// -1 unless TCP or UDP
+	int l4_cksum_off;	// -1 if no transport checksum
+	uint32_t headroom;
+    };
+
+    struct Stream {
+	Stream(TemplateSource *e, int i)
+	    : task(e), timer(&task), index(i), count(0), limit(0), done(false),
+	      template_pos(0), length_pos(0), epoch(0), paced(0), start(0) {
+	}
+	Task task;
+	Timer timer;
+	int index;
+	uint64_t count;
+	uint64_t limit;		// 0 means unlimited
+	bool done;
+	uint64_t rng;
+	uint64_t odometer[MAX_FIELDS];
+	uint32_t template_pos;
+	uint32_t length_pos;
+	uint32_t epoch;
+	uint64_t paced;		// packets since start under the current rate
+	uint64_t start;
+    } CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+
+    String _filename;
+    Vector<String> _data;
+    int _dlt;
+    Vector<uint32_t> _lengths;
+
+    Vector<Template> _templates;	// one per template and length
+    Vector<Field> _fields;
+    Vector<int> _seq_fields;
+    int _nlengths;
+    Vector<uint32_t> _length_seq;
+
+    Vector<Stream *> _streams;
+    atomic_uint32_t _streams_left;
+    unsigned _burst;
+    int64_t _limit;
+    uint32_t _rate;
+    uint32_t _rate_epoch;
+    bool _stop;
+    bool _active;
+
+    bool _use_cycles;
+    double _ticks_per_sec;
+    double _packets_per_tick;
+
+    static int parse_field(const String &, Field &, ErrorHandler *);
+    static int parse_lengths(const String &, Vector<uint32_t> &, Vector<uint32_t> &, ErrorHandler *);
+    int read_templates(const String &, Vector<Template> &, ErrorHandler *);
+    static void analyze(Template &, int dlt);
+    int make_variant(const Template &, uint32_t length, Template &, ErrorHandler *);
+    void calibrate();
+    void set_rate(uint32_t);
+    inline uint64_t ticks() const;
+    inline void advance(Stream *);
+    inline Packet *generate(Stream *);
+
+    enum { h_count, h_stream_counts, h_flows, h_rate, h_active };
+    static String read_handler(Element *, void *) CLICK_COLD;
+    static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -46,12 +46,14 @@
 # include <sys/socket.h>
 # include <sys/ioctl.h>
 # include <net/if.h>
-# include <net/if_packet.h>
 # include <features.h>
-# if __GLIBC__ >= 2 && __GLIBC_MINOR__ >= 1
-#  include <netpacket/packet.h>
-# else
-#  include <linux/if_packet.h>
+# include <linux/if_packet.h>
+# if defined(TPACKET2_HDRLEN) && defined(PACKET_TX_RING)
+#  define TODEVICE_ALLOW_MMAP 1
+#  include <sys/mman.h>
+# endif
+# if __GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 14)
+#  define TODEVICE_ALLOW_SENDMMSG 1
 # endif
 #endif
 #if TODEVICE_ALLOW_NETMAP
@@ -61,7 +63,7 @@
 CLICK_DECLS
 
 ToDevice::ToDevice()
-    : _task(this), _timer(&_task), _q(0), _pulls(0)
+    : _task(this), _timer(&_task), _pulls(0)
 {
 #if TODEVICE_ALLOW_PCAP
     _pcap = 0;
@@ -71,6 +73,11 @@ ToDevice::ToDevice()
     _fd = -1;
     _my_fd = false;
 #endif
+#if TODEVICE_ALLOW_LINUX
+    _ring = 0;
+    _ring_size = 0;
+    _ring_pos = _ring_full = 0;
+#endif
 }
 
 ToDevice::~ToDevice()
@@ -82,11 +89,21 @@ ToDevice::configure(Vector<String> &conf, ErrorHandler *errh)
 {
     String method;
     _burst = 1;
+#if TODEVICE_ALLOW_LINUX
+    _qdisc_bypass = false;
+    _ring_frames = 512;
+    _ring_frame_size = 2048;
+#endif
     if (Args(conf, this, errh)
 	.read_mp("DEVNAME", _ifname)
 	.read("DEBUG", _debug)
 	.read("METHOD", WordArg(), method)
 	.read("BURST", _burst)
+#if TODEVICE_ALLOW_LINUX
+	.read("QDISC_BYPASS", _qdisc_bypass)
+	.read("RING_FRAMES", _ring_frames)
+	.read("RING_FRAME_SIZE", _ring_frame_size)
+#endif
 	.complete() < 0)
 	return -1;
     if (!_ifname)
@@ -108,6 +125,18 @@ ToDevice::configure(Vector<String> &conf, ErrorHandler *errh)
 #if TODEVICE_ALLOW_LINUX
     else if (method == "LINUX")
 	_method = method_linux;
+    else if (method == "MMAP") {
+# if TODEVICE_ALLOW_MMAP
+	_method = method_mmap;
+	if (_ring_frames == 0)
+	    return errh->error("RING_FRAMES out of range");
+	if (_ring_frame_size < TPACKET2_HDRLEN + 64
+	    || _ring_frame_size % TPACKET_ALIGNMENT != 0)
+	    return errh->error("RING_FRAME_SIZE must be a multiple of %d and at least %d", TPACKET_ALIGNMENT, (int) (TPACKET2_HDRLEN + 64));
+# else
+	return errh->error("METHOD MMAP not supported on this platform");
+# endif
+    }
 #endif
 #if TODEVICE_ALLOW_DEVBPF
     else if (method == "DEVBPF")
@@ -234,6 +263,27 @@ ToDevice::initialize(ErrorHandler *errh)
 	}
 	_method = method_linux;
     }
+# if TODEVICE_ALLOW_MMAP
+    if (_method == method_mmap) {
+	// The ring needs a socket of its own: a socket has one TPACKET
+	// version, and FromDevice may use another for its receive ring.
+	_fd = FromDevice::open_packet_socket(_ifname, errh, false);
+	if (_fd < 0)
+	    return -1;
+	_my_fd = true;
+	if (open_ring(errh) < 0)
+	    return -1;
+    }
+# endif
+    if (_qdisc_bypass && (_method == method_linux || _method == method_mmap)) {
+# ifdef PACKET_QDISC_BYPASS
+	int one = 1;
+	if (setsockopt(_fd, SOL_PACKET, PACKET_QDISC_BYPASS, &one, sizeof(one)) < 0)
+	    errh->warning("%s: PACKET_QDISC_BYPASS: %s", _ifname.c_str(), strerror(errno));
+# else
+	errh->warning("QDISC_BYPASS not supported on this platform");
+# endif
+    }
 #endif
 
 #if TODEVICE_ALLOW_PCAPFD
@@ -261,6 +311,7 @@ ToDevice::initialize(ErrorHandler *errh)
 void
 ToDevice::cleanup(CleanupStage)
 {
+    _q.kill();
 #if TODEVICE_ALLOW_PCAP
     if (_pcap && _my_pcap)
 	pcap_close(_pcap);
@@ -272,6 +323,11 @@ ToDevice::cleanup(CleanupStage)
 	_fd = -1;
     }
 #endif
+#if TODEVICE_ALLOW_MMAP
+    if (_ring)
+	munmap(_ring, _ring_size);
+    _ring = 0;
+#endif
 #if TODEVICE_ALLOW_LINUX || TODEVICE_ALLOW_DEVBPF || TODEVICE_ALLOW_PCAPFD || TODEVICE_ALLOW_NETMAP
     if (_fd >= 0 && _my_fd)
 	close(_fd);
@@ -279,6 +335,125 @@ ToDevice::cleanup(CleanupStage)
 #endif
 }
 
+#if TODEVICE_ALLOW_MMAP
+int
+ToDevice::open_ring(ErrorHandler *errh)
+{
+    int version = TPACKET_V2;
+    if (setsockopt(_fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0)
+	return errh->error("%s: PACKET_VERSION: %s", _ifname.c_str(), strerror(errno));
+
+    // Blocks are the smallest page multiple holding one frame; frames never
+    // straddle blocks.
+    long page_size = sysconf(_SC_PAGESIZE);
+    tpacket_req req;
+    memset(&req, 0, sizeof(req));
+    req.tp_frame_size = _ring_frame_size;
+    req.tp_block_size = (_ring_frame_size + page_size - 1) & ~(page_size - 1);
+    unsigned frames_per_block = req.tp_block_size / req.tp_frame_size;
+    req.tp_block_nr = (_ring_frames + frames_per_block - 1) / frames_per_block;
+    req.tp_frame_nr = req.tp_block_nr * frames_per_block;
+    if (setsockopt(_fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req)) < 0)
+	return errh->error("%s: PACKET_TX_RING: %s", _ifname.c_str(), strerror(errno));
+
+    size_t map_size = (size_t) req.tp_block_size * req.tp_block_nr;
+    void *map = mmap(0, map_size, PROT_READ | PROT_WRITE,
+		     MAP_SHARED | MAP_LOCKED, _fd, 0);
+    if (map == MAP_FAILED)	// MAP_LOCKED may exceed RLIMIT_MEMLOCK
+	map = mmap(0, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    if (map == MAP_FAILED)
+	return errh->error("%s: mmap: %s", _ifname.c_str(), strerror(errno));
+
+    _ring = reinterpret_cast<unsigned char *>(map);
+    _ring_size = map_size;
+    _ring_frames = req.tp_frame_nr;
+    _ring_block_size = req.tp_block_size;
+    _ring_pos = 0;
+    return 0;
+}
+
+inline unsigned char *
+ToDevice::ring_frame(unsigned i) const
+{
+    unsigned frames_per_block = _ring_block_size / _ring_frame_size;
+    return _ring + (i / frames_per_block) * _ring_block_size
+	+ (i % frames_per_block) * _ring_frame_size;
+}
+
+int
+ToDevice::send_ring(PacketBatch &batch, PacketBatch &sent)
+{
+    // Without PACKET_TX_HAS_OFF, transmit data starts where the
+    // sockaddr_ll would sit in a receive frame.
+    const unsigned data_offset = TPACKET2_HDRLEN - sizeof(struct sockaddr_ll);
+    int r = 0;
+    bool queued = false;
+    while (Packet *p = batch.first()) {
+	unsigned char *frame = ring_frame(_ring_pos);
+	tpacket2_hdr *h = reinterpret_cast<tpacket2_hdr *>(frame);
+	volatile uint32_t *status = &h->tp_status;
+	if (*status != TP_STATUS_AVAILABLE && *status != TP_STATUS_WRONG_FORMAT) {
+	    ++_ring_full;
+	    r = -ENOBUFS;
+	    break;
+	}
+	if (p->length() > _ring_frame_size - data_offset) {
+	    r = -EMSGSIZE;
+	    break;
+	}
+	memcpy(frame + data_offset, p->data(), p->length());
+	h->tp_len = p->length();
+	__sync_synchronize();	// frame contents before status
+	*status = TP_STATUS_SEND_REQUEST;
+	if (++_ring_pos == _ring_frames)
+	    _ring_pos = 0;
+	sent.append(batch.pop_front());
+	queued = true;
+    }
+
+    // One system call sends every frame marked so far, including any left
+    // by an earlier kick that failed.
+    if (queued || r == -ENOBUFS) {
+	if (send(_fd, 0, 0, MSG_DONTWAIT) < 0 && r == 0
+	    && errno != EAGAIN && errno != ENOBUFS && errno != EINTR)
+	    click_chatter("%p{element}: %s", this, strerror(errno));
+    }
+    if (queued)
+	_backoff = 0;
+    return r;
+}
+#endif
+
+#if TODEVICE_ALLOW_SENDMMSG
+int
+ToDevice::send_mmsg(PacketBatch &batch, PacketBatch &sent)
+{
+    enum { max_mmsg = 64 };
+    struct mmsghdr msgs[max_mmsg];
+    struct iovec iov[max_mmsg];
+    while (!batch.empty()) {
+	int n = 0;
+	for (Packet *p = batch.first(); p && n < max_mmsg; p = p->next(), ++n) {
+	    iov[n].iov_base = const_cast<unsigned char *>(p->data());
+	    iov[n].iov_len = p->length();
+	    memset(&msgs[n].msg_hdr, 0, sizeof(msgs[n].msg_hdr));
+	    msgs[n].msg_hdr.msg_iov = &iov[n];
+	    msgs[n].msg_hdr.msg_iovlen = 1;
+	}
+	int r = sendmmsg(_fd, msgs, n, 0);
+	if (r < 0)
+	    return errno ? -errno : -EINVAL;
+	// A short count means the next packet hit an error; the next call
+	// reports it.
+	for (int i = 0; i < r; ++i)
+	    sent.append(batch.pop_front());
+	if (r > 0)
+	    _backoff = 0;
+    }
+    return 0;
+}
+#endif
+
 
 /*
  * Linux select marks datagram fd's as writeable when the socket
@@ -339,32 +514,49 @@ ToDevice::send_packet(Packet *p)
 	return errno ? -errno : -EINVAL;
 }
 
-bool
-ToDevice::run_task(Task *)
+int
+ToDevice::send_batch(PacketBatch &batch, PacketBatch &sent)
 {
-    Packet *p = _q;
-    _q = 0;
-    int count = 0, r = 0;
-
-    do {
-	if (!p) {
-	    ++_pulls;
-	    if (!(p = input(0).pull()))
-		break;
-	}
+#if TODEVICE_ALLOW_MMAP
+    if (_method == method_mmap)
+	return send_ring(batch, sent);
+#endif
+#if TODEVICE_ALLOW_SENDMMSG
+    if (_method == method_linux && _burst > 1)
+	return send_mmsg(batch, sent);
+#endif
+    int r = 0;
+    while (Packet *p = batch.pop_front()) {
 	if ((r = send_packet(p)) >= 0) {
 	    _backoff = 0;
-	    checked_output_push(0, p);
-	    ++count;
-	    p = 0;
-	} else
+	    sent.append(p);
+	} else {
+	    batch.prepend(p);
 	    break;
-    } while (count < _burst);
+	}
+    }
+    return r;
+}
 
-    if (r == -ENOBUFS || r == -EAGAIN) {
-	assert(!_q);
-	_q = p;
+bool
+ToDevice::run_task(Task *)
+{
+    // Pull a whole burst at once; packets left over from a previous attempt
+    // go first.
+    PacketBatch batch, sent;
+    batch.swap(_q);
+    if (batch.count() < _burst) {
+	++_pulls;
+	input(0).pull_batch(batch, _burst - batch.count());
+    }
+
+    int r = send_batch(batch, sent);
+    int count = sent.count();
+    checked_output_push_batch(0, sent);
 
+    if (r == -ENOBUFS || r == -EAGAIN) {
+	assert(_q.empty());
+	_q.swap(batch);
 	if (!_backoff) {
 	    _backoff = 1;
 	    add_select(_fd, SELECT_WRITE);
@@ -380,10 +572,10 @@ ToDevice::run_task(Task *)
 	return count > 0;
     } else if (r < 0) {
 	click_chatter("ToDevice(%s): %s", _ifname.c_str(), strerror(-r));
-	checked_output_push(1, p);
+	checked_output_push(1, batch.pop_front());
+	_q.swap(batch);
     }
-
-    if (p || _signal)
+    if (!_q.empty() || r < 0 || _signal)
 	_task.fast_reschedule();
     return count > 0;
 }
@@ -408,7 +600,11 @@ ToDevice::read_param(Element *e, void *thunk)
     case h_pulls:
 	return String(td->_pulls);
     case h_q:
-	return String((bool) td->_q);
+	return String(!td->_q.empty());
+#if TODEVICE_ALLOW_LINUX
+    case h_ring_full:
+	return String(td->_ring_full);
+#endif
     default:
 	return String();
     }
@@ -440,6 +636,9 @@ ToDevice::add_handlers()
     add_read_handler("pulls", read_param, h_pulls);
     add_read_handler("signal", read_param, h_signal);
     add_read_handler("q", read_param, h_q);
+#if TODEVICE_ALLOW_LINUX
+    add_read_handler("ring_full", read_param, h_ring_full);
+#endif
     add_write_handler("debug", write_param, h_debug);
 }
 
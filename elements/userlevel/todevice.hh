@@ -29,15 +29,40 @@ CLICK_DECLS
  * =item BURST
  *
  * Integer. Maximum number of packets to pull per scheduling. Defaults to 1.
+ * The packets are pulled as a single batch.  With METHOD LINUX and a BURST
+ * greater than 1, the batch is handed to the kernel with one sendmmsg(2)
+ * call where the C library provides it.
  *
  * =item METHOD
  *
  * Word. Defines the method ToDevice will use to write packets to the
- * device. Linux targets generally support PCAP and LINUX; other targets
- * support PCAP or, occasionally, other methods. Defaults to the method
+ * device. Linux targets generally support PCAP, LINUX, and MMAP; other
+ * targets support PCAP or, occasionally, other methods. Defaults to the method
  * specified for a matching L<FromDevice(n)>, or the first supported
  * method among NETMAP, PCAP, DEVBPF, LINUX and PCAPFD otherwise.
  *
+ * METHOD MMAP writes packets into a memory-mapped TPACKET_V2 transmit ring on
+ * a packet socket of its own, then asks the kernel to send the whole burst
+ * with a single system call.  Packets are copied into the ring; a packet
+ * longer than a ring frame fails and is emitted on output 1.
+ *
+ * =item RING_FRAMES
+ *
+ * Integer.  Minimum number of frames in the METHOD MMAP ring.  Defaults to
+ * 512.
+ *
+ * =item RING_FRAME_SIZE
+ *
+ * Integer.  Size of each METHOD MMAP ring frame in bytes, including a
+ * 32-byte frame header.  Defaults to 2048.
+ *
+ * =item QDISC_BYPASS
+ *
+ * Boolean.  If true, packets sent with METHOD LINUX or MMAP skip the
+ * device's queueing discipline (PACKET_QDISC_BYPASS) and go straight to the
+ * driver.  Traffic control settings on the device then no longer apply.
+ * Defaults to false.
+ *
  * =item DEBUG
  *
  * Boolean.  If true, print out debug messages.
@@ -46,6 +71,10 @@ CLICK_DECLS
  *
  * This element is only available at user level.
  *
+ * =h ring_full read-only
+ *
+ * Returns the number of times ToDevice found the METHOD MMAP ring full.
+ *
  * =n
  *
  * Packets sent via ToDevice should already have a link-level
@@ -120,11 +149,12 @@ class ToDevice : public Element { public:
 #if TODEVICE_ALLOW_NETMAP
     NetmapInfo _netmap;
 #endif
-    enum { method_default, method_netmap, method_linux, method_pcap, method_devbpf, method_pcapfd };
+    enum { method_default, method_netmap, method_linux, method_pcap, method_devbpf, method_pcapfd,
+	   method_mmap };
     int _method;
     NotifierSignal _signal;
 
-    Packet *_q;
+    PacketBatch _q;
     int _burst;
 
     bool _debug;
@@ -137,9 +167,27 @@ class ToDevice : public Element { public:
     int _backoff;
     int _pulls;
 
-    enum { h_debug, h_signal, h_pulls, h_q };
+#if TODEVICE_ALLOW_LINUX
+    bool _qdisc_bypass;
+    unsigned char *_ring;
+    size_t _ring_size;
+    unsigned _ring_frames;
+    unsigned _ring_frame_size;
+    unsigned _ring_block_size;
+    unsigned _ring_pos;
+    unsigned _ring_full;
+#endif
+
+    enum { h_debug, h_signal, h_pulls, h_q, h_ring_full };
     FromDevice *find_fromdevice() const;
     int send_packet(Packet *p);
+    int send_batch(PacketBatch &batch, PacketBatch &sent);
+#if TODEVICE_ALLOW_LINUX
+    int open_ring(ErrorHandler *errh) CLICK_COLD;
+    inline unsigned char *ring_frame(unsigned i) const;
+    int send_ring(PacketBatch &batch, PacketBatch &sent);
+    int send_mmsg(PacketBatch &batch, PacketBatch &sent);
+#endif
     static int write_param(const String &in_s, Element *e, void *vparam, ErrorHandler *errh) CLICK_COLD;
     static String read_param(Element *e, void *thunk) CLICK_COLD;
 
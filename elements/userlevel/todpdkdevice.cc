@@ -20,32 +20,41 @@
 #include <click/args.hh>
 #include <click/error.hh>
 #include <click/algorithm.hh>
+#include <click/straccum.hh>
+#include <click/master.hh>
+#include <click/standard/scheduleinfo.hh>
 
 #include "todpdkdevice.hh"
 
 CLICK_DECLS
 
 ToDPDKDevice::ToDPDKDevice() :
-    _iqueues(), _dev(0), _queue_id(0), _blocking(false),
-    _iqueue_size(1024), _timeout(0), _count(0),
-    _dropped(0), _congestion_warning_printed(false)
+    _iqueues(), _locks(0), _dev(0), _queue_id(0), _blocking(false),
+    _iqueue_size(1024), _timeout(0), _congestion_warning_printed(false)
 {
     _burst_size = DPDKDevice::DEF_BURST_SIZE;
 }
 
 ToDPDKDevice::~ToDPDKDevice()
 {
+    for (int i = 0; i < _iqueues.size(); i++)
+        delete _iqueues[i];
+    delete[] _locks;
 }
 
 int ToDPDKDevice::configure(Vector<String> &conf, ErrorHandler *errh)
 {
     int n_desc = -1;
+    int n_queues = -1;
+    int max_queues = 128;
     String dev;
     bool allow_nonexistent = false;
 
     if (Args(conf, this, errh)
         .read_mp("PORT", dev)
         .read_p("QUEUE", _queue_id)
+        .read("N_QUEUES", n_queues)
+        .read("MAXQUEUES", max_queues)
         .read("IQUEUE", _iqueue_size)
         .read("BLOCKING", _blocking)
         .read("BURST", _burst_size)
@@ -69,7 +78,21 @@ int ToDPDKDevice::configure(Vector<String> &conf, ErrorHandler *errh)
             return errh->error("%s : Unknown or invalid PORT", dev.c_str());
     }
 
-    return _dev->add_tx_queue(_queue_id, (n_desc > 0) ? n_desc : DPDKDevice::DEF_DEV_TXDESC, errh);
+    // One TX queue per thread, so that threads need not share them
+    if (n_queues <= 0) {
+        n_queues = master()->nthreads();
+        if (max_queues > 0 && n_queues > max_queues)
+            n_queues = max_queues;
+    }
+
+    for (int i = 0; i < n_queues; i++) {
+        unsigned queue_id = _queue_id ? _queue_id + i : 0;
+        if (_dev->add_tx_queue(queue_id, (n_desc > 0) ? n_desc : DPDKDevice::DEF_DEV_TXDESC, errh) < 0)
+            return -1;
+        _queue_ids.push_back(queue_id);
+    }
+
+    return 0;
 }
 
 int ToDPDKDevice::initialize(ErrorHandler *errh)
@@ -77,13 +100,27 @@ int ToDPDKDevice::initialize(ErrorHandler *errh)
     if (!_dev)
         return 0;
 
-    _iqueues.resize(click_max_cpu_ids());
-
-    for (int i = 0; i < _iqueues.size(); i++) {
-        _iqueues[i].pkts = new struct rte_mbuf *[_iqueue_size];
+    /* Thread i sends on queue i modulo the number of queues. Only threads
+     * that share their queue with another thread need a lock. */
+    int n_threads = click_max_cpu_ids();
+    int n_queues = _queue_ids.size();
+    if (n_threads > n_queues)
+        _locks = new Spinlock[n_queues];
+
+    for (int i = 0; i < n_threads; i++) {
+        InternalQueue *iqueue = new InternalQueue(this);
+        _iqueues.push_back(iqueue);
+        iqueue->pkts = new struct rte_mbuf *[_iqueue_size];
+        iqueue->queue_id = _queue_ids[i % n_queues];
+        if (_locks)
+            iqueue->lock = &_locks[i % n_queues];
         if (_timeout >= 0) {
-            _iqueues[i].timeout.assign(this);
-            _iqueues[i].timeout.initialize(this);
+            // the flush task runs on the thread owning the internal queue
+            if (i < master()->nthreads())
+                iqueue->task.move_thread(i);
+            ScheduleInfo::initialize_task(this, &iqueue->task, false, errh);
+            iqueue->task.set_pinned(true);
+            iqueue->timeout.initialize(this);
         }
     }
 
@@ -92,16 +129,20 @@ int ToDPDKDevice::initialize(ErrorHandler *errh)
 
 void ToDPDKDevice::cleanup(CleanupStage)
 {
-    for (int i = 0; i < _iqueues.size(); i++)
-        delete[] _iqueues[i].pkts;
+    for (int i = 0; i < _iqueues.size(); i++) {
+        delete[] _iqueues[i]->pkts;
+        _iqueues[i]->pkts = 0;
+    }
 }
 
 int ToDPDKDevice::reset_counts_handler(const String &, Element *e, void *,
                                        ErrorHandler *)
 {
     ToDPDKDevice *tdd = static_cast<ToDPDKDevice *>(e);
-    tdd->_count = 0;
-    tdd->_dropped = 0;
+    for (int i = 0; i < tdd->_iqueues.size(); i++) {
+        tdd->_iqueues[i]->count = 0;
+        tdd->_iqueues[i]->dropped = 0;
+    }
     return 0;
 }
 
@@ -112,6 +153,28 @@ String ToDPDKDevice::statistics_handler(Element *e, void * thunk)
     if (!td->_dev)
         return "0";
 
+    unsigned long count = 0, dropped = 0;
+    switch((uintptr_t) thunk) {
+        case h_count:
+        case h_dropped:
+            for (int i = 0; i < td->_iqueues.size(); i++) {
+                count += td->_iqueues[i]->count;
+                dropped += td->_iqueues[i]->dropped;
+            }
+            return String((uintptr_t) thunk == h_count ? count : dropped);
+        case h_queue_counts: {
+            StringAccum sa;
+            for (int i = 0; i < td->_iqueues.size(); i++) {
+                InternalQueue *iqueue = td->_iqueues[i];
+                sa << i << ' ' << iqueue->queue_id << ' ' << iqueue->count
+                   << ' ' << iqueue->dropped << '\n';
+            }
+            return sa.take_string();
+        }
+        case h_n_queues:
+            return String(td->_queue_ids.size());
+    }
+
     if (rte_eth_stats_get(td->_dev->port_id, &stats))
         return String::make_empty();
 
@@ -122,10 +185,6 @@ String ToDPDKDevice::statistics_handler(Element *e, void * thunk)
             return String(stats.obytes);
         case h_oerrors:
             return String(stats.oerrors);
-        case h_count:
-             return String(td->_count);
-        case h_dropped:
-            return String(td->_dropped);
     }
 
     return 0;
@@ -135,6 +194,8 @@ void ToDPDKDevice::add_handlers()
 {
     add_read_handler("count", statistics_handler, h_count);
     add_read_handler("dropped", statistics_handler, h_dropped);
+    add_read_handler("queue_counts", statistics_handler, h_queue_counts);
+    add_read_handler("n_queues", statistics_handler, h_n_queues);
     add_write_handler("reset_counts", reset_counts_handler, 0, Handler::BUTTON);
 
     add_read_handler("hw_count",statistics_handler, h_opackets);
@@ -173,13 +234,19 @@ inline struct rte_mbuf* get_mbuf(Packet* p, bool create=true) {
     return mbuf;
 }
 
-void ToDPDKDevice::run_timer(Timer *t)
+/* The timeout fires on the element's home thread and reschedules the flush
+ * task of the internal queue, which runs on the thread owning it. */
+bool ToDPDKDevice::run_task(Task *t)
 {
-    for(int i = 0; i < _iqueues.size(); i++) {
-        if (&_iqueues[i].timeout == t) {
-            flush_internal_queue(_iqueues[i]);
+    for (int i = 0; i < _iqueues.size(); i++) {
+        InternalQueue &iqueue = *_iqueues[i];
+        if (&iqueue.task == t) {
+            if (iqueue.nr_pending)
+                flush_internal_queue(iqueue);
+            return true;
         }
     }
+    return false;
 }
 
 /* Flush as much as possible packets from a given internal queue to the DPDK
@@ -196,14 +263,15 @@ void ToDPDKDevice::flush_internal_queue(InternalQueue &iqueue) {
      */
     unsigned sub_burst;
 
-    _lock.acquire();
+    if (iqueue.lock)
+        iqueue.lock->acquire();
 
     do {
         sub_burst = iqueue.nr_pending > 32 ? 32 : iqueue.nr_pending;
         if (iqueue.index + sub_burst >= _iqueue_size)
             // The sub_burst wraps around the ring
             sub_burst = _iqueue_size - iqueue.index;
-        r = rte_eth_tx_burst(_dev->port_id, _queue_id, &iqueue.pkts[iqueue.index],
+        r = rte_eth_tx_burst(_dev->port_id, iqueue.queue_id, &iqueue.pkts[iqueue.index],
                              sub_burst);
 
         iqueue.nr_pending -= r;
@@ -215,9 +283,10 @@ void ToDPDKDevice::flush_internal_queue(InternalQueue &iqueue) {
         sent += r;
     } while (r == sub_burst && iqueue.nr_pending > 0);
 
-    _count += sent;
+    if (iqueue.lock)
+        iqueue.lock->release();
 
-    _lock.release();
+    iqueue.count += sent;
 
     // If ring is empty, reset the index to avoid wrap ups
     if (iqueue.nr_pending == 0)
@@ -230,7 +299,7 @@ void ToDPDKDevice::push(int, Packet *p)
         return;
 
     // Get the thread-local internal queue
-    InternalQueue &iqueue = _iqueues[click_current_cpu_id()];
+    InternalQueue &iqueue = *_iqueues[click_current_cpu_id()];
 
     bool congestioned;
     do {
@@ -241,9 +310,9 @@ void ToDPDKDevice::push(int, Packet *p)
              * we'll loop, else we'll drop this packet.*/
             congestioned = true;
             if (!_blocking) {
-                if (_dropped < 5)
+                if (iqueue.dropped < 5)
                     click_chatter("%s: packet dropped", name().c_str());
-                _dropped++;
+                iqueue.dropped++;
             } else {
                 if (!_congestion_warning_printed)
                     click_chatter("%s: congestion warning", name().c_str());
@@ -3,6 +3,7 @@
 
 #include <click/element.hh>
 #include <click/sync.hh>
+#include <click/task.hh>
 #include <click/timer.hh>
 #include <click/dpdkdevice.hh>
 
@@ -13,7 +14,7 @@ CLICK_DECLS
 
 =c
 
-ToDPDKDevice(PORT [, QUEUE [, I<keywords> IQUEUE, BLOCKING, etc.]])
+ToDPDKDevice(PORT [, QUEUE [, I<keywords> N_QUEUES, IQUEUE, BLOCKING, etc.]])
 
 =s netdevices
 
@@ -28,6 +29,12 @@ BURST packets, and then send the batch to DPDK. If the batch is not ready after
 TIMEOUT ms, it will flush the batch of packets even if it doesn't cointain
 BURST packets.
 
+ToDPDKDevice sets up one hardware TX queue per Click thread, and each thread
+that pushes packets keeps its own internal queue and sends them on its own TX
+queue, so threads never wait for each other.  If there are fewer TX queues
+than threads (see N_QUEUES and MAXQUEUES), threads share the queues as evenly
+as possible, and a thread takes a lock to send its batch on a shared queue.
+
 Arguments:
 
 =over 8
@@ -39,12 +46,22 @@ format fffff:ff:ff.f
 
 =item QUEUE
 
-Integer.  Index of the queue to use. If omitted or negative, auto-increment
+Integer.  Index of the first queue to use. If omitted or negative, auto-increment
 between ToDPDKDevice attached to the same port will be used.
 
+=item N_QUEUES
+
+Integer.  Number of TX queues to use.  If omitted or negative, one queue per
+Click thread is used, up to MAXQUEUES.
+
+=item MAXQUEUES
+
+Integer.  Maximum number of TX queues to use when N_QUEUES is omitted.
+Defaults to 128.
+
 =item IQUEUE
 
-Integer.  Size of the internal queue, i.e. number of packets that we can buffer
+Integer.  Size of each internal queue, i.e. number of packets that we can buffer
 before pushing them to the DPDK framework. If IQUEUE is bigger than BURST,
 some packets could be buffered in the internal queue when the output ring is
 full. Defaults to 1024.
@@ -65,7 +82,7 @@ performance.
 
 =item TIMEOUT
 
-Integer.  Set a timeout to flush the internal queue. It is useful under low
+Integer.  Set a timeout to flush the internal queues. It is useful under low
 throughput as it could take a long time before reaching BURST packet in the
 internal queue. The timeout is expressed in milliseconds. Setting the timer to
 0 is not a bad idea as it will schedule after the source element (such as a
@@ -96,11 +113,20 @@ This element is only available at user level, when compiled with DPDK support.
 
 =h count read-only
 
-Returns the number of packets sent by the device.
+Returns the number of packets sent by the device, summed over all queues.
 
 =h dropped read-only
 
-Returns the number of packets dropped by the device.
+Returns the number of packets dropped by the device, summed over all queues.
+
+=h queue_counts read-only
+
+Returns the number of packets sent and dropped by each Click thread, one
+thread per line, as "THREAD QUEUE COUNT DROPPED".
+
+=h n_queues read-only
+
+Returns the number of TX queues used by this element.
 
 =h reset_counts write-only
 
@@ -142,29 +168,39 @@ public:
     static String statistics_handler(Element *e, void * thunk) CLICK_COLD;
     void add_handlers() override CLICK_COLD;
 
-    void run_timer(Timer *) override;
+    bool run_task(Task *) override;
     void push(int port, Packet *p) override;
 
 private:
 
-    /* InternalQueue is a ring of DPDK buffers pointers (rte_mbuf *) awaiting
-     * to be sent.
+    /* InternalQueue is a thread's ring of DPDK buffers pointers (rte_mbuf *)
+     * awaiting to be sent on its TX queue.
      * index is the index of the first valid packets awaiting to be sent, while
      * nr_pending is the number of packets. index + nr_pending may be greater
-     * than _iqueue_size but index should be wrapped-around. */
+     * than _iqueue_size but index should be wrapped-around.
+     * Only the owning thread touches an InternalQueue, except for the
+     * counters, which handlers read and reset. */
     class InternalQueue {
     public:
-        InternalQueue() : pkts(0), index(0), nr_pending(0) { }
+        InternalQueue(ToDPDKDevice *e)
+            : task(e), timeout(&task), pkts(0), index(0), nr_pending(0),
+              queue_id(0), lock(0), count(0), dropped(0) { }
 
+        // Task flushing the queue on its thread, and timer scheduling it
+        // to limit time a batch will take to be completed
+        Task task;
+        Timer timeout;
         // Array of DPDK Buffers
         struct rte_mbuf ** pkts;
         // Index of the first valid packet in the pkts array
         unsigned int index;
         // Number of valid packets awaiting to be sent after index
         unsigned int nr_pending;
-
-        // Timer to limit time a batch will take to be completed
-        Timer timeout;
+        // Hardware TX queue, and its lock if other threads share it
+        unsigned queue_id;
+        Spinlock *lock;
+        unsigned long count;
+        unsigned long dropped;
     } __attribute__((aligned(64)));
 
     static int reset_counts_handler(const String &, Element *, void *,
@@ -173,20 +209,20 @@ private:
     void flush_internal_queue(InternalQueue &);
 
     enum {
-        h_count, h_dropped, h_opackets, h_obytes, h_oerrors
+        h_count, h_dropped, h_opackets, h_obytes, h_oerrors, h_queue_counts,
+        h_n_queues
     };
 
-    Vector<InternalQueue> _iqueues;
+    Vector<InternalQueue *> _iqueues;
+    Vector<unsigned> _queue_ids;
+    Spinlock *_locks;
 
     DPDKDevice* _dev;
     unsigned _queue_id;
     bool _blocking;
-    Spinlock _lock;
     unsigned int _iqueue_size;
     unsigned int _burst_size;
     int _timeout;
-    unsigned long _count;
-    unsigned long _dropped;
     bool _congestion_warning_printed;
 };
 
@@ -32,6 +32,14 @@
 #include <click/packet_anno.hh>
 #include "fakepcap.hh"
 #include <click/userutils.hh>
+#if CLICK_USERLEVEL
+# include <click/routerthread.hh>
+# include <click/machine.hh>
+# include <sys/stat.h>
+# include <sys/uio.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
 #if HAVE_PCAP
 extern "C" {
 # include <pcap.h>
@@ -40,8 +48,21 @@ extern "C" {
 CLICK_DECLS
 
 ToDump::ToDump()
-    : _fp(0), _count(0), _task(this), _use_encap_from(0)
+    : _fp(0), _ring(0), _ring_thread(0), _wbuf_cur(0), _woffset(0),
+      _count(0), _sync_count(0),
+      _async(false), _direct(true),
+#if TODUMP_ASYNC
+      _abufs(0), _aslots(0), _naslots(0), _writer_running(false), _afd(-1),
+      _dbuf(0),
+#endif
+      _task(this), _use_encap_from(0)
 {
+    for (int i = 0; i < 2; ++i) {
+	_wbuf[i].owner = this;
+	_wbuf[i].data = 0;
+	_wbuf[i].length = 0;
+	_wbuf[i].busy = false;
+    }
 }
 
 ToDump::~ToDump()
@@ -53,9 +74,14 @@ ToDump::configure(Vector<String> &conf, ErrorHandler *errh)
 {
     String encap_type;
     String use_encap_from;
+    bool async = false, direct = true;
+    uint32_t abuf_size = 4194304, nabufs = 16;
+    uint64_t rotate_size = 0;
+    Timestamp flush_interval(1, 0), rotate_interval;
     _snaplen = 2000;
     _extra_length = true;
     _unbuffered = false;
+    _io_uring = false;
     _nano = Timestamp::subsec_per_sec == Timestamp::nsec_per_sec;
 #if HAVE_PCAP && !defined(PCAP_TSTAMP_PRECISION_NANO)
     _nano = false;
@@ -72,6 +98,14 @@ ToDump::configure(Vector<String> &conf, ErrorHandler *errh)
 	.read("EXTRA_LENGTH", _extra_length)
 	.read("UNBUFFERED", _unbuffered)
         .read("NANO", _nano)
+	.read("IO_URING", _io_uring)
+	.read("ASYNC", async)
+	.read("BUFFER_SIZE", abuf_size)
+	.read("BUFFERS", nabufs)
+	.read("FLUSH_INTERVAL", flush_interval)
+	.read("DIRECT", direct)
+	.read("ROTATE_SIZE", rotate_size)
+	.read("ROTATE_INTERVAL", rotate_interval)
 #if CLICK_NS
 	.read("PER_NODE", per_node)
 #endif
@@ -80,6 +114,33 @@ ToDump::configure(Vector<String> &conf, ErrorHandler *errh)
 
     if (_snaplen == 0)
 	_snaplen = 0xFFFFFFFFU;
+    if (_io_uring && _unbuffered)
+	return errh->error("IO_URING and UNBUFFERED are incompatible");
+    if (_io_uring && (_filename == "-" || compressed_filename(_filename) > 0))
+	return errh->error("IO_URING requires a regular, uncompressed file");
+    if (async && (_io_uring || _unbuffered))
+	return errh->error("ASYNC is incompatible with IO_URING and UNBUFFERED");
+    if (async && (_filename == "-" || compressed_filename(_filename) > 0))
+	return errh->error("ASYNC requires a regular, uncompressed file");
+    if (!async && (rotate_size || rotate_interval))
+	return errh->error("ROTATE_SIZE and ROTATE_INTERVAL require ASYNC");
+#if TODUMP_ASYNC
+    if (async && (abuf_size < 65536 || nabufs < 2))
+	return errh->error("ASYNC needs BUFFERS of at least 2 and BUFFER_SIZE of at least 65536");
+    if (async && flush_interval <= Timestamp())
+	return errh->error("FLUSH_INTERVAL must be positive");
+    _async = async;
+    _direct = direct;
+    _abuf_size = abuf_size;
+    _nabufs = nabufs;
+    _flush_interval = flush_interval;
+    _rotate_size = rotate_size;
+    _rotate_interval = rotate_interval;
+#else
+    if (async)
+	errh->warning("multithreading not available, ignoring ASYNC");
+    (void) direct, (void) abuf_size, (void) nabufs;
+#endif
 
     if (use_encap_from && encap_type)
 	return errh->error("specify at most one of 'ENCAP' and 'USE_ENCAP_FROM'");
@@ -116,11 +177,25 @@ ToDump::hotswap_element() const
     if (Element *e = Element::hotswap_element())
 	if (ToDump *td = (ToDump *)e->cast("ToDump"))
 	    if (td->_filename == _filename
-		&& td->_linktype == _linktype)
+		&& td->_linktype == _linktype
+		&& !td->_async && !_async)
 		return td;
     return 0;
 }
 
+void
+ToDump::make_file_header(fake_pcap_file_header &h) const
+{
+    h.magic = _nano ? FAKE_PCAP_MAGIC_NANO : FAKE_PCAP_MAGIC;
+    h.version_major = FAKE_PCAP_VERSION_MAJOR;
+    h.version_minor = FAKE_PCAP_VERSION_MINOR;
+
+    h.thiszone = 0;		// timestamps are in GMT
+    h.sigfigs = 0;		// XXX accuracy of timestamps?
+    h.snaplen = _snaplen;
+    h.linktype = _linktype;
+}
+
 int
 ToDump::initialize(ErrorHandler *errh)
 {
@@ -151,7 +226,12 @@ ToDump::initialize(ErrorHandler *errh)
     }
 
     // skip initialization if we're hotswapping later
-    if (!hotswap_element()) {
+    if (_async) {
+#if TODUMP_ASYNC
+	if (async_initialize(errh) < 0)
+	    return -1;
+#endif
+    } else if (!hotswap_element()) {
 
 	// prepare files
 	assert(!_fp);
@@ -171,19 +251,30 @@ ToDump::initialize(ErrorHandler *errh)
 	    setvbuf(_fp, (char *) 0, _IONBF, 0);
 
 	struct fake_pcap_file_header h;
-
-	h.magic = _nano ? FAKE_PCAP_MAGIC_NANO : FAKE_PCAP_MAGIC;
-	h.version_major = FAKE_PCAP_VERSION_MAJOR;
-	h.version_minor = FAKE_PCAP_VERSION_MINOR;
-
-	h.thiszone = 0;		// timestamps are in GMT
-	h.sigfigs = 0;		// XXX accuracy of timestamps?
-	h.snaplen = _snaplen;
-	h.linktype = _linktype;
-
+	make_file_header(h);
 	size_t wrote_header = fwrite(&h, sizeof(h), 1, _fp);
 	if (wrote_header != 1)
 	    return errh->error("%s: unable to write file header", _filename.c_str());
+	fflush(_fp);
+	_woffset = ftello(_fp);
+    }
+
+    if (_io_uring) {
+#if CLICK_USERLEVEL && HAVE_LINUX_IO_URING_H
+	// records are written at explicit offsets, so the file must be
+	// seekable
+	struct stat s;
+	if (_fp && (_fp == stdout || fstat(fileno(_fp), &s) < 0 || !S_ISREG(s.st_mode)))
+	    return errh->error("IO_URING requires a regular, uncompressed file");
+	_ring_thread = home_thread();
+	if (!(_ring = _ring_thread->io_uring()))
+	    errh->warning("io_uring not available, ignoring IO_URING");
+#else
+	errh->warning("io_uring not available, ignoring IO_URING");
+#endif
+	for (int i = 0; _ring && i < 2; ++i)
+	    if (!(_wbuf[i].data = new unsigned char[WBUF_SIZE]))
+		return errh->error("out of memory");
     }
 
     if (input_is_pull(0) && noutputs() == 0) {
@@ -198,18 +289,403 @@ void
 ToDump::take_state(Element *e, ErrorHandler *)
 {
     ToDump *td = static_cast<ToDump *>(e); // result of hotswap_element()
+    if (td->_ring)
+	td->finish_writes();
+    else if (td->_fp)
+	fflush(td->_fp);
     _fp = td->_fp;
     td->_fp = 0;
+    // continue at the end of the old element's records
+    if (td->_ring && !_ring && _fp)
+	fseeko(_fp, td->_woffset, SEEK_SET);
+    else if (!td->_ring && _fp)
+	td->_woffset = ftello(_fp);
+    _woffset = td->_woffset;
 }
 
 void
 ToDump::cleanup(CleanupStage)
 {
+#if TODUMP_ASYNC
+    async_cleanup();
+#endif
+    if (_ring)
+	finish_writes();
+    for (int i = 0; i < 2; ++i) {
+	delete[] _wbuf[i].data;
+	_wbuf[i].data = 0;
+    }
     if (_fp && _fp != stdout)
 	fclose(_fp);
     _fp = 0;
 }
 
+void
+ToDump::write_done(int result, void *user_data)
+{
+    WriteBuffer *b = static_cast<WriteBuffer *>(user_data);
+    ToDump *td = b->owner;
+    if (result != (int) b->length && td->_active) {
+	td->_active = false;
+	click_chatter("ToDump(%s): %s", td->_filename.c_str(),
+		      result < 0 ? strerror(-result) : "short write");
+    }
+    b->length = 0;
+    b->busy = false;
+}
+
+/* Return the file offset at which to write @a length bytes of records.
+ * Offsets are handed out in order, so regions written by different threads
+ * never overlap. */
+inline off_t
+ToDump::reserve(size_t length)
+{
+    _wlock.acquire();
+    off_t offset = _woffset;
+    _woffset += length;
+    _wlock.release();
+    return offset;
+}
+
+void
+ToDump::submit_buffer()
+{
+#if CLICK_USERLEVEL && HAVE_LINUX_IO_URING_H
+    WriteBuffer &b = _wbuf[_wbuf_cur];
+    b.busy = true;
+    _ring->write(fileno(_fp), b.data, b.length, reserve(b.length),
+		 write_done, &b);
+    // wait only if the disk has fallen two buffers behind
+    _wbuf_cur = !_wbuf_cur;
+    if (_wbuf[_wbuf_cur].busy)
+	_ring->wait(&_wbuf[_wbuf_cur]);
+#endif
+}
+
+void
+ToDump::finish_writes()
+{
+#if CLICK_USERLEVEL && HAVE_LINUX_IO_URING_H
+    for (int i = 0; i < 2; ++i)
+	if (_wbuf[i].busy)
+	    _ring->wait(&_wbuf[i]);
+    WriteBuffer &b = _wbuf[_wbuf_cur];
+    if (b.length && _active) {
+	ssize_t w = pwrite(fileno(_fp), b.data, b.length, reserve(b.length));
+	write_done(w < 0 ? -errno : w, &b);
+    }
+    b.length = 0;
+#endif
+}
+
+/* Write one record at once, for packets that arrive off the io_uring's
+ * thread. */
+void
+ToDump::write_record_sync(const fake_pcap_pkthdr &ph, const unsigned char *data)
+{
+#if CLICK_USERLEVEL && HAVE_LINUX_IO_URING_H
+    struct iovec iov[2];
+    iov[0].iov_base = const_cast<fake_pcap_pkthdr *>(&ph);
+    iov[0].iov_len = sizeof(ph);
+    iov[1].iov_base = const_cast<unsigned char *>(data);
+    iov[1].iov_len = ph.caplen;
+    size_t length = sizeof(ph) + ph.caplen;
+    ssize_t w = pwritev(fileno(_fp), iov, 2, reserve(length));
+    if (w != (ssize_t) length) {
+	if (_active) {
+	    _active = false;
+	    click_chatter("ToDump(%s): %s", _filename.c_str(),
+			  w < 0 ? strerror(errno) : "short write");
+	}
+	return;
+    }
+    _wlock.acquire();
+    ++_sync_count;
+    _wlock.release();
+#else
+    (void) ph, (void) data;
+#endif
+}
+
+#if TODUMP_ASYNC
+int
+ToDump::async_initialize(ErrorHandler *errh)
+{
+    _naslots = click_max_cpu_ids();
+    _aslots = new AsyncSlot[_naslots];
+    _abufs = new AsyncBuffer[_nabufs];
+    if (!_aslots || !_abufs)
+	return errh->error("out of memory");
+    for (unsigned i = 0; i < _naslots; ++i) {
+	_aslots[i].buf = 0;
+	_aslots[i].count = _aslots[i].drops = 0;
+    }
+    _free_abuf = _full_head = _full_tail = -1;
+    for (int i = _nabufs - 1; i >= 0; --i) {
+	if (!(_abufs[i].data = new unsigned char[_abuf_size]))
+	    return errh->error("out of memory");
+	_abufs[i].length = 0;
+	_abufs[i].next = _free_abuf;
+	_free_abuf = i;
+    }
+
+    // O_DIRECT needs aligned writes, which the writer thread assembles in
+    // a staging buffer
+# ifdef O_DIRECT
+    if (_direct && posix_memalign((void **) &_dbuf, DIRECT_ALIGN, _abuf_size + DIRECT_ALIGN) != 0)
+	_dbuf = 0;
+# endif
+    _file_seq = 0;
+    if (async_open_file(errh) < 0)
+	return -1;
+
+    pthread_mutex_init(&_alock, 0);
+    pthread_cond_init(&_acond, 0);
+    _writer_stop = false;
+    if (int err = pthread_create(&_writer, 0, async_writer, this))
+	return errh->error("pthread_create: %s", strerror(err));
+    _writer_running = true;
+    return 0;
+}
+
+void
+ToDump::async_cleanup()
+{
+    if (_writer_running) {
+	pthread_mutex_lock(&_alock);
+	_writer_stop = true;
+	pthread_cond_signal(&_acond);
+	pthread_mutex_unlock(&_alock);
+	pthread_join(_writer, 0);
+	pthread_mutex_destroy(&_alock);
+	pthread_cond_destroy(&_acond);
+	_writer_running = false;
+    }
+    if (_afd >= 0) {
+	async_write_data(0, 0, true);
+	close(_afd);
+	_afd = -1;
+    }
+    for (unsigned i = 0; _abufs && i < _nabufs; ++i)
+	delete[] _abufs[i].data;
+    delete[] _abufs;
+    delete[] _aslots;
+    free(_dbuf);
+    _abufs = 0;
+    _aslots = 0;
+    _dbuf = 0;
+}
+
+String
+ToDump::async_filename(unsigned seq) const
+{
+    if (_rotate_size || _rotate_interval)
+	return _filename + "." + String(seq);
+    else
+	return _filename;
+}
+
+int
+ToDump::async_open_file(ErrorHandler *errh)
+{
+    if (_afd >= 0) {
+	async_write_data(0, 0, true);
+	close(_afd);
+	_afd = -1;
+	++_file_seq;
+    }
+
+    String fn = async_filename(_file_seq);
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+# ifdef O_DIRECT
+    if (_dbuf) {
+	_afd = open(fn.c_str(), flags | O_DIRECT, 0666);
+	// some file systems, such as tmpfs, don't support O_DIRECT
+	if (_afd < 0 && errno == EINVAL) {
+	    free(_dbuf);
+	    _dbuf = 0;
+	}
+    }
+# endif
+    if (_afd < 0 && !_dbuf)
+	_afd = open(fn.c_str(), flags, 0666);
+    if (_afd < 0) {
+	if (errh)
+	    return errh->error("%s: %s", fn.c_str(), strerror(errno));
+	click_chatter("ToDump(%s): %s", fn.c_str(), strerror(errno));
+	_active = false;
+	return -1;
+    }
+
+    _file_bytes = 0;
+    _dlen = 0;
+    _file_opened = Timestamp::now_steady();
+    fake_pcap_file_header h;
+    make_file_header(h);
+    return async_write_data(reinterpret_cast<const unsigned char *>(&h), sizeof(h), false) ? 0 : -1;
+}
+
+/* Write data to the current file.  If @a sync is true, also write any data
+   held back for O_DIRECT alignment. */
+bool
+ToDump::async_write_data(const unsigned char *data, size_t len, bool sync)
+{
+    size_t n = len;
+    _file_bytes += len;
+    if (_dbuf) {
+	memcpy(_dbuf + _dlen, data, len);
+	_dlen += len;
+	if (sync) {
+	    n = _dlen;
+# ifdef O_DIRECT
+	    fcntl(_afd, F_SETFL, fcntl(_afd, F_GETFL) & ~O_DIRECT);
+# endif
+	} else
+	    n = _dlen & ~(size_t) (DIRECT_ALIGN - 1);
+	data = _dbuf;
+    }
+
+    for (size_t pos = 0; pos < n; ) {
+	ssize_t w = write(_afd, data + pos, n - pos);
+	if (w < 0 && errno == EINTR)
+	    continue;
+	else if (w <= 0) {
+	    if (_active)
+		click_chatter("ToDump(%s): %s", async_filename(_file_seq).c_str(),
+			      w < 0 ? strerror(errno) : "short write");
+	    _active = false;
+	    return false;
+	}
+	pos += w;
+    }
+
+    if (_dbuf) {
+	memmove(_dbuf, _dbuf + n, _dlen - n);
+	_dlen -= n;
+    }
+    return true;
+}
+
+void
+ToDump::async_write_buffer(int bi)
+{
+    AsyncBuffer &b = _abufs[bi];
+    if (_afd >= 0 && _active) {
+	if ((_rotate_size && _file_bytes > sizeof(fake_pcap_file_header)
+	     && _file_bytes + b.length > _rotate_size)
+	    || (_rotate_interval
+		&& Timestamp::now_steady() >= _file_opened + _rotate_interval))
+	    async_open_file(0);
+	if (_afd >= 0)
+	    async_write_data(b.data, b.length, false);
+    }
+    b.length = 0;
+
+    pthread_mutex_lock(&_alock);
+    b.next = _free_abuf;
+    _free_abuf = bi;
+    pthread_mutex_unlock(&_alock);
+}
+
+/* Hand buffer @a full, if any, to the writer thread, and return a free
+   buffer, or -1 if none is available. */
+int
+ToDump::async_exchange(int full)
+{
+    pthread_mutex_lock(&_alock);
+    if (full >= 0) {
+	_abufs[full].next = -1;
+	if (_full_tail >= 0)
+	    _abufs[_full_tail].next = full;
+	else
+	    _full_head = full;
+	_full_tail = full;
+	pthread_cond_signal(&_acond);
+    }
+    int bi = _free_abuf;
+    if (bi >= 0)
+	_free_abuf = _abufs[bi].next;
+    pthread_mutex_unlock(&_alock);
+    return bi;
+}
+
+/* Write Click threads' partly filled buffers: those that have held
+   records for longer than FLUSH_INTERVAL, or all of them if @a all. */
+void
+ToDump::async_steal_buffers(bool all)
+{
+    Timestamp limit = Timestamp::now_steady() - _flush_interval;
+    for (unsigned i = 0; i < _naslots; ++i) {
+	uint32_t bi = _aslots[i].buf.value();
+	if (bi && (all || _abufs[bi - 1].first <= limit)
+	    && (bi = _aslots[i].buf.swap(0)))
+	    async_write_buffer(bi - 1);
+    }
+}
+
+void *
+ToDump::async_writer(void *arg)
+{
+    ToDump *td = static_cast<ToDump *>(arg);
+    Timestamp next_steal = Timestamp::now_steady() + td->_flush_interval;
+    pthread_mutex_lock(&td->_alock);
+    while (1) {
+	if (td->_full_head < 0 && !td->_writer_stop) {
+	    Timestamp wake = Timestamp::now() + (next_steal - Timestamp::now_steady());
+	    struct timespec ts = wake.timespec();
+	    pthread_cond_timedwait(&td->_acond, &td->_alock, &ts);
+	}
+	int bi = td->_full_head;
+	if (bi >= 0) {
+	    td->_full_head = td->_abufs[bi].next;
+	    if (td->_full_head < 0)
+		td->_full_tail = -1;
+	    pthread_mutex_unlock(&td->_alock);
+	    td->async_write_buffer(bi);
+	    pthread_mutex_lock(&td->_alock);
+	} else if (td->_writer_stop)
+	    break;
+	if (Timestamp::now_steady() >= next_steal) {
+	    pthread_mutex_unlock(&td->_alock);
+	    td->async_steal_buffers(false);
+	    next_steal = Timestamp::now_steady() + td->_flush_interval;
+	    pthread_mutex_lock(&td->_alock);
+	}
+    }
+    pthread_mutex_unlock(&td->_alock);
+    // the router has stopped, so no Click thread holds a buffer
+    td->async_steal_buffers(true);
+    return 0;
+}
+
+void
+ToDump::async_write(const fake_pcap_pkthdr &ph, const unsigned char *data)
+{
+    AsyncSlot &s = _aslots[click_current_cpu_id()];
+    size_t reclen = sizeof(ph) + ph.caplen;
+
+    // Own the thread's buffer while appending; meanwhile, the writer
+    // thread cannot steal it.
+    uint32_t bi = s.buf.swap(0);
+    if (!bi || _abufs[bi - 1].length + reclen > _abuf_size)
+	bi = async_exchange((int) bi - 1) + 1;
+    if (!bi) {
+	++s.drops;
+	return;
+    }
+
+    AsyncBuffer &b = _abufs[bi - 1];
+    if (!b.length)
+	b.first = Timestamp::recent_steady();
+    memcpy(b.data + b.length, &ph, sizeof(ph));
+    memcpy(b.data + b.length + sizeof(ph), data, ph.caplen);
+    b.length += reclen;
+    ++s.count;
+    click_write_fence();
+    s.buf = bi;
+}
+#endif
+
 void
 ToDump::write_packet(Packet *p)
 {
@@ -225,8 +701,37 @@ ToDump::write_packet(Packet *p)
     ph.len = to_write + (_extra_length ? EXTRA_LENGTH_ANNO(p) : 0);
     if (_snaplen && to_write > _snaplen)
 	to_write = _snaplen;
+    if (_ring && to_write > WBUF_SIZE - sizeof(ph))
+	to_write = WBUF_SIZE - sizeof(ph);
+#if TODUMP_ASYNC
+    if (_async && to_write > _abuf_size - sizeof(ph))
+	to_write = _abuf_size - sizeof(ph);
+#endif
     ph.caplen = to_write;
 
+#if TODUMP_ASYNC
+    if (_async) {
+	async_write(ph, p->data());
+	return;
+    }
+#endif
+
+    if (_ring && !_ring_thread->current_thread_is_running()) {
+	write_record_sync(ph, p->data());
+	return;
+    } else if (_ring) {
+	WriteBuffer *b = &_wbuf[_wbuf_cur];
+	if (b->length + sizeof(ph) + to_write > WBUF_SIZE) {
+	    submit_buffer();
+	    b = &_wbuf[_wbuf_cur];
+	}
+	memcpy(b->data + b->length, &ph, sizeof(ph));
+	memcpy(b->data + b->length + sizeof(ph), p->data(), to_write);
+	b->length += sizeof(ph) + to_write;
+	_count++;
+	return;
+    }
+
     // XXX writing to pipe?
     if (fwrite(&ph, sizeof(ph), 1, _fp) == 0
 	|| (to_write > 0 && fwrite(p->data(), 1, to_write, _fp) == 0)) {
@@ -270,17 +775,33 @@ ToDump::run_task(Task *)
     return p != 0;
 }
 
-enum { H_FILENAME = 0, H_COUNT = 1, H_RESET_COUNTS = 2 };
+enum { H_FILENAME = 0, H_COUNT = 1, H_RESET_COUNTS = 2, H_DROPS = 3,
+       H_IO_URING = 4 };
 
 String
 ToDump::read_handler(Element *e, void *thunk)
 {
     ToDump *td = static_cast<ToDump *>(e);
+    counter_t count = td->_count + td->_sync_count, drops = 0;
+#if TODUMP_ASYNC
+    for (unsigned i = 0; td->_aslots && i < td->_naslots; ++i) {
+	count += td->_aslots[i].count;
+	drops += td->_aslots[i].drops;
+    }
+#endif
     switch ((uintptr_t) thunk) {
     case H_FILENAME:
+#if TODUMP_ASYNC
+	if (td->_async)
+	    return td->async_filename(td->_file_seq);
+#endif
 	return td->_filename;
     case H_COUNT:
-	return String(td->_count);
+	return String(count);
+    case H_DROPS:
+	return String(drops);
+    case H_IO_URING:
+	return String(td->_ring != 0);
     default:
 	return "<error>";
     }
@@ -290,7 +811,11 @@ int
 ToDump::write_handler(const String &, Element *e, void *, ErrorHandler *)
 {
     ToDump *td = static_cast<ToDump *>(e);
-    td->_count = 0;
+    td->_count = td->_sync_count = 0;
+#if TODUMP_ASYNC
+    for (unsigned i = 0; td->_aslots && i < td->_naslots; ++i)
+	td->_aslots[i].count = td->_aslots[i].drops = 0;
+#endif
     return 0;
 }
 
@@ -299,6 +824,8 @@ ToDump::add_handlers()
 {
     add_read_handler("filename", read_handler, H_FILENAME);
     add_read_handler("count", read_handler, H_COUNT);
+    add_read_handler("drops", read_handler, H_DROPS);
+    add_read_handler("io_uring", read_handler, H_IO_URING);
     add_write_handler("reset_counts", write_handler, H_RESET_COUNTS, Handler::BUTTON);
     if (input_is_pull(0) && noutputs() == 0)
 	add_task_handlers(&_task);
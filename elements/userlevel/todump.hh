@@ -6,12 +6,19 @@
 #include <click/task.hh>
 #include <click/notifier.hh>
 #include <stdio.h>
+#if CLICK_USERLEVEL && HAVE_USER_MULTITHREAD
+# include <pthread.h>
+# define TODUMP_ASYNC 1
+#endif
 CLICK_DECLS
+class IOUring;
+struct fake_pcap_file_header;
+struct fake_pcap_pkthdr;
 
 /*
 =c
 
-ToDump(FILENAME [, I<keywords> SNAPLEN, ENCAP, USE_ENCAP_FROM, EXTRA_LENGTH, NANO])
+ToDump(FILENAME [, I<keywords> SNAPLEN, ENCAP, USE_ENCAP_FROM, EXTRA_LENGTH, NANO, IO_URING, ASYNC, ...])
 
 =s traces
 
@@ -71,6 +78,57 @@ false.
 Boolean. Set to true to write nanosecond-precision timestamps. Default depends
 on the version of tcpdump/pcap on the machine.
 
+=item IO_URING
+
+Boolean. Set to true to write asynchronously. ToDump then collects records in
+two 1 MB buffers, and writes each full buffer through its home thread's
+io_uring while it fills the other; the thread waits for the disk only when
+both buffers are full. Since an io_uring belongs to one thread, packets
+arriving on other threads are written synchronously, one record at a time,
+so records from different threads may be out of timestamp order. FILENAME
+must name a regular, uncompressed file. Ignored, with a warning, if io_uring
+is not available. Default is false.
+
+=item ASYNC
+
+Boolean. Set to true to write from a background thread. Each Click thread
+copies records into its own BUFFER_SIZE-byte buffer and hands full buffers to
+a writer thread, so forwarding threads never wait for the disk. If all
+BUFFERS buffers are full, packets are not recorded and are counted in the
+C<drops> handler. Records from different threads may be interleaved, one
+buffer at a time. FILENAME must name a regular, uncompressed file. Ignored,
+with a warning, without multithreading support. Default is false.
+
+=item BUFFER_SIZE
+
+Unsigned integer. Size of each ASYNC buffer in bytes. Default is 4194304.
+
+=item BUFFERS
+
+Unsigned integer. Number of ASYNC buffers. Default is 16.
+
+=item FLUSH_INTERVAL
+
+Time interval. In ASYNC mode, records are written no later than about twice
+this long after they arrive, even if their buffer is not full. Default is 1
+second.
+
+=item DIRECT
+
+Boolean. In ASYNC mode, open files with O_DIRECT, bypassing the page cache,
+if the file system allows it. Default is true.
+
+=item ROTATE_SIZE
+
+Unsigned integer. In ASYNC mode, start a new file before a file would grow
+beyond this many bytes. The files are named FILENAME.0, FILENAME.1, and so
+on. Default is 0, meaning no limit.
+
+=item ROTATE_INTERVAL
+
+Time interval. In ASYNC mode, start a new file once a file has been open this
+long. Files are named as for ROTATE_SIZE. Default is 0, meaning no limit.
+
 =back
 
 This element is only available at user level.
@@ -85,11 +143,22 @@ Returns the number of packets emitted so far.
 
 =h reset_counts write-only
 
-Resets "count" to 0.
+Resets "count" and "drops" to 0.
 
 =h filename read-only
 
-Returns the filename.
+Returns the filename.  In ASYNC mode with rotation, returns the name of the
+file being written.
+
+=h drops read-only
+
+Returns the number of packets not recorded because all ASYNC buffers were
+full.
+
+=h io_uring read-only
+
+Returns true iff ToDump writes through io_uring, which is false when IO_URING
+is false or io_uring is not available.
 
 =a
 
@@ -127,6 +196,22 @@ class ToDump : public Element { public:
     bool _extra_length;
     bool _unbuffered;
     bool _nano;
+    bool _io_uring;
+
+    // IO_URING mode: fill one buffer while the other is written
+    struct WriteBuffer {
+	ToDump *owner;
+	unsigned char *data;
+	size_t length;
+	bool busy;
+    };
+    enum { WBUF_SIZE = 1 << 20 };
+    IOUring *_ring;
+    RouterThread *_ring_thread;
+    WriteBuffer _wbuf[2];
+    int _wbuf_cur;
+    off_t _woffset;
+    Spinlock _wlock;		// protects _woffset and _sync_count
 
 #if HAVE_INT64_TYPES
     typedef uint64_t counter_t;
@@ -134,6 +219,59 @@ class ToDump : public Element { public:
     typedef uint32_t counter_t;
 #endif
     counter_t _count;
+    counter_t _sync_count;	// IO_URING records written off the home thread
+
+    // ASYNC mode: per-thread buffers written by a writer thread
+    bool _async;
+    bool _direct;
+#if TODUMP_ASYNC
+    struct AsyncBuffer {
+	unsigned char *data;
+	size_t length;
+	Timestamp first;	// steady time of first record
+	int next;
+    };
+    struct AsyncSlot {
+	atomic_uint32_t buf;	// 1 + index of the thread's buffer, or 0
+	counter_t count;
+	counter_t drops;
+    } CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
+    enum { DIRECT_ALIGN = 4096 };
+    uint32_t _abuf_size;
+    uint32_t _nabufs;
+    Timestamp _flush_interval;
+    uint64_t _rotate_size;
+    Timestamp _rotate_interval;
+    AsyncBuffer *_abufs;
+    AsyncSlot *_aslots;
+    unsigned _naslots;
+    int _free_abuf;
+    int _full_head;
+    int _full_tail;
+    pthread_mutex_t _alock;
+    pthread_cond_t _acond;
+    pthread_t _writer;
+    bool _writer_running;
+    bool _writer_stop;
+    // writer thread state
+    int _afd;
+    unsigned _file_seq;
+    uint64_t _file_bytes;
+    Timestamp _file_opened;
+    unsigned char *_dbuf;	// O_DIRECT staging buffer
+    size_t _dlen;
+
+    int async_initialize(ErrorHandler *);
+    void async_cleanup();
+    void async_write(const fake_pcap_pkthdr &, const unsigned char *);
+    int async_exchange(int full);
+    int async_open_file(ErrorHandler *);
+    bool async_write_data(const unsigned char *, size_t, bool sync);
+    void async_write_buffer(int);
+    void async_steal_buffers(bool all);
+    static void *async_writer(void *);
+    String async_filename(unsigned seq) const;
+#endif
 
     Task _task;
     NotifierSignal _signal;
@@ -142,6 +280,12 @@ class ToDump : public Element { public:
     static String read_handler(Element *, void *) CLICK_COLD;
     static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
     void write_packet(Packet *);
+    inline off_t reserve(size_t length);
+    void submit_buffer();
+    void write_record_sync(const fake_pcap_pkthdr &, const unsigned char *);
+    void finish_writes();
+    static void write_done(int result, void *user_data);
+    void make_file_header(fake_pcap_file_header &) const;
 
 };
 
@@ -0,0 +1,181 @@
+// -*- c-basic-offset: 4 -*-
+/*
+ * tosharedring.{cc,hh} -- element sends packets to another Click process
+ * through shared memory
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "tosharedring.hh"
+#include "sharedring.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/packetbatch.hh>
+#include <unistd.h>
+CLICK_DECLS
+
+ToSharedRing::ToSharedRing()
+    : _ring(0), _desc_tail_seen(0), _free_head_seen(0), _count(0), _drops(0)
+{
+}
+
+ToSharedRing::~ToSharedRing()
+{
+}
+
+int
+ToSharedRing::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    uint32_t slots = 1024;
+    _buffer_size = 2048;
+    _headroom = 128;
+    if (Args(conf, this, errh)
+	.read_mp("FILENAME", FilenameArg(), _filename)
+	.read("SLOTS", slots)
+	.read("BUFFER_SIZE", _buffer_size)
+	.read("HEADROOM", _headroom)
+	.complete() < 0)
+	return -1;
+    if (slots == 0 || slots > 0x1000000)
+	return errh->error("SLOTS out of range");
+    for (_slots = 1; _slots < slots; _slots *= 2)
+	/* nada */;
+    _buffer_size = (_buffer_size + 63) & ~63U;
+    if (_headroom >= _buffer_size)
+	return errh->error("HEADROOM must be less than BUFFER_SIZE");
+    return 0;
+}
+
+int
+ToSharedRing::initialize(ErrorHandler *errh)
+{
+    _ring = SharedRing::create(_filename, _slots, _buffer_size, _headroom, errh);
+    if (!_ring)
+	return -1;
+    _desc_tail_seen = 0;
+    _free_head_seen = _ring->header()->free_head;
+    return 0;
+}
+
+void
+ToSharedRing::cleanup(CleanupStage)
+{
+    if (_ring) {
+	unlink(_filename.c_str());
+	unlink((_filename + ".bell").c_str());
+	_ring->unref();
+	_ring = 0;
+    }
+}
+
+void
+ToSharedRing::push(int port, Packet *p)
+{
+    PacketBatch batch;
+    batch.append(p);
+    push_batch(port, batch);
+}
+
+void
+ToSharedRing::push_batch(int, PacketBatch &batch)
+{
+    SharedRing::Header *h = _ring->header();
+    uint32_t want = batch.count();
+    uint32_t max_length = _buffer_size - _headroom;
+    PacketBatch done;
+
+    _lock.acquire();
+
+    // Refresh our views of the consumer's indexes only when they look
+    // too small.
+    uint32_t head = h->desc_head;
+    uint32_t room = _slots - (head - _desc_tail_seen);
+    if (room < want) {
+	_desc_tail_seen = h->desc_tail;
+	room = _slots - (head - _desc_tail_seen);
+    }
+    uint32_t free_tail = h->free_tail;
+    uint32_t nfree = _free_head_seen - free_tail;
+    if (nfree < want) {
+	_free_head_seen = h->free_head;
+	nfree = _free_head_seen - free_tail;
+    }
+    if (nfree < room)
+	room = nfree;
+    SharedRing::read_fence();
+
+    uint32_t n = 0;
+    while (Packet *p = batch.pop_front()) {
+	if (n < room && p->length() <= max_length) {
+	    uint32_t buffer = _ring->free_slot(free_tail + n);
+	    memcpy(_ring->buffer(buffer) + _headroom, p->data(), p->length());
+	    SharedRing::Desc &d = _ring->desc(head + n);
+	    d.buffer = buffer;
+	    d.length = p->length();
+	    d.sec = p->timestamp_anno().sec();
+	    d.subsec = p->timestamp_anno().nsec();
+	    ++n;
+	} else
+	    ++_drops;
+	done.append(p);
+    }
+
+    if (n) {
+	h->free_tail = free_tail + n;
+	SharedRing::write_fence();
+	h->desc_head = head + n;
+	_count += n;
+	// Pairs with the fence in FromSharedRing::sleep().
+	SharedRing::fence();
+	_ring->ring_bell();
+    }
+
+    _lock.release();
+
+    done.kill();
+}
+
+String
+ToSharedRing::read_handler(Element *e, void *thunk)
+{
+    ToSharedRing *tsr = static_cast<ToSharedRing *>(e);
+    switch ((intptr_t) thunk) {
+    case h_count:
+	return String(tsr->_count);
+    case h_drops:
+	return String(tsr->_drops);
+    default:
+	return String();
+    }
+}
+
+int
+ToSharedRing::write_handler(const String &, Element *e, void *, ErrorHandler *)
+{
+    ToSharedRing *tsr = static_cast<ToSharedRing *>(e);
+    tsr->_count = tsr->_drops = 0;
+    return 0;
+}
+
+void
+ToSharedRing::add_handlers()
+{
+    add_read_handler("count", read_handler, h_count);
+    add_read_handler("drops", read_handler, h_drops);
+    add_write_handler("reset_counts", write_handler, h_reset_counts, Handler::BUTTON);
+    add_data_handlers("filename", Handler::OP_READ, &_filename);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel SharedRing)
+EXPORT_ELEMENT(ToSharedRing)
+ELEMENT_MT_SAFE(ToSharedRing)
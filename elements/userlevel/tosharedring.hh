@@ -0,0 +1,128 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_TOSHAREDRING_HH
+#define CLICK_TOSHAREDRING_HH
+#include <click/element.hh>
+#include <click/sync.hh>
+CLICK_DECLS
+class SharedRing;
+
+/*
+=c
+
+ToSharedRing(FILENAME [, I<keywords> SLOTS, BUFFER_SIZE, HEADROOM])
+
+=s comm
+
+sends packets to another Click process through shared memory
+
+=d
+
+Sends packets to a FromSharedRing element in another Click process on the
+same host, through a ring shared in memory.  No system call is made per
+packet: ToSharedRing copies each packet into a buffer of the shared memory
+and posts a descriptor for it, and FromSharedRing returns the buffer once it
+is done with it.  ToSharedRing only makes a system call to wake FromSharedRing
+when FromSharedRing is asleep.
+
+ToSharedRing creates the shared memory as the file FILENAME, replacing any
+existing file.  The file should be on a memory file system, such as
+/dev/shm; a file on a hugetlbfs mount uses huge pages.  A FIFO named
+FILENAME.bell is used to wake FromSharedRing.  ToSharedRing removes FILENAME
+and FILENAME.bell when the router stops.  Either process can start first, and FromSharedRing
+attaches to the new ring if ToSharedRing's process is restarted.
+
+Packets are dropped when they are longer than BUFFER_SIZE minus HEADROOM, or
+when the ring is full.
+
+Keyword arguments are:
+
+=over 8
+
+=item SLOTS
+
+Integer.  Number of descriptors in the ring, rounded up to a power of two.
+The shared memory holds twice as many packet buffers.  Default is 1024.
+
+=item BUFFER_SIZE
+
+Integer.  Size of each packet buffer, rounded up to a multiple of 64.
+Default is 2048.
+
+=item HEADROOM
+
+Integer.  Space left before the packet data in each buffer, which packets
+received without copying can use to grow.  Default is 128.
+
+=back
+
+ToSharedRing may be pushed to by several threads, which take turns sending
+their batches.
+
+Only available in user-level processes.
+
+=h count read-only
+
+Returns the number of packets sent.
+
+=h drops read-only
+
+Returns the number of packets dropped.
+
+=h reset_counts write-only
+
+Resets the counts to zero.
+
+=h filename read-only
+
+Returns the shared memory's file name.
+
+=e
+
+  // NAT process
+  ... -> ToSharedRing(/dev/shm/nat2filter);
+
+  // filtering process
+  FromSharedRing(/dev/shm/nat2filter) -> ...
+
+=a FromSharedRing, ToDevice.u, Socket */
+
+class ToSharedRing : public Element { public:
+
+    ToSharedRing() CLICK_COLD;
+    ~ToSharedRing() CLICK_COLD;
+
+    const char *class_name() const		{ return "ToSharedRing"; }
+    const char *port_count() const		{ return PORTS_1_0; }
+    const char *processing() const		{ return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    void push(int port, Packet *p);
+    void push_batch(int port, PacketBatch &batch);
+
+  private:
+
+    String _filename;
+    uint32_t _slots;
+    uint32_t _buffer_size;
+    uint32_t _headroom;
+
+    SharedRing *_ring;
+    Spinlock _lock;
+    uint32_t _desc_tail_seen;
+    uint32_t _free_head_seen;
+
+    unsigned long _count;
+    unsigned long _drops;
+
+    enum { h_count, h_drops, h_reset_counts };
+    static String read_handler(Element *, void *) CLICK_COLD;
+    static int write_handler(const String &, Element *, void *, ErrorHandler *) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,131 @@
+// -*- c-basic-offset: 4; related-file-name: "toxdpdevice.hh" -*-
+/*
+ * toxdpdevice.{cc,hh} -- element sends packets to network via AF_XDP
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include "toxdpdevice.hh"
+#include "fromxdpdevice.hh"
+#include <click/args.hh>
+#include <click/error.hh>
+#include <click/master.hh>
+
+CLICK_DECLS
+
+ToXDPDevice::ToXDPDevice()
+    : _dev(0)
+{
+    _count = 0;
+    _dropped = 0;
+}
+
+ToXDPDevice::~ToXDPDevice()
+{
+}
+
+int
+ToXDPDevice::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    String ifname;
+    int queue = -1;
+    if (Args(this, errh).bind(conf)
+        .read_mp("DEVNAME", ifname)
+        .read_p("QUEUE", queue)
+        .consume() < 0)
+        return -1;
+
+    if (!(_dev = XDPDevice::get(ifname, errh))
+        || FromXDPDevice::configure_device(_dev, conf, this, errh) < 0
+        || Args(conf, this, errh).complete() < 0)
+        return -1;
+
+    if (queue >= 0)
+        _queue_ids.push_back(queue);
+    else {
+        int n = master()->nthreads();
+        if (n > _dev->nqueues())
+            n = _dev->nqueues();
+        for (int q = 0; q < n; ++q)
+            _queue_ids.push_back(q);
+    }
+    for (int i = 0; i < _queue_ids.size(); ++i)
+        if (_dev->add_queue(_queue_ids[i], false, errh) < 0)
+            return -1;
+    return 0;
+}
+
+int
+ToXDPDevice::initialize(ErrorHandler *errh)
+{
+    if (_dev->initialize(errh) < 0)
+        return -1;
+    for (int i = 0; i < _queue_ids.size(); ++i)
+        _socks.push_back(_dev->socket(_queue_ids[i]));
+    return 0;
+}
+
+void
+ToXDPDevice::cleanup(CleanupStage)
+{
+    _socks.clear();
+    if (_dev)
+        _dev->unuse();
+    _dev = 0;
+}
+
+void
+ToXDPDevice::push_batch(int, PacketBatch &batch)
+{
+    XDPSocket *sock = _socks[click_current_cpu_id() % _socks.size()];
+    PacketBatch dropped;
+    unsigned n = sock->send(batch, dropped);
+    _count += n;
+    if (!dropped.empty()) {
+        _dropped += dropped.count();
+        dropped.kill();
+    }
+}
+
+void
+ToXDPDevice::push(int port, Packet *p)
+{
+    PacketBatch batch;
+    batch.append(p);
+    push_batch(port, batch);
+}
+
+String
+ToXDPDevice::read_handler(Element *e, void *thunk)
+{
+    ToXDPDevice *td = static_cast<ToXDPDevice *>(e);
+    switch ((uintptr_t) thunk) {
+    case h_count:
+        return String(td->_count.value());
+    case h_dropped:
+        return String(td->_dropped.value());
+    default:
+        return String();
+    }
+}
+
+void
+ToXDPDevice::add_handlers()
+{
+    add_read_handler("count", read_handler, h_count);
+    add_read_handler("dropped", read_handler, h_dropped);
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel xdp XDPDevice FromXDPDevice)
+EXPORT_ELEMENT(ToXDPDevice)
+ELEMENT_MT_SAFE(ToXDPDevice)
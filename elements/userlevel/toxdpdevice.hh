@@ -0,0 +1,83 @@
+#ifndef CLICK_TOXDPDEVICE_HH
+#define CLICK_TOXDPDEVICE_HH
+#include <click/element.hh>
+#include "elements/userlevel/xdpdevice.hh"
+CLICK_DECLS
+
+/*
+=title ToXDPDevice
+
+=c
+
+ToXDPDevice(DEVNAME [, QUEUE, I<keywords> MODE, ZEROCOPY, NFRAMES, FRAME_SIZE, NDESC])
+
+=s netdevices
+
+sends packets to network device using AF_XDP sockets (user-level)
+
+=d
+
+Sends packets to the Linux network device named DEVNAME through AF_XDP
+sockets.  Each batch of packets pushed to ToXDPDevice is placed on a
+socket's transmit ring and sent with at most one system call.
+
+A packet received by FromXDPDevice on the same device and queue is sent
+without copying: its UMEM frame moves straight to the transmit ring.  Other
+packets are copied into free frames of the socket's UMEM.  Packets that do
+not fit in a frame, or that find the transmit ring or the UMEM full, are
+dropped.
+
+If QUEUE is given, all packets go to that queue.  Otherwise, each Click
+thread sends on its own queue: thread 0 on queue 0, thread 1 on queue 1, and
+so on, wrapping around if there are more threads than device queues.  With
+FromXDPDevice also reading one queue per thread, packets then leave through
+the queue and UMEM they arrived on.
+
+Keyword arguments MODE, ZEROCOPY, NFRAMES, FRAME_SIZE, and NDESC are as for
+FromXDPDevice, and apply to the whole device.
+
+This element is only available at user level on Linux.
+
+=h count read-only
+
+Returns the number of packets sent.
+
+=h dropped read-only
+
+Returns the number of packets dropped.
+
+=a FromXDPDevice, ToDevice.u, ToDPDKDevice */
+
+class ToXDPDevice : public Element { public:
+
+    ToXDPDevice() CLICK_COLD;
+    ~ToXDPDevice() CLICK_COLD;
+
+    const char *class_name() const { return "ToXDPDevice"; }
+    const char *port_count() const { return PORTS_1_0; }
+    const char *processing() const { return PUSH; }
+    int configure_phase() const { return CONFIGURE_PHASE_PRIVILEGED; }
+
+    int configure(Vector<String> &, ErrorHandler *) CLICK_COLD;
+    int initialize(ErrorHandler *) CLICK_COLD;
+    void cleanup(CleanupStage) CLICK_COLD;
+    void add_handlers() CLICK_COLD;
+
+    void push(int port, Packet *p);
+    void push_batch(int port, PacketBatch &batch);
+
+  private:
+
+    XDPDevice *_dev;
+    Vector<int> _queue_ids;
+    Vector<XDPSocket *> _socks;
+    atomic_uint32_t _count;
+    atomic_uint32_t _dropped;
+
+    enum { h_count, h_dropped };
+    static String read_handler(Element *e, void *thunk) CLICK_COLD;
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -0,0 +1,584 @@
+// -*- c-basic-offset: 4; related-file-name: "xdpdevice.hh" -*-
+/*
+ * xdpdevice.{cc,hh} -- AF_XDP sockets and UMEMs shared by FromXDPDevice and
+ * ToXDPDevice
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/error.hh>
+#include "xdpdevice.hh"
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <linux/if_xdp.h>
+#include <linux/if_link.h>
+#include <linux/bpf.h>
+#include <linux/ethtool.h>
+#include <linux/sockios.h>
+#include <stddef.h>
+
+#ifndef AF_XDP
+# define AF_XDP 44
+#endif
+#ifndef SOL_XDP
+# define SOL_XDP 283
+#endif
+
+CLICK_DECLS
+
+static inline uint32_t
+load_acquire(const uint32_t *x)
+{
+    return __atomic_load_n(x, __ATOMIC_ACQUIRE);
+}
+
+static inline void
+store_release(uint32_t *x, uint32_t v)
+{
+    __atomic_store_n(x, v, __ATOMIC_RELEASE);
+}
+
+static int
+sys_bpf(int cmd, union bpf_attr *attr)
+{
+    return syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+}
+
+
+XDPSocket::XDPSocket(XDPDevice *dev, int queue, bool rx)
+    : _dev(dev), _queue(queue), _fd(-1), _rx(rx), _zerocopy(false),
+      _umem(0), _umem_size(0), _frame_size(dev->_frame_size),
+      _ndesc(dev->_ndesc), _free(0), _nfree(0)
+{
+    memset(&_rx_ring, 0, sizeof(_rx_ring));
+    memset(&_fill, 0, sizeof(_fill));
+    memset(&_tx_ring, 0, sizeof(_tx_ring));
+    memset(&_comp, 0, sizeof(_comp));
+    _refcount = 1;
+}
+
+XDPSocket::~XDPSocket()
+{
+    close();
+    if (_umem)
+        munmap(_umem, _umem_size);
+    delete[] _free;
+}
+
+int
+XDPSocket::map_ring(Ring &ring, unsigned ndesc, unsigned desc_size,
+                    const void *offsets, off_t pgoff, ErrorHandler *errh)
+{
+    const xdp_ring_offset *off = static_cast<const xdp_ring_offset *>(offsets);
+    ring.map_size = off->desc + ndesc * desc_size;
+    void *map = mmap(0, ring.map_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, _fd, pgoff);
+    if (map == MAP_FAILED) {
+        ring.map = 0;
+        return errh->error("%s: mmap ring: %s", _dev->_ifname.c_str(), strerror(errno));
+    }
+    unsigned char *base = static_cast<unsigned char *>(map);
+    ring.map = map;
+    ring.producer = reinterpret_cast<uint32_t *>(base + off->producer);
+    ring.consumer = reinterpret_cast<uint32_t *>(base + off->consumer);
+    ring.flags = reinterpret_cast<uint32_t *>(base + off->flags);
+    ring.desc = base + off->desc;
+    ring.mask = ndesc - 1;
+    ring.cached = 0;
+    return 0;
+}
+
+int
+XDPSocket::open(ErrorHandler *errh)
+{
+    const char *ifname = _dev->_ifname.c_str();
+    unsigned nframes = _dev->_nframes;
+
+    _umem_size = (size_t) nframes * _frame_size;
+    void *umem = mmap(0, _umem_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (umem == MAP_FAILED) {
+        _umem = 0;
+        return errh->error("%s: UMEM: %s", ifname, strerror(errno));
+    }
+    _umem = static_cast<unsigned char *>(umem);
+    _free = new uint64_t[nframes];
+    for (unsigned i = 0; i < nframes; ++i)
+        _free[i] = (uint64_t) (nframes - 1 - i) * _frame_size;
+    _nfree = nframes;
+
+    _fd = socket(AF_XDP, SOCK_RAW, 0);
+    if (_fd < 0)
+        return errh->error("%s: AF_XDP socket: %s", ifname, strerror(errno));
+
+    xdp_umem_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.addr = reinterpret_cast<uintptr_t>(_umem);
+    reg.len = _umem_size;
+    reg.chunk_size = _frame_size;
+    if (setsockopt(_fd, SOL_XDP, XDP_UMEM_REG, &reg, sizeof(reg)) < 0)
+        return errh->error("%s: XDP_UMEM_REG: %s", ifname, strerror(errno));
+
+    int ndesc = _ndesc;
+    if (setsockopt(_fd, SOL_XDP, XDP_UMEM_FILL_RING, &ndesc, sizeof(ndesc)) < 0
+        || setsockopt(_fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &ndesc, sizeof(ndesc)) < 0
+        || (_rx && setsockopt(_fd, SOL_XDP, XDP_RX_RING, &ndesc, sizeof(ndesc)) < 0)
+        || setsockopt(_fd, SOL_XDP, XDP_TX_RING, &ndesc, sizeof(ndesc)) < 0)
+        return errh->error("%s: XDP ring setup: %s", ifname, strerror(errno));
+
+    xdp_mmap_offsets off;
+    socklen_t optlen = sizeof(off);
+    if (getsockopt(_fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen) < 0)
+        return errh->error("%s: XDP_MMAP_OFFSETS: %s", ifname, strerror(errno));
+    if (map_ring(_fill, _ndesc, sizeof(uint64_t), &off.fr, XDP_UMEM_PGOFF_FILL_RING, errh) < 0
+        || map_ring(_comp, _ndesc, sizeof(uint64_t), &off.cr, XDP_UMEM_PGOFF_COMPLETION_RING, errh) < 0
+        || (_rx && map_ring(_rx_ring, _ndesc, sizeof(xdp_desc), &off.rx, XDP_PGOFF_RX_RING, errh) < 0)
+        || map_ring(_tx_ring, _ndesc, sizeof(xdp_desc), &off.tx, XDP_PGOFF_TX_RING, errh) < 0)
+        return -1;
+
+    sockaddr_xdp sxdp;
+    memset(&sxdp, 0, sizeof(sxdp));
+    sxdp.sxdp_family = AF_XDP;
+    sxdp.sxdp_ifindex = _dev->_ifindex;
+    sxdp.sxdp_queue_id = _queue;
+    sxdp.sxdp_flags = XDP_USE_NEED_WAKEUP;
+    // Generic XDP cannot feed a zero-copy socket, so SKB mode means copy
+    // mode unless zero copy was requested explicitly.
+    if (_dev->_zerocopy > 0)
+        sxdp.sxdp_flags |= XDP_ZEROCOPY;
+    else if (_dev->_zerocopy == 0 || _dev->_mode == XDPDevice::mode_skb)
+        sxdp.sxdp_flags |= XDP_COPY;
+    if (bind(_fd, reinterpret_cast<sockaddr *>(&sxdp), sizeof(sxdp)) < 0)
+        return errh->error("%s: bind queue %d: %s", ifname, _queue, strerror(errno));
+
+#ifdef XDP_OPTIONS_ZEROCOPY
+    xdp_options opts;
+    optlen = sizeof(opts);
+    if (getsockopt(_fd, SOL_XDP, XDP_OPTIONS, &opts, &optlen) == 0)
+        _zerocopy = (opts.flags & XDP_OPTIONS_ZEROCOPY) != 0;
+#endif
+
+    if (_rx)
+        refill();
+    return 0;
+}
+
+void
+XDPSocket::close()
+{
+    Ring *rings[] = { &_rx_ring, &_fill, &_tx_ring, &_comp };
+    for (int i = 0; i < 4; ++i)
+        if (rings[i]->map) {
+            munmap(rings[i]->map, rings[i]->map_size);
+            rings[i]->map = 0;
+        }
+    if (_fd >= 0)
+        ::close(_fd);
+    _fd = -1;
+}
+
+void
+XDPSocket::unuse()
+{
+    if (_refcount.dec_and_test())
+        delete this;
+}
+
+inline void
+XDPSocket::release(uint64_t addr)
+{
+    _free[_nfree++] = addr & ~(uint64_t) (_frame_size - 1);
+}
+
+inline void
+XDPSocket::reap_completions()
+{
+    uint32_t n = load_acquire(_comp.producer) - _comp.cached;
+    if (n) {
+        const uint64_t *addrs = static_cast<const uint64_t *>(_comp.desc);
+        for (uint32_t i = 0; i < n; ++i)
+            release(addrs[(_comp.cached + i) & _comp.mask]);
+        _comp.cached += n;
+        store_release(_comp.consumer, _comp.cached);
+    }
+}
+
+inline void
+XDPSocket::wakeup_tx()
+{
+    // In copy mode the kernel transmits from sendto(); in zero-copy mode
+    // the driver only needs a kick when it says so.
+    if (!_zerocopy || (load_acquire(_tx_ring.flags) & XDP_RING_NEED_WAKEUP))
+        sendto(_fd, 0, 0, MSG_DONTWAIT, 0, 0);
+}
+
+void
+XDPSocket::free_frame(unsigned char *buf, size_t, void *arg)
+{
+    XDPSocket *s = static_cast<XDPSocket *>(arg);
+    s->_lock.acquire();
+    s->release(buf - s->_umem);
+    s->_lock.release();
+    s->unuse();
+}
+
+/** @brief Hand free frames to the kernel through the fill ring.
+ *
+ * Also recycles frames whose transmission has completed.  Returns false if
+ * the kernel has no frame left to receive into, which happens when Click
+ * holds every frame; the caller should then retry later. */
+bool
+XDPSocket::refill()
+{
+    _lock.acquire();
+    reap_completions();
+    uint32_t held = _fill.cached - load_acquire(_fill.consumer);
+    uint32_t n = _ndesc - held;
+    if (n > _nfree)
+        n = _nfree;
+    if (n) {
+        uint64_t *addrs = static_cast<uint64_t *>(_fill.desc);
+        for (uint32_t i = 0; i < n; ++i)
+            addrs[(_fill.cached + i) & _fill.mask] = _free[--_nfree];
+        _fill.cached += n;
+        store_release(_fill.producer, _fill.cached);
+        held += n;
+    }
+    _lock.release();
+    if (n && (load_acquire(_fill.flags) & XDP_RING_NEED_WAKEUP))
+        recvfrom(_fd, 0, 0, MSG_DONTWAIT, 0, 0);
+    return held != 0;
+}
+
+/** @brief Receive up to @a max packets into @a batch.
+ *
+ * The packets wrap UMEM frames directly.  Each frame returns to the socket
+ * when its packet is freed. */
+unsigned
+XDPSocket::receive(PacketBatch &batch, unsigned max)
+{
+    uint32_t n = load_acquire(_rx_ring.producer) - _rx_ring.cached;
+    if (n > max)
+        n = max;
+    if (!n)
+        return 0;
+    const xdp_desc *descs = static_cast<const xdp_desc *>(_rx_ring.desc);
+    _refcount += n;
+    unsigned got = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        const xdp_desc &d = descs[(_rx_ring.cached + i) & _rx_ring.mask];
+        unsigned char *data = _umem + d.addr;
+        unsigned offset = d.addr & (_frame_size - 1);
+        WritablePacket *p = Packet::make(data, d.len, free_frame, this,
+                                         offset, _frame_size - offset - d.len);
+        if (!p) {
+            free_frame(data - offset, 0, this);
+            continue;
+        }
+        p->set_packet_type_anno(Packet::HOST);
+        p->set_mac_header(data);
+        batch.append(p);
+        ++got;
+    }
+    _rx_ring.cached += n;
+    store_release(_rx_ring.consumer, _rx_ring.cached);
+    return got;
+}
+
+/** @brief Transmit the packets in @a batch.
+ *
+ * A packet that wraps one of this socket's frames is sent without copying;
+ * other packets are copied into free frames.  Packets that do not fit in a
+ * frame, or that find the transmit ring or the UMEM full, are moved to
+ * @a dropped.  Returns the number of packets queued for transmission. */
+unsigned
+XDPSocket::send(PacketBatch &batch, PacketBatch &dropped)
+{
+    _lock.acquire();
+    reap_completions();
+    uint32_t space = _ndesc - (_tx_ring.cached - load_acquire(_tx_ring.consumer));
+    xdp_desc *descs = static_cast<xdp_desc *>(_tx_ring.desc);
+    unsigned sent = 0;
+    while (Packet *p = batch.pop_front()) {
+        uint64_t addr;
+        uint32_t len = p->length();
+        if (!space || len > _frame_size) {
+            dropped.append(p);
+            continue;
+        } else if (p->buffer_destructor() == free_frame
+                   && p->destructor_argument() == this && !p->shared()) {
+            // the frame now belongs to the transmit ring
+            addr = p->data() - _umem;
+            p->reset_buffer();
+            --_refcount;
+        } else if (_nfree) {
+            addr = _free[--_nfree];
+            memcpy(_umem + addr, p->data(), len);
+        } else {
+            dropped.append(p);
+            continue;
+        }
+        xdp_desc &d = descs[_tx_ring.cached & _tx_ring.mask];
+        d.addr = addr;
+        d.len = len;
+        d.options = 0;
+        ++_tx_ring.cached;
+        --space;
+        ++sent;
+        p->kill();
+    }
+    if (sent) {
+        store_release(_tx_ring.producer, _tx_ring.cached);
+        wakeup_tx();
+    }
+    _lock.release();
+    return sent;
+}
+
+/** @brief Return the number of packets the kernel dropped for this socket,
+ * or -1 if unknown. */
+long long
+XDPSocket::kernel_drops() const
+{
+    xdp_statistics stats;
+    socklen_t optlen = sizeof(stats);
+    if (_fd < 0 || getsockopt(_fd, SOL_XDP, XDP_STATISTICS, &stats, &optlen) < 0)
+        return -1;
+    long long drops = stats.rx_dropped;
+    // older kernels do not report rx_ring_full
+    if (optlen >= offsetof(xdp_statistics, rx_fill_ring_empty_descs))
+        drops += stats.rx_ring_full;
+    return drops;
+}
+
+
+Vector<XDPDevice *> XDPDevice::_devs;
+
+XDPDevice::XDPDevice(const String &ifname)
+    : _ifname(ifname), _ifindex(0), _nqueues(1), _refcount(0),
+      _initialized(false), _mode(mode_auto), _zerocopy(-1),
+      _nframes(DEF_NFRAMES), _frame_size(DEF_FRAME_SIZE), _ndesc(DEF_NDESC),
+      _map_fd(-1), _prog_fd(-1), _link_fd(-1)
+{
+}
+
+XDPDevice::~XDPDevice()
+{
+    // Closing the link detaches the XDP program.
+    if (_link_fd >= 0)
+        close(_link_fd);
+    if (_prog_fd >= 0)
+        close(_prog_fd);
+    if (_map_fd >= 0)
+        close(_map_fd);
+    // Packets may still hold UMEM frames; the sockets free themselves once
+    // the last one is gone.
+    for (int i = 0; i < _sockets.size(); ++i)
+        if (XDPSocket *s = _sockets[i]) {
+            s->close();
+            s->unuse();
+        }
+}
+
+/** @brief Return the XDPDevice for interface @a ifname.
+ *
+ * The caller holds a reference and must release it with unuse(). */
+XDPDevice *
+XDPDevice::get(const String &ifname, ErrorHandler *errh)
+{
+    XDPDevice *dev = 0;
+    for (int i = 0; i < _devs.size() && !dev; ++i)
+        if (_devs[i]->_ifname == ifname)
+            dev = _devs[i];
+    if (!dev) {
+        int ifindex = if_nametoindex(ifname.c_str());
+        if (!ifindex) {
+            errh->error("%s: unknown device", ifname.c_str());
+            return 0;
+        }
+        dev = new XDPDevice(ifname);
+        dev->_ifindex = ifindex;
+
+        // The XDP program can only redirect from the device's receive
+        // queues, so find out how many there are.
+        int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+        ethtool_channels ch;
+        memset(&ch, 0, sizeof(ch));
+        ch.cmd = ETHTOOL_GCHANNELS;
+        ifreq ifr;
+        memset(&ifr, 0, sizeof(ifr));
+        strncpy(ifr.ifr_name, ifname.c_str(), sizeof(ifr.ifr_name) - 1);
+        ifr.ifr_data = reinterpret_cast<char *>(&ch);
+        if (fd >= 0 && ioctl(fd, SIOCETHTOOL, &ifr) == 0) {
+            int n = ch.combined_count > ch.rx_count ? ch.combined_count : ch.rx_count;
+            if (n > 0)
+                dev->_nqueues = n;
+        }
+        if (fd >= 0)
+            close(fd);
+        _devs.push_back(dev);
+    }
+    ++dev->_refcount;
+    return dev;
+}
+
+void
+XDPDevice::unuse()
+{
+    if (--_refcount == 0) {
+        for (int i = 0; i < _devs.size(); ++i)
+            if (_devs[i] == this) {
+                _devs[i] = _devs.back();
+                _devs.pop_back();
+                break;
+            }
+        delete this;
+    }
+}
+
+/** @brief Declare that an element uses queue @a queue.
+ *
+ * At most one receiver may use each queue.  Call before initialize(). */
+int
+XDPDevice::add_queue(int queue, bool rx, ErrorHandler *errh)
+{
+    if (queue < 0 || queue >= _nqueues)
+        return errh->error("%s: queue %d out of range (device has %d)", _ifname.c_str(), queue, _nqueues);
+    if (_initialized)
+        return errh->error("%s: device already initialized", _ifname.c_str());
+    if (_queue_flags.size() <= queue)
+        _queue_flags.resize(queue + 1, 0);
+    if (rx && (_queue_flags[queue] & queue_rx))
+        return errh->error("%s: queue %d already has a receiver", _ifname.c_str(), queue);
+    _queue_flags[queue] |= queue_used | (rx ? queue_rx : 0);
+    return 0;
+}
+
+int
+XDPDevice::attach_program(ErrorHandler *errh)
+{
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_type = BPF_MAP_TYPE_XSKMAP;
+    attr.key_size = sizeof(int);
+    attr.value_size = sizeof(int);
+    attr.max_entries = _nqueues;
+    if ((_map_fd = sys_bpf(BPF_MAP_CREATE, &attr)) < 0)
+        return errh->error("%s: XSKMAP: %s", _ifname.c_str(), strerror(errno));
+
+    for (int q = 0; q < _sockets.size(); ++q)
+        if (_sockets[q] && (_queue_flags[q] & queue_rx)) {
+            int key = q, value = _sockets[q]->fd();
+            memset(&attr, 0, sizeof(attr));
+            attr.map_fd = _map_fd;
+            attr.key = reinterpret_cast<uintptr_t>(&key);
+            attr.value = reinterpret_cast<uintptr_t>(&value);
+            attr.flags = BPF_ANY;
+            if (sys_bpf(BPF_MAP_UPDATE_ELEM, &attr) < 0)
+                return errh->error("%s: XSKMAP update: %s", _ifname.c_str(), strerror(errno));
+        }
+
+    // return bpf_redirect_map(&xsks, ctx->rx_queue_index, XDP_PASS);
+    struct bpf_insn prog[] = {
+        { BPF_LDX | BPF_W | BPF_MEM, BPF_REG_2, BPF_REG_1,
+          offsetof(struct xdp_md, rx_queue_index), 0 },
+        { BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0, _map_fd },
+        { 0, 0, 0, 0, 0 },
+        { BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_3, 0, 0, XDP_PASS },
+        { BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map },
+        { BPF_JMP | BPF_EXIT, 0, 0, 0, 0 }
+    };
+    static const char license[] = "Dual BSD/GPL";
+    memset(&attr, 0, sizeof(attr));
+    attr.prog_type = BPF_PROG_TYPE_XDP;
+    attr.insns = reinterpret_cast<uintptr_t>(prog);
+    attr.insn_cnt = sizeof(prog) / sizeof(prog[0]);
+    attr.license = reinterpret_cast<uintptr_t>(license);
+    if ((_prog_fd = sys_bpf(BPF_PROG_LOAD, &attr)) < 0)
+        return errh->error("%s: XDP program: %s", _ifname.c_str(), strerror(errno));
+
+    memset(&attr, 0, sizeof(attr));
+    attr.link_create.prog_fd = _prog_fd;
+    attr.link_create.target_ifindex = _ifindex;
+    attr.link_create.attach_type = BPF_XDP;
+    if (_mode == mode_skb)
+        attr.link_create.flags = XDP_FLAGS_SKB_MODE;
+    else if (_mode == mode_drv)
+        attr.link_create.flags = XDP_FLAGS_DRV_MODE;
+    if ((_link_fd = sys_bpf(BPF_LINK_CREATE, &attr)) < 0)
+        return errh->error("%s: attach XDP program: %s", _ifname.c_str(), strerror(errno));
+    return 0;
+}
+
+/** @brief Open the sockets for every declared queue and attach the XDP
+ * program.
+ *
+ * Only the first call does anything. */
+int
+XDPDevice::initialize(ErrorHandler *errh)
+{
+    if (_initialized)
+        return 0;
+    _initialized = true;
+
+    if (_frame_size < 2048 || (_frame_size & (_frame_size - 1))
+        || _frame_size > (unsigned) sysconf(_SC_PAGESIZE))
+        return errh->error("%s: FRAME_SIZE must be a power of two between 2048 and the page size", _ifname.c_str());
+    if (_ndesc == 0 || (_ndesc & (_ndesc - 1)))
+        return errh->error("%s: NDESC must be a power of two", _ifname.c_str());
+    if (_nframes < 2 * _ndesc)
+        return errh->error("%s: NFRAMES must be at least twice NDESC", _ifname.c_str());
+
+    bool any_rx = false;
+    _sockets.resize(_queue_flags.size(), 0);
+    for (int q = 0; q < _queue_flags.size(); ++q)
+        if (_queue_flags[q] & queue_used) {
+            bool rx = _queue_flags[q] & queue_rx;
+            _sockets[q] = new XDPSocket(this, q, rx);
+            if (_sockets[q]->open(errh) < 0)
+                return -1;
+            any_rx |= rx;
+        }
+    if (any_rx)
+        return attach_program(errh);
+    return 0;
+}
+
+bool
+XDPDevice::parse_mode(const String &str, int &mode)
+{
+    if (str == "AUTO")
+        mode = mode_auto;
+    else if (str == "SKB")
+        mode = mode_skb;
+    else if (str == "DRV")
+        mode = mode_drv;
+    else
+        return false;
+    return true;
+}
+
+const char *
+XDPDevice::unparse_mode(int mode)
+{
+    static const char * const names[] = { "AUTO", "SKB", "DRV" };
+    return names[mode];
+}
+
+CLICK_ENDDECLS
+ELEMENT_REQUIRES(userlevel xdp)
+ELEMENT_PROVIDES(XDPDevice)
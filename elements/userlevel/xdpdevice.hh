@@ -0,0 +1,173 @@
+#ifndef CLICK_XDPDEVICE_HH
+#define CLICK_XDPDEVICE_HH
+#include <click/packetbatch.hh>
+#include <click/string.hh>
+#include <click/vector.hh>
+#include <click/atomic.hh>
+#include <click/sync.hh>
+CLICK_DECLS
+class ErrorHandler;
+class XDPDevice;
+
+/** @class XDPSocket
+ * @brief One AF_XDP socket bound to one device queue, with its own UMEM.
+ *
+ * The receive side (receive() and refill()) must only be used by one thread
+ * at a time.  The transmit side and frame recycling are protected by a
+ * spinlock, so any thread may send() or free a packet that wraps one of the
+ * socket's frames. */
+class XDPSocket { public:
+
+    int fd() const {
+        return _fd;
+    }
+    int queue() const {
+        return _queue;
+    }
+    bool zerocopy() const {
+        return _zerocopy;
+    }
+
+    unsigned receive(PacketBatch &batch, unsigned max);
+    bool refill();
+    unsigned send(PacketBatch &batch, PacketBatch &dropped);
+
+    long long kernel_drops() const;
+
+    static void free_frame(unsigned char *buf, size_t size, void *arg);
+
+  private:
+
+    struct Ring {
+        uint32_t *producer;
+        uint32_t *consumer;
+        uint32_t *flags;
+        void *desc;
+        uint32_t mask;
+        uint32_t cached;
+        void *map;
+        size_t map_size;
+    };
+
+    XDPDevice *_dev;
+    int _queue;
+    int _fd;
+    bool _rx;
+    bool _zerocopy;
+
+    unsigned char *_umem;
+    size_t _umem_size;
+    unsigned _frame_size;
+    unsigned _ndesc;
+
+    Ring _rx_ring;
+    Ring _fill;
+    Ring _tx_ring;
+    Ring _comp;
+
+    Spinlock _lock;
+    uint64_t *_free;
+    unsigned _nfree;
+    atomic_uint32_t _refcount;
+
+    XDPSocket(XDPDevice *dev, int queue, bool rx);
+    ~XDPSocket();
+
+    int open(ErrorHandler *errh);
+    int map_ring(Ring &ring, unsigned ndesc, unsigned desc_size,
+                 const void *offsets, off_t pgoff, ErrorHandler *errh);
+    void close();
+    void unuse();
+
+    inline void release(uint64_t addr);
+    inline void reap_completions();
+    inline void wakeup_tx();
+
+    friend class XDPDevice;
+
+};
+
+/** @class XDPDevice
+ * @brief The AF_XDP state of one network interface.
+ *
+ * FromXDPDevice and ToXDPDevice elements share an XDPDevice per interface.
+ * During configuration, each element declares the queues it needs with
+ * add_queue().  The first initialize() call opens one XDPSocket per queue and
+ * attaches an XDP program that redirects every received packet on those
+ * queues to its socket.  Packets on other queues go to the kernel stack as
+ * usual. */
+class XDPDevice { public:
+
+    enum { mode_auto = 0, mode_skb, mode_drv };
+
+    static XDPDevice *get(const String &ifname, ErrorHandler *errh);
+    void unuse();
+
+    const String &ifname() const {
+        return _ifname;
+    }
+    int nqueues() const {
+        return _nqueues;
+    }
+
+    void set_mode(int mode) {
+        _mode = mode;
+    }
+    void set_zerocopy(int zerocopy) {
+        _zerocopy = zerocopy;
+    }
+    void set_frames(unsigned nframes, unsigned frame_size) {
+        _nframes = nframes;
+        _frame_size = frame_size;
+    }
+    void set_ndesc(unsigned ndesc) {
+        _ndesc = ndesc;
+    }
+
+    int add_queue(int queue, bool rx, ErrorHandler *errh);
+    int initialize(ErrorHandler *errh);
+    XDPSocket *socket(int queue) const {
+        return queue < _sockets.size() ? _sockets[queue] : 0;
+    }
+
+    static bool parse_mode(const String &str, int &mode);
+    static const char *unparse_mode(int mode);
+
+    static const unsigned DEF_NFRAMES = 4096;
+    static const unsigned DEF_FRAME_SIZE = 4096;
+    static const unsigned DEF_NDESC = 1024;
+
+  private:
+
+    String _ifname;
+    int _ifindex;
+    int _nqueues;
+    int _refcount;
+    bool _initialized;
+
+    int _mode;
+    int _zerocopy;
+    unsigned _nframes;
+    unsigned _frame_size;
+    unsigned _ndesc;
+
+    enum { queue_used = 1, queue_rx = 2 };
+    Vector<int> _queue_flags;
+    Vector<XDPSocket *> _sockets;
+    int _map_fd;
+    int _prog_fd;
+    int _link_fd;
+
+    static Vector<XDPDevice *> _devs;
+
+    XDPDevice(const String &ifname);
+    ~XDPDevice();
+
+    int attach_program(ErrorHandler *errh);
+
+    friend class XDPSocket;
+
+};
+
+CLICK_ENDDECLS
+#endif
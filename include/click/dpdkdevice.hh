@@ -66,6 +66,8 @@ public:
     EtherAddress get_mac();
     void set_init_mac(EtherAddress mac);
     void set_init_mtu(uint16_t mtu);
+    int set_init_rss(const String &key, uint64_t hash_fields,
+                     ErrorHandler *errh) CLICK_COLD;
 
     unsigned int get_nb_txdesc();
     int nbRXQueues();
@@ -118,7 +120,8 @@ private:
     struct DevInfo {
         inline DevInfo() :
             rx_queues(0,false), tx_queues(0,false), promisc(false), n_rx_descs(0),
-            n_tx_descs(0), init_mac(), init_mtu(0) {
+            n_tx_descs(0), init_mac(), init_mtu(0), rss_set(false),
+            rss_hash_fields(ETH_RSS_IP | ETH_RSS_UDP | ETH_RSS_TCP) {
             rx_queues.reserve(128);
             tx_queues.reserve(128);
         }
@@ -131,6 +134,9 @@ private:
         unsigned n_tx_descs;
         EtherAddress init_mac;
         uint16_t init_mtu;
+        bool rss_set;
+        String rss_key;
+        uint64_t rss_hash_fields;
     };
 
     DevInfo info;
@@ -2,9 +2,11 @@
 #ifndef CLICK_ELEMENT_HH
 #define CLICK_ELEMENT_HH
 #include <click/glue.hh>
+#include <click/atomic.hh>
 #include <click/vector.hh>
 #include <click/string.hh>
 #include <click/packet.hh>
+#include <click/packetbatch.hh>
 #include <click/handler.hh>
 CLICK_DECLS
 class Router;
@@ -37,6 +39,9 @@ class Element { public:
     virtual Packet *pull(int port) CLICK_WARN_UNUSED_RESULT;
     virtual Packet *simple_action(Packet *p);
 
+    virtual void push_batch(int port, PacketBatch &batch);
+    virtual int pull_batch(int port, PacketBatch &batch, int max);
+
     virtual bool run_task(Task *task);  // return true iff did useful work
     virtual void run_timer(Timer *timer);
 #if CLICK_USERLEVEL
@@ -47,6 +52,7 @@ class Element { public:
 
     inline void checked_output_push(int port, Packet *p) const;
     inline Packet* checked_input_pull(int port) const;
+    inline void checked_output_push_batch(int port, PacketBatch &batch) const;
 
     // ELEMENT CHARACTERISTICS
     virtual const char *class_name() const = 0;
@@ -220,6 +226,9 @@ class Element { public:
         inline void push(Packet* p) const;
         inline Packet* pull() const;
 
+        inline void push_batch(PacketBatch& batch) const;
+        inline int pull_batch(PacketBatch& batch, int max) const;
+
 #if CLICK_STATS >= 1
         unsigned npackets() const       { return _packets; }
 #endif
@@ -247,6 +256,13 @@ class Element { public:
         inline Port();
         inline void assign(bool isoutput, Element *owner, Element *e, int port);
 
+        inline void raw_push(Packet *p) const;
+        inline Packet *raw_pull() const;
+        void profile_push(Packet *p) const;
+        Packet *profile_pull() const;
+        void profile_push_batch(PacketBatch &batch) const;
+        int profile_pull_batch(PacketBatch &batch, int max) const;
+
         friend class Element;
 
     };
@@ -269,6 +285,8 @@ class Element { public:
     Router* _router;
     int _eindex;
 
+    static atomic_uint32_t nprofiling;  // number of routers profiling
+
 #if CLICK_STATS >= 2
     // STATISTICS
     unsigned _xfer_calls;       // Push and pull calls into this element.
@@ -307,8 +325,8 @@ class Element { public:
     inline void add_data_handlers(const char *name, int flags, HandlerCallback callback, void *data);
 
     friend class Router;
-#if CLICK_STATS >= 2
     friend class Task;
+#if CLICK_STATS >= 2
     friend class Master;
     friend class TimerSet;
 # if CLICK_USERLEVEL
@@ -556,6 +574,26 @@ Element::Port::assign(bool isoutput, Element *owner, Element *e, int port)
     assign(isoutput, e, port);
 }
 
+inline void
+Element::Port::raw_push(Packet *p) const
+{
+#if HAVE_BOUND_PORT_TRANSFER
+    _bound.push(_e, _port, p);
+#else
+    _e->push(_port, p);
+#endif
+}
+
+inline Packet *
+Element::Port::raw_pull() const
+{
+#if HAVE_BOUND_PORT_TRANSFER
+    return _bound.pull(_e, _port);
+#else
+    return _e->pull(_port);
+#endif
+}
+
 /** @brief Returns whether this port is active (a push output or a pull input).
  *
  * @sa Element::port_active
@@ -616,22 +654,20 @@ Element::Port::push(Packet* p) const
     ++_e->input(_port)._packets;
     click_cycles_t start_cycles = click_get_cycles(),
         start_child_cycles = _e->_child_cycles;
-# if HAVE_BOUND_PORT_TRANSFER
-    _bound.push(_e, _port, p);
-# else
-    _e->push(_port, p);
-# endif
+    if (unlikely(nprofiling.value()))
+        profile_push(p);
+    else
+        raw_push(p);
     click_cycles_t all_delta = click_get_cycles() - start_cycles,
         own_delta = all_delta - (_e->_child_cycles - start_child_cycles);
     _e->_xfer_calls += 1;
     _e->_xfer_own_cycles += own_delta;
     _owner->_child_cycles += all_delta;
 #else
-# if HAVE_BOUND_PORT_TRANSFER
-    _bound.push(_e, _port, p);
-# else
-    _e->push(_port, p);
-# endif
+    if (unlikely(nprofiling.value()))
+        profile_push(p);
+    else
+        raw_push(p);
 #endif
 }
 
@@ -658,11 +694,7 @@ Element::Port::pull() const
 #if CLICK_STATS >= 2
     click_cycles_t start_cycles = click_get_cycles(),
         old_child_cycles = _e->_child_cycles;
-# if HAVE_BOUND_PORT_TRANSFER
-    Packet *p = _bound.pull(_e, _port);
-# else
-    Packet *p = _e->pull(_port);
-# endif
+    Packet *p = unlikely(nprofiling.value()) ? profile_pull() : raw_pull();
     if (p)
         _e->output(_port)._packets += 1;
     click_cycles_t all_delta = click_get_cycles() - start_cycles,
@@ -671,11 +703,7 @@ Element::Port::pull() const
     _e->_xfer_own_cycles += own_delta;
     _owner->_child_cycles += all_delta;
 #else
-# if HAVE_BOUND_PORT_TRANSFER
-    Packet *p = _bound.pull(_e, _port);
-# else
-    Packet *p = _e->pull(_port);
-# endif
+    Packet *p = unlikely(nprofiling.value()) ? profile_pull() : raw_pull();
 #endif
 #if CLICK_STATS >= 1
     if (p)
@@ -684,6 +712,83 @@ Element::Port::pull() const
     return p;
 }
 
+/** @brief Push the packets in @a batch over this port.
+ *
+ * Pushes every packet in @a batch downstream by passing the whole batch to
+ * the next element's @link Element::push_batch() push_batch() @endlink
+ * function.  Elements that do not handle batches natively process the
+ * packets one at a time through push(), so this is always equivalent to
+ * pushing each packet of @a batch in order.
+ *
+ * This port must be an active() push output port.  When push_batch()
+ * returns, @a batch is empty; as with push(), the caller relinquishes
+ * control of its packets.
+ */
+inline void
+Element::Port::push_batch(PacketBatch& batch) const
+{
+    assert(_e);
+    if (batch.empty())
+        return;
+#if CLICK_STATS >= 1
+    _packets += batch.count();
+#endif
+#if CLICK_STATS >= 2
+    _e->input(_port)._packets += batch.count();
+    click_cycles_t start_cycles = click_get_cycles(),
+        start_child_cycles = _e->_child_cycles;
+    if (unlikely(nprofiling.value()))
+        profile_push_batch(batch);
+    else
+        _e->push_batch(_port, batch);
+    click_cycles_t all_delta = click_get_cycles() - start_cycles,
+        own_delta = all_delta - (_e->_child_cycles - start_child_cycles);
+    _e->_xfer_calls += 1;
+    _e->_xfer_own_cycles += own_delta;
+    _owner->_child_cycles += all_delta;
+#else
+    if (unlikely(nprofiling.value()))
+        profile_push_batch(batch);
+    else
+        _e->push_batch(_port, batch);
+#endif
+    assert(batch.empty());
+}
+
+/** @brief Pull up to @a max packets over this port into @a batch.
+ *
+ * Calls the previous element's @link Element::pull_batch() pull_batch()
+ * @endlink function, which appends at most @a max packets to the end of
+ * @a batch.  Returns the number of packets appended; 0 means that no packet
+ * was available, just as a null return from pull() does.
+ *
+ * This port must be an active() pull input port.
+ */
+inline int
+Element::Port::pull_batch(PacketBatch& batch, int max) const
+{
+    assert(_e);
+#if CLICK_STATS >= 2
+    click_cycles_t start_cycles = click_get_cycles(),
+        old_child_cycles = _e->_child_cycles;
+    int n = unlikely(nprofiling.value()) ? profile_pull_batch(batch, max)
+        : _e->pull_batch(_port, batch, max);
+    _e->output(_port)._packets += n;
+    click_cycles_t all_delta = click_get_cycles() - start_cycles,
+        own_delta = all_delta - (_e->_child_cycles - old_child_cycles);
+    _e->_xfer_calls += 1;
+    _e->_xfer_own_cycles += own_delta;
+    _owner->_child_cycles += all_delta;
+#else
+    int n = unlikely(nprofiling.value()) ? profile_pull_batch(batch, max)
+        : _e->pull_batch(_port, batch, max);
+#endif
+#if CLICK_STATS >= 1
+    _packets += n;
+#endif
+    return n;
+}
+
 /** @brief Push packet @a p to output @a port, or kill it if @a port is out of
  * range.
  *
@@ -724,6 +829,27 @@ Element::checked_input_pull(int port) const
         return 0;
 }
 
+/** @brief Push @a batch to output @a port, or kill its packets if @a port
+ * is out of range.
+ *
+ * @param port output port number
+ * @param batch packets to push
+ *
+ * The batch analogue of checked_output_push().  On return, @a batch is
+ * empty.
+ *
+ * @note It is invalid to call checked_output_push_batch() on a pull output
+ * @a port.
+ */
+inline void
+Element::checked_output_push_batch(int port, PacketBatch& batch) const
+{
+    if ((unsigned) port < (unsigned) noutputs())
+        _ports[1][port].push_batch(batch);
+    else
+        batch.kill();
+}
+
 #undef PORT_ASSIGN
 CLICK_ENDDECLS
 #endif
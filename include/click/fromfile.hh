@@ -3,12 +3,14 @@
 #define CLICK_FROMFILE_HH
 #include <click/string.hh>
 #include <click/vector.hh>
+#include <click/atomic.hh>
 #include <stdio.h>
 CLICK_DECLS
 class ErrorHandler;
 class Element;
 class Packet;
 class WritablePacket;
+class IOUring;
 
 class FromFile { public:
 
@@ -29,6 +31,8 @@ class FromFile { public:
     off_t file_pos() const		{ return _file_offset + _pos; }
 
     int configure_keywords(Vector<String>& conf, Element* e, ErrorHandler* errh);
+    void set_io_uring(IOUring *ring);
+    IOUring *io_uring() const		{ return _ring; }
     int set_data(const String& data, ErrorHandler* errh);
     int initialize(ErrorHandler* errh, bool allow_nonexistent = false);
     void add_handlers(Element* e, bool filepos_writable = false) const;
@@ -67,11 +71,35 @@ class FromFile { public:
 #endif
 
 #ifdef ALLOW_MMAP
-    enum { WANT_MMAP_UNIT = 4194304 }; // 4 MB
+    // The whole file is mapped at once; the buffer is a window onto the
+    // mapping.  Windows share the mapping, which is unmapped once the last
+    // packet referring to it dies.
+    struct Mapping {
+	unsigned char *data;
+	size_t length;
+	atomic_uint32_t refcount;
+    };
+    enum { WANT_MMAP_UNIT = 67108864, DEFAULT_PREFETCH = 16777216 }; // 64 MB, 16 MB
     size_t _mmap_unit;
     off_t _mmap_off;
+    Mapping *_mapping;
+    size_t _prefetch;
+    off_t _prefetched;
 #endif
 
+    // With an io_uring, the next buffer is read while the current one is
+    // parsed.  Reads are at explicit offsets, so the file descriptor's
+    // position is not used.
+    struct ReadAhead {
+	WritablePacket *packet;
+	off_t offset;
+	int result;
+	bool busy;
+    };
+    enum { IO_URING_BUFFER_SIZE = 262144 };
+    IOUring *_ring;
+    ReadAhead _ahead;
+
     String _filename;
     FILE *_pipe;
     off_t _file_offset;
@@ -80,7 +108,14 @@ class FromFile { public:
 
 #ifdef ALLOW_MMAP
     int read_buffer_mmap(ErrorHandler *);
+    bool set_mmap_window(off_t);
+    static void mapping_destructor(unsigned char *, size_t, void *);
 #endif
+    inline bool have_mmap(size_t size);
+    int read_buffer_io_uring(ErrorHandler *);
+    void start_read_ahead(off_t);
+    void finish_read_ahead();
+    static void read_done(int, void *);
     int read_buffer(ErrorHandler *);
     bool read_packet(ErrorHandler *);
     int skip_ahead(ErrorHandler *);
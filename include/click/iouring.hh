@@ -0,0 +1,151 @@
+// -*- c-basic-offset: 4; related-file-name: "../../lib/iouring.cc" -*-
+#ifndef CLICK_IOURING_HH
+#define CLICK_IOURING_HH 1
+#if !CLICK_USERLEVEL
+# error "<click/iouring.hh> only meaningful at user level"
+#endif
+#include <click/vector.hh>
+#include <sys/types.h>
+struct msghdr;
+struct io_uring_sqe;
+struct io_uring_cqe;
+CLICK_DECLS
+
+/** @file <click/iouring.hh>
+ * @brief An io_uring asynchronous I/O engine.
+ */
+
+/** @class IOUring
+ * @brief A RouterThread's io_uring asynchronous I/O engine.
+ *
+ * Elements use an IOUring to read, write, and send and receive messages
+ * without blocking the thread that forwards packets.  Each RouterThread owns
+ * at most one IOUring, returned by RouterThread::io_uring().  Requests are
+ * queued by read(), write(), recvmsg() and sendmsg(), handed to the kernel
+ * in batches, and completed asynchronously.  The RouterThread reaps
+ * completions in its driver loop, next to its tasks and timers, and calls
+ * each request's callback there with the system call's result (a byte count
+ * or a negative errno).
+ *
+ * An IOUring is not thread safe.  Requests must be submitted on the thread
+ * that owns the IOUring, and their callbacks run on that thread.  Buffers
+ * and message headers must stay valid until the callback runs.  An element
+ * with outstanding requests must call wait() or cancel() in its cleanup()
+ * method.
+ *
+ * IOUring is only available on Linux systems with <linux/io_uring.h>.
+ */
+class IOUring { public:
+
+    /** @brief Type of completion callbacks.
+     * @param result system call result, or negative errno
+     * @param user_data the request's user data */
+    typedef void (*Callback)(int result, void *user_data);
+
+    IOUring();
+    ~IOUring();
+
+    /** @brief Set up the io_uring with room for @a entries requests.
+     * @param entries submission queue size
+     * @param wake_fd eventfd to signal on completions, or -1
+     * @return 0 on success, negative errno on failure */
+    int initialize(unsigned entries, int wake_fd);
+
+    /** @brief Return true iff the io_uring was successfully set up. */
+    bool initialized() const {
+	return _fd >= 0;
+    }
+
+    /** @brief Return the number of requests awaiting completion. */
+    unsigned inflight() const {
+	return _inflight;
+    }
+
+    /** @brief Queue a read of @a len bytes from @a fd at @a offset.
+     *
+     * If @a offset is -1, read at the file's current position. */
+    int read(int fd, void *buf, size_t len, off_t offset,
+	     Callback callback, void *user_data);
+
+    /** @brief Queue a write of @a len bytes to @a fd at @a offset.
+     *
+     * If @a offset is -1, write at the file's current position.  Writes at
+     * the current position may complete in any order. */
+    int write(int fd, const void *buf, size_t len, off_t offset,
+	      Callback callback, void *user_data);
+
+    /** @brief Queue a recvmsg(2) on @a fd. */
+    int recvmsg(int fd, struct msghdr *msg, int flags,
+		Callback callback, void *user_data);
+
+    /** @brief Queue a sendmsg(2) on @a fd. */
+    int sendmsg(int fd, const struct msghdr *msg, int flags,
+		Callback callback, void *user_data);
+
+    /** @brief Hand queued requests to the kernel. */
+    void submit();
+
+    /** @brief Submit queued requests and call the callbacks of completed
+     * requests.
+     * @return number of completions reaped
+     *
+     * Does not block.  RouterThread::driver() calls this once per
+     * iteration. */
+    int run();
+
+    /** @brief Block until every request with @a user_data has completed.
+     *
+     * Callbacks of other requests that complete meanwhile are also
+     * called. */
+    void wait(void *user_data);
+
+    /** @brief Cancel every request with @a user_data, and wait for them.
+     *
+     * Cancelled requests' callbacks are called with -ECANCELED.  Requests
+     * the kernel has already started, such as most file writes, run to
+     * completion. */
+    void cancel(void *user_data);
+
+  private:
+
+    struct Slot {
+	Callback callback;
+	void *user_data;
+	int next;		// free list, or -2 if in use
+    };
+
+    int _fd;
+    unsigned _sq_entries;
+    unsigned _sq_mask;
+    unsigned _sq_tail;		// local copy
+    unsigned _nqueued;
+    unsigned *_sq_khead;
+    unsigned *_sq_ktail;
+    unsigned *_sq_array;
+    struct io_uring_sqe *_sqes;
+    unsigned _cq_mask;
+    unsigned *_cq_khead;
+    unsigned *_cq_ktail;
+    struct io_uring_cqe *_cqes;
+
+    void *_sq_map;
+    size_t _sq_map_size;
+    void *_cq_map;
+    size_t _cq_map_size;
+    size_t _sqes_map_size;
+
+    Vector<Slot> _slots;
+    int _free_slot;
+    unsigned _inflight;
+
+    struct io_uring_sqe *prepare(int op, int fd, Callback callback, void *user_data);
+    void wait_one();
+    bool has_pending(void *user_data) const;
+
+    IOUring(const IOUring &);
+    IOUring &operator=(const IOUring &);
+
+};
+
+CLICK_ENDDECLS
+#endif
@@ -18,6 +18,9 @@
 #if (CLICK_USERLEVEL || CLICK_NS || CLICK_MINIOS) && (!HAVE_MULTITHREAD || HAVE___THREAD_STORAGE_CLASS)
 # define HAVE_CLICK_PACKET_POOL 1
 #endif
+#if HAVE_CLICK_PACKET_POOL && CLICK_USERLEVEL && ALLOW_MMAP
+# define HAVE_CLICK_PACKET_ARENA 1
+#endif
 #ifndef CLICK_PACKET_DEPRECATED_ENUM
 # define CLICK_PACKET_DEPRECATED_ENUM CLICK_DEPRECATED_ENUM
 #endif
@@ -31,6 +34,7 @@ CLICK_DECLS
 
 class IP6Address;
 class WritablePacket;
+class PacketBatch;
 
 class Packet { public:
 
@@ -68,9 +72,22 @@ class Packet { public:
                                 void* argument = (void*) 0, int headroom = 0, int tailroom = 0) CLICK_WARN_UNUSED_RESULT;
 #endif
 
+    static int make_bulk(int n, uint32_t headroom, uint32_t length,
+			 uint32_t tailroom, PacketBatch &batch);
+
     static void static_cleanup();
+#if HAVE_CLICK_PACKET_POOL
+    static unsigned packet_pool_size();
+    static void set_packet_pool_size(unsigned size);
+#endif
+#if HAVE_CLICK_PACKET_ARENA
+    static bool packet_arena();
+    static void set_packet_arena(bool on);
+    static String packet_arena_stats();
+#endif
 
     inline void kill();
+    static void kill_bulk(PacketBatch &batch);
 
     inline bool shared() const;
     Packet *clone() CLICK_WARN_UNUSED_RESULT;
@@ -814,7 +831,10 @@ class WritablePacket : public Packet { public:
     static WritablePacket *pool_allocate(bool with_data);
     static WritablePacket *pool_allocate(uint32_t headroom, uint32_t length,
 					 uint32_t tailroom);
+    static void pool_reserve(unsigned n, bool with_data);
+    static inline unsigned char *recycle_prepare(WritablePacket *p);
     static void recycle(WritablePacket *p);
+    static void recycle_bulk(PacketBatch &batch);
 #endif
 
     friend class Packet;
@@ -141,4 +141,30 @@
 # endif
 #endif
 
+// bytes 40-47: virtio_net_hdr offload state, in host byte order
+#define VNET_FLAGS_ANNO_OFFSET		40
+#define VNET_FLAGS_ANNO_SIZE		1
+#define VNET_FLAGS_ANNO(p)		((p)->anno_u8(VNET_FLAGS_ANNO_OFFSET))
+#define SET_VNET_FLAGS_ANNO(p, v)	((p)->set_anno_u8(VNET_FLAGS_ANNO_OFFSET, (v)))
+
+#define VNET_GSO_TYPE_ANNO_OFFSET	41
+#define VNET_GSO_TYPE_ANNO_SIZE		1
+#define VNET_GSO_TYPE_ANNO(p)		((p)->anno_u8(VNET_GSO_TYPE_ANNO_OFFSET))
+#define SET_VNET_GSO_TYPE_ANNO(p, v)	((p)->set_anno_u8(VNET_GSO_TYPE_ANNO_OFFSET, (v)))
+
+#define VNET_GSO_SIZE_ANNO_OFFSET	42
+#define VNET_GSO_SIZE_ANNO_SIZE		2
+#define VNET_GSO_SIZE_ANNO(p)		((p)->anno_u16(VNET_GSO_SIZE_ANNO_OFFSET))
+#define SET_VNET_GSO_SIZE_ANNO(p, v)	((p)->set_anno_u16(VNET_GSO_SIZE_ANNO_OFFSET, (v)))
+
+#define VNET_CSUM_START_ANNO_OFFSET	44
+#define VNET_CSUM_START_ANNO_SIZE	2
+#define VNET_CSUM_START_ANNO(p)		((p)->anno_u16(VNET_CSUM_START_ANNO_OFFSET))
+#define SET_VNET_CSUM_START_ANNO(p, v)	((p)->set_anno_u16(VNET_CSUM_START_ANNO_OFFSET, (v)))
+
+#define VNET_CSUM_OFFSET_ANNO_OFFSET	46
+#define VNET_CSUM_OFFSET_ANNO_SIZE	2
+#define VNET_CSUM_OFFSET_ANNO(p)	((p)->anno_u16(VNET_CSUM_OFFSET_ANNO_OFFSET))
+#define SET_VNET_CSUM_OFFSET_ANNO(p, v)	((p)->set_anno_u16(VNET_CSUM_OFFSET_ANNO_OFFSET, (v)))
+
 #endif
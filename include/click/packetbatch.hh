@@ -0,0 +1,168 @@
+// -*- c-basic-offset: 4 -*-
+#ifndef CLICK_PACKETBATCH_HH
+#define CLICK_PACKETBATCH_HH
+#include <click/packet.hh>
+CLICK_DECLS
+
+/** @file <click/packetbatch.hh>
+ * @brief Click's PacketBatch class.
+ */
+
+/** @class PacketBatch
+ * @brief An ordered list of packets moved between elements as a unit.
+ *
+ * A PacketBatch strings packets together through their next-packet
+ * annotations (Packet::next()).  Batches are passed by reference to
+ * Element::push_batch() and Element::pull_batch(); moving a batch through a
+ * port costs one function call however many packets it holds.
+ *
+ * A PacketBatch does not own its packets in the C++ sense: destroying a
+ * nonempty batch leaks them.  Code that receives a batch must account for
+ * every packet, by pushing the batch onward, by taking packets off with
+ * pop_front(), or by calling kill().
+ *
+ * While a packet belongs to a batch, its next-packet annotation is reserved
+ * for the batch.  Packets removed with pop_front() have a null next-packet
+ * annotation.  The previous-packet annotation is not used.
+ *
+ * Iterate over a batch's packets like this:
+ *
+ * @code
+ * for (Packet *p = batch.first(); p; p = p->next())
+ *     ...
+ * @endcode
+ */
+class PacketBatch { public:
+
+    /** @brief Construct an empty batch. */
+    PacketBatch()
+	: _head(0), _tail(0), _count(0) {
+    }
+
+    /** @brief Return true iff the batch holds no packets. */
+    bool empty() const {
+	return !_head;
+    }
+    /** @brief Return the number of packets in the batch. */
+    int count() const {
+	return _count;
+    }
+    /** @brief Return the first packet in the batch, or null if empty. */
+    Packet *first() const {
+	return _head;
+    }
+    /** @brief Return the last packet in the batch, or null if empty. */
+    Packet *last() const {
+	return _tail;
+    }
+
+    inline void append(Packet *p);
+    inline void append(PacketBatch &x);
+    inline void prepend(Packet *p);
+    inline Packet *pop_front();
+    inline void swap(PacketBatch &x);
+    inline void clear();
+    inline void kill();
+
+  private:
+
+    Packet *_head;
+    Packet *_tail;
+    int _count;
+
+    PacketBatch(const PacketBatch &x);
+    PacketBatch &operator=(const PacketBatch &x);
+
+};
+
+/** @brief Add packet @a p to the end of the batch. */
+inline void
+PacketBatch::append(Packet *p)
+{
+    assert(p);
+    p->set_next(0);
+    if (_tail)
+	_tail->set_next(p);
+    else
+	_head = p;
+    _tail = p;
+    ++_count;
+}
+
+/** @brief Move all packets in @a x to the end of the batch.
+ *
+ * On return, @a x is empty. */
+inline void
+PacketBatch::append(PacketBatch &x)
+{
+    if (!x._head)
+	return;
+    if (_tail)
+	_tail->set_next(x._head);
+    else
+	_head = x._head;
+    _tail = x._tail;
+    _count += x._count;
+    x.clear();
+}
+
+/** @brief Add packet @a p to the front of the batch. */
+inline void
+PacketBatch::prepend(Packet *p)
+{
+    assert(p);
+    p->set_next(_head);
+    if (!_tail)
+	_tail = p;
+    _head = p;
+    ++_count;
+}
+
+/** @brief Remove and return the first packet in the batch.
+ *
+ * Returns null if the batch is empty.  The returned packet's next-packet
+ * annotation is null. */
+inline Packet *
+PacketBatch::pop_front()
+{
+    Packet *p = _head;
+    if (p) {
+	_head = p->next();
+	if (!_head)
+	    _tail = 0;
+	p->set_next(0);
+	--_count;
+    }
+    return p;
+}
+
+/** @brief Exchange the contents of this batch and @a x. */
+inline void
+PacketBatch::swap(PacketBatch &x)
+{
+    Packet *h = _head, *t = _tail;
+    int c = _count;
+    _head = x._head, _tail = x._tail, _count = x._count;
+    x._head = h, x._tail = t, x._count = c;
+}
+
+/** @brief Forget the batch's packets without freeing them. */
+inline void
+PacketBatch::clear()
+{
+    _head = _tail = 0;
+    _count = 0;
+}
+
+/** @brief Free every packet in the batch and leave it empty.
+ *
+ * @sa Packet::kill_bulk */
+inline void
+PacketBatch::kill()
+{
+    if (_head)
+	Packet::kill_bulk(*this);
+}
+
+CLICK_ENDDECLS
+#endif
@@ -107,6 +107,11 @@ class Router { public:
     void unparse_connections(StringAccum& sa, const String& indent = String()) const;
 
     String element_ports_string(const Element *e) const;
+
+    // PROFILING
+    inline unsigned profile_interval() const;
+    void set_profile_interval(unsigned interval);
+    void reset_profile();
     //@}
 
     // INITIALIZATION
@@ -192,6 +197,8 @@ class Router { public:
             return p[0] < x.p[0] || (p[0] == x.p[0] && p[1] < x.p[1]);
         }
     };
+
+    class ProfileSample;
     /** @endcond never */
 
 #if CLICK_NS
@@ -298,6 +305,26 @@ class Router { public:
 
     Router* _next_router;
 
+    struct ProfileCounters {
+        uint64_t samples;
+        uint64_t packets;
+        click_cycles_t own_cycles;
+        click_cycles_t child_cycles;
+    };
+    struct ProfileThread {              // followed by ProfileCounters
+        unsigned countdown;
+        int depth;
+        click_cycles_t child_cycles;
+        ProfileCounters *counters() {
+            return reinterpret_cast<ProfileCounters *>(this + 1);
+        }
+    };
+    ProfileThread **_profile_threads;
+    int _profile_nthreads;
+    int _profile_nslots;
+    Vector<int> _profile_slot;          // element index -> first slot
+    volatile unsigned _profile_interval;
+
 #if CLICK_LINUXMODULE
     Vector<struct module*> _modules;
 #endif
@@ -339,6 +366,8 @@ class Router { public:
     static void store_global_handler(Handler &h);
     static inline void store_handler(const Element *element, Handler &h);
 
+    String profile_report(bool ports) const;
+
     // global handlers
     static String router_read_handler(Element *e, void *user_data);
     static int router_write_handler(const String &str, Element *e, void *user_data, ErrorHandler *errh);
@@ -351,6 +380,33 @@ class Router { public:
 
 };
 
+/** @cond never */
+/** @brief Measures one sampled port transfer or task run.
+ *
+ * Construct a ProfileSample just before a transfer or task run and call
+ * finish() just after.  Every profile_interval()th event on a thread is a
+ * sample; its own and child cycles are charged to the element passed to
+ * finish().  The @a which argument picks the counter: 0 for the element's
+ * tasks, 1 + @em i for input @em i, and 1 + ninputs() + @em i for output
+ * @em i.  Events nested inside a sample are timed too, but only to compute
+ * their parent's child cycles.  Events on threads other than RouterThreads
+ * are not sampled, since they would share another thread's counters. */
+class Router::ProfileSample { public:
+
+    inline ProfileSample(Router *router);
+    inline void finish(const Element *e, int which, uint64_t packets);
+
+  private:
+
+    Router *_router;
+    Router::ProfileThread *_pt;
+    bool _record;
+    click_cycles_t _saved_child_cycles;
+    click_cycles_t _start_cycles;
+
+};
+/** @endcond never */
+
 
 /** @brief  Increment the router's reference count.
  *
@@ -620,5 +676,64 @@ Handler::Handler(const String &name)
     _write_hook.w = 0;
 }
 
+/** @brief Return the profiling sample interval, or 0 if profiling is off.
+ * @sa set_profile_interval */
+inline unsigned
+Router::profile_interval() const
+{
+    return _profile_interval;
+}
+
+inline
+Router::ProfileSample::ProfileSample(Router *router)
+    : _router(router), _pt(0)
+{
+    ProfileThread **pts = router->_profile_threads;
+    unsigned interval = router->_profile_interval;
+    if (!pts || !interval)
+        return;
+#if CLICK_USERLEVEL && HAVE_MULTITHREAD && HAVE___THREAD_STORAGE_CLASS
+    // RouterThread::driver() marks its thread; others get no counters.
+    if (!(click_current_thread_id & 0x40000000))
+        return;
+#endif
+    unsigned tid = click_current_cpu_id();
+    if (tid >= (unsigned) router->_profile_nthreads)
+        return;
+    ProfileThread *pt = pts[tid];
+    _record = pt->countdown <= 1;
+    if (_record)
+        pt->countdown = interval;
+    else {
+        --pt->countdown;
+        if (pt->depth == 0)
+            return;
+    }
+    _pt = pt;
+    _saved_child_cycles = pt->child_cycles;
+    pt->child_cycles = 0;
+    ++pt->depth;
+    _start_cycles = click_get_cycles();
+}
+
+inline void
+Router::ProfileSample::finish(const Element *e, int which, uint64_t packets)
+{
+    if (!_pt)
+        return;
+    click_cycles_t all_cycles = click_get_cycles() - _start_cycles;
+    ProfileThread *pt = _pt;
+    --pt->depth;
+    if (_record && e->eindex() >= 0) {
+        int slot = _router->_profile_slot.unchecked_at(e->eindex()) + which;
+        ProfileCounters &c = pt->counters()[slot];
+        ++c.samples;
+        c.packets += packets;
+        c.own_cycles += all_cycles - pt->child_cycles;
+        c.child_cycles += pt->child_cycles;
+    }
+    pt->child_cycles = _saved_child_cycles + all_cycles;
+}
+
 CLICK_ENDDECLS
 #endif
@@ -18,6 +18,7 @@ CLICK_CXX_UNPROTECT
 # include <click/cxxunprotect.h>
 #elif CLICK_USERLEVEL
 # include <click/selectset.hh>
+# include <click/iouring.hh>
 #endif
 
 // NB: user must #include <click/task.hh> before <click/routerthread.hh>.
@@ -30,6 +31,7 @@ class RouterThread { public:
     enum { THREAD_QUIESCENT = -1, THREAD_UNKNOWN = -1000 };
 
     inline int thread_id() const;
+    inline bool current_thread_is_running() const;
 
     inline Master *master() const;
     inline TimerSet &timer_set()                { return _timers; }
@@ -37,6 +39,7 @@ class RouterThread { public:
 #if CLICK_USERLEVEL
     inline SelectSet &select_set()              { return _selects; }
     inline const SelectSet &select_set() const  { return _selects; }
+    IOUring *io_uring();
 #endif
 
     // Task list functions
@@ -69,6 +72,9 @@ class RouterThread { public:
     void set_cpu_share(unsigned min_share, unsigned max_share);
 #endif
 
+    bool work_stealing() const          { return _work_stealing; }
+    void set_work_stealing(bool ws);
+
 #if CLICK_LINUXMODULE || CLICK_BSDMODULE
     bool greedy() const                 { return _greedy; }
     void set_greedy(bool g)             { _greedy = g; }
@@ -118,6 +124,9 @@ class RouterThread { public:
     // LOCAL STATE GROUP
     TaskLink _task_link;
     volatile bool _stop_flag;
+    unsigned _task_list_version;        // changes when tasks are (un)linked
+    unsigned _steal_failed_version;     // version of last failed steal scan
+    bool _steal_failed;
 #if HAVE_TASK_HEAP
     Vector<task_heap_element> _task_heap;
 #endif
@@ -125,6 +134,8 @@ class RouterThread { public:
     TimerSet _timers;
 #if CLICK_USERLEVEL
     SelectSet _selects;
+    IOUring *_io_uring;
+    bool _io_uring_failed;
 #endif
 
 #if HAVE_ADAPTIVE_SCHEDULER
@@ -157,6 +168,8 @@ class RouterThread { public:
     Master *_master CLICK_ALIGNED(CLICK_CACHE_LINE_SIZE);
     int _id;
     bool _driver_entered;
+    volatile bool _work_stealing;
+    atomic_uint32_t _steal_request;     // 0 or ID + 1 of an idle thread
 #if HAVE_MULTITHREAD && !(CLICK_LINUXMODULE || CLICK_MINIOS)
     click_processor_t _running_processor;
 #endif
@@ -227,6 +240,9 @@ class RouterThread { public:
 
     inline void run_tasks(int ntasks);
     inline void process_pending();
+    inline void balance_tasks();
+    void request_tasks();
+    void hand_off_task();
     inline void run_os();
 #if HAVE_ADAPTIVE_SCHEDULER
     void client_set_tickets(int client, int tickets);
@@ -236,7 +252,6 @@ class RouterThread { public:
     void task_reheapify_from(int pos, Task*);
 #endif
     static inline bool running_in_interrupt();
-    inline bool current_thread_is_running() const;
     inline bool current_thread_is_running_cleanup() const;
 
     friend class Task;
@@ -369,6 +384,11 @@ RouterThread::mark_driver_entry()
     _driver_entered = true;
 }
 
+/** @brief Returns whether the calling thread is running this RouterThread's
+ * driver.
+ *
+ * Elements use this to tell whether they may touch state owned by this
+ * thread, such as its io_uring(). */
 inline bool
 RouterThread::current_thread_is_running() const
 {
@@ -274,6 +274,20 @@ class Task : private TaskLink { public:
      */
     void move_thread(int new_thread_id);
 
+    /** @brief Return true iff the Task is pinned to its home thread.
+     *
+     * Work stealing (see RouterThread::set_work_stealing()) never moves a
+     * pinned task to another thread.  Tasks that poll a per-thread resource,
+     * such as a device receive queue, should be pinned.  Explicit
+     * move_thread() calls ignore the pinned flag. */
+    bool pinned() const {
+        return _pinned;
+    }
+
+    /** @brief Set whether the Task is pinned to its home thread.
+     * @sa pinned */
+    inline void set_pinned(bool pinned);
+
 
 #if HAVE_STRIDE_SCHED
     inline int tickets() const;
@@ -320,6 +334,8 @@ class Task : private TaskLink { public:
         uint32_t status;
     } _status;
 
+    bool _pinned;
+
     TaskCallback _hook;
     void *_thunk;
 
@@ -362,6 +378,7 @@ class Task : private TaskLink { public:
     void process_pending(RouterThread* thread);
 
     void complete_schedule(RouterThread* process_pending_thread);
+    bool profile_fire();
     inline void remove_from_scheduled_list();
 
     static bool error_hook(Task *task, void *user_data);
@@ -386,7 +403,7 @@ Task::Task(TaskCallback f, void *user_data)
 #if HAVE_STRIDE_SCHED
       _stride(0), _tickets(-1),
 #endif
-      _hook(f), _thunk(user_data),
+      _pinned(false), _hook(f), _thunk(user_data),
 #if HAVE_ADAPTIVE_SCHEDULER
       _runs(0), _work_done(0),
 #endif
@@ -409,7 +426,7 @@ Task::Task(Element* e)
 #if HAVE_STRIDE_SCHED
       _stride(0), _tickets(-1),
 #endif
-      _hook(0), _thunk(e),
+      _pinned(false), _hook(0), _thunk(e),
 #if HAVE_ADAPTIVE_SCHEDULER
       _runs(0), _work_done(0),
 #endif
@@ -511,9 +528,18 @@ Task::remove_from_scheduled_list()
         click_fence();
         _prev = 0;
 #endif
+        ++_thread->_task_list_version;
     }
 }
 
+inline void
+Task::set_pinned(bool pinned)
+{
+    _pinned = pinned;
+    if (_thread)
+        ++_thread->_task_list_version;
+}
+
 #if HAVE_STRIDE_SCHED
 
 /** @brief Return the task's number of tickets.
@@ -580,7 +606,9 @@ Task::fire()
     _cycle_runs++;
 #endif
     bool work_done;
-    if (!_hook)
+    if (unlikely(Element::nprofiling.value()))
+        work_done = profile_fire();
+    else if (!_hook)
         work_done = ((Element*)_thunk)->run_task(this);
     else
         work_done = _hook(this, _thunk);
@@ -340,6 +340,8 @@ class Timer { public:
 
     int _schedpos1;
     Timestamp _expiry_s;
+    Timer *_wheel_next;
+    Timer **_wheel_pprev;
     union {
 	TimerCallback callback;
     } _hook;
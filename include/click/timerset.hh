@@ -12,6 +12,7 @@ class Timer;
 class TimerSet { public:
 
     TimerSet();
+    ~TimerSet();
 
     Timestamp timer_expiry_steady() const	{ return _timer_expiry; }
     inline Timestamp timer_expiry_steady_adjusted() const;
@@ -25,6 +26,9 @@ class TimerSet { public:
     unsigned timer_stride() const		{ return _timer_stride; }
     void set_max_timer_stride(unsigned timer_stride);
 
+    bool timer_wheel() const			{ return _wheel_slots != 0; }
+    void set_timer_wheel(bool wheel);
+
     void kill_router(Router *router);
 
     void run_timers(RouterThread *thread, Master *master);
@@ -62,6 +66,18 @@ class TimerSet { public:
     unsigned _timer_count;
     Vector<heap_element> _timer_heap;
     Vector<Timer *> _timer_runchunk;
+
+    // Hashed hierarchical timing wheel, used instead of _timer_heap when
+    // _wheel_slots is nonnull.  Level 0 has one slot per millisecond; each
+    // slot on a higher level spans a whole turn of the level below.  Slot
+    // i's timers are linked through _wheel_next, and _schedpos1 == i + 1.
+    enum { wheel_levels = 5, wheel_bits0 = 8, wheel_bits = 6,
+	   wheel_size0 = 1 << wheel_bits0, wheel_size = 1 << wheel_bits,
+	   wheel_nslots = wheel_size0 + (wheel_levels - 1) * wheel_size };
+    Timer **_wheel_slots;
+    uint64_t _wheel_bitmap[wheel_nslots / 64]; // nonempty slots
+    uint64_t _wheel_tick;	// current tick; earlier slots are processed
+    unsigned _wheel_count;	// # timers in wheel
     SimpleSpinlock _timer_lock;
 #if CLICK_LINUXMODULE
     struct task_struct *_timer_task;
@@ -72,15 +88,32 @@ class TimerSet { public:
     uint32_t _timer_check_reports;
 
     inline void run_one_timer(Timer *);
+    inline void adjust_timer_stride(const Timestamp &first_expiry);
+    void run_timer_runchunk(RouterThread *thread);
 
     void set_timer_expiry() {
-	if (_timer_heap.size())
+	if (_wheel_slots)
+	    _timer_expiry = wheel_expiry();
+	else if (_timer_heap.size())
 	    _timer_expiry = _timer_heap.unchecked_at(0).expiry_s;
 	else
 	    _timer_expiry = Timestamp();
     }
     void check_timer_expiry(Timer *t);
 
+    inline int wheel_slot(uint64_t tick) const;
+    inline int wheel_find(unsigned idx) const;
+    inline void wheel_link(Timer *t);
+    inline void wheel_unlink(Timer *t);
+    uint64_t wheel_next_cascade() const;
+    void wheel_cascade();
+    void wheel_collect_slot(int slot, bool partial);
+    void wheel_collect();
+    Timestamp wheel_expiry() const;
+    Timer *wheel_first();
+    bool wheel_schedule(Timer *t);
+    void wheel_unschedule(Timer *t);
+
     inline void lock_timers();
     inline bool attempt_lock_timers();
     inline void unlock_timers();
@@ -153,7 +186,11 @@ inline Timer *
 TimerSet::next_timer()
 {
     lock_timers();
-    Timer *t = _timer_heap.empty() ? 0 : _timer_heap.unchecked_at(0).t;
+    Timer *t;
+    if (_wheel_slots)
+	t = wheel_first();
+    else
+	t = _timer_heap.empty() ? 0 : _timer_heap.unchecked_at(0).t;
     unlock_timers();
     return t;
 }
@@ -182,6 +182,23 @@ click_update_in_cksum(uint16_t *csum, uint16_t old_hw, uint16_t new_hw)
     *csum = ~(sum + (sum >> 16));
 }
 
+/** @brief Incrementally adjust an Internet checksum for a 32-bit change.
+ * @param[in, out] csum points to checksum
+ * @param old_w old word
+ * @param new_w new word
+ *
+ * Equivalent to calling click_update_in_cksum() on each halfword of @a old_w
+ * and @a new_w, such as IP addresses or TCP sequence numbers, but folds only
+ * once.  The words are taken in memory (network) order. */
+static inline void
+click_update_in_cksum32(uint16_t *csum, uint32_t old_w, uint32_t new_w)
+{
+    uint32_t sum = (~*csum & 0xFFFF) + (~old_w & 0xFFFF) + (~old_w >> 16)
+	+ (new_w & 0xFFFF) + (new_w >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    *csum = ~(sum + (sum >> 16));
+}
+
 /** @brief Potentially fix a zero-valued Internet checksum.
  * @param[in, out] csum points to checksum
  * @param x data to checksum
@@ -119,10 +119,6 @@ int DPDKDevice::initialize_device(ErrorHandler *errh)
     dev_conf.rxmode.offloads = DEV_RX_OFFLOAD_CRC_STRIP;
     dev_conf.txmode.offloads = 0;
 #endif
-    dev_conf.rxmode.mq_mode = ETH_MQ_RX_RSS;
-    dev_conf.rx_adv_conf.rss_conf.rss_key = NULL;
-    dev_conf.rx_adv_conf.rss_conf.rss_hf = ETH_RSS_IP | ETH_RSS_UDP | ETH_RSS_TCP;
-
     //We must open at least one queue per direction
     if (info.rx_queues.size() == 0) {
         info.rx_queues.resize(1);
@@ -132,6 +128,32 @@ int DPDKDevice::initialize_device(ErrorHandler *errh)
         info.tx_queues.resize(1);
     }
 
+    dev_conf.rxmode.mq_mode = ETH_MQ_RX_RSS;
+    dev_conf.rx_adv_conf.rss_conf.rss_key = NULL;
+    if (info.rss_key.length()) {
+#if RTE_VERSION >= RTE_VERSION_NUM(17,02,0,0)
+        if (dev_info.hash_key_size > 0
+            && (unsigned) info.rss_key.length() != dev_info.hash_key_size)
+            return errh->error("Port %u needs an RSS key of %u bytes, not %d",
+                               port_id, dev_info.hash_key_size,
+                               info.rss_key.length());
+#endif
+        dev_conf.rx_adv_conf.rss_conf.rss_key = (uint8_t *) info.rss_key.data();
+        dev_conf.rx_adv_conf.rss_conf.rss_key_len = info.rss_key.length();
+    }
+    dev_conf.rx_adv_conf.rss_conf.rss_hf = info.rss_hash_fields;
+#if RTE_VERSION >= RTE_VERSION_NUM(2,1,0,0)
+    // Only ask for the hash fields the device supports
+    dev_conf.rx_adv_conf.rss_conf.rss_hf &= dev_info.flow_type_rss_offloads;
+#endif
+    if (dev_conf.rx_adv_conf.rss_conf.rss_hf == 0) {
+        if (info.rx_queues.size() > 1)
+            errh->warning("Port %u cannot hash packets to its %d RX queues, "
+                          "which will receive unevenly", port_id,
+                          info.rx_queues.size());
+        dev_conf.rxmode.mq_mode = ETH_MQ_RX_NONE;
+    }
+
 #if RTE_VERSION >= RTE_VERSION_NUM(18,05,0,0)
     if (info.n_rx_descs == 0)
         info.n_rx_descs = dev_info.default_rxportconf.ring_size > 0? dev_info.default_rxportconf.ring_size : DEF_DEV_RXDESC;
@@ -280,6 +302,24 @@ void DPDKDevice::set_init_mtu(uint16_t mtu) {
     info.init_mtu = mtu;
 }
 
+/* Set the RSS key and hash fields used to dispatch received packets among
+ * the RX queues. An empty key leaves the driver's default key. */
+int DPDKDevice::set_init_rss(const String &key, uint64_t hash_fields,
+                             ErrorHandler *errh) {
+    if (_is_initialized)
+        return errh->error(
+            "Trying to configure DPDK device after initialization");
+    if (info.rss_set
+        && (key != info.rss_key || hash_fields != info.rss_hash_fields))
+        return errh->error(
+            "Some elements disagree on the RSS configuration of device %u",
+            port_id);
+    info.rss_set = true;
+    info.rss_key = key;
+    info.rss_hash_fields = hash_fields;
+    return 0;
+}
+
 EtherAddress DPDKDevice::get_mac() {
     assert(_is_initialized);
     struct ether_addr addr;
@@ -67,6 +67,7 @@ const char Element::PROCESSING_A_AH[] = "a/ah";
 const char Element::COMPLETE_FLOW[] = "x/x";
 
 int Element::nelements_allocated = 0;
+atomic_uint32_t Element::nprofiling;
 
 /** @mainpage Click
  *  @section  Introduction
@@ -796,6 +797,44 @@ Element::connect_port(bool isoutput, int port, Element* e, int e_port)
 	return -1;
 }
 
+// Sampled profiling (see Router::set_profile_interval).  Port transfers take
+// these out-of-line paths only while some router has profiling on.
+
+void
+Element::Port::profile_push(Packet *p) const
+{
+    Router::ProfileSample ps(_e->router());
+    raw_push(p);
+    ps.finish(_e, 1 + _port, 1);
+}
+
+Packet *
+Element::Port::profile_pull() const
+{
+    Router::ProfileSample ps(_e->router());
+    Packet *p = raw_pull();
+    ps.finish(_e, 1 + _e->ninputs() + _port, p ? 1 : 0);
+    return p;
+}
+
+void
+Element::Port::profile_push_batch(PacketBatch &batch) const
+{
+    Router::ProfileSample ps(_e->router());
+    int n = batch.count();
+    _e->push_batch(_port, batch);
+    ps.finish(_e, 1 + _port, n);
+}
+
+int
+Element::Port::profile_pull_batch(PacketBatch &batch, int max) const
+{
+    Router::ProfileSample ps(_e->router());
+    int n = _e->pull_batch(_port, batch, max);
+    ps.finish(_e, 1 + _e->ninputs() + _port, n);
+    return n;
+}
+
 
 // FLOW
 
@@ -2971,6 +3010,63 @@ Element::simple_action(Packet *p)
     return p;
 }
 
+/** @brief Push a batch of packets onto push input @a port.
+ *
+ * @param port the input port number on which the packets arrive
+ * @param batch the packets
+ *
+ * An upstream element transferred the packets in @a batch to this element
+ * over a push connection using Port::push_batch().  push_batch() must
+ * account for every packet in @a batch, just as push() accounts for a single
+ * packet, and must leave @a batch empty on return.  Elements usually
+ * forward the batch, or what remains of it, with output(i).push_batch().
+ *
+ * Elements that handle batches natively override this method to amortize
+ * per-packet function call overhead.  The default implementation removes
+ * the packets from @a batch one at a time and passes each one to push(), so
+ * every element accepts batches whether or not it overrides push_batch().
+ *
+ * @sa pull_batch, PacketBatch
+ */
+void
+Element::push_batch(int port, PacketBatch &batch)
+{
+    while (Packet *p = batch.pop_front())
+	push(port, p);
+}
+
+/** @brief Pull up to @a max packets from pull output @a port.
+ *
+ * @param port the output port number receiving the pull request
+ * @param batch batch to which packets are appended
+ * @param max maximum number of packets to append
+ * @return the number of packets appended to @a batch
+ *
+ * A downstream element requested up to @a max packets from this element
+ * over a pull connection using Port::pull_batch().  This element should
+ * append at most @a max packets to the end of @a batch and return the number
+ * appended.  A return value of 0 has the same meaning as a null return from
+ * pull().
+ *
+ * The default implementation calls pull() repeatedly until it returns null
+ * or @a max packets have been appended.
+ *
+ * @sa push_batch, PacketBatch
+ */
+int
+Element::pull_batch(int port, PacketBatch &batch, int max)
+{
+    int n = 0;
+    while (n < max) {
+	Packet *p = pull(port);
+	if (!p)
+	    break;
+	batch.append(p);
+	++n;
+    }
+    return n;
+}
+
 /** @brief Run the element's task.
  *
  * @return true if the task accomplished some meaningful work, false otherwise
@@ -31,15 +31,20 @@
 #ifdef ALLOW_MMAP
 # include <sys/mman.h>
 #endif
+#if CLICK_USERLEVEL && HAVE_LINUX_IO_URING_H
+# include <click/iouring.hh>
+#endif
 CLICK_DECLS
 
 FromFile::FromFile()
     : _fd(-1), _buffer(0), _data_packet(0),
 #ifdef ALLOW_MMAP
-      _mmap(true),
+      _mmap(true), _mapping(0), _prefetch(DEFAULT_PREFETCH),
 #endif
-      _filename(), _pipe(0), _landmark_pattern("%f"), _lineno(0)
+      _ring(0), _filename(), _pipe(0), _landmark_pattern("%f"), _lineno(0)
 {
+    _ahead.packet = 0;
+    _ahead.busy = false;
 }
 
 int
@@ -47,15 +52,19 @@ FromFile::configure_keywords(Vector<String> &conf, Element *e, ErrorHandler *err
 {
 #ifdef ALLOW_MMAP
     bool mmap = _mmap;
+    uint32_t prefetch = _prefetch;
 #else
     bool mmap = false;
+    uint32_t prefetch = 0;
 #endif
     if (Args(e, errh).bind(conf)
 	.read("MMAP", mmap)
+	.read("PREFETCH", prefetch)
 	.consume() < 0)
 	return -1;
 #ifdef ALLOW_MMAP
     _mmap = mmap;
+    _prefetch = prefetch;
 #else
     if (mmap)
 	errh->warning("%<MMAP true%> is not supported on this platform");
@@ -63,6 +72,21 @@ FromFile::configure_keywords(Vector<String> &conf, Element *e, ErrorHandler *err
     return 0;
 }
 
+/** @brief Read the file through @a ring, which must belong to the thread
+    that reads the file.
+
+    Call before initialize().  Turns off MMAP.  Only regular, uncompressed
+    files can be read this way; initialize() fails for others. */
+void
+FromFile::set_io_uring(IOUring *ring)
+{
+    _ring = ring;
+#ifdef ALLOW_MMAP
+    if (ring)
+	_mmap = false;
+#endif
+}
+
 String
 FromFile::print_filename() const
 {
@@ -117,58 +141,180 @@ FromFile::warning(ErrorHandler *errh, const char *format, ...) const
 }
 
 #ifdef ALLOW_MMAP
-static void
-munmap_destructor(unsigned char *data, size_t amount, void*)
+void
+FromFile::mapping_destructor(unsigned char *, size_t, void *arg)
 {
-    if (munmap((caddr_t)data, amount) < 0)
-	click_chatter("FromFile: munmap: %s", strerror(errno));
+    Mapping *m = static_cast<Mapping *>(arg);
+    if (m->refcount.dec_and_test()) {
+	if (munmap((caddr_t) m->data, m->length) < 0)
+	    click_chatter("FromFile: munmap: %s", strerror(errno));
+	delete m;
+    }
+}
+
+/** @brief Make the buffer a window onto the mapping starting at or just
+    before @a off.
+
+    Returns false at end of file. */
+bool
+FromFile::set_mmap_window(off_t off)
+{
+    off_t start = off - off % getpagesize();
+    if (start >= (off_t) _mapping->length)
+	return false;
+    size_t len = _mmap_unit;
+    if ((size_t) (_mapping->length - start) < len)
+	len = _mapping->length - start;
+
+    WritablePacket *p = Packet::make(_mapping->data + start, len,
+				     mapping_destructor, _mapping);
+    if (!p)
+	return false;
+    ++_mapping->refcount;
+    if (_data_packet)
+	_data_packet->kill();
+    _data_packet = p;
+    _buffer = p->data();
+    _file_offset = start;
+    _len = len;
+    _mmap_off = start + len;
+
+# ifdef HAVE_MADVISE
+    // ask the kernel to read ahead of the window
+    off_t want = _mmap_off + _prefetch;
+    if (want > (off_t) _mapping->length)
+	want = _mapping->length;
+    if (_prefetched < start)
+	_prefetched = start;
+    if (_prefetch && _prefetched < want) {
+	(void) madvise((caddr_t) (_mapping->data + _prefetched),
+		       want - _prefetched, MADV_WILLNEED);
+	_prefetched = want;
+    }
+# endif
+    return true;
 }
 
 int
 FromFile::read_buffer_mmap(ErrorHandler *errh)
 {
-    if (_mmap_unit == 0) {
+    if (!_mapping) {
 	size_t page_size = getpagesize();
 	_mmap_unit = (WANT_MMAP_UNIT / page_size) * page_size;
 	_mmap_off = 0;
-	// don't report most errors on the first time through
-	errh = ErrorHandler::silent_handler();
+
+	// Only regular files are mapped; anything else, like a pipe, uses
+	// read().  Don't report errors: read() may work.
+	struct stat statbuf;
+	if (fstat(_fd, &statbuf) < 0 || !S_ISREG(statbuf.st_mode)
+	    || statbuf.st_size == 0 || (off_t) (size_t) statbuf.st_size != statbuf.st_size)
+	    return -1;
+	void *mmap_data = mmap(0, statbuf.st_size, PROT_READ, MAP_SHARED, _fd, 0);
+	if (mmap_data == MAP_FAILED)
+	    return -1;
+# ifdef HAVE_MADVISE
+	// don't care about errors
+	(void) madvise((caddr_t) mmap_data, statbuf.st_size, MADV_SEQUENTIAL);
+# endif
+	_mapping = new Mapping;
+	_mapping->data = (unsigned char *) mmap_data;
+	_mapping->length = statbuf.st_size;
+	_mapping->refcount = 1;
+	_prefetched = 0;
     }
 
-    // get length of file
-    struct stat statbuf;
-    if (fstat(_fd, &statbuf) < 0)
-	return error(errh, "stat: %s", strerror(errno));
+    (void) errh;
+    off_t base = _file_offset;
+    if (_mmap_off >= (off_t) _mapping->length || !set_mmap_window(_mmap_off))
+	return 0;
+    _pos += base - _file_offset;
+    return 1;
+}
+#endif
 
-    // check for end of file
-    // But return -1 if we have not mmaped before: it might be a pipe, not
-    // true EOF.
-    if (_mmap_off >= statbuf.st_size)
-	return (_mmap_off == 0 ? -1 : 0);
+/** @brief Move the mmap window so that the next @a size bytes are in the
+    buffer, if possible.
 
-    // actually mmap
-    _len = _mmap_unit;
-    if ((off_t)(_mmap_off + _len) > statbuf.st_size)
-	_len = statbuf.st_size - _mmap_off;
+    Records that straddle two windows thus need not be copied. */
+inline bool
+FromFile::have_mmap(size_t size)
+{
+#ifdef ALLOW_MMAP
+    off_t pos = _file_offset + _pos;
+    if (!_mapping || pos + size > _mapping->length || !set_mmap_window(pos))
+	return false;
+    _pos = pos - _file_offset;
+    return true;
+#else
+    (void) size;
+    return false;
+#endif
+}
 
-    void *mmap_data = mmap(0, _len, PROT_READ, MAP_SHARED, _fd, _mmap_off);
+void
+FromFile::read_done(int result, void *user_data)
+{
+    ReadAhead *a = static_cast<ReadAhead *>(user_data);
+    a->result = result;
+    a->busy = false;
+}
 
-    if (mmap_data == MAP_FAILED)
-	return error(errh, "mmap: %s", strerror(errno));
+void
+FromFile::start_read_ahead(off_t offset)
+{
+#if CLICK_USERLEVEL && HAVE_LINUX_IO_URING_H
+    if (!(_ahead.packet = Packet::make(0, 0, IO_URING_BUFFER_SIZE, 0)))
+	return;
+    _ahead.offset = offset;
+    _ahead.busy = true;
+    _ring->read(_fd, _ahead.packet->data(), IO_URING_BUFFER_SIZE, offset,
+		read_done, &_ahead);
+    _ring->submit();
+#else
+    (void) offset;
+#endif
+}
 
-    _data_packet = Packet::make((unsigned char *)mmap_data, _len, munmap_destructor, 0);
-    _buffer = _data_packet->data();
-    _file_offset = _mmap_off;
-    _mmap_off += _len;
+void
+FromFile::finish_read_ahead()
+{
+#if CLICK_USERLEVEL && HAVE_LINUX_IO_URING_H
+    if (_ahead.busy)
+	_ring->wait(&_ahead);
+#endif
+    if (_ahead.packet)
+	_ahead.packet->kill();
+    _ahead.packet = 0;
+}
 
-# ifdef HAVE_MADVISE
-    // don't care about errors
-    (void) madvise((caddr_t)mmap_data, _len, MADV_SEQUENTIAL);
-# endif
+int
+FromFile::read_buffer_io_uring(ErrorHandler *errh)
+{
+    // a read-ahead left behind by a seek is useless
+    if (_ahead.packet && _ahead.offset != _file_offset)
+	finish_read_ahead();
+    if (!_ahead.packet)
+	start_read_ahead(_file_offset);
+    if (!_ahead.packet)
+	return error(errh, strerror(ENOMEM));
+#if CLICK_USERLEVEL && HAVE_LINUX_IO_URING_H
+    if (_ahead.busy)
+	_ring->wait(&_ahead);
+#endif
 
-    return 1;
+    WritablePacket *p = _ahead.packet;
+    _ahead.packet = 0;
+    if (_ahead.result < 0) {
+	p->kill();
+	return error(errh, strerror(-_ahead.result));
+    }
+    _data_packet = p;
+    _buffer = p->data();
+    _len = _ahead.result;
+    if (_len)
+	start_read_ahead(_file_offset + _len);
+    return _len;
 }
-#endif
 
 int
 FromFile::read_buffer(ErrorHandler *errh)
@@ -197,6 +343,9 @@ FromFile::read_buffer(ErrorHandler *errh)
     }
 #endif
 
+    if (_ring)
+	return read_buffer_io_uring(errh);
+
     _data_packet = Packet::make(0, 0, BUFFER_SIZE, 0);
     if (!_data_packet)
 	return error(errh, strerror(ENOMEM));
@@ -316,14 +465,21 @@ int
 FromFile::seek(off_t want, ErrorHandler* errh)
 {
     if (want >= _file_offset && want < (off_t) (_file_offset + _len)) {
-	_pos = want;
+	_pos = want - _file_offset;
 	return 0;
     }
 
 #ifdef ALLOW_MMAP
-    if (_mmap) {
-	_mmap_off = (want / _mmap_unit) * _mmap_unit;
-	_pos = _len + want - _mmap_off;
+    if (_mapping) {
+	if (want > (off_t) _mapping->length)
+	    return errh->error("FILEPOS out of range");
+	if (want == (off_t) _mapping->length || !set_mmap_window(want)) {
+	    // at end of file
+	    _file_offset = want;
+	    _pos = _len = 0;
+	    _mmap_off = want;
+	} else
+	    _pos = want - _file_offset;
 	return 0;
     }
 #endif
@@ -346,6 +502,8 @@ FromFile::seek(off_t want, ErrorHandler* errh)
     }
 
     // otherwise, read data
+    if (want < _file_offset)
+	return error(errh, "can't seek backwards in this file");
     while ((off_t) (_file_offset + _len) < want && _len)
 	if (read_buffer(errh) < 0)
 	    return -1;
@@ -388,10 +546,16 @@ FromFile::initialize(ErrorHandler *errh, bool allow_nonexistent)
 	    errh->error("%s: %s", print_filename().c_str(), strerror(-e));
 	return e;
     }
+    struct stat statbuf;
+    if (_ring && (fstat(_fd, &statbuf) < 0 || !S_ISREG(statbuf.st_mode)))
+	return error(errh, "IO_URING requires a regular, uncompressed file");
 
   retry_file:
 #ifdef ALLOW_MMAP
-    _mmap_unit = 0;
+    if (_mapping) {
+	mapping_destructor(0, 0, _mapping);
+	_mapping = 0;
+    }
 #endif
     _file_offset = 0;
     _pos = _len = 0;
@@ -408,6 +572,8 @@ FromFile::initialize(ErrorHandler *errh, bool allow_nonexistent)
     if (_fd == STDIN_FILENO || _pipe)
 	/* cannot handle gzip or bzip2 */;
     else if (compressed_data(_buffer, _len)) {
+	if (_ring)
+	    return error(errh, "IO_URING requires a regular, uncompressed file");
 	close(_fd);
 	_fd = -1;
 	if (!(_pipe = open_uncompress_pipe(_filename, _buffer, _len, errh)))
@@ -422,6 +588,8 @@ FromFile::initialize(ErrorHandler *errh, bool allow_nonexistent)
 void
 FromFile::take_state(FromFile &o, ErrorHandler *errh)
 {
+    if (o._ring)
+	o.finish_read_ahead();
     _fd = o._fd;
     o._fd = -1;
     _pipe = o._pipe;
@@ -440,16 +608,26 @@ FromFile::take_state(FromFile &o, ErrorHandler *errh)
     _mmap = o._mmap;
     _mmap_unit = o._mmap_unit;
     _mmap_off = o._mmap_off;
+    _mapping = o._mapping;
+    o._mapping = 0;
+    _prefetch = o._prefetch;
+    _prefetched = o._prefetched;
 #else
     (void) errh;
 #endif
 
     _file_offset = o._file_offset;
+    // without an io_uring, reads continue from the descriptor's position
+    if (o._ring && !_ring && _fd >= 0)
+	(void) lseek(_fd, _file_offset + _len, SEEK_SET);
 }
 
 void
 FromFile::cleanup()
 {
+    if (_ring)
+	finish_read_ahead();
+    _ring = 0;
     if (_pipe)
 	pclose(_pipe);
     else if (_fd >= 0 && _fd != STDIN_FILENO)
@@ -459,13 +637,18 @@ FromFile::cleanup()
     if (_data_packet)
 	_data_packet->kill();
     _data_packet = 0;
+#ifdef ALLOW_MMAP
+    if (_mapping)
+	mapping_destructor(0, 0, _mapping);
+    _mapping = 0;
+#endif
 }
 
 const uint8_t *
 FromFile::get_aligned(size_t size, void *buffer, ErrorHandler *errh)
 {
     // we may need to read bits of the file
-    if (_pos + size <= _len) {
+    if (_pos + size <= _len || have_mmap(size)) {
 	const uint8_t *chunk = _buffer + _pos;
 	_pos += size;
 #if HAVE_INDIFFERENT_ALIGNMENT
@@ -489,7 +672,7 @@ const uint8_t *
 FromFile::get_unaligned(size_t size, void *buffer, ErrorHandler *errh)
 {
     // we may need to read bits of the file
-    if (_pos + size <= _len) {
+    if (_pos + size <= _len || have_mmap(size)) {
 	const uint8_t *chunk = _buffer + _pos;
 	_pos += size;
 	return reinterpret_cast<const uint8_t *>(chunk);
@@ -503,7 +686,7 @@ String
 FromFile::get_string(size_t size, ErrorHandler *errh)
 {
     // we may need to read bits of the file
-    if (_pos + size <= _len) {
+    if (_pos + size <= _len || have_mmap(size)) {
 	const uint8_t *chunk = _buffer + _pos;
 	_pos += size;
 	return String::make_stable((const char *) chunk, size);
@@ -519,7 +702,7 @@ FromFile::get_string(size_t size, ErrorHandler *errh)
 Packet *
 FromFile::get_packet(size_t size, uint32_t sec, uint32_t subsec, ErrorHandler *errh)
 {
-    if (_pos + size <= _len) {
+    if (_pos + size <= _len || have_mmap(size)) {
 	if (Packet *p = _data_packet->clone()) {
 	    p->shrink_data(_buffer + _pos, size);
 	    p->timestamp_anno().assign(sec, subsec);
@@ -0,0 +1,366 @@
+// -*- c-basic-offset: 4; related-file-name: "../include/click/iouring.hh" -*-
+/*
+ * iouring.{cc,hh} -- io_uring asynchronous I/O engine
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, subject to the conditions
+ * listed in the Click LICENSE file. These conditions include: you must
+ * preserve this copyright notice, and you cannot mention the copyright
+ * holders in advertising related to the Software without their permission.
+ * The Software is provided WITHOUT ANY WARRANTY, EXPRESS OR IMPLIED. This
+ * notice is a summary of the Click LICENSE file; the license in that file is
+ * legally binding.
+ */
+
+#include <click/config.h>
+#include <click/iouring.hh>
+#include <click/glue.hh>
+#if HAVE_LINUX_IO_URING_H
+# include <linux/io_uring.h>
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <sys/socket.h>
+# include <unistd.h>
+# if !defined(__NR_io_uring_setup) || !defined(__NR_io_uring_enter) || !defined(__NR_io_uring_register)
+#  undef HAVE_LINUX_IO_URING_H
+# endif
+#endif
+CLICK_DECLS
+
+#if HAVE_LINUX_IO_URING_H
+namespace {
+// glibc has no wrappers for the io_uring system calls.
+inline int
+sys_io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+    return syscall(__NR_io_uring_setup, entries, p);
+}
+
+inline int
+sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+		   unsigned flags)
+{
+    return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+		   (void *) 0, (size_t) 0);
+}
+
+inline int
+sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nargs)
+{
+    return syscall(__NR_io_uring_register, fd, opcode, arg, nargs);
+}
+
+// The kernel reads the submission tail and writes the completion tail
+// concurrently with us.
+inline unsigned
+load_acquire(const unsigned *x)
+{
+    return __atomic_load_n(x, __ATOMIC_ACQUIRE);
+}
+
+inline void
+store_release(unsigned *x, unsigned v)
+{
+    __atomic_store_n(x, v, __ATOMIC_RELEASE);
+}
+}
+#endif
+
+IOUring::IOUring()
+    : _fd(-1), _sq_entries(0), _sq_tail(0), _nqueued(0),
+      _sq_map(0), _cq_map(0), _free_slot(-1), _inflight(0)
+{
+}
+
+IOUring::~IOUring()
+{
+#if HAVE_LINUX_IO_URING_H
+    if (_fd >= 0) {
+	munmap(_sqes, _sqes_map_size);
+	if (_cq_map != _sq_map)
+	    munmap(_cq_map, _cq_map_size);
+	munmap(_sq_map, _sq_map_size);
+	close(_fd);
+    }
+#endif
+}
+
+int
+IOUring::initialize(unsigned entries, int wake_fd)
+{
+#if HAVE_LINUX_IO_URING_H
+    assert(_fd < 0);
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int fd = sys_io_uring_setup(entries, &p);
+    if (fd < 0)
+	return -errno;
+
+    _sq_map_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    _cq_map_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+	if (_cq_map_size > _sq_map_size)
+	    _sq_map_size = _cq_map_size;
+	_cq_map_size = _sq_map_size;
+    }
+    _sqes_map_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    void *sqes = MAP_FAILED;
+    _sq_map = mmap(0, _sq_map_size, PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (_sq_map == MAP_FAILED)
+	goto fail;
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+	_cq_map = _sq_map;
+    else if ((_cq_map = mmap(0, _cq_map_size, PROT_READ | PROT_WRITE,
+			     MAP_SHARED | MAP_POPULATE, fd,
+			     IORING_OFF_CQ_RING)) == MAP_FAILED)
+	goto fail;
+    sqes = mmap(0, _sqes_map_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+	goto fail;
+
+    // Completions signal the RouterThread's wake eventfd, so a thread
+    // blocked in select() notices them.
+    if (wake_fd >= 0
+	&& sys_io_uring_register(fd, IORING_REGISTER_EVENTFD, &wake_fd, 1) < 0)
+	goto fail;
+
+    {
+	char *sq = static_cast<char *>(_sq_map);
+	char *cq = static_cast<char *>(_cq_map);
+	_sq_entries = p.sq_entries;
+	_sq_mask = *reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+	_sq_khead = reinterpret_cast<unsigned *>(sq + p.sq_off.head);
+	_sq_ktail = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+	_sq_array = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+	_sq_tail = *_sq_ktail;
+	_sqes = static_cast<struct io_uring_sqe *>(sqes);
+	_cq_mask = *reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+	_cq_khead = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+	_cq_ktail = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+	_cqes = reinterpret_cast<struct io_uring_cqe *>(cq + p.cq_off.cqes);
+    }
+
+    // At most cq_entries requests may be outstanding, so the completion
+    // queue never overflows.
+    _slots.resize(p.cq_entries);
+    for (int i = 0; i < _slots.size(); ++i)
+	_slots[i].next = i + 1 < _slots.size() ? i + 1 : -1;
+    _free_slot = 0;
+    _fd = fd;
+    return 0;
+
+  fail:
+    int err = -errno;
+    if (sqes != MAP_FAILED)
+	munmap(sqes, _sqes_map_size);
+    if (_cq_map && _cq_map != MAP_FAILED && _cq_map != _sq_map)
+	munmap(_cq_map, _cq_map_size);
+    if (_sq_map != MAP_FAILED)
+	munmap(_sq_map, _sq_map_size);
+    _sq_map = _cq_map = 0;
+    close(fd);
+    return err;
+#else
+    (void) entries, (void) wake_fd;
+    return -ENOSYS;
+#endif
+}
+
+#if HAVE_LINUX_IO_URING_H
+struct io_uring_sqe *
+IOUring::prepare(int op, int fd, Callback callback, void *user_data)
+{
+    assert(_fd >= 0);
+    while (_free_slot < 0)
+	wait_one();
+    if (_sq_tail - load_acquire(_sq_khead) == _sq_entries)
+	submit();
+    while (_sq_tail - load_acquire(_sq_khead) == _sq_entries)
+	wait_one();
+
+    int slot = _free_slot;
+    _free_slot = _slots[slot].next;
+    _slots[slot].callback = callback;
+    _slots[slot].user_data = user_data;
+    _slots[slot].next = -2;
+    ++_inflight;
+
+    unsigned idx = _sq_tail & _sq_mask;
+    struct io_uring_sqe *sqe = &_sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = op;
+    sqe->fd = fd;
+    sqe->user_data = slot;
+    _sq_array[idx] = idx;
+    ++_sq_tail;
+    ++_nqueued;
+    return sqe;
+}
+#endif
+
+int
+IOUring::read(int fd, void *buf, size_t len, off_t offset,
+	      Callback callback, void *user_data)
+{
+#if HAVE_LINUX_IO_URING_H
+    struct io_uring_sqe *sqe = prepare(IORING_OP_READ, fd, callback, user_data);
+    sqe->addr = reinterpret_cast<uintptr_t>(buf);
+    sqe->len = len;
+    sqe->off = offset;
+    return 0;
+#else
+    (void) fd, (void) buf, (void) len, (void) offset, (void) callback, (void) user_data;
+    return -ENOSYS;
+#endif
+}
+
+int
+IOUring::write(int fd, const void *buf, size_t len, off_t offset,
+	       Callback callback, void *user_data)
+{
+#if HAVE_LINUX_IO_URING_H
+    struct io_uring_sqe *sqe = prepare(IORING_OP_WRITE, fd, callback, user_data);
+    sqe->addr = reinterpret_cast<uintptr_t>(buf);
+    sqe->len = len;
+    sqe->off = offset;
+    return 0;
+#else
+    (void) fd, (void) buf, (void) len, (void) offset, (void) callback, (void) user_data;
+    return -ENOSYS;
+#endif
+}
+
+int
+IOUring::recvmsg(int fd, struct msghdr *msg, int flags,
+		 Callback callback, void *user_data)
+{
+#if HAVE_LINUX_IO_URING_H
+    struct io_uring_sqe *sqe = prepare(IORING_OP_RECVMSG, fd, callback, user_data);
+    sqe->addr = reinterpret_cast<uintptr_t>(msg);
+    sqe->len = 1;
+    sqe->msg_flags = flags;
+    return 0;
+#else
+    (void) fd, (void) msg, (void) flags, (void) callback, (void) user_data;
+    return -ENOSYS;
+#endif
+}
+
+int
+IOUring::sendmsg(int fd, const struct msghdr *msg, int flags,
+		 Callback callback, void *user_data)
+{
+#if HAVE_LINUX_IO_URING_H
+    struct io_uring_sqe *sqe = prepare(IORING_OP_SENDMSG, fd, callback, user_data);
+    sqe->addr = reinterpret_cast<uintptr_t>(msg);
+    sqe->len = 1;
+    sqe->msg_flags = flags;
+    return 0;
+#else
+    (void) fd, (void) msg, (void) flags, (void) callback, (void) user_data;
+    return -ENOSYS;
+#endif
+}
+
+void
+IOUring::submit()
+{
+#if HAVE_LINUX_IO_URING_H
+    if (!_nqueued)
+	return;
+    store_release(_sq_ktail, _sq_tail);
+    int r = sys_io_uring_enter(_fd, _nqueued, 0, 0);
+    if (r >= 0)
+	_nqueued -= r;
+    else if (errno != EAGAIN && errno != EBUSY && errno != EINTR)
+	click_chatter("io_uring_enter: %s", strerror(errno));
+    // otherwise, try again on the next run()
+#endif
+}
+
+int
+IOUring::run()
+{
+#if HAVE_LINUX_IO_URING_H
+    submit();
+    int n = 0;
+    unsigned head = *_cq_khead;
+    while (head != load_acquire(_cq_ktail)) {
+	struct io_uring_cqe *cqe = &_cqes[head & _cq_mask];
+	int slot = cqe->user_data;
+	int result = cqe->res;
+	store_release(_cq_khead, ++head);
+
+	// Free the slot before calling back, so the callback can submit
+	// another request.
+	Slot &s = _slots[slot];
+	Callback callback = s.callback;
+	void *user_data = s.user_data;
+	s.next = _free_slot;
+	_free_slot = slot;
+	--_inflight;
+	if (callback)
+	    callback(result, user_data);
+	++n;
+	head = *_cq_khead;
+    }
+    return n;
+#else
+    return 0;
+#endif
+}
+
+#if HAVE_LINUX_IO_URING_H
+void
+IOUring::wait_one()
+{
+    store_release(_sq_ktail, _sq_tail);
+    int r = sys_io_uring_enter(_fd, _nqueued, 1, IORING_ENTER_GETEVENTS);
+    if (r >= 0)
+	_nqueued -= r;
+    else if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+	click_chatter("io_uring_enter: %s", strerror(errno));
+    run();
+}
+
+bool
+IOUring::has_pending(void *user_data) const
+{
+    for (int i = 0; i < _slots.size(); ++i)
+	if (_slots[i].next == -2 && _slots[i].user_data == user_data)
+	    return true;
+    return false;
+}
+#endif
+
+void
+IOUring::wait(void *user_data)
+{
+#if HAVE_LINUX_IO_URING_H
+    while (has_pending(user_data))
+	wait_one();
+#else
+    (void) user_data;
+#endif
+}
+
+void
+IOUring::cancel(void *user_data)
+{
+#if HAVE_LINUX_IO_URING_H
+    for (int i = 0; i < _slots.size(); ++i)
+	if (_slots[i].next == -2 && _slots[i].user_data == user_data) {
+	    struct io_uring_sqe *sqe = prepare(IORING_OP_ASYNC_CANCEL, -1, 0, 0);
+	    sqe->addr = i;
+	}
+    wait(user_data);
+#else
+    (void) user_data;
+#endif
+}
+
+CLICK_ENDDECLS
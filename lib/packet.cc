@@ -22,11 +22,26 @@
 #define CLICK_PACKET_DEPRECATED_ENUM
 #include <click/packet.hh>
 #include <click/packet_anno.hh>
+#include <click/packetbatch.hh>
 #include <click/glue.hh>
 #include <click/sync.hh>
 #if CLICK_USERLEVEL || CLICK_MINIOS
 # include <unistd.h>
 #endif
+#if HAVE_CLICK_PACKET_ARENA
+# include <click/straccum.hh>
+# include <sys/mman.h>
+# if defined(__linux__)
+#  include <sys/syscall.h>
+#  include <linux/mempolicy.h>
+# endif
+# if defined(SYS_getcpu) && defined(SYS_mbind) && defined(_LINUX_MEMPOLICY_H)
+#  define HAVE_PACKET_ARENA_NUMA 1
+# endif
+# if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#  define MAP_ANONYMOUS MAP_ANON
+# endif
+#endif
 CLICK_DECLS
 
 /** @file packet.hh
@@ -255,9 +270,45 @@ struct PacketPool {
 #  if HAVE_MULTITHREAD
     PacketPool* thread_pool_next; // link to next per-thread pool
 #  endif
+#  if HAVE_CLICK_PACKET_ARENA
+    unsigned char* arena;       // next uncarved buffer in arena region
+    unsigned char* arena_end;   // end of arena region
+#  endif
+};
+}
+
+// Maximum # packets (and # data buffers) kept in a thread's pool; also the
+// size of the batches exchanged with the global pool.
+static unsigned packet_pool_size = CLICK_PACKET_POOL_SIZE;
+
+#  if HAVE_CLICK_PACKET_ARENA
+// Packet arena: When enabled, pooled data buffers are carved from 2MB
+// regions allocated per thread, backed by huge pages where the system has
+// them, and placed on the NUMA node of the allocating thread.  Arena buffers
+// have packet_arena_free as their destructor.  They circulate through the
+// pools like other buffers but never return to the heap; regions are
+// unmapped only at exit.  A region's first buffer slot holds its header.
+
+#   define CLICK_PACKET_ARENA_REGION_SIZE	(2U << 20)
+
+namespace {
+struct PacketArenaRegion {
+    PacketArenaRegion* next;    // link to next region
+    int node;                   // NUMA node, or -1 if unknown
+    bool hugepage;              // true iff backed by huge pages
 };
 }
 
+static void packet_arena_free(unsigned char* buf, size_t size, void* arg);
+static bool packet_arena_enabled;
+static PacketArenaRegion* packet_arena_regions;
+// Destructor carried by buffers that may enter the pools.
+static Packet::buffer_destructor_type pool_destructor;
+#  else
+static const bool packet_arena_enabled = false;
+static const Packet::buffer_destructor_type pool_destructor = 0;
+#  endif
+
 #  if HAVE_MULTITHREAD
 static __thread PacketPool *thread_packet_pool;
 
@@ -307,6 +358,165 @@ static inline PacketPool* make_local_packet_pool() {
 #  endif
 }
 
+#  if HAVE_MULTITHREAD
+/** @brief Move batches from the global pool to @a packet_pool.
+
+    Takes the global pool lock once, then moves batches until @a packet_pool
+    holds at least @a np packets and @a npd data buffers, or the global pool
+    runs dry. */
+static void
+global_packet_pool_get(PacketPool& packet_pool, unsigned np, unsigned npd)
+{
+    while (atomic_uint32_t::swap(global_packet_pool.lock, 1) == 1)
+	/* do nothing */;
+
+    while (packet_pool.pcount < np && global_packet_pool.pbatch) {
+	WritablePacket *pp = global_packet_pool.pbatch;
+	global_packet_pool.pbatch = static_cast<WritablePacket *>(pp->prev());
+	--global_packet_pool.pbatchcount;
+	unsigned n = pp->anno_u32(0);
+	if (WritablePacket *tail = packet_pool.p) {
+	    while (tail->next())
+		tail = static_cast<WritablePacket *>(tail->next());
+	    tail->set_next(pp);
+	} else
+	    packet_pool.p = pp;
+	packet_pool.pcount += n;
+    }
+
+    while (packet_pool.pdcount < npd && global_packet_pool.pdbatch) {
+	PacketData *pd = global_packet_pool.pdbatch;
+	global_packet_pool.pdbatch = pd->batch_next;
+	--global_packet_pool.pdbatchcount;
+	unsigned n = pd->batch_pdcount;
+	if (PacketData *tail = packet_pool.pd) {
+	    while (tail->next)
+		tail = tail->next;
+	    tail->next = pd;
+	} else
+	    packet_pool.pd = pd;
+	packet_pool.pdcount += n;
+    }
+
+    click_compiler_fence();
+    global_packet_pool.lock = 0;
+}
+
+/** @brief Hand full batches to the global pool.
+
+    @a pbatch is a list of packet batches linked by p->prev(), with each
+    batch's count in p->anno_u32(0); @a pdbatch is a list of data buffer
+    batches linked by pd->batch_next.  Takes the global pool lock once.
+    Batches that do not fit in the global pool are freed, except that arena
+    data buffers are always kept. */
+static void
+global_packet_pool_put(WritablePacket* pbatch, PacketData* pdbatch)
+{
+    while (atomic_uint32_t::swap(global_packet_pool.lock, 1) == 1)
+	/* do nothing */;
+
+    while (WritablePacket *pb = pbatch) {
+	pbatch = static_cast<WritablePacket *>(pb->prev());
+	if (global_packet_pool.pbatchcount >= CLICK_GLOBAL_PACKET_POOL_COUNT) {
+	    while (WritablePacket *p = pb) {
+		pb = static_cast<WritablePacket *>(p->next());
+		::operator delete((void *) p);
+	    }
+	} else {
+	    pb->set_prev(global_packet_pool.pbatch);
+	    global_packet_pool.pbatch = pb;
+	    ++global_packet_pool.pbatchcount;
+	}
+    }
+
+    while (PacketData *pdb = pdbatch) {
+	pdbatch = pdb->batch_next;
+	if (global_packet_pool.pdbatchcount >= CLICK_GLOBAL_PACKET_POOL_COUNT
+	    && !packet_arena_enabled) {
+	    while (PacketData *pd = pdb) {
+		pdb = pd->next;
+		delete[] reinterpret_cast<unsigned char *>(pd);
+	    }
+	} else {
+	    pdb->batch_next = global_packet_pool.pdbatch;
+	    global_packet_pool.pdbatch = pdb;
+	    ++global_packet_pool.pdbatchcount;
+	}
+    }
+
+    click_compiler_fence();
+    global_packet_pool.lock = 0;
+}
+#  endif /* HAVE_MULTITHREAD */
+
+#  if HAVE_CLICK_PACKET_ARENA
+/** @brief Map a new arena region for @a packet_pool.
+
+    Tries huge pages first, then ordinary pages.  The region's pages are
+    bound to the calling thread's NUMA node before they are touched. */
+static bool
+packet_arena_grow(PacketPool& packet_pool)
+{
+    size_t size = CLICK_PACKET_ARENA_REGION_SIZE;
+    bool hugepage = false;
+    void *m = MAP_FAILED;
+#   ifdef MAP_HUGETLB
+    m = mmap(0, size, PROT_READ | PROT_WRITE,
+	     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    hugepage = (m != MAP_FAILED);
+#   endif
+    if (m == MAP_FAILED
+	&& (m = mmap(0, size, PROT_READ | PROT_WRITE,
+		     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED)
+	return false;
+
+    int node = -1;
+#   if HAVE_PACKET_ARENA_NUMA
+    unsigned cpu, n;
+    unsigned long mask[16];
+    const unsigned mask_bits = sizeof(mask) * 8;
+    if (syscall(SYS_getcpu, &cpu, &n, (void *) 0) == 0 && n < mask_bits - 1) {
+	memset(mask, 0, sizeof(mask));
+	mask[n / (sizeof(mask[0]) * 8)] |= 1UL << (n % (sizeof(mask[0]) * 8));
+	(void) syscall(SYS_mbind, m, size, MPOL_PREFERRED, mask, mask_bits, 0);
+	node = n;
+    }
+#   endif
+
+    PacketArenaRegion *r = reinterpret_cast<PacketArenaRegion *>(m);
+    r->node = node;
+    r->hugepage = hugepage;
+#   if HAVE_MULTITHREAD
+    while (atomic_uint32_t::swap(global_packet_pool.lock, 1) == 1)
+	/* do nothing */;
+#   endif
+    r->next = packet_arena_regions;
+    packet_arena_regions = r;
+#   if HAVE_MULTITHREAD
+    click_compiler_fence();
+    global_packet_pool.lock = 0;
+#   endif
+
+    packet_pool.arena = reinterpret_cast<unsigned char *>(m) + CLICK_PACKET_POOL_BUFSIZ;
+    packet_pool.arena_end = reinterpret_cast<unsigned char *>(m) + size;
+    return true;
+}
+
+/** @brief Carve a fresh data buffer from @a packet_pool's arena.
+
+    Returns null if no region could be mapped. */
+static inline unsigned char *
+packet_arena_allocate(PacketPool& packet_pool)
+{
+    if (packet_pool.arena == packet_pool.arena_end
+	&& !packet_arena_grow(packet_pool))
+	return 0;
+    unsigned char *data = packet_pool.arena;
+    packet_pool.arena += CLICK_PACKET_POOL_BUFSIZ;
+    return data;
+}
+#  endif /* HAVE_CLICK_PACKET_ARENA */
+
 WritablePacket *
 WritablePacket::pool_allocate(bool with_data)
 {
@@ -317,29 +527,8 @@ WritablePacket::pool_allocate(bool with_data)
     // Steal packets and/or data from the global pool if there's nothing on
     // the local pool.
     if ((!packet_pool.p && global_packet_pool.pbatch)
-	|| (with_data && !packet_pool.pd && global_packet_pool.pdbatch)) {
-	while (atomic_uint32_t::swap(global_packet_pool.lock, 1) == 1)
-	    /* do nothing */;
-
-	WritablePacket *pp;
-	if (!packet_pool.p && (pp = global_packet_pool.pbatch)) {
-	    global_packet_pool.pbatch = static_cast<WritablePacket *>(pp->prev());
-	    --global_packet_pool.pbatchcount;
-	    packet_pool.p = pp;
-	    packet_pool.pcount = pp->anno_u32(0);
-	}
-
-	PacketData *pd;
-	if (with_data && !packet_pool.pd && (pd = global_packet_pool.pdbatch)) {
-	    global_packet_pool.pdbatch = pd->batch_next;
-	    --global_packet_pool.pdbatchcount;
-	    packet_pool.pd = pd;
-	    packet_pool.pdcount = pd->batch_pdcount;
-	}
-
-	click_compiler_fence();
-	global_packet_pool.lock = 0;
-    }
+	|| (with_data && !packet_pool.pd && global_packet_pool.pdbatch))
+	global_packet_pool_get(packet_pool, 1, with_data ? 1 : 0);
 #  endif /* HAVE_MULTITHREAD */
 
     WritablePacket *p = packet_pool.p;
@@ -367,6 +556,12 @@ WritablePacket::pool_allocate(uint32_t headroom, uint32_t length,
 	    packet_pool.pd = pd->next;
 	    --packet_pool.pdcount;
 	    p->_head = reinterpret_cast<unsigned char *>(pd);
+	    p->_destructor = pool_destructor;
+#  if HAVE_CLICK_PACKET_ARENA
+	} else if (n == CLICK_PACKET_POOL_BUFSIZ && packet_arena_enabled
+		   && (p->_head = packet_arena_allocate(packet_pool))) {
+	    p->_destructor = packet_arena_free;
+#  endif
 	} else if ((p->_head = new unsigned char[n]))
 	    /* OK */;
 	else {
@@ -381,84 +576,230 @@ WritablePacket::pool_allocate(uint32_t headroom, uint32_t length,
 }
 
 void
-WritablePacket::recycle(WritablePacket *p)
+WritablePacket::pool_reserve(unsigned n, bool with_data)
+{
+    PacketPool& packet_pool = *make_local_packet_pool();
+    (void) n, (void) with_data;
+#  if HAVE_MULTITHREAD
+    if ((packet_pool.pcount < n && global_packet_pool.pbatch)
+	|| (with_data && packet_pool.pdcount < n && global_packet_pool.pdbatch))
+	global_packet_pool_get(packet_pool, n, with_data ? n : 0);
+#  endif
+}
+
+/** @brief Destroy @a p and return its pooled data buffer, if any. */
+inline unsigned char *
+WritablePacket::recycle_prepare(WritablePacket *p)
 {
     unsigned char *data = 0;
-    if (!p->_data_packet && p->_head && !p->_destructor
+    if (!p->_data_packet && p->_head && p->_destructor == pool_destructor
 	&& p->_end - p->_head == CLICK_PACKET_POOL_BUFSIZ) {
 	data = p->_head;
 	p->_head = 0;
     }
     p->~WritablePacket();
+    return data;
+}
 
-    PacketPool& packet_pool = *make_local_packet_pool();
-#  if HAVE_MULTITHREAD
-    if ((packet_pool.p && packet_pool.pcount == CLICK_PACKET_POOL_SIZE)
-	|| (data && packet_pool.pd && packet_pool.pdcount == CLICK_PACKET_POOL_SIZE)) {
-	while (atomic_uint32_t::swap(global_packet_pool.lock, 1) == 1)
-	    /* do nothing */;
+/** @brief Add @a p and @a data to the local pool.
 
-	if (packet_pool.p && packet_pool.pcount == CLICK_PACKET_POOL_SIZE) {
-	    if (global_packet_pool.pbatchcount == CLICK_GLOBAL_PACKET_POOL_COUNT) {
-		while (WritablePacket *p = packet_pool.p) {
-		    packet_pool.p = static_cast<WritablePacket *>(p->next());
-		    ::operator delete((void *) p);
-		}
-	    } else {
-		packet_pool.p->set_prev(global_packet_pool.pbatch);
-                packet_pool.p->set_anno_u32(0, packet_pool.pcount);
-		global_packet_pool.pbatch = packet_pool.p;
-		++global_packet_pool.pbatchcount;
-		packet_pool.p = 0;
-	    }
+    Either may be null.  In multithreaded drivers, a local list that reaches
+    packet_pool_size is detached and prepended to @a pbatch or @a pdbatch for
+    global_packet_pool_put().  Otherwise, objects that do not fit are freed;
+    arena data buffers always fit. */
+static inline void
+local_packet_pool_put(PacketPool& packet_pool,
+		      WritablePacket* p, unsigned char* data,
+		      WritablePacket*& pbatch, PacketData*& pdbatch)
+{
+    (void) pbatch, (void) pdbatch;
+    if (p) {
+#  if HAVE_MULTITHREAD
+	if (packet_pool.p && packet_pool.pcount >= packet_pool_size) {
+	    packet_pool.p->set_prev(pbatch);
+	    packet_pool.p->set_anno_u32(0, packet_pool.pcount);
+	    pbatch = packet_pool.p;
+	    packet_pool.p = 0;
 	    packet_pool.pcount = 0;
 	}
-
-	if (data && packet_pool.pd && packet_pool.pdcount == CLICK_PACKET_POOL_SIZE) {
-	    if (global_packet_pool.pdbatchcount == CLICK_GLOBAL_PACKET_POOL_COUNT) {
-		while (PacketData *pd = packet_pool.pd) {
-		    packet_pool.pd = pd->next;
-		    delete[] reinterpret_cast<unsigned char *>(pd);
-		}
-	    } else {
-		packet_pool.pd->batch_next = global_packet_pool.pdbatch;
-                packet_pool.pd->batch_pdcount = packet_pool.pdcount;
-		global_packet_pool.pdbatch = packet_pool.pd;
-		++global_packet_pool.pdbatchcount;
-		packet_pool.pd = 0;
-	    }
-	    packet_pool.pdcount = 0;
+#  else
+	if (packet_pool.pcount >= packet_pool_size) {
+	    ::operator delete((void *) p);
+	    p = 0;
 	}
-
-	click_compiler_fence();
-	global_packet_pool.lock = 0;
-    }
-#  else /* !HAVE_MULTITHREAD */
-    if (packet_pool.pcount == CLICK_PACKET_POOL_SIZE) {
-	::operator delete((void *) p);
-	p = 0;
-    }
-    if (data && packet_pool.pdcount == CLICK_PACKET_POOL_SIZE) {
-	delete[] data;
-	data = 0;
+#  endif
     }
-#  endif /* HAVE_MULTITHREAD */
-
     if (p) {
 	++packet_pool.pcount;
 	p->set_next(packet_pool.p);
 	packet_pool.p = p;
-	assert(packet_pool.pcount <= CLICK_PACKET_POOL_SIZE);
+    }
+
+    if (data) {
+#  if HAVE_MULTITHREAD
+	if (packet_pool.pd && packet_pool.pdcount >= packet_pool_size) {
+	    packet_pool.pd->batch_next = pdbatch;
+	    packet_pool.pd->batch_pdcount = packet_pool.pdcount;
+	    pdbatch = packet_pool.pd;
+	    packet_pool.pd = 0;
+	    packet_pool.pdcount = 0;
+	}
+#  else
+	if (packet_pool.pdcount >= packet_pool_size && !packet_arena_enabled) {
+	    delete[] data;
+	    data = 0;
+	}
+#  endif
     }
     if (data) {
 	++packet_pool.pdcount;
 	PacketData *pd = reinterpret_cast<PacketData *>(data);
 	pd->next = packet_pool.pd;
 	packet_pool.pd = pd;
-	assert(packet_pool.pdcount <= CLICK_PACKET_POOL_SIZE);
     }
 }
 
+void
+WritablePacket::recycle(WritablePacket *p)
+{
+    unsigned char *data = recycle_prepare(p);
+    PacketPool& packet_pool = *make_local_packet_pool();
+    WritablePacket *pbatch = 0;
+    PacketData *pdbatch = 0;
+    local_packet_pool_put(packet_pool, p, data, pbatch, pdbatch);
+#  if HAVE_MULTITHREAD
+    if (pbatch || pdbatch)
+	global_packet_pool_put(pbatch, pdbatch);
+#  endif
+}
+
+void
+WritablePacket::recycle_bulk(PacketBatch &batch)
+{
+    PacketPool& packet_pool = *make_local_packet_pool();
+    WritablePacket *pbatch = 0;
+    PacketData *pdbatch = 0;
+    while (Packet *x = batch.pop_front())
+	if (x->_use_count.dec_and_test()) {
+	    WritablePacket *p = static_cast<WritablePacket *>(x);
+	    unsigned char *data = recycle_prepare(p);
+	    local_packet_pool_put(packet_pool, p, data, pbatch, pdbatch);
+	}
+#  if HAVE_MULTITHREAD
+    // Only one lock acquisition, however many batches filled up.
+    if (pbatch || pdbatch)
+	global_packet_pool_put(pbatch, pdbatch);
+#  endif
+}
+
+/** @brief Return the maximum size of each thread's packet pool.
+
+    Each thread keeps up to this many free packets, and up to this many free
+    data buffers, for reuse.  Surplus objects move to a shared global pool in
+    batches of this size. */
+unsigned
+Packet::packet_pool_size()
+{
+    return ::packet_pool_size;
+}
+
+/** @brief Set the maximum size of each thread's packet pool.
+    @param size new size; must be positive
+
+    Takes effect the next time a thread frees a packet.  Batches already in
+    the global pool keep their old sizes.  The packet_pool_size global
+    handler calls this function. */
+void
+Packet::set_packet_pool_size(unsigned size)
+{
+    assert(size > 0);
+    ::packet_pool_size = size;
+}
+
+#  if HAVE_CLICK_PACKET_ARENA
+/** @brief Return an arena data buffer to the local pool.
+
+    This is the destructor of arena buffers that are freed other than by
+    recycle(), for example when uniqueify() copies a shared packet. */
+static void
+packet_arena_free(unsigned char* buf, size_t, void*)
+{
+    PacketPool& packet_pool = *make_local_packet_pool();
+    WritablePacket *pbatch = 0;
+    PacketData *pdbatch = 0;
+    local_packet_pool_put(packet_pool, 0, buf, pbatch, pdbatch);
+#   if HAVE_MULTITHREAD
+    if (pdbatch)
+	global_packet_pool_put(0, pdbatch);
+#   endif
+}
+
+/** @brief Return true iff pooled data buffers come from the packet arena. */
+bool
+Packet::packet_arena()
+{
+    return packet_arena_enabled;
+}
+
+/** @brief Set whether pooled data buffers come from the packet arena.
+    @pre No packets have been allocated.
+
+    The packet arena allocates pooled data buffers from 2MB regions, backed
+    by huge pages when available, and binds each region to the NUMA node of
+    the thread that allocated it.  Since packet pools are per thread, a
+    thread's buffers then stay local to that thread's node.  The
+    <tt>click --packet-arena</tt> option calls this function. */
+void
+Packet::set_packet_arena(bool on)
+{
+    packet_arena_enabled = on;
+    pool_destructor = on ? packet_arena_free : 0;
+}
+
+/** @brief Return a description of the packet arena's regions.
+
+    Returns one line per NUMA node, of the form "node N regions R hugepage
+    H buffers B", where R counts regions, H counts regions backed by huge
+    pages, and B counts data buffers the regions hold.  N is "-" for regions
+    whose node is unknown.  The packet_arena global handler calls this
+    function. */
+String
+Packet::packet_arena_stats()
+{
+    enum { nnodes = 64 };
+    unsigned regions[nnodes + 1], hugepages[nnodes + 1];
+    memset(regions, 0, sizeof(regions));
+    memset(hugepages, 0, sizeof(hugepages));
+#   if HAVE_MULTITHREAD
+    while (atomic_uint32_t::swap(global_packet_pool.lock, 1) == 1)
+	/* do nothing */;
+#   endif
+    for (PacketArenaRegion *r = packet_arena_regions; r; r = r->next) {
+	int i = (r->node >= 0 && r->node < nnodes ? r->node + 1 : 0);
+	++regions[i];
+	hugepages[i] += r->hugepage;
+    }
+#   if HAVE_MULTITHREAD
+    click_compiler_fence();
+    global_packet_pool.lock = 0;
+#   endif
+
+    const unsigned per_region = CLICK_PACKET_ARENA_REGION_SIZE / CLICK_PACKET_POOL_BUFSIZ - 1;
+    StringAccum sa;
+    for (int i = 0; i <= nnodes; ++i)
+	if (regions[i]) {
+	    sa << "node ";
+	    if (i)
+		sa << (i - 1);
+	    else
+		sa << '-';
+	    sa << " regions " << regions[i] << " hugepage " << hugepages[i]
+	       << " buffers " << regions[i] * per_region << '\n';
+	}
+    return sa.take_string();
+}
+#  endif /* HAVE_CLICK_PACKET_ARENA */
+
 # endif /* HAVE_PACKET_POOL */
 
 bool
@@ -571,6 +912,59 @@ Packet::make(uint32_t headroom, const void *data,
 #endif
 }
 
+/** @brief Create @a n new packets and append them to @a batch.
+ * @param n number of packets to create
+ * @param headroom headroom in each new packet
+ * @param length length of each new packet
+ * @param tailroom tailroom in each new packet
+ * @param batch batch to which the new packets are appended
+ * @return the number of packets created
+ *
+ * Each packet is created as by make(@a headroom, 0, @a length, @a tailroom):
+ * its data is uninitialized and its annotations are cleared.  Fewer than @a
+ * n packets are created only if memory runs out.
+ *
+ * When packet pools are in use, make_bulk() first refills this thread's pool
+ * with enough packets and data buffers for the whole request, taking the
+ * global pool lock at most once.  This is cheaper than @a n calls to make()
+ * when the local pool is low. */
+int
+Packet::make_bulk(int n, uint32_t headroom, uint32_t length,
+		  uint32_t tailroom, PacketBatch &batch)
+{
+#if HAVE_CLICK_PACKET_POOL
+    if (n > 0)
+	WritablePacket::pool_reserve(n, headroom + length + tailroom <= CLICK_PACKET_POOL_BUFSIZ);
+#endif
+    int i;
+    for (i = 0; i < n; ++i) {
+	WritablePacket *p = make(headroom, 0, length, tailroom);
+	if (!p)
+	    break;
+	batch.append(p);
+    }
+    return i;
+}
+
+/** @brief Kill every packet in @a batch.
+ *
+ * On return, @a batch is empty.  Equivalent to calling kill() on each
+ * packet, but when packet pools are in use, freed packets and data buffers
+ * are returned to this thread's pool together, and any surplus is handed to
+ * the global pool under a single lock acquisition.
+ *
+ * @sa PacketBatch::kill */
+void
+Packet::kill_bulk(PacketBatch &batch)
+{
+#if HAVE_CLICK_PACKET_POOL
+    WritablePacket::recycle_bulk(batch);
+#else
+    while (Packet *p = batch.pop_front())
+	p->kill();
+#endif
+}
+
 #if CLICK_USERLEVEL || CLICK_MINIOS
 /** @brief Create and return a new packet (userlevel).
  * @param data data used in the new packet
@@ -945,10 +1339,9 @@ cleanup_pool(PacketPool *pp, int global)
     while (PacketData *pd = pp->pd) {
 	++pdcount;
 	pp->pd = pd->next;
-	delete[] reinterpret_cast<unsigned char *>(pd);
+	if (!packet_arena_enabled)
+	    delete[] reinterpret_cast<unsigned char *>(pd);
     }
-    assert(pcount <= CLICK_PACKET_POOL_SIZE);
-    assert(pdcount <= CLICK_PACKET_POOL_SIZE);
     assert(global || (pcount == pp->pcount && pdcount == pp->pdcount));
 }
 #endif
@@ -966,7 +1359,7 @@ Packet::static_cleanup()
     unsigned rounds = global_packet_pool.pbatchcount;
     if (rounds < global_packet_pool.pdbatchcount)
         rounds = global_packet_pool.pdbatchcount;
-    assert(rounds <= CLICK_GLOBAL_PACKET_POOL_COUNT);
+    assert(rounds <= CLICK_GLOBAL_PACKET_POOL_COUNT || packet_arena_enabled);
     PacketPool fake_pool;
     while (global_packet_pool.pbatch || global_packet_pool.pdbatch) {
         if ((fake_pool.p = global_packet_pool.pbatch))
@@ -980,6 +1373,13 @@ Packet::static_cleanup()
 # else
     cleanup_pool(&global_packet_pool, 0);
 # endif
+# if HAVE_CLICK_PACKET_ARENA
+    // Arena buffers were not freed above; they go away with their regions.
+    while (PacketArenaRegion *r = packet_arena_regions) {
+	packet_arena_regions = r->next;
+	munmap(r, CLICK_PACKET_ARENA_REGION_SIZE);
+    }
+# endif
 #endif
 }
 
@@ -83,7 +83,9 @@ Router::Router(const String &configuration, Master *master)
       _configuration(configuration),
       _notifier_signals(0),
       _arena_factory(new HashMap_ArenaFactory),
-      _hotswap_router(0), _thread_sched(0), _name_info(0), _next_router(0)
+      _hotswap_router(0), _thread_sched(0), _name_info(0), _next_router(0),
+      _profile_threads(0), _profile_nthreads(0), _profile_nslots(0),
+      _profile_interval(0)
 {
     _refcount = 0;
     _runcount = 0;
@@ -151,6 +153,11 @@ Router::~Router()
         delete ns;
     }
     delete _name_info;
+    if (_profile_interval)
+        --Element::nprofiling;
+    for (int t = 0; t < _profile_nthreads; ++t)
+        delete[] reinterpret_cast<char *>(_profile_threads[t]);
+    delete[] _profile_threads;
     if (_master)
         _master->unregister_router(this);
 }
@@ -1278,6 +1285,168 @@ Router::set_hotswap_router(Router *r)
 }
 
 
+// PROFILING
+
+/** @brief Turn sampled cycle profiling on or off.
+ * @param interval sample interval, or 0 to turn profiling off
+ *
+ * While profiling is on, one in every @a interval port transfers and task
+ * runs on each thread is timed with click_get_cycles().  Each sample charges
+ * its own and child cycles, and the number of packets it moved, to the
+ * called element: push transfers to the element's input port, pull
+ * transfers to its output port, and task runs to the element itself.
+ * Counters are kept per RouterThread and summed when read, so threads never
+ * share a counter; transfers made by other threads are not profiled.  The
+ * "profile_ports.csv" global handler reports them per port, and
+ * "profile_elements.csv" per element.  An element's packets are those that
+ * arrived on its inputs, whether pushed to it or pulled by it, so sources
+ * report none.
+ *
+ * When profiling is off, transfers and task runs cost one extra test of a
+ * global counter.  Counters survive turning profiling off and on; see
+ * reset_profile(). */
+void
+Router::set_profile_interval(unsigned interval)
+{
+    if (interval && !_profile_threads) {
+        _profile_slot.resize(nelements());
+        int nslots = 0;
+        for (int i = 0; i < nelements(); ++i) {
+            _profile_slot[i] = nslots;
+            nslots += 1 + _elements[i]->ninputs() + _elements[i]->noutputs();
+        }
+        int nthreads = _master ? _master->nthreads() : 1;
+        if (nthreads < 1)
+            nthreads = 1;
+        size_t size = sizeof(ProfileThread) + nslots * sizeof(ProfileCounters);
+        ProfileThread **pts = new ProfileThread *[nthreads];
+        for (int t = 0; t < nthreads; ++t) {
+            pts[t] = reinterpret_cast<ProfileThread *>(new char[size]);
+            memset(pts[t], 0, size);
+        }
+        _profile_nslots = nslots;
+        _profile_nthreads = nthreads;
+        click_fence();
+        _profile_threads = pts;
+    }
+    if (interval && !_profile_interval)
+        ++Element::nprofiling;
+    else if (!interval && _profile_interval)
+        --Element::nprofiling;
+    _profile_interval = interval;
+}
+
+/** @brief Zero all profiling counters. */
+void
+Router::reset_profile()
+{
+    for (int t = 0; t < _profile_nthreads; ++t)
+        memset(_profile_threads[t]->counters(), 0,
+               _profile_nslots * sizeof(ProfileCounters));
+}
+
+namespace {
+struct profile_row {
+    int eindex;
+    int which;
+    uint64_t samples;
+    uint64_t packets;
+    click_cycles_t own_cycles;
+    click_cycles_t child_cycles;
+};
+
+int
+profile_row_compar(const void *ap, const void *bp, void *)
+{
+    const profile_row *a = reinterpret_cast<const profile_row *>(ap),
+        *b = reinterpret_cast<const profile_row *>(bp);
+    if (a->own_cycles != b->own_cycles)
+        return a->own_cycles > b->own_cycles ? -1 : 1;
+    else if (a->eindex != b->eindex)
+        return a->eindex - b->eindex;
+    else
+        return a->which - b->which;
+}
+}
+
+String
+Router::profile_report(bool ports) const
+{
+    // Element rows count the packets that arrived on the element's inputs:
+    // pushes to its push inputs, and pulls through its pull inputs, which
+    // are charged to the upstream element's output.  Summing every slot
+    // would count a packet passing through an element twice.
+    Vector<uint64_t> in_packets;
+    if (!ports && _profile_threads) {
+        in_packets.resize(nelements(), 0);
+        for (int t = 0; t < _profile_nthreads; ++t) {
+            const ProfileCounters *cs = _profile_threads[t]->counters();
+            for (int i = 0; i < nelements(); ++i)
+                for (int j = 0; j < _elements[i]->ninputs(); ++j)
+                    if (!_elements[i]->input_is_pull(j))
+                        in_packets[i] += cs[_profile_slot[i] + 1 + j].packets;
+            for (const Connection *cp = _conn.begin(); cp != _conn.end(); ++cp) {
+                Element *from = _elements[(*cp)[1].idx];
+                if (from->output_is_pull((*cp)[1].port))
+                    in_packets[(*cp)[0].idx] +=
+                        cs[_profile_slot[(*cp)[1].idx] + 1 + from->ninputs()
+                           + (*cp)[1].port].packets;
+            }
+        }
+    }
+
+    // sum per-thread counters into one row per element or per port
+    Vector<profile_row> rows;
+    for (int i = 0; _profile_threads && i < nelements(); ++i) {
+        Element *e = _elements[i];
+        int nwhich = 1 + e->ninputs() + e->noutputs();
+        profile_row row;
+        for (int w = 0; w < nwhich; ++w) {
+            if (ports || w == 0) {
+                memset(&row, 0, sizeof(row));
+                row.eindex = i;
+                row.which = w;
+            }
+            for (int t = 0; t < _profile_nthreads; ++t) {
+                const ProfileCounters &c = _profile_threads[t]->counters()[_profile_slot[i] + w];
+                row.samples += c.samples;
+                row.packets += c.packets;
+                row.own_cycles += c.own_cycles;
+                row.child_cycles += c.child_cycles;
+            }
+            if ((ports || w == nwhich - 1) && row.samples) {
+                if (!ports)
+                    row.packets = in_packets[i];
+                rows.push_back(row);
+            }
+        }
+    }
+    if (rows.size())
+        click_qsort(rows.begin(), rows.size(), sizeof(profile_row),
+                    profile_row_compar, 0);
+
+    StringAccum sa;
+    sa << (ports ? "name,port" : "name,class")
+       << ",samples,packets,own_cycles,child_cycles,cycles_per_sample\n";
+    for (profile_row *row = rows.begin(); row != rows.end(); ++row) {
+        Element *e = _elements[row->eindex];
+        sa << _element_names[row->eindex] << ',';
+        if (!ports)
+            sa << e->class_name();
+        else if (row->which == 0)
+            sa << "task";
+        else if (row->which <= e->ninputs())
+            sa << 'i' << (row->which - 1);
+        else
+            sa << 'o' << (row->which - 1 - e->ninputs());
+        sa << ',' << row->samples << ',' << row->packets << ','
+           << row->own_cycles << ',' << row->child_cycles << ','
+           << (row->own_cycles / row->samples) << '\n';
+    }
+    return sa.take_string();
+}
+
+
 // HANDLERS
 
 /** @class Handler
@@ -2188,7 +2357,13 @@ Router::configuration_string() const
 enum { GH_VERSION, GH_CONFIG, GH_FLATCONFIG, GH_LIST, GH_REQUIREMENTS,
        GH_DRIVER, GH_ACTIVE_PORTS, GH_ACTIVE_PORT_STATS, GH_STRING_PROFILE,
        GH_STRING_PROFILE_LONG, GH_SCHEDULING_PROFILE, GH_STOP,
-       GH_ELEMENT_CYCLES, GH_CLASS_CYCLES, GH_RESET_CYCLES };
+       GH_ELEMENT_CYCLES, GH_CLASS_CYCLES, GH_RESET_CYCLES,
+       GH_PACKET_POOL_SIZE, GH_PACKET_ARENA, GH_TIMER_WHEEL,
+       GH_WORK_STEALING, GH_PROFILE, GH_PROFILE_ELEMENTS, GH_PROFILE_PORTS,
+       GH_PROFILE_RESET };
+
+// Prime, so that samples do not lock onto a fixed stage of a periodic path.
+#define DEFAULT_PROFILE_INTERVAL 97
 
 #if CLICK_STATS >= 2
 struct stats_info {
@@ -2284,6 +2459,38 @@ Router::router_read_handler(Element *e, void *thunk)
         break;
 #endif
 
+#if HAVE_CLICK_PACKET_POOL
+    case GH_PACKET_POOL_SIZE:
+        return String(Packet::packet_pool_size());
+#endif
+#if HAVE_CLICK_PACKET_ARENA
+    case GH_PACKET_ARENA:
+        return Packet::packet_arena_stats();
+#endif
+
+    case GH_TIMER_WHEEL:
+        if (r)
+            for (int i = 0; i < r->master()->nthreads(); ++i)
+                sa << i << ' ' << r->master()->thread(i)->timer_set().timer_wheel() << '\n';
+        break;
+
+    case GH_WORK_STEALING:
+        if (r)
+            for (int i = 0; i < r->master()->nthreads(); ++i)
+                sa << i << ' ' << r->master()->thread(i)->work_stealing() << '\n';
+        break;
+
+    case GH_PROFILE:
+        if (r)
+            return String(r->profile_interval());
+        break;
+
+    case GH_PROFILE_ELEMENTS:
+    case GH_PROFILE_PORTS:
+        if (r)
+            return r->profile_report((intptr_t) thunk == GH_PROFILE_PORTS);
+        break;
+
 #if CLICK_DEBUG_MASTER || CLICK_DEBUG_SCHEDULING
     case GH_SCHEDULING_PROFILE:
         if (r)
@@ -2401,6 +2608,53 @@ Router::router_write_handler(const String &s, Element *e, void *thunk, ErrorHand
             r->_elements[i]->reset_cycles();
         break;
 #endif
+#if HAVE_CLICK_PACKET_POOL
+    case GH_PACKET_POOL_SIZE: {
+        unsigned size;
+        if (!IntArg().parse(cp_uncomment(s), size) || size == 0)
+            return errh->error("expected positive integer");
+        Packet::set_packet_pool_size(size);
+        break;
+    }
+#endif
+    case GH_TIMER_WHEEL:
+    case GH_WORK_STEALING: {
+        // "BOOL" sets every thread; "THREAD BOOL" sets one.
+        Vector<String> words;
+        cp_spacevec(cp_uncomment(s), words);
+        int nthreads = r->master()->nthreads(), first = 0, last = nthreads;
+        bool on;
+        if (words.size() == 2 && IntArg().parse(words[0], first)
+            && first >= 0 && first < nthreads)
+            last = first + 1;
+        else if (words.size() != 1)
+            return errh->error("expected [THREAD] BOOL");
+        if (!BoolArg().parse(words.back(), on))
+            return errh->error("expected [THREAD] BOOL");
+        for (int i = first; i < last; ++i)
+            if ((uintptr_t) thunk == GH_TIMER_WHEEL)
+                r->master()->thread(i)->timer_set().set_timer_wheel(on);
+            else
+                r->master()->thread(i)->set_work_stealing(on);
+        break;
+    }
+    case GH_PROFILE: {
+        // "BOOL" or a sample interval; 0 and false turn profiling off
+        unsigned interval;
+        bool on;
+        String str = cp_uncomment(s);
+        if (IntArg().parse(str, interval))
+            /* OK */;
+        else if (BoolArg().parse(str, on))
+            interval = on ? DEFAULT_PROFILE_INTERVAL : 0;
+        else
+            return errh->error("expected BOOL or sample interval");
+        r->set_profile_interval(interval);
+        break;
+    }
+    case GH_PROFILE_RESET:
+        r->reset_profile();
+        break;
     default:
         break;
     }
@@ -2430,6 +2684,22 @@ Router::static_initialize()
         add_read_handler(0, "string_profile_long", router_read_handler, (void *) GH_STRING_PROFILE_LONG);
 # endif
 #endif
+#if HAVE_CLICK_PACKET_POOL
+        add_read_handler(0, "packet_pool_size", router_read_handler, (void *)GH_PACKET_POOL_SIZE);
+        add_write_handler(0, "packet_pool_size", router_write_handler, (void *)GH_PACKET_POOL_SIZE);
+#endif
+#if HAVE_CLICK_PACKET_ARENA
+        add_read_handler(0, "packet_arena", router_read_handler, (void *)GH_PACKET_ARENA);
+#endif
+        add_read_handler(0, "timer_wheel", router_read_handler, (void *)GH_TIMER_WHEEL);
+        add_write_handler(0, "timer_wheel", router_write_handler, (void *)GH_TIMER_WHEEL);
+        add_read_handler(0, "work_stealing", router_read_handler, (void *)GH_WORK_STEALING);
+        add_write_handler(0, "work_stealing", router_write_handler, (void *)GH_WORK_STEALING);
+        add_read_handler(0, "profile", router_read_handler, (void *)GH_PROFILE);
+        add_write_handler(0, "profile", router_write_handler, (void *)GH_PROFILE);
+        add_read_handler(0, "profile_elements.csv", router_read_handler, (void *)GH_PROFILE_ELEMENTS);
+        add_read_handler(0, "profile_ports.csv", router_read_handler, (void *)GH_PROFILE_PORTS);
+        add_write_handler(0, "profile_reset", router_write_handler, (void *)GH_PROFILE_RESET);
 #if CLICK_DEBUG_MASTER || CLICK_DEBUG_SCHEDULING
         add_read_handler(0, "scheduling_profile", router_read_handler, (void *) GH_SCHEDULING_PROFILE);
 #endif
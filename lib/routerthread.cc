@@ -67,7 +67,9 @@ static unsigned long greedy_schedule_jiffies;
  */
 
 RouterThread::RouterThread(Master *master, int id)
-    : _stop_flag(false), _master(master), _id(id), _driver_entered(false)
+    : _stop_flag(false), _task_list_version(0), _steal_failed(false),
+      _master(master), _id(id), _driver_entered(false),
+      _work_stealing(false)
 {
     _pending_head.x = 0;
     _pending_tail = &_pending_head;
@@ -80,9 +82,14 @@ RouterThread::RouterThread(Master *master, int id)
 #elif CLICK_USERLEVEL && HAVE_MULTITHREAD
     _running_processor = click_invalid_processor();
 #endif
+#if CLICK_USERLEVEL
+    _io_uring = 0;
+    _io_uring_failed = false;
+#endif
 
     _task_blocker = 0;
     _task_blocker_waiting = 0;
+    _steal_request = 0;
 #if HAVE_ADAPTIVE_SCHEDULER
     _max_click_share = 80 * Task::MAX_UTILIZATION / 100;
     _min_click_share = Task::MAX_UTILIZATION / 200;
@@ -134,8 +141,33 @@ RouterThread::RouterThread(Master *master, int id)
 RouterThread::~RouterThread()
 {
     assert(!active());
+#if CLICK_USERLEVEL
+    delete _io_uring;
+#endif
 }
 
+#if CLICK_USERLEVEL
+/** @brief Return this thread's io_uring engine, creating it if necessary.
+ *
+ * Returns null if io_uring is unavailable.  Call from this thread, or from
+ * the main thread before the drivers start, for example in an element's
+ * initialize() method. */
+IOUring *
+RouterThread::io_uring()
+{
+    if (!_io_uring && !_io_uring_failed) {
+        _io_uring = new IOUring;
+        int wake_fd = _selects.wake_eventfd();
+        if (wake_fd < 0 || _io_uring->initialize(256, wake_fd) < 0) {
+            delete _io_uring;
+            _io_uring = 0;
+            _io_uring_failed = true;
+        }
+    }
+    return _io_uring;
+}
+#endif
+
 void
 RouterThread::driver_lock_tasks()
 {
@@ -549,6 +581,90 @@ RouterThread::process_pending()
     }
 }
 
+/** @brief Set whether this thread takes part in work stealing.
+ *
+ * An idle work-stealing thread asks the other work-stealing threads for
+ * work.  A thread that has a request outstanding, and at least two runnable
+ * tasks, hands one of its unpinned tasks to the requester with
+ * Task::move_thread().  Requests are posted to a single lock-free slot per
+ * thread, so neither side takes the other's locks.  Pinned tasks (see
+ * Task::set_pinned()) never move. */
+void
+RouterThread::set_work_stealing(bool ws)
+{
+    _work_stealing = ws;
+    if (!ws)
+        _steal_request = 0;
+    else
+        wake();                 // an idle thread must post its request
+}
+
+void
+RouterThread::request_tasks()
+{
+    // post a request to every work-stealing thread that has none
+    uint32_t me = _id + 1;
+    for (int i = 0; i < _master->nthreads(); ++i) {
+        RouterThread *t = _master->thread(i);
+        if (t != this && t->_work_stealing && t->_steal_request.value() == 0)
+            t->_steal_request.compare_swap(0, me);
+    }
+}
+
+void
+RouterThread::hand_off_task()
+{
+    // must be called with thread's lock acquired
+    uint32_t req = _steal_request.value();
+    RouterThread *thief = _master->thread(req - 1);
+
+    // drop requests from threads that have since found work
+    if (thief == this || thief->thread_id() < 0
+        || !thief->_work_stealing || thief->active()) {
+        _steal_request.compare_swap(req, 0);
+        return;
+    }
+
+    // nothing has changed since the last scan found nothing to give away
+    if (_steal_failed && _steal_failed_version == _task_list_version)
+        return;
+
+    Task::Status want_status;
+    want_status.home_thread_id = thread_id();
+    want_status.is_scheduled = true;
+    want_status.is_strong_unscheduled = false;
+
+    // keep at least one runnable task; give away the last unpinned one
+    Task *victim = 0;
+    int nrunnable = 0;
+    for (Task *t = task_begin(); t != task_end(); t = task_next(t))
+        if (t->_status.status == want_status.status) {
+            ++nrunnable;
+            if (!t->_pinned)
+                victim = t;
+        }
+
+    // otherwise leave the request in place until we have work to spare
+    if (victim && nrunnable >= 2) {
+        if (_steal_request.compare_swap(req, 0) == req)
+            victim->move_thread(thief->thread_id());
+        _steal_failed = false;
+    } else {
+        _steal_failed = true;
+        _steal_failed_version = _task_list_version;
+    }
+}
+
+inline void
+RouterThread::balance_tasks()
+{
+    click_compiler_fence();
+    if (_steal_request.value())
+        hand_off_task();
+    if (!active())
+        request_tasks();
+}
+
 void
 RouterThread::driver()
 {
@@ -613,6 +729,10 @@ RouterThread::driver()
             run_tasks(_tasks_per_iter);
         } while (0);
 
+        // trade tasks with other threads
+        if (_work_stealing)
+            balance_tasks();
+
 #if CLICK_USERLEVEL
         // run signals
         run_signals();
@@ -631,6 +751,12 @@ RouterThread::driver()
             timer_set().run_timers(this, _master);
         } while (0);
 
+#if CLICK_USERLEVEL
+        // submit asynchronous I/O and run completions
+        if (_io_uring)
+            _io_uring->run();
+#endif
+
         // run operating system
         do {
 #if !HAVE_ADAPTIVE_SCHEDULER && !BSD_NETISRSCHED
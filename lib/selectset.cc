@@ -33,6 +33,12 @@
 #  define EV_SET_UDATA_CAST	/* nothing */
 # endif
 #endif
+#if HAVE_ALLOW_EPOLL
+# include <sys/epoll.h>
+#endif
+#if HAVE_SYS_EVENTFD_H
+# include <sys/eventfd.h>
+#endif
 CLICK_DECLS
 
 namespace {
@@ -45,6 +51,7 @@ enum { POLLIN = Element::SELECT_READ, POLLOUT = Element::SELECT_WRITE };
 SelectSet::SelectSet()
 {
     _wake_pipe_pending = false;
+    _wake_pipe_shared = false;
     _wake_pipe[0] = _wake_pipe[1] = -1;
 
 #if HAVE_ALLOW_KQUEUE
@@ -57,6 +64,9 @@ SelectSet::SelectSet()
     _kqueue = kqueue();
 # endif
 #endif
+#if HAVE_ALLOW_EPOLL
+    _epoll = epoll_create1(EPOLL_CLOEXEC);
+#endif
 
 #if !HAVE_ALLOW_POLL
     FD_ZERO(&_read_select_fd_set);
@@ -85,24 +95,52 @@ SelectSet::~SelectSet()
 #if HAVE_ALLOW_KQUEUE
     if (_kqueue >= 0)
 	close(_kqueue);
+#endif
+#if HAVE_ALLOW_EPOLL
+    if (_epoll >= 0)
+	close(_epoll);
 #endif
     if (_wake_pipe[0] >= 0) {
 	close(_wake_pipe[0]);
-	close(_wake_pipe[1]);
+	if (_wake_pipe[1] != _wake_pipe[0])
+	    close(_wake_pipe[1]);
     }
 }
 
 void
 SelectSet::initialize()
 {
+    if (_wake_pipe[0] >= 0)
+	return;
+#if HAVE_SYS_EVENTFD_H
+    // Prefer an eventfd: one descriptor, and wakeups coalesce in a counter.
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd >= 0)
+	_wake_pipe[0] = _wake_pipe[1] = fd;
+#endif
     if (_wake_pipe[0] < 0 && pipe(_wake_pipe) >= 0) {
 	fcntl(_wake_pipe[0], F_SETFL, O_NONBLOCK);
 	fcntl(_wake_pipe[1], F_SETFL, O_NONBLOCK);
 	fcntl(_wake_pipe[0], F_SETFD, FD_CLOEXEC);
 	fcntl(_wake_pipe[1], F_SETFD, FD_CLOEXEC);
-	register_select(_wake_pipe[0], true, false);
     }
     assert(_wake_pipe[0] >= 0);
+    register_select(_wake_pipe[0], true, false);
+}
+
+/** @brief Return an eventfd that wakes this SelectSet, or -1 if there is
+    none.
+
+    The caller may arrange for others, such as the kernel, to signal the
+    eventfd.  The SelectSet then drains it after every select. */
+int
+SelectSet::wake_eventfd()
+{
+    initialize();
+    if (_wake_pipe[0] != _wake_pipe[1])
+	return -1;
+    _wake_pipe_shared = true;
+    return _wake_pipe[0];
 }
 
 void
@@ -138,6 +176,7 @@ SelectSet::register_select(int fd, bool add_read, bool add_write)
 	_pollfds.back().events = 0;
     }
     int pi = _selinfo[fd].pollfd;
+    int old_events = _pollfds[pi].events;
 
     // add the elements
     if (add_read)
@@ -145,6 +184,13 @@ SelectSet::register_select(int fd, bool add_read, bool add_write)
     if (add_write)
 	_pollfds[pi].events |= POLLOUT;
 
+#if HAVE_ALLOW_EPOLL
+    if (_epoll >= 0 && _pollfds[pi].events != old_events)
+	update_epoll(fd, old_events, _pollfds[pi].events);
+#else
+    (void) old_events;
+#endif
+
 #if HAVE_ALLOW_KQUEUE
     if (_kqueue >= 0) {
 	// Add events to the kqueue
@@ -252,6 +298,7 @@ SelectSet::remove_pollfd(int pi, int event)
 
     // remove event
     int fd = _pollfds[pi].fd;
+    int old_events = _pollfds[pi].events;
     _pollfds[pi].events &= ~event;
     if (event == POLLIN)
 	_selinfo[fd].read = 0;
@@ -268,6 +315,13 @@ SelectSet::remove_pollfd(int pi, int event)
 	    click_chatter("SelectSet::remove_pollfd(fd %d): kevent: %s", _pollfds[pi].fd, strerror(errno));
     }
 #endif
+#if HAVE_ALLOW_EPOLL
+    // remove event from epoll
+    if (_epoll >= 0 && _pollfds[pi].events != old_events)
+	update_epoll(fd, old_events, _pollfds[pi].events);
+#else
+    (void) old_events;
+#endif
 #if !HAVE_ALLOW_POLL
     // remove event from select list
     if (fd < FD_SETSIZE) {
@@ -338,7 +392,7 @@ SelectSet::post_select(RouterThread *thread, bool acquire)
     (void) acquire;
 #endif
 
-    if (_wake_pipe_pending) {
+    if (_wake_pipe_pending || _wake_pipe_shared) {
 	_wake_pipe_pending = false;
 	char crap[64];
 	while (read(_wake_pipe[0], crap, 64) == 64)
@@ -424,6 +478,78 @@ SelectSet::run_selects_kqueue(RouterThread *thread)
 }
 #endif /* HAVE_ALLOW_KQUEUE */
 
+#if HAVE_ALLOW_EPOLL
+/** @brief Change @a fd's epoll interest from @a old_events to @a events.
+
+    Both are POLLIN/POLLOUT masks; zero means not registered. */
+void
+SelectSet::update_epoll(int fd, int old_events, int events)
+{
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    if (events & POLLIN)
+	ev.events |= EPOLLIN;
+    if (events & POLLOUT)
+	ev.events |= EPOLLOUT;
+    ev.data.fd = fd;
+
+    int op = (!old_events ? EPOLL_CTL_ADD
+	      : events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL);
+    int r = epoll_ctl(_epoll, op, fd, &ev);
+    // If a file descriptor was closed without remove_select(), epoll has
+    // already forgotten it, and its number may have been reused.
+    if (r < 0 && op == EPOLL_CTL_MOD && errno == ENOENT)
+	r = epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &ev);
+    if (r < 0 && op != EPOLL_CTL_DEL) {
+	// Not all file descriptors are epollable (regular files, for
+	// example).  So if we encounter a problem, fall back to select() or
+	// poll().
+	close(_epoll);
+	_epoll = -1;
+    }
+}
+
+void
+SelectSet::run_selects_epoll(RouterThread *thread)
+{
+# if HAVE_MULTITHREAD
+    click_fence();
+    _select_lock.release();
+# endif
+
+    // Decide how long to wait.
+    int timeout;
+    Timestamp t;
+    int delay_type = thread->timer_set().next_timer_delay(thread->active(), t);
+    if (delay_type == 0)
+	timeout = 0;
+    else if (delay_type > 0)
+	timeout = (t.sec() >= INT_MAX / 1000 ? INT_MAX - 1000 : t.msecval());
+    else
+	timeout = -1;
+    thread->set_thread_state_for_blocking(delay_type);
+
+    struct epoll_event ev[256];
+    int n = epoll_wait(_epoll, &ev[0], 256, timeout);
+    int was_errno = errno;
+
+    if (post_select(thread, true))
+	return;
+
+    thread->set_thread_state(RouterThread::S_RUNSELECT);
+    if (n < 0 && was_errno != EINTR)
+	perror("epoll_wait");
+    else if (n > 0)
+	// epoll reports each file descriptor at most once per call, and
+	// call_selected() tolerates selectors removed by earlier callbacks.
+	for (struct epoll_event *p = &ev[0]; p < &ev[n]; ++p) {
+	    int mask = (p->events & ~EPOLLOUT ? Element::SELECT_READ : 0)
+		+ (p->events & ~EPOLLIN ? Element::SELECT_WRITE : 0);
+	    call_selected(p->data.fd, mask);
+	}
+}
+#endif /* HAVE_ALLOW_EPOLL */
+
 #if HAVE_ALLOW_POLL
 void
 SelectSet::run_selects_poll(RouterThread *thread)
@@ -577,6 +703,12 @@ SelectSet::run_selects(RouterThread *thread)
 	    break;
 	}
 #endif
+#if HAVE_ALLOW_EPOLL
+	if (_epoll >= 0) {
+	    run_selects_epoll(thread);
+	    break;
+	}
+#endif
 #if HAVE_ALLOW_POLL
 	run_selects_poll(thread);
 #else
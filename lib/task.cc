@@ -211,6 +211,7 @@ Task::complete_schedule(RouterThread* process_pending_thread)
     thread->_task_link._prev = this;
     _prev->_next = this;
 #endif /* HAVE_STRIDE_SCHED */
+    ++thread->_task_list_version;
 
  done:
     if (process_pending_thread) {
@@ -376,6 +377,20 @@ Task::move_thread(int new_thread_id)
         add_pending(false);
 }
 
+bool
+Task::profile_fire()
+{
+    // see Router::set_profile_interval
+    Router::ProfileSample ps(_owner->router());
+    bool work_done;
+    if (!_hook)
+        work_done = ((Element*)_thunk)->run_task(this);
+    else
+        work_done = _hook(this, _thunk);
+    ps.finish(_owner, 0, 0);
+    return work_done;
+}
+
 void
 Task::process_pending(RouterThread* thread)
 {
@@ -267,6 +267,13 @@ Timer::schedule_at_steady(const Timestamp &when)
     _expiry_s = when ? when : Timestamp::epsilon();
     ts.check_timer_expiry(this);
 
+    if (ts._wheel_slots) {
+	if (ts.wheel_schedule(this))
+	    _thread->wake();
+	ts.unlock_timers();
+	return;
+    }
+
     // manipulate list; this is essentially a "decrease-key" operation
     // any reschedule removes a timer from the runchunk (XXX -- even backwards
     // reschedulings)
@@ -305,6 +312,11 @@ Timer::unschedule()
 	return;
     TimerSet &ts = _thread->timer_set();
     ts.lock_timers();
+    if (ts._wheel_slots) {
+	ts.wheel_unschedule(this);
+	ts.unlock_timers();
+	return;
+    }
     int old_schedpos1 = _schedpos1;
     if (_schedpos1 > 0) {
 	remove_heap<4>(ts._timer_heap.begin(), ts._timer_heap.end(),
@@ -48,6 +48,15 @@ TimerSet::TimerSet()
 #endif
     _timer_check = Timestamp::now_steady();
     _timer_check_reports = 0;
+
+    _wheel_slots = 0;
+    _wheel_tick = 0;
+    _wheel_count = 0;
+}
+
+TimerSet::~TimerSet()
+{
+    delete[] _wheel_slots;
 }
 
 void
@@ -55,6 +64,16 @@ TimerSet::kill_router(Router *router)
 {
     lock_timers();
     assert(!_timer_runchunk.size());
+    if (_wheel_slots)
+	for (int slot = 0; slot < wheel_nslots; ++slot) {
+	    Timer **pprev = &_wheel_slots[slot];
+	    while (Timer *t = *pprev)
+		if (t->router() == router) {
+		    wheel_unlink(t);
+		    t->_owner = 0;
+		} else
+		    pprev = &t->_wheel_next;
+	}
     for (heap_element *thp = _timer_heap.end();
 	 thp > _timer_heap.begin(); ) {
 	--thp;
@@ -78,6 +97,53 @@ TimerSet::set_max_timer_stride(unsigned timer_stride)
 	_timer_stride = _max_timer_stride;
 }
 
+/** @brief Select this thread's timer data structure.
+ *
+ * By default, timers are kept in a heap, which makes scheduling O(log n).
+ * If @a wheel is true, timers are kept in a hashed hierarchical timing wheel
+ * instead, which makes scheduling and unscheduling O(1) at the cost of
+ * millisecond bucketing; timers still fire in expiry order.  Scheduled
+ * timers move to the new structure. */
+void
+TimerSet::set_timer_wheel(bool wheel)
+{
+    lock_timers();
+    if (wheel != (_wheel_slots != 0)) {
+	Vector<Timer *> timers;
+	if (_wheel_slots) {
+	    for (int slot = 0; slot < wheel_nslots; ++slot)
+		while (Timer *t = _wheel_slots[slot]) {
+		    wheel_unlink(t);
+		    timers.push_back(t);
+		}
+	    delete[] _wheel_slots;
+	    _wheel_slots = 0;
+	} else {
+	    for (heap_element *thp = _timer_heap.begin();
+		 thp != _timer_heap.end(); ++thp)
+		timers.push_back(thp->t);
+	    _timer_heap.clear();
+	    _wheel_slots = new Timer *[wheel_nslots];
+	    memset(_wheel_slots, 0, sizeof(Timer *) * wheel_nslots);
+	    memset(_wheel_bitmap, 0, sizeof(_wheel_bitmap));
+	    _wheel_count = 0;
+	    _wheel_tick = Timestamp::recent_steady().msecval();
+	}
+
+	for (Timer **tp = timers.begin(); tp != timers.end(); ++tp)
+	    if (_wheel_slots)
+		wheel_link(*tp);
+	    else {
+		(*tp)->_schedpos1 = _timer_heap.size() + 1;
+		_timer_heap.push_back(heap_element(*tp));
+		push_heap<4>(_timer_heap.begin(), _timer_heap.end(),
+			     heap_less(), heap_place());
+	    }
+	set_timer_expiry();
+    }
+    unlock_timers();
+}
+
 void
 TimerSet::check_timer_expiry(Timer *t)
 {
@@ -110,12 +176,56 @@ TimerSet::run_one_timer(Timer *t)
 #endif
 }
 
+inline void
+TimerSet::adjust_timer_stride(const Timestamp &first_expiry)
+{
+    Timestamp adj_expiry = first_expiry + Timer::adjustment();
+    if (adj_expiry <= _timer_check) {
+	_timer_count = 0;
+	if (_timer_stride > 1)
+	    _timer_stride = (_timer_stride * 4) / 5;
+    } else if (++_timer_count >= 12) {
+	_timer_count = 0;
+	if (++_timer_stride >= _max_timer_stride)
+	    _timer_stride = _max_timer_stride;
+    }
+}
+
+void
+TimerSet::run_timer_runchunk(RouterThread *thread)
+{
+    Vector<Timer*>::iterator i = _timer_runchunk.begin();
+    for (; !thread->stop_flag() && i != _timer_runchunk.end(); ++i)
+	if (*i) {
+	    (*i)->_schedpos1 = 0;
+	    run_one_timer(*i);
+	}
+
+    // reschedule unrun timers if stopped early
+    for (; i != _timer_runchunk.end(); ++i)
+	if (*i) {
+	    (*i)->_schedpos1 = 0;
+	    (*i)->schedule_at_steady((*i)->_expiry_s);
+	}
+    _timer_runchunk.clear();
+}
+
+static int
+timer_expiry_compare(const void *ap, const void *bp, void *)
+{
+    const Timer *a = *static_cast<Timer * const *>(ap);
+    const Timer *b = *static_cast<Timer * const *>(bp);
+    const Timestamp &ae = a->expiry_steady(), &be = b->expiry_steady();
+    return ae < be ? -1 : (be < ae ? 1 : 0);
+}
+
 void
 TimerSet::run_timers(RouterThread *thread, Master *master)
 {
     if (!_timer_lock.attempt())
 	return;
-    if (!master->paused() && _timer_heap.size() > 0 && !thread->stop_flag()) {
+    if (!master->paused() && (_timer_heap.size() > 0 || _wheel_count > 0)
+	&& !thread->stop_flag()) {
 	thread->set_thread_state(RouterThread::S_RUNTIMER);
 #if CLICK_LINUXMODULE
 	_timer_task = current;
@@ -123,20 +233,27 @@ TimerSet::run_timers(RouterThread *thread, Master *master)
 	_timer_processor = click_current_processor();
 #endif
 	_timer_check = Timestamp::now_steady();
-	heap_element *th = _timer_heap.begin();
 
-	if (th->expiry_s <= _timer_check) {
-	    // potentially adjust timer stride
-	    Timestamp adj_expiry = th->expiry_s + Timer::adjustment();
-	    if (adj_expiry <= _timer_check) {
-		_timer_count = 0;
-		if (_timer_stride > 1)
-		    _timer_stride = (_timer_stride * 4) / 5;
-	    } else if (++_timer_count >= 12) {
-		_timer_count = 0;
-		if (++_timer_stride >= _max_timer_stride)
-		    _timer_stride = _max_timer_stride;
+	if (_wheel_slots) {
+	    // Move expired timers to the runchunk, then run them in expiry
+	    // order.  Timers they schedule wait for the next call.
+	    if (_timer_expiry <= _timer_check) {
+		wheel_collect();
+		if (int n = _timer_runchunk.size()) {
+		    click_qsort(_timer_runchunk.begin(), n, sizeof(Timer *),
+				timer_expiry_compare, 0);
+		    for (int i = 0; i < n; ++i)
+			_timer_runchunk[i]->_schedpos1 = -i - 1;
+		    adjust_timer_stride(_timer_runchunk[0]->_expiry_s);
+		    run_timer_runchunk(thread);
+		}
+		set_timer_expiry();
 	    }
+	} else if (_timer_heap.begin()->expiry_s <= _timer_check) {
+	    heap_element *th = _timer_heap.begin();
+
+	    // potentially adjust timer stride
+	    adjust_timer_stride(th->expiry_s);
 
 	    // actually run timers
 	    int max_timers = 64;
@@ -170,21 +287,7 @@ TimerSet::run_timers(RouterThread *thread, Master *master)
 		} while (_timer_heap.size() > 0
 			 && (th = _timer_heap.begin(), th->expiry_s <= _timer_check));
 		set_timer_expiry();
-
-		Vector<Timer*>::iterator i = _timer_runchunk.begin();
-		for (; !thread->stop_flag() && i != _timer_runchunk.end(); ++i)
-		    if (*i) {
-			(*i)->_schedpos1 = 0;
-			run_one_timer(*i);
-		    }
-
-		// reschedule unrun timers if stopped early
-		for (; i != _timer_runchunk.end(); ++i)
-		    if (*i) {
-			(*i)->_schedpos1 = 0;
-			(*i)->schedule_at_steady((*i)->_expiry_s);
-		    }
-		_timer_runchunk.clear();
+		run_timer_runchunk(thread);
 	    }
 	}
 
@@ -197,4 +300,265 @@ TimerSet::run_timers(RouterThread *thread, Master *master)
     _timer_lock.release();
 }
 
+
+// Timing wheel.  A timer due at tick T (its expiry in milliseconds) lives
+// on the lowest level whose span covers T - _wheel_tick, in the slot
+// selected by the corresponding bits of T.  When _wheel_tick enters a new
+// turn of level L, the matching level L+1 slot is "cascaded": its timers
+// are reinserted, landing on lower levels.  A timer whose tick has passed
+// goes in the current level-0 slot.
+
+static inline uint64_t
+wheel_tick(const Timestamp &t)
+{
+    return t.sec() < 0 ? 0 : t.msecval();
+}
+
+/** @brief Return the slot for a timer due at @a tick. */
+inline int
+TimerSet::wheel_slot(uint64_t tick) const
+{
+    if (tick < _wheel_tick)
+	tick = _wheel_tick;
+    uint64_t delta = tick - _wheel_tick;
+    if (delta < wheel_size0)
+	return tick & (wheel_size0 - 1);
+    int shift = wheel_bits0, base = wheel_size0;
+    for (int level = 1; level < wheel_levels - 1; ++level) {
+	if (delta < (uint64_t(1) << (shift + wheel_bits)))
+	    break;
+	shift += wheel_bits;
+	base += wheel_size;
+    }
+    // Park timers beyond the wheel's range in its farthest slot; they will
+    // be reinserted when that slot cascades.
+    if (delta >= (uint64_t(1) << (shift + wheel_bits)))
+	tick = _wheel_tick + (uint64_t(1) << (shift + wheel_bits)) - 1;
+    return base + ((tick >> shift) & (wheel_size - 1));
+}
+
+/** @brief Return the first nonempty level-0 slot at or after @a idx, or -1. */
+inline int
+TimerSet::wheel_find(unsigned idx) const
+{
+    for (unsigned w = idx / 64; w < wheel_size0 / 64; ++w) {
+	uint64_t bits = _wheel_bitmap[w];
+	if (w == idx / 64)
+	    bits &= ~uint64_t(0) << (idx % 64);
+	if (bits)
+	    return w * 64 + ffs_lsb(bits) - 1;
+    }
+    return -1;
+}
+
+inline void
+TimerSet::wheel_link(Timer *t)
+{
+    int slot = wheel_slot(wheel_tick(t->_expiry_s));
+    Timer **pprev = &_wheel_slots[slot];
+    if ((t->_wheel_next = *pprev))
+	t->_wheel_next->_wheel_pprev = &t->_wheel_next;
+    *pprev = t;
+    t->_wheel_pprev = pprev;
+    t->_schedpos1 = slot + 1;
+    _wheel_bitmap[slot / 64] |= uint64_t(1) << (slot % 64);
+    ++_wheel_count;
+}
+
+inline void
+TimerSet::wheel_unlink(Timer *t)
+{
+    int slot = t->_schedpos1 - 1;
+    if ((*t->_wheel_pprev = t->_wheel_next))
+	t->_wheel_next->_wheel_pprev = t->_wheel_pprev;
+    if (!_wheel_slots[slot])
+	_wheel_bitmap[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+    t->_schedpos1 = 0;
+    --_wheel_count;
+}
+
+/** @brief Return the next tick at which a nonempty slot cascades.
+
+    Only meaningful when the rest of the current level-0 turn is empty.
+    Level-0 timers in earlier slots belong to the next turn, so their
+    presence makes the end of this turn the answer. */
+uint64_t
+TimerSet::wheel_next_cascade() const
+{
+    static_assert(wheel_size == 64, "one bitmap word per upper level");
+    uint64_t next = ~uint64_t(0);
+    for (int w = 0; w < wheel_size0 / 64; ++w)
+	if (_wheel_bitmap[w]) {
+	    next = (_wheel_tick | (wheel_size0 - 1)) + 1;
+	    break;
+	}
+    int shift = wheel_bits0;
+    for (int level = 1; level < wheel_levels; ++level, shift += wheel_bits)
+	if (uint64_t bits = _wheel_bitmap[wheel_size0 / 64 + level - 1]) {
+	    // Rotate so bit 0 is the slot after the current one; the
+	    // current slot itself comes a full turn later.
+	    unsigned r = (((_wheel_tick >> shift) + 1) & (wheel_size - 1));
+	    if (r)
+		bits = (bits >> r) | (bits << (64 - r));
+	    uint64_t t = ((_wheel_tick >> shift) + ffs_lsb(bits)) << shift;
+	    if (t < next)
+		next = t;
+	}
+    return next;
+}
+
+/** @brief Cascade the upper-level slots that start at _wheel_tick.
+    @pre _wheel_tick is a multiple of wheel_size0 */
+void
+TimerSet::wheel_cascade()
+{
+    int shift = wheel_bits0, base = wheel_size0;
+    for (int level = 1; level < wheel_levels; ++level) {
+	unsigned idx = (_wheel_tick >> shift) & (wheel_size - 1);
+	int slot = base + idx;
+	Timer *t = _wheel_slots[slot];
+	_wheel_slots[slot] = 0;
+	_wheel_bitmap[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+	while (t) {
+	    Timer *next = t->_wheel_next;
+	    --_wheel_count;
+	    wheel_link(t);
+	    t = next;
+	}
+	if (idx)
+	    break;
+	shift += wheel_bits;
+	base += wheel_size;
+    }
+}
+
+/** @brief Move a level-0 slot's timers to the runchunk.
+
+    If @a partial, only timers that have expired by _timer_check move. */
+void
+TimerSet::wheel_collect_slot(int slot, bool partial)
+{
+    Timer **pprev = &_wheel_slots[slot];
+    while (Timer *t = *pprev)
+	if (partial && _timer_check < t->_expiry_s)
+	    pprev = &t->_wheel_next;
+	else {
+	    wheel_unlink(t);
+	    t->_schedpos1 = -_timer_runchunk.size() - 1;
+	    _timer_runchunk.push_back(t);
+	}
+}
+
+/** @brief Advance the wheel to _timer_check, collecting expired timers. */
+void
+TimerSet::wheel_collect()
+{
+    uint64_t now_tick = wheel_tick(_timer_check);
+    while (_wheel_count) {
+	unsigned idx = _wheel_tick & (wheel_size0 - 1);
+	int s = wheel_find(idx);
+	uint64_t next = (s >= 0 ? _wheel_tick + (s - idx) : wheel_next_cascade());
+	if (next > now_tick) {
+	    // Nothing more is due, except perhaps late-scheduled timers in
+	    // the current slot if next_timer() moved the wheel ahead.
+	    if (s == (int) idx)
+		wheel_collect_slot(s, true);
+	    else if (_wheel_tick < now_tick)
+		_wheel_tick = now_tick;
+	    break;
+	}
+	_wheel_tick = next;
+	if (s < 0)
+	    wheel_cascade();
+	else if (next == now_tick) {
+	    wheel_collect_slot(s, true);
+	    break;
+	} else {
+	    wheel_collect_slot(s, false);
+	    if (!(++_wheel_tick & (wheel_size0 - 1)))
+		wheel_cascade();
+	}
+    }
+}
+
+/** @brief Return a lower bound on the earliest timer expiry.
+
+    The bound is exact if a timer is due in the current level-0 turn. */
+Timestamp
+TimerSet::wheel_expiry() const
+{
+    if (!_wheel_count)
+	return Timestamp();
+    int s = wheel_find(_wheel_tick & (wheel_size0 - 1));
+    if (s < 0)
+	return Timestamp::make_msec(wheel_next_cascade());
+    Timer *t = _wheel_slots[s];
+    Timestamp e = t->_expiry_s;
+    for (t = t->_wheel_next; t; t = t->_wheel_next)
+	if (t->_expiry_s < e)
+	    e = t->_expiry_s;
+    return e;
+}
+
+/** @brief Return the timer with the earliest expiry.
+
+    Cascades as necessary, which may move the wheel ahead of the clock.
+    That is harmless, but makes later scheduling less efficient; this
+    function is meant for benchmarks. */
+Timer *
+TimerSet::wheel_first()
+{
+    while (_wheel_count) {
+	int s = wheel_find(_wheel_tick & (wheel_size0 - 1));
+	if (s >= 0) {
+	    Timer *first = _wheel_slots[s];
+	    for (Timer *t = first->_wheel_next; t; t = t->_wheel_next)
+		if (t->_expiry_s < first->_expiry_s)
+		    first = t;
+	    return first;
+	}
+	_wheel_tick = wheel_next_cascade();
+	wheel_cascade();
+    }
+    return 0;
+}
+
+/** @brief Schedule @a t on the wheel at its current expiry.
+
+    Returns true iff @a t is now the earliest timer, so the thread should
+    wake up. */
+bool
+TimerSet::wheel_schedule(Timer *t)
+{
+    if (t->_schedpos1 > 0)
+	wheel_unlink(t);
+    else if (t->_schedpos1 < 0)
+	_timer_runchunk[-t->_schedpos1 - 1] = 0;
+    if (!_wheel_count)
+	_wheel_tick = wheel_tick(Timestamp::recent_steady());
+    wheel_link(t);
+    if (!_timer_expiry || t->_expiry_s < _timer_expiry) {
+	_timer_expiry = t->_expiry_s;
+	return true;
+    }
+    return false;
+}
+
+/** @brief Remove @a t from the wheel or runchunk.
+
+    Leaves _timer_expiry alone unless the wheel empties; a stale, early
+    expiry only causes a spurious run_timers(). */
+void
+TimerSet::wheel_unschedule(Timer *t)
+{
+    if (t->_schedpos1 > 0) {
+	wheel_unlink(t);
+	if (!_wheel_count)
+	    _timer_expiry = Timestamp();
+    } else if (t->_schedpos1 < 0) {
+	_timer_runchunk[-t->_schedpos1 - 1] = 0;
+	t->_schedpos1 = 0;
+    }
+}
+
 CLICK_ENDDECLS
@@ -82,6 +82,8 @@ CLICK_USING_DECLS
 #define SOCKET_OPT              318
 #define THREADS_AFF_OPT         319
 #define DPDK_OPT                320
+#define PACKET_ARENA_OPT        321
+#define TIMER_WHEEL_OPT         322
 
 static const Clp_Option options[] = {
     { "allow-reconfigure", 'R', ALLOW_RECONFIG_OPT, 0, Clp_Negate },
@@ -92,6 +94,7 @@ static const Clp_Option options[] = {
     { "handler", 'h', HANDLER_OPT, Clp_ValString, 0 },
     { "help", 0, HELP_OPT, 0, 0 },
     { "output", 'o', OUTPUT_OPT, Clp_ValString, 0 },
+    { "packet-arena", 0, PACKET_ARENA_OPT, 0, Clp_Negate },
     { "socket", 0, SOCKET_OPT, Clp_ValInt, 0 },
     { "port", 'p', PORT_OPT, Clp_ValString, 0 },
     { "quit", 'q', QUIT_OPT, 0, 0 },
@@ -101,6 +104,7 @@ static const Clp_Option options[] = {
     { "cpu", 0, THREADS_AFF_OPT, Clp_ValInt, Clp_Optional | Clp_Negate },
     { "affinity", 'a', THREADS_AFF_OPT, Clp_ValInt, Clp_Optional | Clp_Negate },
     { "time", 't', TIME_OPT, 0, 0 },
+    { "timer-wheel", 0, TIMER_WHEEL_OPT, 0, Clp_Negate },
     { "unix-socket", 'u', UNIX_SOCKET_OPT, Clp_ValString, 0 },
     { "version", 'v', VERSION_OPT, 0, 0 },
     { "warnings", 0, WARNINGS_OPT, 0, Clp_Negate },
@@ -140,7 +144,13 @@ Options:\n\
     printf("\
   -a, --affinity[=N]            Pin threads to CPUs starting at #N (default 0).\n");
 #endif
+#if HAVE_CLICK_PACKET_ARENA
     printf("\
+      --packet-arena            Allocate packet buffers from per-thread\n\
+                                hugepage regions on the local NUMA node.\n");
+#endif
+    printf("\
+      --timer-wheel             Keep timers in timing wheels, not heaps.\n\
   -p, --port PORT               Listen for control connections on TCP port.\n\
   -u, --unix-socket FILE        Listen for control connections on Unix socket.\n\
       --socket FD               Add a file descriptor control connection.\n\
@@ -530,6 +540,7 @@ main(int argc, char **argv)
   bool quit_immediately = false;
   bool report_time = false;
   bool allow_reconfigure = false;
+  bool timer_wheel = false;
   Vector<String> handlers;
   String exit_handler;
   Vector<char*> dpdk_arg;
@@ -648,6 +659,18 @@ main(int argc, char **argv)
 #endif
       break;
 
+     case PACKET_ARENA_OPT:
+#if HAVE_CLICK_PACKET_ARENA
+      Packet::set_packet_arena(!clp->negated);
+#else
+      errh->warning("Click was built without packet arena support");
+#endif
+      break;
+
+     case TIMER_WHEEL_OPT:
+      timer_wheel = !clp->negated;
+      break;
+
      case THREADS_AFF_OPT:
 #if HAVE_DECL_PTHREAD_SETAFFINITY_NP
       if (clp->negated)
@@ -727,6 +750,9 @@ particular purpose.\n");
 
   // parse configuration
   click_master = new Master(click_nthreads);
+  if (timer_wheel)
+      for (int t = 0; t < click_nthreads; ++t)
+          click_master->thread(t)->timer_set().set_timer_wheel(true);
   click_router = parse_configuration(router_file, file_is_expr, false, errh);
   if (!click_router)
     return cleanup(clp, 1);